@@ -0,0 +1,257 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import java.nio.channels.SelectableChannel;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * A lightweight thread of control, run by a {@link FiberScheduler}
+ * on one of a small, fixed pool of carrier threads.
+ *
+ * <p>A fiber which blocks by calling one of the static methods of
+ * this class ({@link #park}, {@link #sleep}, {@link #await} or
+ * {@link #yield}) captures its continuation and gives its carrier
+ * back to the scheduler, which may later resume it on any carrier.
+ * A fiber which blocks any other way (e.g. <code>Object.wait</code>,
+ * <code>Thread.sleep</code> or a blocking socket read) blocks its
+ * carrier along with it.
+ *
+ * <p>As described in {@link Continuations}, unwinding a continuation
+ * does not release monitors, so a fiber must not hold a monitor
+ * across any of the blocking methods above.  Likewise,
+ * <code>Thread.currentThread()</code> returns the carrier, which may
+ * change each time the fiber blocks.
+ *
+ * <p>Fibers require a VM built with continuation support.
+ */
+public class Fiber {
+  final FiberScheduler scheduler;
+  private final Runnable task;
+
+  // the following are guarded by this:
+  private Callback<Object> continuation;
+  private boolean parked;
+  private boolean permit;
+  private boolean done;
+  private Throwable exception;
+  private List<Fiber> joiners;
+
+  Fiber(FiberScheduler scheduler, Runnable task) {
+    this.scheduler = scheduler;
+    this.task = task;
+  }
+
+  /**
+   * Returns the fiber running on the current thread, or null if the
+   * current thread is not a carrier.
+   */
+  public static Fiber current() {
+    FiberScheduler.Carrier carrier = FiberScheduler.currentCarrier();
+    return carrier == null ? null : carrier.fiber;
+  }
+
+  private static Fiber currentOrFail() {
+    Fiber f = current();
+    if (f == null) {
+      throw new IllegalStateException("not running in a fiber");
+    }
+    return f;
+  }
+
+  /**
+   * Suspends the current fiber until another thread or fiber calls
+   * {@link #unpark} on it, or returns immediately if that has already
+   * happened since the last call to this method.  As with
+   * <code>LockSupport.park</code>, callers should recheck whatever
+   * condition they are waiting for when this returns.
+   */
+  public static void park() {
+    Fiber f = currentOrFail();
+
+    synchronized (f) {
+      if (f.permit) {
+        f.permit = false;
+        return;
+      }
+    }
+
+    f.block(false);
+  }
+
+  /**
+   * Lets other runnable fibers run before continuing.
+   */
+  public static void yield() {
+    currentOrFail().block(true);
+  }
+
+  /**
+   * Suspends the current fiber for at least the specified number of
+   * milliseconds.
+   */
+  public static void sleep(long milliseconds) {
+    Fiber f = currentOrFail();
+    FiberScheduler.Timer timer = f.scheduler.poller().sleep(f, milliseconds);
+    while (! timer.fired) {
+      park();
+    }
+  }
+
+  /**
+   * Suspends the current fiber until the specified channel, which
+   * must be in non-blocking mode, is ready for at least one of the
+   * specified operations (a combination of the
+   * <code>SelectionKey.OP_*</code> constants).  Returns the
+   * operations for which it is ready.
+   */
+  public static int await(SelectableChannel channel, int operations) {
+    Fiber f = currentOrFail();
+    FiberScheduler.Wait wait = f.scheduler.poller().await
+      (f, channel, operations);
+    while (wait.readyOperations == 0) {
+      park();
+    }
+    return wait.readyOperations;
+  }
+
+  /**
+   * Makes this fiber runnable if it is parked, or otherwise ensures
+   * its next call to {@link #park} will return immediately.
+   */
+  public void unpark() {
+    synchronized (this) {
+      if (parked) {
+        parked = false;
+      } else {
+        permit = true;
+        return;
+      }
+    }
+
+    scheduler.schedule(this);
+  }
+
+  /**
+   * Waits for this fiber to finish.  If the current thread is running
+   * a fiber, only that fiber is suspended, not its carrier.
+   */
+  public void join() throws InterruptedException {
+    Fiber current = current();
+    if (current == null) {
+      synchronized (this) {
+        while (! done) {
+          wait();
+        }
+      }
+    } else {
+      synchronized (this) {
+        if (done) {
+          return;
+        }
+
+        if (joiners == null) {
+          joiners = new ArrayList();
+        }
+        joiners.add(current);
+      }
+
+      while (! isDone()) {
+        park();
+      }
+    }
+  }
+
+  public synchronized boolean isDone() {
+    return done;
+  }
+
+  /**
+   * Returns the exception which terminated this fiber, if any.
+   */
+  public synchronized Throwable exception() {
+    return exception;
+  }
+
+  Callback<Object> takeContinuation() {
+    synchronized (this) {
+      Callback<Object> c = continuation;
+      continuation = null;
+      return c;
+    }
+  }
+
+  private void block(final boolean reschedule) {
+    try {
+      Continuations.callWithCurrentContinuation
+        (new CallbackReceiver<Object>() {
+          public Object receive(Callback<Object> continuation) {
+            suspend(continuation, reschedule);
+            FiberScheduler.currentCarrier().back.handleResult(null);
+            throw new AssertionError();
+          }
+        });
+    } catch (RuntimeException e) {
+      throw e;
+    } catch (Exception e) {
+      throw new RuntimeException(e);
+    }
+  }
+
+  private void suspend(Callback<Object> continuation, boolean reschedule) {
+    synchronized (this) {
+      this.continuation = continuation;
+      if (reschedule) {
+        // yielding
+      } else if (permit) {
+        // we were unparked while capturing the continuation
+        permit = false;
+      } else {
+        parked = true;
+        return;
+      }
+    }
+
+    scheduler.schedule(this);
+  }
+
+  void run() {
+    Throwable exception = null;
+    try {
+      task.run();
+    } catch (Throwable e) {
+      exception = e;
+    }
+
+    List<Fiber> joiners;
+    synchronized (this) {
+      this.exception = exception;
+      done = true;
+      joiners = this.joiners;
+      this.joiners = null;
+      notifyAll();
+    }
+
+    if (joiners != null) {
+      for (Fiber f: joiners) {
+        f.unpark();
+      }
+    }
+
+    scheduler.finished(this);
+
+    // this fiber may have started on a different carrier than the one
+    // it is finishing on, so we must not return into the frames which
+    // started it
+    FiberScheduler.currentCarrier().back.handleResult(null);
+  }
+}
@@ -0,0 +1,420 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import java.io.IOException;
+import java.nio.channels.SelectableChannel;
+import java.nio.channels.SelectionKey;
+import java.nio.channels.Selector;
+import java.util.ArrayList;
+import java.util.Comparator;
+import java.util.Iterator;
+import java.util.LinkedList;
+import java.util.List;
+import java.util.TreeSet;
+
+/**
+ * Runs {@link Fiber}s over a fixed pool of carrier threads.
+ *
+ * <p>Each carrier keeps a queue of runnable fibers.  Fibers made
+ * runnable by a carrier go on that carrier's queue, and those made
+ * runnable by any other thread go on a shared queue.  A carrier whose
+ * own queue is empty takes from the shared queue, and failing that
+ * steals from the far end of another carrier's queue.
+ *
+ * <p>Sleeping fibers and fibers waiting for channels are tracked by a
+ * single poller thread, started on first use, which unparks them when
+ * their timers expire or their channels become ready.
+ */
+public class FiberScheduler {
+  private final Carrier[] carriers;
+  private final LinkedList<Fiber> shared = new LinkedList();
+  private final Object lock = new Object();
+
+  // the following are guarded by lock:
+  private long signals;
+  private int idle;
+  private int live;
+  private boolean shutdown;
+  private Poller poller;
+
+  public FiberScheduler(int carrierCount) {
+    if (carrierCount < 1) throw new IllegalArgumentException();
+
+    carriers = new Carrier[carrierCount];
+    for (int i = 0; i < carrierCount; ++i) {
+      carriers[i] = new Carrier(this, i);
+    }
+
+    for (int i = 0; i < carrierCount; ++i) {
+      carriers[i].start();
+    }
+  }
+
+  /**
+   * Creates a new fiber which will run the specified task.
+   */
+  public Fiber spawn(Runnable task) {
+    Fiber f = new Fiber(this, task);
+
+    synchronized (lock) {
+      if (shutdown) throw new IllegalStateException();
+
+      ++ live;
+    }
+
+    schedule(f);
+
+    return f;
+  }
+
+  /**
+   * Stops the carriers (and the poller) once every fiber spawned so
+   * far has finished.  No more fibers may be spawned after this.
+   */
+  public void shutdown() {
+    synchronized (lock) {
+      shutdown = true;
+      lock.notifyAll();
+      if (poller != null) {
+        poller.selector.wakeup();
+      }
+    }
+  }
+
+  /**
+   * Waits for the carriers to exit after a call to {@link #shutdown}.
+   */
+  public void awaitTermination() throws InterruptedException {
+    for (int i = 0; i < carriers.length; ++i) {
+      carriers[i].join();
+    }
+
+    Poller p;
+    synchronized (lock) {
+      p = poller;
+    }
+    if (p != null) {
+      p.join();
+    }
+  }
+
+  static Carrier currentCarrier() {
+    Thread t = Thread.currentThread();
+    return t instanceof Carrier ? (Carrier) t : null;
+  }
+
+  void schedule(Fiber f) {
+    Carrier c = currentCarrier();
+    if (c != null && c.scheduler == this) {
+      synchronized (c.queue) {
+        c.queue.addLast(f);
+      }
+    } else {
+      synchronized (shared) {
+        shared.addLast(f);
+      }
+    }
+
+    synchronized (lock) {
+      ++ signals;
+      if (idle > 0) {
+        lock.notify();
+      }
+    }
+  }
+
+  void finished(Fiber f) {
+    synchronized (lock) {
+      if (-- live == 0 && shutdown) {
+        lock.notifyAll();
+        if (poller != null) {
+          poller.selector.wakeup();
+        }
+      }
+    }
+  }
+
+  private boolean finished() {
+    return shutdown && live == 0;
+  }
+
+  Poller poller() {
+    synchronized (lock) {
+      if (poller == null) {
+        try {
+          poller = new Poller(this, Selector.open());
+        } catch (IOException e) {
+          throw new RuntimeException(e);
+        }
+        poller.start();
+      }
+      return poller;
+    }
+  }
+
+  private Fiber poll(Carrier c) {
+    synchronized (c.queue) {
+      if (! c.queue.isEmpty()) {
+        return c.queue.removeFirst();
+      }
+    }
+
+    synchronized (shared) {
+      if (! shared.isEmpty()) {
+        return shared.removeFirst();
+      }
+    }
+
+    for (int i = 1; i < carriers.length; ++i) {
+      Carrier victim = carriers[(c.index + i) % carriers.length];
+      synchronized (victim.queue) {
+        if (! victim.queue.isEmpty()) {
+          return victim.queue.removeLast();
+        }
+      }
+    }
+
+    return null;
+  }
+
+  private Fiber next(Carrier c) {
+    while (true) {
+      long seen;
+      synchronized (lock) {
+        seen = signals;
+      }
+
+      Fiber f = poll(c);
+      if (f != null) {
+        return f;
+      }
+
+      synchronized (lock) {
+        if (finished()) {
+          return null;
+        }
+
+        // only sleep if nothing has been scheduled since we looked
+        if (signals == seen) {
+          ++ idle;
+          try {
+            lock.wait();
+          } catch (InterruptedException e) {
+            // ignore
+          } finally {
+            -- idle;
+          }
+        }
+      }
+    }
+  }
+
+  private static void resume(final Carrier carrier, final Fiber f) {
+    carrier.fiber = f;
+
+    try {
+      Continuations.callWithCurrentContinuation
+        (new CallbackReceiver<Object>() {
+          public Object receive(Callback<Object> back) {
+            carrier.back = back;
+
+            Callback<Object> continuation = f.takeContinuation();
+            if (continuation == null) {
+              f.run();
+            } else {
+              continuation.handleResult(null);
+            }
+
+            throw new AssertionError();
+          }
+        });
+    } catch (Exception e) {
+      // fibers catch their own exceptions, so this is a bug
+      throw new RuntimeException(e);
+    }
+
+    carrier.fiber = null;
+    carrier.back = null;
+  }
+
+  static class Carrier extends Thread {
+    final FiberScheduler scheduler;
+    final int index;
+    final LinkedList<Fiber> queue = new LinkedList();
+    Fiber fiber;
+    Callback<Object> back;
+
+    Carrier(FiberScheduler scheduler, int index) {
+      super("fiber carrier " + index);
+      this.scheduler = scheduler;
+      this.index = index;
+      setDaemon(true);
+    }
+
+    public void run() {
+      Fiber f;
+      while ((f = scheduler.next(this)) != null) {
+        resume(this, f);
+      }
+    }
+  }
+
+  static class Timer {
+    final Fiber fiber;
+    // a System.nanoTime value, so changes to the wall clock don't
+    // affect it
+    final long deadline;
+    final long sequence;
+    volatile boolean fired;
+
+    Timer(Fiber fiber, long deadline, long sequence) {
+      this.fiber = fiber;
+      this.deadline = deadline;
+      this.sequence = sequence;
+    }
+  }
+
+  static class Wait {
+    final Fiber fiber;
+    final SelectableChannel channel;
+    final int operations;
+    volatile int readyOperations;
+
+    Wait(Fiber fiber, SelectableChannel channel, int operations) {
+      this.fiber = fiber;
+      this.channel = channel;
+      this.operations = operations;
+    }
+  }
+
+  static class Poller extends Thread {
+    private static final long MaxSleepMillis = 100L * 365 * 24 * 60 * 60 * 1000;
+
+    final FiberScheduler scheduler;
+    final Selector selector;
+
+    // the following are guarded by this:
+    private final TreeSet<Timer> timers = new TreeSet
+      (new Comparator<Timer>() {
+        public int compare(Timer a, Timer b) {
+          // nanoTime values may wrap, so only their difference is
+          // meaningful
+          long difference = a.deadline - b.deadline;
+          if (difference != 0) {
+            return difference < 0 ? -1 : 1;
+          } else if (a.sequence != b.sequence) {
+            return a.sequence < b.sequence ? -1 : 1;
+          } else {
+            return 0;
+          }
+        }
+      });
+    private List<Wait> pending = new ArrayList();
+    private long sequence;
+
+    Poller(FiberScheduler scheduler, Selector selector) {
+      super("fiber poller");
+      this.scheduler = scheduler;
+      this.selector = selector;
+      setDaemon(true);
+    }
+
+    Timer sleep(Fiber f, long milliseconds) {
+      // pretend anything greater than one hundred years is infinity so
+      // as to avoid overflow
+      long nanoseconds = Math.min(Math.max(0, milliseconds), MaxSleepMillis)
+        * 1000 * 1000;
+
+      Timer t;
+      synchronized (this) {
+        t = new Timer(f, System.nanoTime() + nanoseconds, sequence++);
+        timers.add(t);
+      }
+      selector.wakeup();
+      return t;
+    }
+
+    Wait await(Fiber f, SelectableChannel channel, int operations) {
+      Wait w = new Wait(f, channel, operations);
+      synchronized (this) {
+        pending.add(w);
+      }
+      selector.wakeup();
+      return w;
+    }
+
+    public void run() {
+      List<Timer> expired = new ArrayList();
+
+      try {
+        while (true) {
+          synchronized (scheduler.lock) {
+            if (scheduler.finished()) {
+              break;
+            }
+          }
+
+          List<Wait> waits;
+          long timeout = 0;
+          long now = System.nanoTime();
+          synchronized (this) {
+            waits = pending;
+            pending = new ArrayList();
+
+            while (! timers.isEmpty()) {
+              Timer t = timers.first();
+              long remaining = t.deadline - now;
+              if (remaining <= 0) {
+                expired.add(t);
+                timers.remove(t);
+              } else {
+                // round up, so we never wake early or pass zero
+                timeout = (remaining + (1000 * 1000) - 1) / (1000 * 1000);
+                break;
+              }
+            }
+          }
+
+          for (Timer t: expired) {
+            t.fired = true;
+            t.fiber.unpark();
+          }
+          expired.clear();
+
+          for (Wait w: waits) {
+            w.channel.register(selector, w.operations, w);
+          }
+
+          // a timeout of zero means wait indefinitely
+          selector.select(timeout);
+
+          for (Iterator<SelectionKey> it = selector.selectedKeys().iterator();
+               it.hasNext();)
+          {
+            SelectionKey key = it.next();
+            Wait w = (Wait) key.attachment();
+
+            // registrations are one-shot
+            selector.remove(key);
+
+            w.readyOperations = key.readyOps();
+            w.fiber.unpark();
+          }
+        }
+      } catch (IOException e) {
+        e.printStackTrace();
+      } finally {
+        selector.close();
+      }
+    }
+  }
+}
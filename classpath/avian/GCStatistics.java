@@ -0,0 +1,62 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+/**
+ * Snapshot of the garbage collector's counters, as returned by
+ * Machine.getGCStatistics.  Times are in nanoseconds and sizes in
+ * bytes.  Occupancy figures reflect the end of the most recent
+ * collection.
+ */
+public class GCStatistics {
+  public final long minorCollections;
+  public final long majorCollections;
+  public final long totalPauseTime;
+  public final long maxPauseTime;
+  public final long lastPauseTime;
+  public final long promotedBytes;
+  public final long gen1Bytes;
+  public final long gen1Capacity;
+  public final long gen2Bytes;
+  public final long gen2Capacity;
+  public final long untenuredFixieBytes;
+  public final long tenuredFixieBytes;
+  public final long footprint;
+  public final long limit;
+
+  /**
+   * pauseHistogram[i] counts collections which took less than 2^i
+   * microseconds, except for the last element, which counts the
+   * rest.
+   */
+  public final long[] pauseHistogram;
+
+  GCStatistics(long[] values) {
+    int i = 0;
+    minorCollections = values[i++];
+    majorCollections = values[i++];
+    totalPauseTime = values[i++];
+    maxPauseTime = values[i++];
+    lastPauseTime = values[i++];
+    promotedBytes = values[i++];
+    gen1Bytes = values[i++];
+    gen1Capacity = values[i++];
+    gen2Bytes = values[i++];
+    gen2Capacity = values[i++];
+    untenuredFixieBytes = values[i++];
+    tenuredFixieBytes = values[i++];
+    footprint = values[i++];
+    limit = values[i++];
+
+    pauseHistogram = new long[values.length - i];
+    System.arraycopy(values, i, pauseHistogram, 0, pauseHistogram.length);
+  }
+}
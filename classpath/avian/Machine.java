@@ -10,6 +10,7 @@
 
 package avian;
 
+import java.io.IOException;
 import sun.misc.Unsafe;
 
 public abstract class Machine {
@@ -18,6 +19,73 @@ public abstract class Machine {
 
   public static native void dumpHeap(String outputFile);
 
+  private static native long[] gcStatistics();
+
+  public static GCStatistics getGCStatistics() {
+    return new GCStatistics(gcStatistics());
+  }
+
+  private static native long[] safepointStatistics();
+
+  public static SafepointStatistics getSafepointStatistics() {
+    return new SafepointStatistics(safepointStatistics());
+  }
+
+  /**
+   * Starts the sampling profiler, which captures the stacks of all
+   * other threads running Java code every <code>intervalMillis</code>
+   * milliseconds.  Threads which are blocked, waiting, sleeping or in
+   * native code are not sampled.  If
+   * <code>outputFile</code> is non-null, the collected profile is
+   * written there in collapsed stack format when the VM shuts down.
+   */
+  public static void startProfiler(int intervalMillis, String outputFile) {
+    Profiler.start(intervalMillis, outputFile);
+  }
+
+  public static void stopProfiler() {
+    Profiler.stop();
+  }
+
+  /**
+   * Writes the samples collected so far by the running profiler to
+   * <code>outputFile</code> in collapsed stack format.
+   */
+  public static void dumpProfile(String outputFile) throws IOException {
+    Profiler.dump(outputFile);
+  }
+
+  private static void startProfiler() {
+    String interval = System.getProperty("avian.profile.interval");
+    startProfiler(interval == null ? 10 : Integer.parseInt(interval),
+                  System.getProperty("avian.profile"));
+  }
+
+  private static native int precompile();
+
+  /**
+   * Compiles the methods recorded in the JIT profile named by the
+   * avian.jit.profile property on a daemon thread, so that they are
+   * ready before their first use.  Methods whose classes haven't
+   * been initialized yet are retried periodically for a while, since
+   * compiling them would run their static initializers early.
+   */
+  private static void startPrecompiler() {
+    Thread thread = new Thread(new Runnable() {
+        public void run() {
+          for (int i = 0; i < 100 && precompile() != 0; ++i) {
+            try {
+              Thread.sleep(100);
+            } catch (InterruptedException e) {
+              return;
+            }
+          }
+        }
+      }, "avian precompiler");
+    thread.setDaemon(true);
+    thread.start();
+  }
+
   public static Unsafe getUnsafe() {
     return unsafe;
   }
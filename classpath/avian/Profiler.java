@@ -0,0 +1,223 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.PrintStream;
+import java.util.HashMap;
+import java.util.Iterator;
+import java.util.Map;
+
+/**
+ * Sampling CPU profiler.  A daemon thread wakes up periodically and
+ * has the VM sample the stack of every other thread which is running
+ * Java code at that moment; threads which are blocked, waiting,
+ * sleeping or in native code are skipped.  Each sample is recorded
+ * as a list of methods in a buffer belonging to the sampled thread,
+ * without allocating anything, and the buffers are only drained and
+ * aggregated here when one of them fills up or a profile is written.
+ * The result is written in the "collapsed stack" format understood by
+ * flamegraph.pl and similar tools: one line per distinct stack, frames
+ * separated by semicolons from the outermost inwards, followed by a
+ * space and the sample count.
+ */
+class Profiler implements Runnable {
+  private static final Object lock = new Object();
+  private static Profiler current;
+  private static boolean hookInstalled;
+
+  private final Map<String, int[]> counts = new HashMap();
+  private final Object[] buffer = new Object[4096];
+  private final int interval;
+  private final String outputFile;
+  private Thread thread;
+  private volatile boolean running = true;
+
+  private Profiler(int interval, String outputFile) {
+    this.interval = interval;
+    this.outputFile = outputFile;
+  }
+
+  public static void start(int interval, String outputFile) {
+    if (interval <= 0) {
+      throw new IllegalArgumentException("interval must be positive");
+    }
+
+    synchronized (lock) {
+      if (current != null) {
+        throw new IllegalStateException("profiler already running");
+      }
+
+      Profiler p = new Profiler(interval, outputFile);
+      Thread t = new Thread(p, "avian profiler");
+      t.setDaemon(true);
+      p.thread = t;
+      current = p;
+
+      if (outputFile != null && ! hookInstalled) {
+        hookInstalled = true;
+        Runtime.getRuntime().addShutdownHook(new Thread() {
+            public void run() {
+              Profiler p = stop();
+              if (p != null && p.outputFile != null) {
+                try {
+                  p.write(p.outputFile);
+                } catch (IOException e) {
+                  e.printStackTrace();
+                }
+              }
+            }
+          });
+      }
+
+      t.start();
+    }
+  }
+
+  public static Profiler stop() {
+    Profiler p;
+    synchronized (lock) {
+      p = current;
+      current = null;
+    }
+
+    if (p != null) {
+      p.running = false;
+      p.thread.interrupt();
+      try {
+        p.thread.join();
+      } catch (InterruptedException e) {
+        Thread.currentThread().interrupt();
+      }
+
+      // claim the samples taken so far, so that a profiler started
+      // later doesn't see them
+      p.drain();
+    }
+
+    return p;
+  }
+
+  public static void dump(String outputFile) throws IOException {
+    Profiler p;
+    synchronized (lock) {
+      p = current;
+    }
+
+    if (p == null) {
+      throw new IllegalStateException("profiler not running");
+    }
+
+    p.write(outputFile);
+  }
+
+  /**
+   * Samples every other thread running Java code, returning true if
+   * a sample buffer should be drained soon.
+   */
+  private static native boolean sample();
+
+  /**
+   * Moves as many samples as fit into <code>buffer</code>, returning
+   * the number of elements used.  Each sample is written as the
+   * sampled Thread, its methods from the innermost outwards, and a
+   * null.
+   */
+  private static native int drain(Object[] buffer);
+
+  public void run() {
+    while (running) {
+      try {
+        Thread.sleep(interval);
+      } catch (InterruptedException e) {
+        continue;
+      }
+
+      if (sample()) {
+        drain();
+      }
+    }
+  }
+
+  private void drain() {
+    StringBuilder sb = new StringBuilder();
+    synchronized (counts) {
+      int count;
+      while ((count = drain(buffer)) > 0) {
+        for (int i = 0; i < count;) {
+          int start = i;
+          while (buffer[i] != null) {
+            ++ i;
+          }
+
+          sb.setLength(0);
+          sb.append(((Thread) buffer[start]).getName());
+          for (int j = i - 1; j > start; --j) {
+            VMMethod m = (VMMethod) buffer[j];
+            sb.append(';');
+            append(sb, m.class_.name);
+            sb.append('.');
+            append(sb, m.name);
+          }
+
+          record(sb.toString());
+
+          ++ i;
+        }
+
+        for (int i = 0; i < count; ++i) {
+          buffer[i] = null;
+        }
+      }
+    }
+  }
+
+  private static void append(StringBuilder sb, byte[] name) {
+    // names are null-terminated, and class names use '/' as the
+    // package separator
+    for (int i = 0; i < name.length - 1; ++i) {
+      char c = (char) (name[i] & 0xFF);
+      sb.append(c == '/' ? '.' : c);
+    }
+  }
+
+  private void record(String stack) {
+    synchronized (counts) {
+      int[] count = counts.get(stack);
+      if (count == null) {
+        counts.put(stack, new int[] { 1 });
+      } else {
+        ++ count[0];
+      }
+    }
+  }
+
+  private void write(String outputFile) throws IOException {
+    drain();
+
+    PrintStream out = new PrintStream(new FileOutputStream(outputFile));
+    try {
+      synchronized (counts) {
+        for (Iterator<Map.Entry<String, int[]>> it
+               = counts.entrySet().iterator(); it.hasNext();)
+        {
+          Map.Entry<String, int[]> e = it.next();
+          out.print(e.getKey());
+          out.print(' ');
+          out.println(e.getValue()[0]);
+        }
+      }
+    } finally {
+      out.close();
+    }
+  }
+}
@@ -0,0 +1,31 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+/**
+ * Snapshot of the time threads have spent waiting for all other
+ * threads to stop so they could enter the exclusive state (e.g. to
+ * collect garbage), as returned by Machine.getSafepointStatistics.
+ * Times are in nanoseconds.
+ */
+public class SafepointStatistics {
+  public final long count;
+  public final long totalTime;
+  public final long maxTime;
+  public final long lastTime;
+
+  SafepointStatistics(long[] values) {
+    count = values[0];
+    totalTime = values[1];
+    maxTime = values[2];
+    lastTime = values[3];
+  }
+}
@@ -29,4 +29,6 @@ public class VMClass {
   public Object staticTable;
   public ClassLoader loader;
   public byte[] source;
+  public Object[] primarySupers;
+  public VMClass secondarySuperCache;
 }
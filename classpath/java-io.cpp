@@ -30,6 +30,7 @@
 #  define READ _read
 #  define WRITE _write
 #  define STAT _wstat
+#  define FSTAT _fstat
 #  define STRUCT_STAT struct _stat
 #  define MKDIR(path, mode) _wmkdir(path)
 #  define CHMOD(path, mode) _wchmod(path, mode)
@@ -76,6 +77,7 @@ typedef wchar_t char_t;
 #  define READ read
 #  define WRITE write
 #  define STAT stat
+#  define FSTAT fstat
 #  define STRUCT_STAT struct stat
 #  define MKDIR mkdir
 #  define CHMOD chmod
@@ -176,6 +178,30 @@ doWrite(JNIEnv* e, jint fd, const jbyte* data, jint length)
   }
 }
 
+// transfers of up to this many bytes are staged through a buffer on
+// the calling thread's stack instead of touching the array in place
+const jint ScratchSize = 8 * 1024;
+
+// larger transfers to and from regular files use the array body
+// directly, at most this many bytes per critical section so that a
+// long transfer does not hold off garbage collection for its duration
+const jint CriticalChunkSize = 1024 * 1024;
+
+inline bool
+isRegularFile(jint fd)
+{
+  // reads and writes on pipes, sockets and terminals may block
+  // indefinitely, so we must never enter a critical section for them
+  STRUCT_STAT s;
+  return FSTAT(fd, &s) == 0 and S_ISREG(s.st_mode);
+}
+
+inline jint
+minimum(jint a, jint b)
+{
+  return a < b ? a : b;
+}
+
 
 #ifdef PLATFORM_WINDOWS
 
@@ -725,19 +751,36 @@ extern "C" JNIEXPORT jint JNICALL
 Java_java_io_FileInputStream_read__I_3BII
 (JNIEnv* e, jclass, jint fd, jbyteArray b, jint offset, jint length)
 {
-  jbyte* data = static_cast<jbyte*>(malloc(length));
-  if (data == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return 0;    
+  if (offset < 0 or length < 0
+      or length > e->GetArrayLength(b) - offset)
+  {
+    throwNew(e, "java/lang/ArrayIndexOutOfBoundsException", 0);
+    return -1;
   }
 
-  int r = doRead(e, fd, data, length);
-
-  e->SetByteArrayRegion(b, offset, length, data);
-
-  free(data);
-
-  return r;
+  if (length <= ScratchSize or not isRegularFile(fd)) {
+    jbyte data[ScratchSize];
+    int r = doRead(e, fd, data, minimum(length, ScratchSize));
+    if (r > 0) {
+      e->SetByteArrayRegion(b, offset, r, data);
+    }
+    return r;
+  } else {
+    jbyte* data = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(b, 0));
+    int r = READ(fd, data + offset, minimum(length, CriticalChunkSize));
+    int error = errno;
+    e->ReleasePrimitiveArrayCritical(b, data, 0);
+
+    if (r > 0) {
+      return r;
+    } else if (r == 0) {
+      return -1;
+    } else {
+      errno = error;
+      throwNewErrno(e, "java/io/IOException");
+      return 0;
+    }
+  }
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -772,19 +815,41 @@ extern "C" JNIEXPORT void JNICALL
 Java_java_io_FileOutputStream_write__I_3BII
 (JNIEnv* e, jclass, jint fd, jbyteArray b, jint offset, jint length)
 {
-  jbyte* data = static_cast<jbyte*>(malloc(length));
-
-  if (data == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
+  if (offset < 0 or length < 0
+      or length > e->GetArrayLength(b) - offset)
+  {
+    throwNew(e, "java/lang/ArrayIndexOutOfBoundsException", 0);
+    return;
   }
 
-  e->GetByteArrayRegion(b, offset, length, data);
-  if (not e->ExceptionCheck()) {
-    doWrite(e, fd, data, length);
+  if (length <= ScratchSize or not isRegularFile(fd)) {
+    jbyte data[ScratchSize];
+    while (length > 0 and not e->ExceptionCheck()) {
+      jint n = minimum(length, ScratchSize);
+      e->GetByteArrayRegion(b, offset, n, data);
+      if (not e->ExceptionCheck()) {
+        doWrite(e, fd, data, n);
+      }
+      offset += n;
+      length -= n;
+    }
+  } else {
+    while (length > 0) {
+      jint n = minimum(length, CriticalChunkSize);
+      jbyte* data = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(b, 0));
+      int r = WRITE(fd, data + offset, n);
+      int error = errno;
+      e->ReleasePrimitiveArrayCritical(b, data, 0);
+
+      if (r != n) {
+        errno = error;
+        throwNewErrno(e, "java/io/IOException");
+        return;
+      }
+      offset += n;
+      length -= n;
+    }
   }
-
-  free(data);
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -859,8 +924,11 @@ Java_java_io_RandomAccessFile_readBytes(JNIEnv* e, jclass, jlong peer,
   uint8_t* dst = reinterpret_cast<uint8_t*>
     (e->GetPrimitiveArrayCritical(buffer, 0));
 
-  int64_t bytesRead = ::read(fd, dst + offset, length);
+  int64_t bytesRead = ::read
+    (fd, dst + offset, minimum(length, CriticalChunkSize));
+  int error = errno;
   e->ReleasePrimitiveArrayCritical(buffer, dst, 0);
+  errno = error;
   
   if(bytesRead == -1) {
 	throwNewErrno(e, "java/io/IOException");
@@ -879,11 +947,13 @@ Java_java_io_RandomAccessFile_readBytes(JNIEnv* e, jclass, jlong peer,
     (e->GetPrimitiveArrayCritical(buffer, 0));
 
   DWORD bytesRead = 0;
-  if(!ReadFile(hFile, dst + offset, length, &bytesRead, nullptr)) {
+  BOOL success = ReadFile
+    (hFile, dst + offset, minimum(length, CriticalChunkSize), &bytesRead, nullptr);
+  e->ReleasePrimitiveArrayCritical(buffer, dst, 0);
+  if(!success) {
       throwNewErrno(e, "java/io/IOException");
       return -1;
   }
-  e->ReleasePrimitiveArrayCritical(buffer, dst, 0);
 #endif
 
   return (jint)bytesRead;
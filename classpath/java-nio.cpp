@@ -38,6 +38,11 @@
 #  include <sys/socket.h>
 #endif
 
+#ifdef __linux__
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#endif
+
 #define java_nio_channels_SelectionKey_OP_READ 1L
 #define java_nio_channels_SelectionKey_OP_WRITE 4L
 #define java_nio_channels_SelectionKey_OP_CONNECT 8L
@@ -1014,6 +1019,221 @@ Java_java_nio_channels_SocketSelector_natUpdateReadySet(JNIEnv *, jclass,
   return ready;
 }
 
+extern "C" JNIEXPORT jboolean JNICALL
+Java_java_nio_channels_EpollSelector_natSupported(JNIEnv *, jclass)
+{
+#ifdef __linux__
+  return JNI_TRUE;
+#else
+  return JNI_FALSE;
+#endif
+}
+
+#ifdef __linux__
+
+namespace {
+
+// state for the epoll-based selector, which keeps registrations in
+// the kernel across calls to select and uses an eventfd for wakeups
+// instead of a Pipe
+struct EpollState {
+  int epoll;
+  int wakeup;
+};
+
+const unsigned MaxEpollEvents = 1024;
+
+uint32_t
+interestToEvents(jint interest)
+{
+  uint32_t events = 0;
+  if (interest & (java_nio_channels_SelectionKey_OP_READ |
+                  java_nio_channels_SelectionKey_OP_ACCEPT)) {
+    events |= EPOLLIN;
+  }
+
+  if (interest & (java_nio_channels_SelectionKey_OP_WRITE |
+                  java_nio_channels_SelectionKey_OP_CONNECT)) {
+    events |= EPOLLOUT;
+  }
+  return events;
+}
+
+jint
+eventsToReady(uint32_t events)
+{
+  jint ready = 0;
+  if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+    ready |= java_nio_channels_SelectionKey_OP_READ
+      | java_nio_channels_SelectionKey_OP_ACCEPT;
+  }
+
+  if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+    ready |= java_nio_channels_SelectionKey_OP_WRITE
+      | java_nio_channels_SelectionKey_OP_CONNECT;
+  }
+  return ready;
+}
+
+} // namespace
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_nio_channels_EpollSelector_natInit(JNIEnv* e, jclass)
+{
+  EpollState* s = static_cast<EpollState*>(malloc(sizeof(EpollState)));
+  if (s == 0) {
+    throwNew(e, "java/lang/OutOfMemoryError", 0);
+    return 0;
+  }
+
+  s->epoll = epoll_create1(EPOLL_CLOEXEC);
+  if (s->epoll < 0) {
+    throwIOException(e);
+    free(s);
+    return 0;
+  }
+
+  s->wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (s->wakeup < 0) {
+    throwIOException(e);
+    ::doClose(s->epoll);
+    free(s);
+    return 0;
+  }
+
+  epoll_event event;
+  memset(&event, 0, sizeof(epoll_event));
+  event.events = EPOLLIN;
+  event.data.fd = s->wakeup;
+  if (epoll_ctl(s->epoll, EPOLL_CTL_ADD, s->wakeup, &event) != 0) {
+    throwIOException(e);
+    ::doClose(s->wakeup);
+    ::doClose(s->epoll);
+    free(s);
+    return 0;
+  }
+
+  return reinterpret_cast<jlong>(s);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_EpollSelector_natWakeup(JNIEnv *e, jclass, jlong state)
+{
+  EpollState* s = reinterpret_cast<EpollState*>(state);
+  uint64_t v = 1;
+  if (::write(s->wakeup, &v, sizeof(uint64_t)) != sizeof(uint64_t)
+      and not eagain())
+  {
+    throwIOException(e);
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_EpollSelector_natClose(JNIEnv *, jclass, jlong state)
+{
+  EpollState* s = reinterpret_cast<EpollState*>(state);
+  ::doClose(s->wakeup);
+  ::doClose(s->epoll);
+  free(s);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_EpollSelector_natRegister(JNIEnv *e, jclass,
+                                                 jlong state,
+                                                 jint socket,
+                                                 jint interest,
+                                                 jboolean registered)
+{
+  EpollState* s = reinterpret_cast<EpollState*>(state);
+
+  epoll_event event;
+  memset(&event, 0, sizeof(epoll_event));
+  event.events = interestToEvents(interest);
+  event.data.fd = socket;
+
+  int r = epoll_ctl(s->epoll, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                    socket, &event);
+
+  // the socket may have been closed and its descriptor reused since we
+  // last saw it, in which case the kernel's view differs from ours:
+  if (r != 0 and errno == ENOENT) {
+    r = epoll_ctl(s->epoll, EPOLL_CTL_ADD, socket, &event);
+  } else if (r != 0 and errno == EEXIST) {
+    r = epoll_ctl(s->epoll, EPOLL_CTL_MOD, socket, &event);
+  }
+
+  if (r != 0) {
+    throwIOException(e);
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_nio_channels_EpollSelector_natUnregister(JNIEnv *, jclass,
+                                                   jlong state,
+                                                   jint socket)
+{
+  EpollState* s = reinterpret_cast<EpollState*>(state);
+
+  // this fails harmlessly if the socket has already been closed, since
+  // closing a descriptor removes it from any epoll sets
+  epoll_event event;
+  epoll_ctl(s->epoll, EPOLL_CTL_DEL, socket, &event);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_java_nio_channels_EpollSelector_natDoSocketSelect(JNIEnv *e, jclass,
+                                                       jlong state,
+                                                       jlong interval,
+                                                       jintArray ready)
+{
+  EpollState* s = reinterpret_cast<EpollState*>(state);
+
+  int timeout;
+  if (interval > 0) {
+    timeout = interval > 0x7FFFFFFF ? 0x7FFFFFFF : interval;
+  } else if (interval < 0) {
+    timeout = 0;
+  } else {
+    timeout = -1;
+  }
+
+  unsigned capacity = e->GetArrayLength(ready) / 2;
+  if (capacity > MaxEpollEvents) {
+    capacity = MaxEpollEvents;
+  }
+
+  epoll_event events[MaxEpollEvents];
+  int r = epoll_wait(s->epoll, events, capacity, timeout);
+
+  if (r < 0) {
+    if (errno != EINTR) {
+      throwIOException(e);
+    }
+    return 0;
+  }
+
+  jint pairs[MaxEpollEvents * 2];
+  unsigned count = 0;
+  for (int i = 0; i < r; ++i) {
+    if (events[i].data.fd == s->wakeup) {
+      uint64_t v;
+      if (::read(s->wakeup, &v, sizeof(uint64_t)) < 0 and not eagain()) {
+        throwIOException(e);
+        return 0;
+      }
+    } else {
+      pairs[count * 2] = events[i].data.fd;
+      pairs[(count * 2) + 1] = eventsToReady(events[i].events);
+      ++ count;
+    }
+  }
+
+  e->SetIntArrayRegion(ready, 0, count * 2, pairs);
+
+  return count;
+}
+
+#endif // __linux__
 
 extern "C" JNIEXPORT jboolean JNICALL
 Java_java_nio_ByteOrder_isNativeBigEndian(JNIEnv *, jclass)
@@ -15,6 +15,28 @@
 #include "jni.h"
 #include "jni-util.h"
 
+#ifndef PLATFORM_WINDOWS
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#endif
+
+namespace {
+
+void
+setResults(JNIEnv* e, z_stream* s, int r, jint inputLength,
+           jint outputLength, jintArray results)
+{
+  jint resultArray[3]
+    = { r,
+        static_cast<jint>(inputLength - s->avail_in),
+        static_cast<jint>(outputLength - s->avail_out) };
+
+  e->SetIntArrayRegion(results, 0, 3, resultArray);
+}
+
+} // namespace
+
 extern "C" JNIEXPORT jlong JNICALL
 Java_java_util_zip_Inflater_make
 (JNIEnv* e, jclass, jboolean nowrap)
@@ -54,38 +76,55 @@ Java_java_util_zip_Inflater_inflate
 {
   z_stream* s = reinterpret_cast<z_stream*>(peer);
 
-  jbyte* in = static_cast<jbyte*>(malloc(inputLength));
+  // zlib never calls back into the VM, so it can work on the array
+  // memory directly rather than on copies of it
+  jbyte* in = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(input, 0));
   if (in == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
+    return;
   }
 
-  jbyte* out = static_cast<jbyte*>(malloc(outputLength));
+  jbyte* out = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(output, 0));
   if (out == 0) {
-    free(in);
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
+    e->ReleasePrimitiveArrayCritical(input, in, JNI_ABORT);
+    return;
   }
 
-  e->GetByteArrayRegion(input, inputOffset, inputLength, in);
-  
-  s->next_in = reinterpret_cast<Bytef*>(in);
+  s->next_in = reinterpret_cast<Bytef*>(in + inputOffset);
   s->avail_in = inputLength;
-  s->next_out = reinterpret_cast<Bytef*>(out);
+  s->next_out = reinterpret_cast<Bytef*>(out + outputOffset);
   s->avail_out = outputLength;
 
   int r = inflate(s, Z_SYNC_FLUSH);
-  jint resultArray[3]
-    = { r,
-        static_cast<jint>(inputLength - s->avail_in),
-        static_cast<jint>(outputLength - s->avail_out) };
 
-  free(in);
+  e->ReleasePrimitiveArrayCritical(output, out, 0);
+  e->ReleasePrimitiveArrayCritical(input, in, JNI_ABORT);
 
-  e->SetByteArrayRegion(output, outputOffset, resultArray[2], out);
-  free(out);
+  setResults(e, s, r, inputLength, outputLength, results);
+}
 
-  e->SetIntArrayRegion(results, 0, 3, resultArray);
+extern "C" JNIEXPORT void JNICALL
+Java_java_util_zip_Inflater_inflateDirect
+(JNIEnv* e, jclass, jlong peer, jlong input, jint inputLength,
+ jbyteArray output, jint outputOffset, jint outputLength,
+ jintArray results)
+{
+  z_stream* s = reinterpret_cast<z_stream*>(peer);
+
+  jbyte* out = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(output, 0));
+  if (out == 0) {
+    return;
+  }
+
+  s->next_in = reinterpret_cast<Bytef*>(input);
+  s->avail_in = inputLength;
+  s->next_out = reinterpret_cast<Bytef*>(out + outputOffset);
+  s->avail_out = outputLength;
+
+  int r = inflate(s, Z_SYNC_FLUSH);
+
+  e->ReleasePrimitiveArrayCritical(output, out, 0);
+
+  setResults(e, s, r, inputLength, outputLength, results);
 }
 
 extern "C" JNIEXPORT jlong JNICALL
@@ -127,36 +166,63 @@ Java_java_util_zip_Deflater_deflate
 {
   z_stream* s = reinterpret_cast<z_stream*>(peer);
 
-  jbyte* in = static_cast<jbyte*>(malloc(inputLength));
+  jbyte* in = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(input, 0));
   if (in == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
+    return;
   }
 
-  jbyte* out = static_cast<jbyte*>(malloc(outputLength));
+  jbyte* out = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(output, 0));
   if (out == 0) {
-    free(in);
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;    
+    e->ReleasePrimitiveArrayCritical(input, in, JNI_ABORT);
+    return;
   }
 
-  e->GetByteArrayRegion(input, inputOffset, inputLength, in);
-  
-  s->next_in = reinterpret_cast<Bytef*>(in);
+  s->next_in = reinterpret_cast<Bytef*>(in + inputOffset);
   s->avail_in = inputLength;
-  s->next_out = reinterpret_cast<Bytef*>(out);
+  s->next_out = reinterpret_cast<Bytef*>(out + outputOffset);
   s->avail_out = outputLength;
 
   int r = deflate(s, finish ? Z_FINISH : Z_NO_FLUSH);
-  jint resultArray[3]
-    = { r,
-        static_cast<jint>(inputLength - s->avail_in),
-        static_cast<jint>(outputLength - s->avail_out) };
 
-  free(in);
+  e->ReleasePrimitiveArrayCritical(output, out, 0);
+  e->ReleasePrimitiveArrayCritical(input, in, JNI_ABORT);
 
-  e->SetByteArrayRegion(output, outputOffset, resultArray[2], out);
-  free(out);
+  setResults(e, s, r, inputLength, outputLength, results);
+}
 
-  e->SetIntArrayRegion(results, 0, 3, resultArray);
+extern "C" JNIEXPORT jlong JNICALL
+Java_java_util_zip_ZipFile_map(JNIEnv* e, jclass, jstring path, jlong length)
+{
+#ifdef PLATFORM_WINDOWS
+  // not supported; ZipFile falls back to reading through the file
+  return 0;
+#else
+  if (length <= 0) {
+    return 0;
+  }
+
+  const char* chars = e->GetStringUTFChars(path, 0);
+  if (chars == 0) {
+    return 0;
+  }
+
+  int fd = open(chars, O_RDONLY);
+  e->ReleaseStringUTFChars(path, chars);
+  if (fd == -1) {
+    return 0;
+  }
+
+  void* p = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  return p == MAP_FAILED ? 0 : reinterpret_cast<jlong>(p);
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_java_util_zip_ZipFile_unmap(JNIEnv*, jclass, jlong address, jlong length)
+{
+#ifndef PLATFORM_WINDOWS
+  munmap(reinterpret_cast<void*>(address), length);
+#endif
 }
@@ -57,7 +57,7 @@ public class FileInputStream extends InputStream {
       throw new NullPointerException();
     }
 
-    if (offset < 0 || offset + length > b.length) {
+    if (offset < 0 || length < 0 || length > b.length - offset) {
       throw new ArrayIndexOutOfBoundsException();
     }
 
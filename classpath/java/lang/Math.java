@@ -83,6 +83,8 @@ public final class Math {
 
   public static native double ceil(double v);
 
+  public static native double rint(double v);
+
   public static native double exp(double v);
 
   public static native double log(double v);
@@ -45,14 +45,19 @@ public class Object {
     wait(0);
   }
 
-  public native final void wait(long milliseconds) throws InterruptedException;
+  public final void wait(long milliseconds) throws InterruptedException {
+    wait(milliseconds, 0);
+  }
 
   public final void wait(long milliseconds, int nanoseconds)
     throws InterruptedException
   {
-    if (nanoseconds != 0) {
-      ++ milliseconds;
+    if (milliseconds < 0 || nanoseconds < 0 || nanoseconds > 999999) {
+      throw new IllegalArgumentException();
     }
-    wait(milliseconds);
+    timedWait(milliseconds, nanoseconds);
   }
+
+  private native void timedWait(long milliseconds, int nanoseconds)
+    throws InterruptedException;
 }
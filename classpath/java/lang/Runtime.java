@@ -132,6 +132,8 @@ public class Runtime {
 
   public native long totalMemory();
 
+  public native long maxMemory();
+
   private static class MyProcess extends Process {
     private long pid;
     private long tid;
@@ -278,6 +278,12 @@ public final class String
   }
 
   public int indexOf(int c, int start) {
+    if (start < 0) start = 0;
+
+    if (Character.isSupplementaryCodePoint(c)) {
+      return indexOf(new String(Character.toChars(c)), start);
+    }
+
     for (int i = start; i < length; ++i) {
       if (charAt(i) == c) {
         return i;
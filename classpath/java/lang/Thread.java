@@ -156,8 +156,23 @@ public class Thread implements Runnable {
   }
 
   public static void sleep(long milliseconds) throws InterruptedException {
+    sleep(milliseconds, 0);
+  }
+
+  public static void sleep(long milliseconds, int nanoseconds)
+    throws InterruptedException
+  {
+    if (nanoseconds < 0 || nanoseconds > 999999) {
+      throw new IllegalArgumentException();
+    }
+
     if (milliseconds <= 0) {
-      milliseconds = 1;
+      // a timeout of zero means wait forever, so sleep for as short a
+      // time as we can instead
+      milliseconds = 0;
+      if (nanoseconds == 0) {
+        nanoseconds = 1;
+      }
     }
 
     Thread t = currentThread();
@@ -165,20 +180,10 @@ public class Thread implements Runnable {
       t.sleepLock = new Object();
     }
     synchronized (t.sleepLock) {
-      t.sleepLock.wait(milliseconds);
+      t.sleepLock.wait(milliseconds, nanoseconds);
     }
   }
 
-  public static void sleep(long milliseconds, int nanoseconds)
-    throws InterruptedException
-  {
-    if (nanoseconds > 0) {
-      ++ milliseconds;
-    }
-
-    sleep(milliseconds);
-  }
-
   public StackTraceElement[] getStackTrace() {
     long p = peer;
     if (p == 0) {
@@ -0,0 +1,189 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio.channels;
+
+import java.io.IOException;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.Iterator;
+import java.util.Map;
+import java.util.Set;
+import java.net.Socket;
+
+/**
+ * Selector backed by Linux's epoll facility.  Unlike SocketSelector,
+ * which rebuilds an fd_set from every registered key on each call to
+ * select, this keeps registrations in the kernel and only tells it
+ * about keys whose interest set or channel state has changed, so the
+ * cost of a select is proportional to the number of ready channels
+ * rather than the number of registered ones.
+ */
+class EpollSelector extends Selector {
+  private static final int ReadyBufferSize = 512;
+
+  private volatile long state;
+  private final Object lock = new Object();
+  private boolean woken = false;
+  private final Map<Integer, SelectionKey> registered = new HashMap();
+  private Set<SelectionKey> changed = new HashSet();
+  private final int[] ready = new int[ReadyBufferSize * 2];
+
+  public EpollSelector() throws IOException {
+    Socket.init();
+
+    state = natInit();
+  }
+
+  public boolean isOpen() {
+    return state != 0;
+  }
+
+  void changed(SelectionKey key) {
+    synchronized (lock) {
+      changed.add(key);
+    }
+  }
+
+  public void add(SelectionKey key) {
+    super.add(key);
+    changed(key);
+  }
+
+  public void remove(SelectionKey key) {
+    super.remove(key);
+    changed(key);
+  }
+
+  public Selector wakeup() {
+    synchronized (lock) {
+      if (isOpen() && (! woken)) {
+        woken = true;
+
+        natWakeup(state);
+      }
+    }
+    return this;
+  }
+
+  private boolean clearWoken() {
+    synchronized (lock) {
+      if (woken) {
+        woken = false;
+        return true;
+      } else {
+        return false;
+      }
+    }
+  }
+
+  public synchronized int selectNow() throws IOException {
+    return doSelect(-1);
+  }
+
+  public synchronized int select() throws IOException {
+    return doSelect(0);
+  }
+
+  public synchronized int select(long interval) throws IOException {
+    if (interval < 0) throw new IllegalArgumentException();
+
+    return doSelect(interval);
+  }
+
+  private void applyChanges() throws IOException {
+    Set<SelectionKey> changes;
+    synchronized (lock) {
+      if (changed.isEmpty()) {
+        return;
+      }
+      changes = changed;
+      changed = new HashSet();
+    }
+
+    for (Iterator<SelectionKey> it = changes.iterator(); it.hasNext();) {
+      SelectionKey key = it.next();
+      SelectableChannel c = key.channel();
+      Integer socket = c.socketFD();
+      boolean live = c.isOpen() && keys.contains(key);
+
+      if (live && key.interestOps() != 0) {
+        SelectionKey old = registered.put(socket, key);
+        natRegister(state, socket, key.interestOps(), old != null);
+      } else {
+        if (! c.isOpen()) {
+          keys.remove(key);
+        }
+
+        // the descriptor may already belong to a newer key if the
+        // channel was closed and its number reused, so only drop the
+        // registration if it is still ours
+        if (registered.get(socket) == key) {
+          registered.remove(socket);
+          natUnregister(state, socket);
+        }
+      }
+    }
+  }
+
+  private int doSelect(long interval) throws IOException {
+    if (! isOpen()) {
+      throw new ClosedSelectorException();
+    }
+
+    for (Iterator<SelectionKey> it = selectedKeys.iterator(); it.hasNext();) {
+      it.next().readyOps(0);
+    }
+    selectedKeys.clear();
+
+    applyChanges();
+
+    if (clearWoken()) interval = -1;
+
+    int count = natDoSocketSelect(state, interval, ready);
+
+    for (int i = 0; i < count; ++i) {
+      SelectionKey key = registered.get(ready[i * 2]);
+      if (key != null) {
+        SelectableChannel c = key.channel();
+        int ops = ready[(i * 2) + 1] & key.interestOps();
+        key.readyOps(ops);
+        if (ops != 0 && c.isOpen()) {
+          c.handleReadyOps(ops);
+          selectedKeys.add(key);
+        }
+      }
+    }
+    clearWoken();
+
+    return selectedKeys.size();
+  }
+
+  public synchronized void close() {
+    synchronized (lock) {
+      if (isOpen()) {
+        natClose(state);
+        state = 0;
+      }
+    }
+  }
+
+  static native boolean natSupported();
+  private static native long natInit();
+  private static native void natWakeup(long state);
+  private static native void natClose(long state);
+  private static native void natRegister(long state, int socket, int interest,
+                                         boolean registered)
+    throws IOException;
+  private static native void natUnregister(long state, int socket);
+  private static native int natDoSocketSelect(long state, long interval,
+                                              int[] ready)
+    throws IOException;
+}
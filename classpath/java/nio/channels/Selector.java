@@ -19,9 +19,18 @@ public abstract class Selector {
   protected final Set<SelectionKey> selectedKeys = new HashSet();
 
   public static Selector open() throws IOException {
-    return new SocketSelector();
+    if (EpollSelector.natSupported()) {
+      return new EpollSelector();
+    } else {
+      return new SocketSelector();
+    }
   }
   
+  void changed(SelectionKey key) {
+    // ignore -- only selectors which keep registrations between calls
+    // to select need to hear about this
+  }
+
   public void add(SelectionKey key) {
     keys.add(key);
   }
@@ -185,6 +185,57 @@ public class Arrays {
     };
   }
 
+  public static boolean equals(byte[] a, byte[] b) {
+    if (a == b) {
+      return true;
+    }
+    if (a == null || b == null || a.length != b.length) {
+      return false;
+    }
+    for (int i = 0; i < a.length; ++i) {
+      if (a[i] != b[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  public static boolean equals(char[] a, char[] b) {
+    if (a == b) {
+      return true;
+    }
+    if (a == null || b == null || a.length != b.length) {
+      return false;
+    }
+    for (int i = 0; i < a.length; ++i) {
+      if (a[i] != b[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  public static boolean equals(int[] a, int[] b) {
+    if (a == b) {
+      return true;
+    }
+    if (a == null || b == null || a.length != b.length) {
+      return false;
+    }
+    for (int i = 0; i < a.length; ++i) {
+      if (a[i] != b[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  public static void fill(byte[] array, byte value) {
+    for (int i=0;i<array.length;i++) {
+      array[i] = value;
+    }
+  }
+
   public static void fill(int[] array, int value) {
     for (int i=0;i<array.length;i++) {
       array[i] = value;
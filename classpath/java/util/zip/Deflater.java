@@ -80,6 +80,10 @@ public class Deflater {
   }
 
   public void setInput(byte[] input, int offset, int length) {
+    if (offset < 0 || length < 0 || length > input.length - offset) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
     this.input = input;
     this.offset = offset;
     this.length = length;
@@ -111,6 +115,10 @@ public class Deflater {
       throw new NullPointerException();
     }
 
+    if (offset < 0 || length < 0 || length > output.length - offset) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
     int[] results = new int[3];
     deflate(peer, 
             input, this.offset, this.length,
@@ -21,6 +21,7 @@ public class Inflater {
 
   private long peer;
   private byte[] input;
+  private long inputAddress;
   private int offset;
   private int length;
   private boolean needDictionary;
@@ -65,15 +66,30 @@ public class Inflater {
   }
 
   public void setInput(byte[] input, int offset, int length) {
+    if (offset < 0 || length < 0 || length > input.length - offset) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
     this.input = input;
+    this.inputAddress = 0;
     this.offset = offset;
     this.length = length;
   }
 
+  // uses the specified native memory as input, which must remain
+  // valid until it has all been consumed or new input is set
+  void setInput(long address, int length) {
+    this.input = null;
+    this.inputAddress = address;
+    this.offset = 0;
+    this.length = length;
+  }
+
   public void reset() {
     dispose();
     peer = make(nowrap);
     input = null;
+    inputAddress = 0;
     offset = length = 0;
     needDictionary = finished = false;
   }
@@ -93,13 +109,22 @@ public class Inflater {
       throw new IllegalStateException();      
     }
 
-    if (input == null || output == null) {
+    if ((input == null && inputAddress == 0) || output == null) {
       throw new NullPointerException();
     }
 
+    if (offset < 0 || length < 0 || length > output.length - offset) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+
     int[] results = new int[3];
-    inflate(peer, input, this.offset, this.length,
-            output, offset, length, results);
+    if (input == null) {
+      inflateDirect(peer, inputAddress + this.offset, this.length,
+                    output, offset, length, results);
+    } else {
+      inflate(peer, input, this.offset, this.length,
+              output, offset, length, results);
+    }
 
     if (results[zlibResult] < 0) {
       throw new DataFormatException();
@@ -127,6 +152,11 @@ public class Inflater {
      byte[] output, int outputOffset, int outputLength,
      int[] results);
 
+  private static native void inflateDirect
+    (long peer, long input, int inputLength,
+     byte[] output, int outputOffset, int outputLength,
+     int[] results);
+
   public void end() {
     dispose();
   }
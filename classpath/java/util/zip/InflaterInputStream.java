@@ -34,6 +34,15 @@ public class InflaterInputStream extends InputStream {
     this(in, new Inflater());
   }
 
+  // inflates directly from the specified native memory, which the
+  // caller must keep valid until this stream is closed
+  InflaterInputStream(Inflater inflater, long address, int length) {
+    this.in = null;
+    this.inflater = inflater;
+    this.buffer = null;
+    inflater.setInput(address, length);
+  }
+
   public int read() throws IOException {
     byte[] buffer = new byte[1];
     int c = read(buffer);
@@ -47,6 +56,10 @@ public class InflaterInputStream extends InputStream {
 
     while (true) {
       if (inflater.needsInput()) {
+        if (in == null) {
+          throw new EOFException();
+        }
+
         int count = in.read(buffer);
         if (count > 0) {
           inflater.setInput(buffer, 0, count);
@@ -75,7 +88,9 @@ public class InflaterInputStream extends InputStream {
   }
 
   public void close() throws IOException {
-    in.close();
+    if (in != null) {
+      in.close();
+    }
     inflater.dispose();
   }
 }
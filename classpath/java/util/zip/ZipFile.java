@@ -23,12 +23,19 @@ public class ZipFile {
   private final RandomAccessFile file;
   private final Window window;
   private final Map<String,Integer> index = new HashMap();
+  private final long mappedLength;
+  // address of the whole file mapped into memory, or zero if it could
+  // not be mapped
+  private long address;
 
   public ZipFile(String name) throws IOException {
     file = new RandomAccessFile(name, "r");
     window = new Window(file, 4096);
     
     int fileLength = (int) file.length();
+    mappedLength = fileLength;
+    address = map(name, mappedLength);
+
     int pointer = fileLength - 22;
     byte[] magic = new byte[] { 0x50, 0x4B, 0x05, 0x06 };
     while (pointer > 0) {
@@ -99,35 +106,14 @@ public class ZipFile {
       return in;
 
     case Deflated:
-      return new InflaterInputStream(in, new Inflater(true)) {
-        int remaining = uncompressedSize(window, pointer);
-
-        public int read() throws IOException {
-          int c = super.read();
-          if (c >= 0) {
-            -- remaining;
-          }
-          return c;
-        }
-
-        public int read(byte[] buffer) throws IOException {
-          return read(buffer, 0, buffer.length);
-        }
-
-        public int read(byte[] buffer, int offset, int length)
-          throws IOException
-        {
-          int c = super.read(buffer, offset, length);
-          if (c > 0) {
-            remaining -= c;
-          }
-          return c;
-        }
-
-        public int available() {
-          return remaining;
-        }
-      };
+      if (address != 0) {
+        return new MyInflaterInputStream
+          (fileData(window, pointer), size,
+           uncompressedSize(window, pointer));
+      } else {
+        return new MyInflaterInputStream
+          (in, uncompressedSize(window, pointer));
+      }
 
     default:
       throw new IOException();
@@ -228,9 +214,21 @@ public class ZipFile {
   }
 
   public void close() throws IOException {
+    // mapped streams read from the mapping while holding this lock, so
+    // none of them can still be using it once we have it
+    synchronized (this) {
+      if (address != 0) {
+        unmap(address, mappedLength);
+        address = 0;
+      }
+    }
     file.close();
   }
 
+  private static native long map(String name, long length);
+
+  private static native void unmap(long address, long length);
+
   protected static class Window {
     private final RandomAccessFile file;
     public final byte[] data;
@@ -352,6 +350,53 @@ public class ZipFile {
     }
   }
 
+  private class MyInflaterInputStream extends InflaterInputStream {
+    private final boolean mapped;
+    private int remaining;
+
+    public MyInflaterInputStream(InputStream in, int remaining) {
+      super(in, new Inflater(true));
+      this.mapped = false;
+      this.remaining = remaining;
+    }
+
+    public MyInflaterInputStream(int start, int length, int remaining) {
+      super(new Inflater(true), address + start, length);
+      this.mapped = true;
+      this.remaining = remaining;
+    }
+
+    public int read(byte[] buffer) throws IOException {
+      return read(buffer, 0, buffer.length);
+    }
+
+    public int read(byte[] buffer, int offset, int length)
+      throws IOException
+    {
+      int c;
+      if (mapped) {
+        synchronized (ZipFile.this) {
+          if (address == 0) {
+            throw new IOException("zip file closed");
+          }
+
+          c = super.read(buffer, offset, length);
+        }
+      } else {
+        c = super.read(buffer, offset, length);
+      }
+
+      if (c > 0) {
+        remaining -= c;
+      }
+      return c;
+    }
+
+    public int available() {
+      return remaining;
+    }
+  }
+
   private static class MyInputStream extends InputStream {
     private RandomAccessFile file;
     private int offset;
@@ -116,6 +116,7 @@ class Compiler {
 
   virtual void checkBounds(Operand* object, unsigned lengthOffset,
                            Operand* index, intptr_t handler) = 0;
+  virtual void checkNull(Operand* object) = 0;
 
   virtual void store(unsigned srcSize, Operand* src, unsigned dstSize,
                      Operand* dst) = 0;
@@ -181,6 +182,9 @@ class Compiler {
   virtual Operand* abs(unsigned size, Operand* a) = 0;
   virtual Operand* fabs(unsigned size, Operand* a) = 0;
   virtual Operand* fsqrt(unsigned size, Operand* a) = 0;
+  virtual Operand* ffloor(unsigned size, Operand* a) = 0;
+  virtual Operand* fceil(unsigned size, Operand* a) = 0;
+  virtual Operand* frint(unsigned size, Operand* a) = 0;
   virtual Operand* f2f(unsigned aSize, unsigned resSize, Operand* a) = 0;
   virtual Operand* f2i(unsigned aSize, unsigned resSize, Operand* a) = 0;
   virtual Operand* i2f(unsigned aSize, unsigned resSize, Operand* a) = 0;
@@ -24,6 +24,9 @@ LIR_OP_2(Float2Int)
 LIR_OP_2(Int2Float)
 LIR_OP_2(FloatSquareRoot)
 LIR_OP_2(FloatAbsolute)
+LIR_OP_2(FloatFloor)
+LIR_OP_2(FloatCeil)
+LIR_OP_2(FloatRint)
 LIR_OP_2(Absolute)
 
 LIR_OP_3(Add)
@@ -46,12 +46,39 @@ class Heap: public Allocator {
     virtual bool visit(unsigned) = 0;
   };
 
+  class Statistics {
+   public:
+    // pauseHistogram[i] counts collections which took less than 2^i
+    // microseconds, except for the last bucket, which counts the rest
+    static const unsigned PauseHistogramSize = 24;
+
+    uint64_t minorCollectionCount;
+    uint64_t majorCollectionCount;
+    uint64_t totalPauseTime; // nanoseconds
+    uint64_t maxPauseTime;
+    uint64_t lastPauseTime;
+    uint64_t promotedBytes;
+
+    // occupancy as of the end of the most recent collection:
+    uint64_t gen1Bytes;
+    uint64_t gen1Capacity;
+    uint64_t gen2Bytes;
+    uint64_t gen2Capacity;
+    uint64_t untenuredFixieBytes;
+    uint64_t tenuredFixieBytes;
+
+    // memory currently allocated through this heap:
+    uint64_t footprint;
+
+    uint64_t pauseHistogram[PauseHistogramSize];
+  };
+
   class Client {
    public:
     virtual void collect(void* context, CollectionType type) = 0;
     virtual void visitRoots(Visitor*) = 0;
     virtual bool isFixed(void*) = 0;
-    virtual unsigned sizeInWords(void*) = 0;
+    virtual uintptr_t sizeInWords(void*) = 0;
     virtual unsigned copiedSizeInWords(void*) = 0;
     virtual void copy(void*, void*) = 0;
     virtual void walk(void*, Walker*) = 0;
@@ -59,25 +86,41 @@ class Heap: public Allocator {
 
   virtual void setClient(Client* client) = 0;
   virtual void setImmortalHeap(uintptr_t* start, unsigned sizeInWords) = 0;
-  virtual unsigned limit() = 0;
+  virtual uintptr_t limit() = 0;
   virtual bool limitExceeded() = 0;
-  virtual void collect(CollectionType type, unsigned footprint) = 0;
+  virtual void collect(CollectionType type, uintptr_t footprint) = 0;
   virtual void* tryAllocateFixed(Allocator* allocator, unsigned sizeInWords,
-                                 bool objectMask, unsigned* totalInBytes) = 0;
+                                 bool objectMask, uintptr_t* totalInBytes) = 0;
   virtual void* tryAllocateImmortalFixed(Allocator* allocator,
                                          unsigned sizeInWords, bool objectMask,
-                                         unsigned* totalInBytes) = 0;
+                                         uintptr_t* totalInBytes) = 0;
   virtual void mark(void* p, unsigned offset, unsigned count) = 0;
   virtual void pad(void* p) = 0;
   virtual void* follow(void* p) = 0;
   virtual void postVisit() = 0;
+
+  // A pinned object stays where it is until it has been unpinned as
+  // many times as it was pinned, and is treated as a root until then.
+  // The client must not pin or unpin objects during a collection.
+  virtual void pin(void* p) = 0;
+  virtual void unpin(void* p) = 0;
+
+  // If any pinned object lies within the specified block, which must
+  // have been allocated from this heap and which the client would
+  // otherwise free or reuse after a collection, the heap takes
+  // ownership of it and returns true.  It will free the block itself
+  // after the first collection during which it holds no pinned
+  // objects.
+  virtual bool retain(void* p, unsigned sizeInBytes) = 0;
   virtual Status status(void* p) = 0;
   virtual CollectionType collectionType() = 0;
+  virtual void setEventLog(FILE* log) = 0;
+  virtual void statistics(Statistics* s) = 0;
   virtual void disposeFixies() = 0;
   virtual void dispose() = 0;
 };
 
-Heap* makeHeap(System* system, unsigned limit);
+Heap* makeHeap(System* system, uintptr_t limit);
 
 } // namespace vm
 
@@ -61,8 +61,11 @@ class System : public avian::util::Aborter {
     virtual bool tryAcquire(Thread* context) = 0;
     virtual void acquire(Thread* context) = 0;
     virtual void release(Thread* context) = 0;
-    virtual void wait(Thread* context, int64_t time) = 0;
-    virtual bool waitAndClearInterrupted(Thread* context, int64_t time) = 0;
+    // timeouts are in nanoseconds, measured against a monotonic
+    // clock; zero means wait indefinitely
+    virtual void wait(Thread* context, int64_t nanoseconds) = 0;
+    virtual bool waitAndClearInterrupted(Thread* context,
+                                         int64_t nanoseconds) = 0;
     virtual void notify(Thread* context) = 0;
     virtual void notifyAll(Thread* context) = 0;
     virtual Thread* owner() = 0;
@@ -120,8 +123,11 @@ class System : public avian::util::Aborter {
   };
 
   virtual bool success(Status) = 0;
-  virtual void* tryAllocate(unsigned sizeInBytes) = 0;
+  virtual void* tryAllocate(uintptr_t sizeInBytes) = 0;
   virtual void free(const void* p) = 0;
+  virtual void* tryAllocatePages(uintptr_t sizeInBytes) = 0;
+  virtual void discardPages(void* p, uintptr_t sizeInBytes) = 0;
+  virtual void freePages(const void* p, uintptr_t sizeInBytes) = 0;
 #if !defined(AVIAN_AOT_ONLY)
   virtual void* tryAllocateExecutable(unsigned sizeInBytes) = 0;
   virtual void freeExecutable(const void* p, unsigned sizeInBytes) = 0;
@@ -149,13 +155,14 @@ class System : public avian::util::Aborter {
   virtual const char* toAbsolutePath(Allocator* allocator,
                                      const char* name) = 0;
   virtual int64_t now() = 0;
+  virtual int64_t nanoTime() = 0;
   virtual void yield() = 0;
   virtual void exit(int code) = 0;
   virtual void dispose() = 0;
 };
 
 inline void*
-allocate(System* s, unsigned size)
+allocate(System* s, uintptr_t size)
 {
   void* p = s->tryAllocate(size);
   if (p == 0) s->abort();
@@ -59,66 +59,6 @@ getTrace(Thread* t, unsigned skipCount)
   return v.trace;
 }
 
-bool
-compatibleArrayTypes(Thread* t, object a, object b)
-{
-  return classArrayElementSize(t, a)
-    and classArrayElementSize(t, b)
-    and (a == b
-         or (not ((classVmFlags(t, a) & PrimitiveFlag)
-                  or (classVmFlags(t, b) & PrimitiveFlag))));
-}
-
-void
-arrayCopy(Thread* t, object src, int32_t srcOffset, object dst,
-          int32_t dstOffset, int32_t length)
-{
-  if (LIKELY(src and dst)) {
-    if (LIKELY(compatibleArrayTypes
-               (t, objectClass(t, src), objectClass(t, dst))))
-    {
-      unsigned elementSize = classArrayElementSize(t, objectClass(t, src));
-
-      if (LIKELY(elementSize)) {
-        intptr_t sl = fieldAtOffset<uintptr_t>(src, BytesPerWord);
-        intptr_t dl = fieldAtOffset<uintptr_t>(dst, BytesPerWord);
-        if (LIKELY(length > 0)) {
-          if (LIKELY(srcOffset >= 0 and srcOffset + length <= sl and
-                     dstOffset >= 0 and dstOffset + length <= dl))
-          {
-            uint8_t* sbody = &fieldAtOffset<uint8_t>(src, ArrayBody);
-            uint8_t* dbody = &fieldAtOffset<uint8_t>(dst, ArrayBody);
-            if (src == dst) {
-              memmove(dbody + (dstOffset * elementSize),
-                      sbody + (srcOffset * elementSize),
-                      length * elementSize);
-            } else {
-              memcpy(dbody + (dstOffset * elementSize),
-                     sbody + (srcOffset * elementSize),
-                     length * elementSize);
-            }
-
-            if (classObjectMask(t, objectClass(t, dst))) {
-              mark(t, dst, ArrayBody + (dstOffset * BytesPerWord), length);
-            }
-
-            return;
-          } else {
-            throwNew(t, Machine::IndexOutOfBoundsExceptionType);
-          }
-        } else {
-          return;
-        }
-      }
-    }
-  } else {
-    throwNew(t, Machine::NullPointerExceptionType);
-    return;
-  }
-
-  throwNew(t, Machine::ArrayStoreExceptionType);
-}
-
 void
 runOnLoadIfFound(Thread* t, System::Library* library)
 {
@@ -252,7 +192,7 @@ clone(Thread* t, object o)
   PROTECT(t, o);
 
   object class_ = objectClass(t, o);
-  unsigned size = baseSize(t, o, class_) * BytesPerWord;
+  uintptr_t size = baseSize(t, o, class_) * BytesPerWord;
   object clone;
 
   if (classArrayElementSize(t, class_)) {
@@ -593,7 +533,7 @@ intercept(Thread* t, object c, const char* name, const char* spec,
 
     methodFlags(t, m) |= ACC_NATIVE;
 
-    object native = makeNativeIntercept(t, function, true, clone);
+    object native = makeNativeIntercept(t, function, true, 0, 0, clone);
 
     PROTECT(t, native);
 
@@ -259,6 +259,10 @@ const unsigned ACC_INTERFACE    = 1 <<  9;
 const unsigned ACC_ABSTRACT     = 1 << 10;
 const unsigned ACC_STRICT       = 1 << 11;
 
+// number of groups instance fields are laid out in (see
+// fieldLayoutGroup in machine.h); the type generator uses it too
+const unsigned FieldLayoutGroupCount = 5;
+
 const int JNI_COMMIT = 1;
 const int JNI_ABORT  = 2;
 
@@ -162,6 +162,7 @@ const unsigned ContinuationFlag = 1 << 11;
 // method vmFlags:
 const unsigned ClassInitFlag = 1 << 0;
 const unsigned ConstructorFlag = 1 << 1;
+const unsigned OverriddenFlag = 1 << 2;
 
 #ifndef JNI_VERSION_1_6
 #define JNI_VERSION_1_6 0x00010006
@@ -1193,6 +1194,10 @@ class Reference {
 
 class Classpath;
 
+class ClassArchive;
+
+class ProfileBuffer;
+
 class Machine {
  public:
   enum Type {
@@ -1267,7 +1272,7 @@ class Machine {
   unsigned activeCount;
   unsigned liveCount;
   unsigned daemonCount;
-  unsigned fixedFootprint;
+  uintptr_t fixedFootprint;
   unsigned stackSizeInBytes;
   System::Local* localThread;
   System::Monitor* stateLock;
@@ -1277,6 +1282,8 @@ class Machine {
   System::Monitor* shutdownLock;
   System::Library* libraries;
   FILE* errorLog;
+  FILE* gcLog;
+  ClassArchive* classArchive;
   BootImage* bootimage;
   object types;
   object roots;
@@ -1295,6 +1302,10 @@ class Machine {
   uintptr_t* heapPool[ThreadHeapPoolSize];
   unsigned heapPoolIndex;
   unsigned bootimageSize;
+  uint64_t safepointCount;
+  uint64_t safepointTotalTime;
+  uint64_t safepointMaxTime;
+  uint64_t safepointLastTime;
 };
 
 void
@@ -1356,6 +1367,9 @@ class Thread {
   static const unsigned ActiveFlag = 1 << 5;
   static const unsigned SystemFlag = 1 << 6;
   static const unsigned JoinFlag = 1 << 7;
+  // set on every other thread while one is in the exclusive state, so
+  // that loops which never allocate notice and call safepoint():
+  static const unsigned SafepointFlag = 1 << 8;
 
   class Protector {
    public:
@@ -1510,7 +1524,6 @@ class Thread {
   Thread* child;
   Thread* waitNext;
   State state;
-  unsigned criticalLevel;
   System::Thread* systemThread;
   System::Monitor* lock;
   object javaThread;
@@ -1527,6 +1540,7 @@ class Thread {
   uintptr_t backupHeap[ThreadBackupHeapSizeInWords];
   unsigned backupHeapIndex;
   unsigned flags;
+  ProfileBuffer* profileBuffer;
 };
 
 class Classpath {
@@ -1640,6 +1654,12 @@ stackSizeInWords(Thread* t)
 void
 enter(Thread* t, Thread::State state);
 
+// Lets any thread which is waiting to enter, or has entered, the
+// exclusive state proceed before returning.  Called by loops which
+// find Thread::SafepointFlag set.
+void
+safepoint(Thread* t);
+
 inline void
 enterActiveState(Thread* t)
 {
@@ -1837,29 +1857,29 @@ ensure(Thread* t, unsigned sizeInBytes)
 }
 
 object
-allocate2(Thread* t, unsigned sizeInBytes, bool objectMask);
+allocate2(Thread* t, uintptr_t sizeInBytes, bool objectMask);
 
 object
 allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
-          unsigned sizeInBytes, bool objectMask);
+          uintptr_t sizeInBytes, bool objectMask);
 
 inline object
-allocateSmall(Thread* t, unsigned sizeInBytes)
+allocateSmall(Thread* t, uintptr_t sizeInBytes)
 {
-  assert(t, t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
+  assert(t, t->heapIndex + ceilingDivideWord(sizeInBytes, BytesPerWord)
          <= ThreadHeapSizeInWords);
 
   object o = reinterpret_cast<object>(t->heap + t->heapIndex);
-  t->heapIndex += ceilingDivide(sizeInBytes, BytesPerWord);
+  t->heapIndex += ceilingDivideWord(sizeInBytes, BytesPerWord);
   return o;
 }
 
 inline object
-allocate(Thread* t, unsigned sizeInBytes, bool objectMask)
+allocate(Thread* t, uintptr_t sizeInBytes, bool objectMask)
 {
   stress(t);
 
-  if (UNLIKELY(t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
+  if (UNLIKELY(t->heapIndex + ceilingDivideWord(sizeInBytes, BytesPerWord)
                > ThreadHeapSizeInWords
                or t->m->exclusive))
   {
@@ -1881,6 +1901,27 @@ mark(Thread* t, object o, unsigned offset)
   t->m->heap->mark(o, offset / BytesPerWord, 1);
 }
 
+// Keeps the specified object where it is (e.g. while native code
+// holds a pointer to its body) until a matching call to unpin, even
+// if the heap is collected in the meantime.
+inline void
+pin(Thread* t, object o)
+{
+  assert(t, t->state == Thread::ActiveState
+         or t->state == Thread::ExclusiveState);
+
+  t->m->heap->pin(o);
+}
+
+inline void
+unpin(Thread* t, object o)
+{
+  assert(t, t->state == Thread::ActiveState
+         or t->state == Thread::ExclusiveState);
+
+  t->m->heap->unpin(o);
+}
+
 inline void
 set(Thread* t, object target, unsigned offset, object value)
 {
@@ -1972,7 +2013,7 @@ runThread(Thread* t, uintptr_t*)
 inline bool
 startThread(Thread* t, Thread* p)
 {
-  p->flags |= Thread::JoinFlag;
+  atomicOr(&(p->flags), Thread::JoinFlag);
   return t->m->system->success(t->m->system->start(&(p->runnable)));
 }
 
@@ -2146,15 +2187,16 @@ hashTaken(Thread*, object o)
   return (alias(o, 0) & (~PointerMask)) == HashTakenMark;
 }
 
-inline unsigned
+inline uintptr_t
 baseSize(Thread* t, object o, object class_)
 {
   assert(t, classFixedSize(t, class_) >= BytesPerWord);
 
   return ceilingDivide(classFixedSize(t, class_), BytesPerWord)
-    + ceilingDivide(classArrayElementSize(t, class_)
-              * fieldAtOffset<uintptr_t>(o, classFixedSize(t, class_) - BytesPerWord),
-              BytesPerWord);
+    + ceilingDivideWord
+    (classArrayElementSize(t, class_)
+     * fieldAtOffset<uintptr_t>(o, classFixedSize(t, class_) - BytesPerWord),
+     BytesPerWord);
 }
 
 object
@@ -2279,6 +2321,35 @@ stringUTFChars(Thread* t, object string, char* chars, unsigned charsLength)
   stringUTFChars(t, string, 0, stringLength(t, string), chars, charsLength);  
 }
 
+// Each class records its first PrimarySuperCount ancestors, root
+// first and ending with itself, in its primary supers display, so a
+// class is a subclass of a class of depth d if and only if element d
+// of its display is that class.  Interfaces and arrays are left out of
+// displays, as are classes too deep to fit; checks against those scan
+// interface tables and superclass chains instead, and the last such
+// check to succeed is cached in the secondarySuperCache of the class
+// being tested.
+const unsigned PrimarySuperCount = 8;
+
+void
+initPrimarySupers(Thread* t, object class_);
+
+// returns the index at which the specified class appears in its
+// subclasses' displays, or -1 if it doesn't
+inline int
+primarySuperDepth(Thread* t, object class_)
+{
+  object supers = classPrimarySupers(t, class_);
+  if (supers and (classVmFlags(t, class_) & BootstrapFlag) == 0) {
+    for (unsigned i = 0; i < PrimarySuperCount; ++i) {
+      if (arrayBody(t, supers, i) == class_) {
+        return i;
+      }
+    }
+  }
+  return -1;
+}
+
 bool
 isAssignableFrom(Thread* t, object a, object b);
 
@@ -2295,8 +2366,8 @@ extendedWord(Thread* t UNUSED, object o, unsigned baseSize)
   return fieldAtOffset<uintptr_t>(o, baseSize * BytesPerWord);
 }
 
-inline unsigned
-extendedSize(Thread* t, object o, unsigned baseSize)
+inline uintptr_t
+extendedSize(Thread* t, object o, uintptr_t baseSize)
 {
   return baseSize + objectExtended(t, o);
 }
@@ -2499,6 +2570,28 @@ fieldSize(Thread* t, object field)
   return fieldSize(t, fieldCode(t, field));
 }
 
+// Instance fields are laid out in groups: 64-bit primitives first,
+// then references, then 32-, 16- and 8-bit primitives.  Padding is
+// then only needed before the first 64-bit field, when the superclass
+// fields (or, on 32-bit targets, the object header) end on a 4-byte
+// boundary.  The order is the same on every target, which the type
+// generator and the boot image generator rely on.  See also
+// FieldLayoutGroupCount in constants.h.
+inline unsigned
+fieldLayoutGroup(Thread* t, unsigned code)
+{
+  if (code == ObjectField) {
+    return 1;
+  } else {
+    switch (primitiveSize(t, code)) {
+    case 8: return 0;
+    case 4: return 2;
+    case 2: return 3;
+    default: return 4;
+    }
+  }
+}
+
 inline void
 scanMethodSpec(Thread* t, const char* s, unsigned* parameterCount,
                unsigned* returnCode)
@@ -2532,7 +2625,13 @@ parseUtf8(Thread* t, object array);
 
 object
 parseClass(Thread* t, object loader, const uint8_t* data, unsigned length,
-           Machine::Type throwType = Machine::NoClassDefFoundErrorType);
+           Machine::Type throwType = Machine::NoClassDefFoundErrorType,
+           bool archive = false);
+
+// finishes making a class from the state parseClass (or the class
+// archive) has left in the specified temporary class and pool
+object
+installClass(Thread* t, object class_, object pool);
 
 object
 resolveClass(Thread* t, object loader, object name, bool throw_ = true,
@@ -2609,6 +2708,13 @@ makeObjectArray(Thread* t, unsigned count)
   return makeObjectArray(t, type(t, Machine::JobjectType), count);
 }
 
+bool
+compatibleArrayTypes(Thread* t, object a, object b);
+
+void
+arrayCopy(Thread* t, object src, int32_t srcOffset, object dst,
+          int32_t dstOffset, int32_t length);
+
 object
 findFieldInClass(Thread* t, object class_, object name, object spec);
 
@@ -2729,6 +2835,19 @@ throwNew(Thread* t, Machine::Type type, const char* format, ...)
   }
 }
 
+// throws OutOfMemoryError unless an object made of fixedSizeInBytes
+// followed by length elements has a size in bytes which fits in a word
+inline void
+checkArraySize(Thread* t, uintptr_t length, unsigned elementSizeInBytes,
+               unsigned fixedSizeInBytes)
+{
+  if (UNLIKELY(length > (~static_cast<uintptr_t>(0) - fixedSizeInBytes
+                         - BytesPerWord) / elementSizeInBytes))
+  {
+    throw_(t, root(t, Machine::OutOfMemoryError));
+  }
+}
+
 object
 findInHierarchyOrNull(Thread* t, object class_, object name, object spec,
                       object (*find)(Thread*, object, object, object));
@@ -3066,7 +3185,7 @@ monitorFindWait(Thread* t, object monitor)
 }
 
 inline bool
-monitorWait(Thread* t, object monitor, int64_t time)
+monitorWait(Thread* t, object monitor, int64_t nanoseconds)
 {
   expect(t, monitorOwner(t, monitor) == t);
 
@@ -3091,7 +3210,8 @@ monitorWait(Thread* t, object monitor, int64_t time)
 
     ENTER(t, Thread::IdleState);
 
-    interrupted = t->lock->waitAndClearInterrupted(t->systemThread, time);
+    interrupted = t->lock->waitAndClearInterrupted
+      (t->systemThread, nanoseconds);
   }
 
   monitorAcquire(t, monitor, monitorNode);
@@ -3208,8 +3328,26 @@ release(Thread* t, object o)
   monitorRelease(t, m);
 }
 
+// Converts a Java-style timeout to the nanoseconds expected by
+// System::Monitor::wait, saturating rather than overflowing.  A
+// negative timeout is treated as one which has already expired.
+inline int64_t
+timeoutInNanoseconds(int64_t milliseconds, int32_t nanoseconds = 0)
+{
+  const int64_t NanosecondsPerMillisecond = 1000 * 1000;
+  const int64_t Max = INT64_C(0x7FFFFFFFFFFFFFFF);
+
+  if (milliseconds < 0) {
+    return -1;
+  } else if (milliseconds > (Max - nanoseconds) / NanosecondsPerMillisecond) {
+    return Max;
+  } else {
+    return (milliseconds * NanosecondsPerMillisecond) + nanoseconds;
+  }
+}
+
 inline void
-wait(Thread* t, object o, int64_t milliseconds)
+wait(Thread* t, object o, int64_t nanoseconds)
 {
   unsigned hash;
   if (DebugMonitors) {
@@ -3219,14 +3357,14 @@ wait(Thread* t, object o, int64_t milliseconds)
   object m = objectMonitor(t, o, false);
 
   if (DebugMonitors) {
-    fprintf(stderr, "thread %p waits %d millis on %p for %x\n",
-            t, static_cast<int>(milliseconds), m, hash);
+    fprintf(stderr, "thread %p waits %" LLD " nanos on %p for %x\n",
+            t, static_cast<long long>(nanoseconds), m, hash);
   }
 
   if (m and monitorOwner(t, m) == t) {
     PROTECT(t, m);
 
-    bool interrupted = monitorWait(t, m, milliseconds);
+    bool interrupted = monitorWait(t, m, nanoseconds);
 
     if (interrupted) {
       if (t->m->alive or (t->flags & Thread::DaemonFlag) == 0) {
@@ -3319,6 +3457,9 @@ exceptionMatch(Thread* t, object type, object exception)
 object
 intern(Thread* t, object s);
 
+object
+internByteArray(Thread* t, object array);
+
 void
 walk(Thread* t, Heap::Walker* w, object o, unsigned start);
 
@@ -3785,6 +3926,58 @@ primitiveClass(Thread* t, char name)
   }
 }
   
+// The largest number of words, including the JNIEnv and the jclass or
+// receiver, which a JNI method may take and still be called through
+// callNativeDirect.
+const unsigned MaxDirectNativeWords = 8;
+
+object
+makeJniNative(Thread* t, object method, void* function);
+
+inline uint64_t
+callNativeDirect(Thread* t, void* function, const uintptr_t* a,
+                 unsigned words)
+{
+  // each case is a separate call signature, so the C++ compiler places
+  // the arguments in registers and on the stack exactly as the
+  // platform ABI requires, without the generic marshalling done by
+  // System::call.  This is only valid for methods which makeJniNative
+  // found to take nothing wider than a word and to return no floating
+  // point value.
+  switch (words) {
+  case 2:
+    return reinterpret_cast<uint64_t (JNICALL *)
+      (uintptr_t, uintptr_t)>(function)(a[0], a[1]);
+  case 3:
+    return reinterpret_cast<uint64_t (JNICALL *)
+      (uintptr_t, uintptr_t, uintptr_t)>(function)(a[0], a[1], a[2]);
+  case 4:
+    return reinterpret_cast<uint64_t (JNICALL *)
+      (uintptr_t, uintptr_t, uintptr_t, uintptr_t)>(function)
+      (a[0], a[1], a[2], a[3]);
+  case 5:
+    return reinterpret_cast<uint64_t (JNICALL *)
+      (uintptr_t, uintptr_t, uintptr_t, uintptr_t, uintptr_t)>(function)
+      (a[0], a[1], a[2], a[3], a[4]);
+  case 6:
+    return reinterpret_cast<uint64_t (JNICALL *)
+      (uintptr_t, uintptr_t, uintptr_t, uintptr_t, uintptr_t,
+       uintptr_t)>(function)
+      (a[0], a[1], a[2], a[3], a[4], a[5]);
+  case 7:
+    return reinterpret_cast<uint64_t (JNICALL *)
+      (uintptr_t, uintptr_t, uintptr_t, uintptr_t, uintptr_t,
+       uintptr_t, uintptr_t)>(function)
+      (a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+  case 8:
+    return reinterpret_cast<uint64_t (JNICALL *)
+      (uintptr_t, uintptr_t, uintptr_t, uintptr_t, uintptr_t,
+       uintptr_t, uintptr_t, uintptr_t)>(function)
+      (a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+  default: abort(t);
+  }
+}
+
 inline void
 registerNative(Thread* t, object method, void* function)
 {
@@ -3792,7 +3985,7 @@ registerNative(Thread* t, object method, void* function)
 
   expect(t, methodFlags(t, method) & ACC_NATIVE);
 
-  object native = makeNative(t, function, false);
+  object native = makeJniNative(t, method, function);
   PROTECT(t, native);
 
   object runtimeData = getMethodRuntimeData(t, method);
@@ -3827,8 +4020,40 @@ getCaller(Thread* t, unsigned target, bool skipMethodInvoke = false);
 object
 defineClass(Thread* t, object loader, const uint8_t* buffer, unsigned length);
 
+bool
+dumpHeap(Thread* t, const char* path);
+
+ClassArchive*
+makeClassArchive(System* s, Allocator* allocator, Finder* finder,
+                 const char* path);
+
+void
+disposeClassArchive(ClassArchive* archive);
+
+const uint8_t*
+findArchivedClass(Thread* t, object loader, object spec);
+
+object
+installArchivedClass(Thread* t, object loader, const uint8_t* record,
+                     Machine::Type throwType);
+
+void
+recordArchivedClass(Thread* t, object class_, object pool);
+
+void
+writeClassArchive(Thread* t);
+
+bool
+sampleThreads(Thread* t);
+
+unsigned
+drainSamples(Thread* t, object array);
+
+void
+visitSamples(Thread* t, Heap::Visitor* v);
+
 void
-dumpHeap(Thread* t, FILE* out);
+disposeSamples(Thread* t);
 
 inline object
 methodClone(Thread* t, object method)
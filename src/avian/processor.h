@@ -50,6 +50,12 @@ class Processor {
    public:
     virtual void compiled(const void* code, unsigned size, unsigned frameSize, const char* name) = 0;
 
+    // called just before compiled() for code which has a line number
+    // table; each entry is encoded as by vm::lineNumber with the ip
+    // relative to the start of the code
+    virtual void lineNumbers(const void* code, const char* sourceFile,
+                             const uint64_t* table, unsigned count) = 0;
+
     virtual void dispose() = 0;
   };
 
@@ -70,6 +76,11 @@ class Processor {
              object class_,
              object code) = 0;
 
+  // prepares a method restored from the class archive, which was not
+  // made by makeMethod in this process
+  virtual void
+  initMethod(Thread* t, object method) = 0;
+
   virtual object
   makeClass(Thread* t,
             uint16_t flags,
@@ -139,6 +150,12 @@ class Processor {
   virtual object
   getStackTrace(Thread* t, Thread* target) = 0;
 
+  // interrupts target wherever it is and walks its stack, calling v
+  // from the interrupted thread's signal context, so v must neither
+  // allocate nor block
+  virtual void
+  sampleStack(Thread* t, Thread* target, StackVisitor* v) = 0;
+
   virtual void
   initialize(BootImage* image, uint8_t* code, unsigned capacity) = 0;
 
@@ -150,6 +167,12 @@ class Processor {
                 avian::codegen::DelayedPromise** addresses, object method,
                 OffsetResolver* resolver) = 0;
 
+  // compiles those methods named in the JIT profile recorded by a
+  // previous run which are ready to be compiled, returning the number
+  // still waiting for their classes to be initialized
+  virtual unsigned
+  precompile(Thread* t) = 0;
+
   virtual void
   visitRoots(Thread* t, HeapWalker* w) = 0;
 
@@ -211,6 +234,13 @@ class Processor {
 Processor*
 makeProcessor(System* system, Allocator* allocator, bool useNativeFeatures);
 
+// returns a handler which writes /tmp/perf-<pid>.map and/or the Linux
+// jitdump format (/tmp/jit-<pid>.dump) as selected by mode ("map",
+// "jitdump", or "true" for both), or null if unsupported or mode is
+// anything else
+Processor::CompilationHandler*
+makePerfCompilationHandler(System* s, Allocator* allocator, const char* mode);
+
 } // namespace vm
 
 #endif//PROCESSOR_H
@@ -16,6 +16,7 @@
 #  if (TARGET_BYTES_PER_WORD == 8)
 
 #define TARGET_THREAD_EXCEPTION 80
+#define TARGET_THREAD_FLAGS 2212
 #define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2256
 #define TARGET_THREAD_EXCEPTIONOFFSET 2264
 #define TARGET_THREAD_EXCEPTIONHANDLER 2272
@@ -36,6 +37,7 @@
 #  elif (TARGET_BYTES_PER_WORD == 4)
 
 #define TARGET_THREAD_EXCEPTION 44
+#define TARGET_THREAD_FLAGS 2140
 #define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2164
 #define TARGET_THREAD_EXCEPTIONOFFSET 2168
 #define TARGET_THREAD_EXCEPTIONHANDLER 2172
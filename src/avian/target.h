@@ -114,11 +114,13 @@ targetVW(T v)
 typedef uint64_t target_uintptr_t;
 typedef int64_t target_intptr_t;
 
-const unsigned TargetClassFixedSize = 12;
-const unsigned TargetClassArrayElementSize = 14;
-const unsigned TargetClassVtable = 128;
+const unsigned TargetClassFixedSize = 128;
+const unsigned TargetClassArrayElementSize = 130;
+const unsigned TargetClassPrimarySupers = 104;
+const unsigned TargetClassSecondarySuperCache = 112;
+const unsigned TargetClassVtable = 144;
 
-const unsigned TargetFieldOffset = 12;
+const unsigned TargetFieldOffset = 46;
 
 #  elif (TARGET_BYTES_PER_WORD == 4)
 
@@ -132,11 +134,13 @@ targetVW(T v)
 typedef uint32_t target_uintptr_t;
 typedef int32_t target_intptr_t;
 
-const unsigned TargetClassFixedSize = 8;
-const unsigned TargetClassArrayElementSize = 10;
-const unsigned TargetClassVtable = 68;
+const unsigned TargetClassFixedSize = 68;
+const unsigned TargetClassArrayElementSize = 70;
+const unsigned TargetClassPrimarySupers = 52;
+const unsigned TargetClassSecondarySuperCache = 56;
+const unsigned TargetClassVtable = 76;
 
-const unsigned TargetFieldOffset = 8;
+const unsigned TargetFieldOffset = 26;
 
 #  else
 #    error
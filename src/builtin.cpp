@@ -171,20 +171,102 @@ Avian_avian_Machine_dumpHeap
   unsigned length = stringLength(t, outputFile);
   THREAD_RUNTIME_ARRAY(t, char, n, length + 1);
   stringChars(t, outputFile, RUNTIME_ARRAY_BODY(n));
-  FILE* out = vm::fopen(RUNTIME_ARRAY_BODY(n), "wb");
-  if (out) {
-    { ENTER(t, Thread::ExclusiveState);
-      dumpHeap(t, out);
-    }
-    fclose(out);
-  } else {
-    throwNew(t, Machine::RuntimeExceptionType, "file not found: %s",
-             RUNTIME_ARRAY_BODY(n));
+  bool success;
+  { ENTER(t, Thread::ExclusiveState);
+    success = dumpHeap(t, RUNTIME_ARRAY_BODY(n));
+  }
+
+  if (not success) {
+    throwNew(t, Machine::RuntimeExceptionType,
+             "unable to write heap dump: %s", RUNTIME_ARRAY_BODY(n));
   }
 }
 
 #endif//AVIAN_HEAPDUMP
 
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_gcStatistics
+(Thread* t, object, uintptr_t*)
+{
+  Heap::Statistics s;
+  t->m->heap->statistics(&s);
+
+  const uint64_t scalars[] = {
+    s.minorCollectionCount,
+    s.majorCollectionCount,
+    s.totalPauseTime,
+    s.maxPauseTime,
+    s.lastPauseTime,
+    s.promotedBytes,
+    s.gen1Bytes,
+    s.gen1Capacity,
+    s.gen2Bytes,
+    s.gen2Capacity,
+    s.untenuredFixieBytes,
+    s.tenuredFixieBytes,
+    s.footprint,
+    t->m->heap->limit()
+  };
+  const unsigned scalarCount = sizeof(scalars) / sizeof(uint64_t);
+
+  object array = makeLongArray
+    (t, scalarCount + Heap::Statistics::PauseHistogramSize);
+
+  for (unsigned i = 0; i < scalarCount; ++i) {
+    longArrayBody(t, array, i) = scalars[i];
+  }
+
+  for (unsigned i = 0; i < Heap::Statistics::PauseHistogramSize; ++i) {
+    longArrayBody(t, array, scalarCount + i) = s.pauseHistogram[i];
+  }
+
+  return reinterpret_cast<int64_t>(array);
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_safepointStatistics
+(Thread* t, object, uintptr_t*)
+{
+  uint64_t values[4];
+  { ACQUIRE_RAW(t, t->m->stateLock);
+
+    values[0] = t->m->safepointCount;
+    values[1] = t->m->safepointTotalTime;
+    values[2] = t->m->safepointMaxTime;
+    values[3] = t->m->safepointLastTime;
+  }
+
+  const unsigned count = sizeof(values) / sizeof(uint64_t);
+
+  object array = makeLongArray(t, count);
+  for (unsigned i = 0; i < count; ++i) {
+    longArrayBody(t, array, i) = values[i];
+  }
+
+  return reinterpret_cast<int64_t>(array);
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Machine_precompile
+(Thread* t, object, uintptr_t*)
+{
+  return t->m->processor->precompile(t);
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Profiler_sample
+(Thread* t, object, uintptr_t*)
+{
+  return sampleThreads(t);
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_avian_Profiler_drain
+(Thread* t, object, uintptr_t* arguments)
+{
+  return drainSamples(t, reinterpret_cast<object>(*arguments));
+}
+
 extern "C" JNIEXPORT void JNICALL
 Avian_java_lang_Runtime_exit
 (Thread* t, object, uintptr_t* arguments)
@@ -0,0 +1,1247 @@
+/* Copyright (c) 2008-2014, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "avian/machine.h"
+#include "avian/alloc-vector.h"
+
+#include <avian/util/runtime-array.h>
+
+using namespace vm;
+
+// The class archive holds application classes in the form parseClass
+// leaves them in just before they are installed, so that a later run
+// with the same class path can install them without reading,
+// inflating or parsing their class files.
+//
+// Each class is stored as a record containing the graph of objects
+// reachable from its temporary class and constant pool.  References
+// to anything owned by another class (superclasses and interfaces,
+// inherited methods, string constants and the loader) are stored
+// symbolically as "externals" and resolved again when the record is
+// installed; a record whose externals no longer match what they were
+// when it was written is ignored, and the class is parsed as usual.
+//
+// The archive is only read if it was written for the same VM and the
+// same class path, as identified by the size and central directory
+// of each jar on it.  Otherwise it is rewritten from the classes
+// loaded by this run when the VM shuts down.  Class paths containing
+// directories are not archived, since we have no cheap way to tell
+// whether their contents have changed.
+
+namespace vm {
+
+class ClassArchive {
+ public:
+  enum State {
+    Unopened,
+    Reading,
+    Recording,
+    Disabled
+  };
+
+  class Record {
+   public:
+    Record(System* s, Allocator* allocator, Record* next):
+      data(s, allocator, 1024), next(next)
+    { }
+
+    Vector data;
+    Record* next;
+  };
+
+  ClassArchive(System* s, Allocator* allocator, Finder* finder,
+               char* path):
+    s(s),
+    allocator(allocator),
+    finder(finder),
+    path(path),
+    state(Unopened),
+    region(0),
+    records(0),
+    recordCount(0)
+  { }
+
+  System* s;
+  Allocator* allocator;
+  Finder* finder;
+  char* path;
+  State state;
+  System::Region* region;
+  Record* records;
+  unsigned recordCount;
+};
+
+} // namespace vm
+
+namespace {
+
+namespace local {
+
+const uint32_t Magic = 0x41564341; // "AVCA"
+const uint32_t Version = 1;
+
+const uintptr_t InternalTag = 1;
+const uintptr_t ExternalTag = 2;
+const uintptr_t TagMask = 3;
+
+const uint32_t InternedFlag = 1 << 0;
+
+enum ExternalKind {
+  ExternalClass,
+  ExternalMethod,
+  ExternalString,
+  ExternalLoader,
+  ExternalClassTable
+};
+
+enum ClassTableKind {
+  VirtualTable,
+  InterfaceTable,
+  ObjectMask
+};
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t bytesPerWord;
+  uint32_t typesDigest;
+  uint32_t elementsLength;
+  uint32_t indexCapacity;
+  uint32_t checksum;
+  uint32_t pad;
+};
+
+// followed by the path of the class path element, padded to four
+// bytes
+struct Element {
+  uint32_t length;
+  uint32_t directoryHash;
+  uint32_t pathLength;
+};
+
+struct IndexEntry {
+  uint32_t hash;
+  uint32_t offset; // zero if this entry is empty
+  uint32_t length;
+  uint32_t checksum;
+};
+
+// followed by the class name (padded to four bytes), the externals
+// (padded to a word) and the objects
+struct RecordHeader {
+  uint32_t nameLength;
+  uint32_t externalCount;
+  uint32_t objectCount;
+  uint32_t poolIndex;
+};
+
+// followed by all but the first word of the object, with each
+// reference replaced by a tagged index
+struct ObjectHeader {
+  uint32_t type;
+  uint32_t flags;
+  uint32_t size;
+  uint32_t pad;
+};
+
+inline uint32_t
+mix(uint32_t h, uint32_t v)
+{
+  return (h * 31) + v;
+}
+
+inline uint32_t
+read4(const uint8_t* p)
+{
+  uint32_t v; memcpy(&v, p, 4);
+  return v;
+}
+
+inline uint32_t
+readLittle4(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16)
+    | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void
+padVector(Vector* v, unsigned alignment)
+{
+  while (v->length() % alignment) {
+    v->append(static_cast<uint8_t>(0));
+  }
+}
+
+void
+appendBytes(Vector* v, const void* data, unsigned length)
+{
+  v->append4(length);
+  v->append(data, length);
+  padVector(v, 4);
+}
+
+char*
+copy(Allocator* allocator, const char* a)
+{
+  unsigned length = strlen(a);
+  char* p = static_cast<char*>(allocator->allocate(length + 1));
+  memcpy(p, a, length + 1);
+  return p;
+}
+
+uint32_t
+typesDigest(Thread* t)
+{
+  uint32_t h = 0;
+  for (unsigned i = 0; i < arrayLength(t, t->m->types); ++i) {
+    object type = arrayBody(t, t->m->types, i);
+    h = mix(h, classFixedSize(t, type));
+    h = mix(h, classArrayElementSize(t, type));
+
+    object mask = classObjectMask(t, type);
+    if (mask) {
+      for (unsigned j = 0; j < intArrayLength(t, mask); ++j) {
+        h = mix(h, intArrayBody(t, mask, j));
+      }
+    }
+  }
+  return h;
+}
+
+inline uint32_t
+byteArrayDigest(Thread* t, object array)
+{
+  return hash(reinterpret_cast<const uint8_t*>(&byteArrayBody(t, array, 0)),
+              byteArrayLength(t, array));
+}
+
+// summarizes everything about a class which the classes and methods
+// archived with a reference to it depend on
+uint32_t
+classDigest(Thread* t, object c)
+{
+  uint32_t h = classFlags(t, c);
+  h = mix(h, classVmFlags(t, c)
+          & (ReferenceFlag | WeakReferenceFlag | HasFinalizerFlag));
+  h = mix(h, classFixedSize(t, c));
+  h = mix(h, classArrayElementSize(t, c));
+
+  object mask = classObjectMask(t, c);
+  if (mask) {
+    for (unsigned i = 0; i < intArrayLength(t, mask); ++i) {
+      h = mix(h, intArrayBody(t, mask, i));
+    }
+  }
+
+  object vtable = classVirtualTable(t, c);
+  if (vtable) {
+    for (unsigned i = 0; i < arrayLength(t, vtable); ++i) {
+      object method = arrayBody(t, vtable, i);
+      h = mix(h, byteArrayDigest(t, methodName(t, method)));
+      h = mix(h, byteArrayDigest(t, methodSpec(t, method)));
+    }
+  }
+
+  object itable = classInterfaceTable(t, c);
+  if (itable) {
+    for (unsigned i = 0; i < arrayLength(t, itable); ++i) {
+      object o = arrayBody(t, itable, i);
+      if (o and objectClass(t, o) == type(t, Machine::ClassType)) {
+        h = mix(h, byteArrayDigest(t, className(t, o)));
+      }
+    }
+  }
+
+  return h;
+}
+
+// hashes the central directory of a jar file, which changes whenever
+// any of its entries do
+uint32_t
+directoryHash(const uint8_t* data, unsigned length)
+{
+  const unsigned EndLength = 22;
+
+  if (length >= EndLength) {
+    unsigned limit = length > EndLength + 0xFFFF
+      ? length - EndLength - 0xFFFF : 0;
+
+    for (unsigned i = length - EndLength + 1; i > limit;) {
+      const uint8_t* p = data + (-- i);
+      if (readLittle4(p) == 0x06054b50) {
+        unsigned size = readLittle4(p + 12);
+        unsigned offset = readLittle4(p + 16);
+        if (offset <= i and size <= i - offset) {
+          return mix(hash(data + offset, size), hash(p, length - i));
+        }
+        break;
+      }
+    }
+  }
+
+  return hash(data, length);
+}
+
+// describes each element of the current class path, returning false
+// if any of them can't be archived
+bool
+describeClassPath(System* s, const char* path, Vector* out)
+{
+  unsigned start = 0;
+  for (unsigned i = 0;; ++i) {
+    if (path[i] == s->pathSeparator() or path[i] == 0) {
+      unsigned pathLength = i - start;
+      if (pathLength) {
+        RUNTIME_ARRAY(char, name, pathLength + 1);
+        memcpy(RUNTIME_ARRAY_BODY(name), path + start, pathLength);
+        RUNTIME_ARRAY_BODY(name)[pathLength] = 0;
+
+        unsigned length;
+        if (s->stat(RUNTIME_ARRAY_BODY(name), &length) != System::TypeFile) {
+          return false;
+        }
+
+        System::Region* region;
+        if (not s->success(s->map(&region, RUNTIME_ARRAY_BODY(name)))) {
+          return false;
+        }
+
+        Element element;
+        element.length = region->length();
+        element.directoryHash = directoryHash
+          (region->start(), region->length());
+        element.pathLength = pathLength;
+
+        region->dispose();
+
+        out->append(&element, sizeof(Element));
+        out->append(path + start, pathLength);
+        padVector(out, 4);
+      }
+
+      if (path[i] == 0) {
+        return true;
+      }
+
+      start = i + 1;
+    }
+  }
+}
+
+void
+openArchive(Thread* t, ClassArchive* a)
+{
+  Vector elements(a->s, a->allocator, 1024);
+  if (not describeClassPath(a->s, a->finder->path(), &elements)) {
+    a->state = ClassArchive::Disabled;
+    return;
+  }
+
+  a->state = ClassArchive::Recording;
+
+  System::Region* region;
+  if (not a->s->success(a->s->map(&region, a->path))) {
+    return;
+  }
+
+  const uint8_t* start = region->start();
+  unsigned length = region->length();
+  const Header* h = reinterpret_cast<const Header*>(start);
+
+  if (length >= sizeof(Header)
+      and h->magic == Magic
+      and h->version == Version
+      and h->bytesPerWord == BytesPerWord
+      and h->typesDigest == typesDigest(t)
+      and h->elementsLength == elements.length()
+      and h->indexCapacity
+      and h->indexCapacity <= length / sizeof(IndexEntry)
+      and (h->indexCapacity & (h->indexCapacity - 1)) == 0
+      and h->elementsLength + (h->indexCapacity * sizeof(IndexEntry))
+      <= length - sizeof(Header)
+      and hash(start + sizeof(Header), h->elementsLength
+               + (h->indexCapacity * sizeof(IndexEntry))) == h->checksum
+      and memcmp(start + sizeof(Header), elements.data, elements.length())
+      == 0)
+  {
+    a->region = region;
+    a->state = ClassArchive::Reading;
+  } else {
+    region->dispose();
+  }
+}
+
+bool
+archivable(Thread* t, object class_, object o)
+{
+  object c = objectClass(t, o);
+  if (c == type(t, Machine::MethodType)) {
+    return methodClass(t, o) == class_;
+  }
+
+  return c == type(t, Machine::ByteArrayType)
+    or c == type(t, Machine::CharArrayType)
+    or c == type(t, Machine::ShortArrayType)
+    or c == type(t, Machine::IntArrayType)
+    or c == type(t, Machine::ArrayType)
+    or c == type(t, Machine::SingletonType)
+    or c == type(t, Machine::ReferenceType)
+    or c == type(t, Machine::PairType)
+    or c == type(t, Machine::FieldType)
+    or c == type(t, Machine::CodeType)
+    or c == type(t, Machine::ExceptionHandlerTableType)
+    or c == type(t, Machine::LineNumberTableType)
+    or c == type(t, Machine::ClassAddendumType)
+    or c == type(t, Machine::MethodAddendumType)
+    or c == type(t, Machine::FieldAddendumType)
+    or c == type(t, Machine::InnerClassReferenceType);
+}
+
+int
+typeIndex(Thread* t, object c)
+{
+  for (unsigned i = 0; i < arrayLength(t, t->m->types); ++i) {
+    if (arrayBody(t, t->m->types, i) == c) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// identity map from objects to their tagged indexes, usable only
+// while the heap can't move anything
+class ObjectMap {
+ public:
+  ObjectMap(Allocator* allocator):
+    allocator(allocator), keys(0), values(0), count(0), capacity(0)
+  { }
+
+  ~ObjectMap() {
+    if (capacity) {
+      allocator->free(keys, capacity * BytesPerWord);
+      allocator->free(values, capacity * BytesPerWord);
+    }
+  }
+
+  uintptr_t find(object o) {
+    if (capacity) {
+      for (unsigned i = index(o);; i = (i + 1) & (capacity - 1)) {
+        if (keys[i] == o) {
+          return values[i];
+        } else if (keys[i] == 0) {
+          return 0;
+        }
+      }
+    }
+    return 0;
+  }
+
+  void insert(object o, uintptr_t value) {
+    if ((count + 1) * 2 > capacity) {
+      grow();
+    }
+
+    unsigned i = index(o);
+    while (keys[i]) {
+      i = (i + 1) & (capacity - 1);
+    }
+
+    keys[i] = o;
+    values[i] = value;
+    ++ count;
+  }
+
+  unsigned index(object o) {
+    return (reinterpret_cast<uintptr_t>(o) / BytesPerWord) & (capacity - 1);
+  }
+
+  void grow() {
+    object* oldKeys = keys;
+    uintptr_t* oldValues = values;
+    unsigned oldCapacity = capacity;
+
+    capacity = (capacity ? capacity * 2 : 256);
+    keys = static_cast<object*>
+      (allocator->allocate(capacity * BytesPerWord));
+    values = static_cast<uintptr_t*>
+      (allocator->allocate(capacity * BytesPerWord));
+    memset(keys, 0, capacity * BytesPerWord);
+    count = 0;
+
+    for (unsigned i = 0; i < oldCapacity; ++i) {
+      if (oldKeys[i]) {
+        insert(oldKeys[i], oldValues[i]);
+      }
+    }
+
+    if (oldCapacity) {
+      allocator->free(oldKeys, oldCapacity * BytesPerWord);
+      allocator->free(oldValues, oldCapacity * BytesPerWord);
+    }
+  }
+
+  Allocator* allocator;
+  object* keys;
+  uintptr_t* values;
+  unsigned count;
+  unsigned capacity;
+};
+
+// serializes the objects making up a class.  Nothing may be allocated
+// on the heap while this is in use, since it holds raw pointers.
+class Writer {
+ public:
+  class Discoverer: public Heap::Walker {
+   public:
+    Discoverer(Writer* w, object o): w(w), o(o) { }
+
+    virtual bool visit(unsigned offset) {
+      if (offset) {
+        object c = objectClass(w->t, o);
+        // annotation data is copied rather than interned
+        bool raw
+          = ((c == type(w->t, Machine::ClassAddendumType)
+              or c == type(w->t, Machine::MethodAddendumType)
+              or c == type(w->t, Machine::FieldAddendumType))
+             and offset * BytesPerWord == AddendumAnnotationTable)
+          or (c == type(w->t, Machine::MethodAddendumType)
+              and offset * BytesPerWord == MethodAddendumAnnotationDefault);
+
+        w->reference(fieldAtOffset<object>(o, offset * BytesPerWord), raw);
+      }
+      return not w->failed;
+    }
+
+    Writer* w;
+    object o;
+  };
+
+  class Encoder: public Heap::Walker {
+   public:
+    Encoder(Writer* w, object o, Vector* out, unsigned start):
+      w(w), o(o), out(out), start(start)
+    { }
+
+    virtual bool visit(unsigned offset) {
+      if (offset) {
+        uintptr_t r = w->map.find
+          (fieldAtOffset<object>(o, offset * BytesPerWord));
+        out->set(start + ((offset - 1) * BytesPerWord), &r, BytesPerWord);
+      }
+      return true;
+    }
+
+    Writer* w;
+    object o;
+    Vector* out;
+    unsigned start;
+  };
+
+  Writer(Thread* t, ClassArchive* a, object class_):
+    t(t),
+    class_(class_),
+    super(classSuper(t, class_)),
+    map(a->allocator),
+    objects(a->s, a->allocator, 256),
+    flags(a->s, a->allocator, 64),
+    externals(a->s, a->allocator, 256),
+    externalCount(0),
+    failed(false)
+  { }
+
+  unsigned objectCount() {
+    return objects.length() / BytesPerWord;
+  }
+
+  object objectAt(unsigned index) {
+    return reinterpret_cast<object>
+      (objects.getAddress(index * BytesPerWord));
+  }
+
+  uintptr_t addInternal(object o) {
+    uintptr_t r = (objectCount() << 2) | InternalTag;
+    objects.appendAddress(o);
+    flags.append4(0);
+    map.insert(o, r);
+    return r;
+  }
+
+  uintptr_t addExternal(object o, ExternalKind kind) {
+    uintptr_t r = (externalCount++ << 2) | ExternalTag;
+    externals.append4(kind);
+    map.insert(o, r);
+    return r;
+  }
+
+  uintptr_t addClassTable(object o, ClassTableKind kind) {
+    uintptr_t owner = reference(super, false);
+    uintptr_t r = addExternal(o, ExternalClassTable);
+    externals.append4(owner >> 2);
+    externals.append4(kind);
+    return r;
+  }
+
+  uintptr_t add(object o) {
+    object c = objectClass(t, o);
+    if (c == type(t, Machine::ClassType)) {
+      uintptr_t r = addExternal(o, ExternalClass);
+      externals.append4(classDigest(t, o));
+      appendBytes(&externals, &byteArrayBody(t, className(t, o), 0),
+                  byteArrayLength(t, className(t, o)));
+      return r;
+    } else if (c == type(t, Machine::MethodType)
+               and methodClass(t, o) != class_)
+    {
+      object owner = methodClass(t, o);
+      object vtable = classVirtualTable(t, owner);
+      if (vtable == 0
+          or methodOffset(t, o) >= arrayLength(t, vtable)
+          or arrayBody(t, vtable, methodOffset(t, o)) != o)
+      {
+        failed = true;
+        return 0;
+      }
+
+      uintptr_t ownerReference = reference(owner, false);
+      uintptr_t r = addExternal(o, ExternalMethod);
+      externals.append4(ownerReference >> 2);
+      externals.append4(methodOffset(t, o));
+      appendBytes(&externals, &byteArrayBody(t, methodName(t, o), 0),
+                  byteArrayLength(t, methodName(t, o)));
+      appendBytes(&externals, &byteArrayBody(t, methodSpec(t, o), 0),
+                  byteArrayLength(t, methodSpec(t, o)));
+      return r;
+    } else if (c == type(t, Machine::StringType)) {
+      uintptr_t r = addExternal(o, ExternalString);
+      unsigned length = stringLength(t, o);
+      externals.append4(length);
+      stringChars(t, o, static_cast<uint16_t*>
+                  (externals.allocate(length * 2)));
+      padVector(&externals, 4);
+      return r;
+    } else if (o == classLoader(t, class_)) {
+      return addExternal(o, ExternalLoader);
+    } else if (super and o == classVirtualTable(t, super)) {
+      return addClassTable(o, VirtualTable);
+    } else if (super and o == classInterfaceTable(t, super)) {
+      return addClassTable(o, InterfaceTable);
+    } else if (super and o == classObjectMask(t, super)) {
+      return addClassTable(o, ObjectMask);
+    } else if (archivable(t, class_, o)) {
+      return addInternal(o);
+    } else {
+      failed = true;
+      return 0;
+    }
+  }
+
+  uintptr_t reference(object o, bool raw) {
+    if (o == 0 or failed) {
+      return 0;
+    }
+
+    uintptr_t r = map.find(o);
+    if (r == 0) {
+      r = add(o);
+    }
+
+    if ((r & TagMask) == InternalTag
+        and (not raw)
+        and objectClass(t, o) == type(t, Machine::ByteArrayType))
+    {
+      unsigned offset = (r >> 2) * 4;
+      flags.set(offset, &InternedFlag, 4);
+    }
+
+    return r;
+  }
+
+  bool write(object pool, Vector* out) {
+    addInternal(class_);
+    uintptr_t poolReference = reference(pool, false);
+
+    for (unsigned i = 0; i < objectCount() and not failed; ++i) {
+      Discoverer discoverer(this, objectAt(i));
+      walk(t, &discoverer, objectAt(i), 0);
+    }
+
+    if (failed) {
+      return false;
+    }
+
+    object name = className(t, class_);
+
+    RecordHeader h;
+    h.nameLength = byteArrayLength(t, name);
+    h.externalCount = externalCount;
+    h.objectCount = objectCount();
+    h.poolIndex = poolReference >> 2;
+
+    out->append(&h, sizeof(RecordHeader));
+    out->append(&byteArrayBody(t, name, 0), h.nameLength);
+    padVector(out, 4);
+    out->append(externals.data, externals.length());
+    padVector(out, BytesPerWord);
+
+    for (unsigned i = 0; i < objectCount(); ++i) {
+      object o = objectAt(i);
+      object c = objectClass(t, o);
+
+      ObjectHeader oh;
+      oh.type = typeIndex(t, c);
+      oh.flags = flags.get4(i * 4);
+      oh.size = baseSize(t, o, c);
+      oh.pad = 0;
+
+      out->append(&oh, sizeof(ObjectHeader));
+
+      unsigned start = out->length();
+      out->append(reinterpret_cast<uintptr_t*>(o) + 1,
+                  (oh.size - 1) * BytesPerWord);
+
+      if (c == type(t, Machine::CodeType)) {
+        // compiled code belongs to the process which compiled it
+        const uintptr_t zero = 0;
+        out->set(start + CodeCompiled - BytesPerWord, &zero,
+                 BytesPerWord);
+        out->set(start + CodeCompiledSize - BytesPerWord, &zero, 4);
+      }
+
+      Encoder encoder(this, o, out, start);
+      walk(t, &encoder, o, 0);
+    }
+
+    return true;
+  }
+
+  Thread* t;
+  object class_;
+  object super;
+  ObjectMap map;
+  Vector objects;
+  Vector flags;
+  Vector externals;
+  unsigned externalCount;
+  bool failed;
+};
+
+class Decoder: public Heap::Walker {
+ public:
+  Decoder(Thread* t, object o, const uint8_t* body, object objects,
+          object externals):
+    t(t), o(o), body(body), objects(objects), externals(externals),
+    failed(false)
+  { }
+
+  virtual bool visit(unsigned offset) {
+    if (offset) {
+      uintptr_t r; memcpy(&r, body + ((offset - 1) * BytesPerWord),
+                          BytesPerWord);
+
+      object value = 0;
+      switch (r & TagMask) {
+      case 0:
+        break;
+
+      case InternalTag:
+        if ((r >> 2) < arrayLength(t, objects)) {
+          value = arrayBody(t, objects, r >> 2);
+        } else {
+          failed = true;
+        }
+        break;
+
+      case ExternalTag:
+        if ((r >> 2) < arrayLength(t, externals)) {
+          value = arrayBody(t, externals, r >> 2);
+        } else {
+          failed = true;
+        }
+        break;
+
+      default:
+        failed = true;
+        break;
+      }
+
+      set(t, o, offset * BytesPerWord, value);
+    }
+    return not failed;
+  }
+
+  Thread* t;
+  object o;
+  const uint8_t* body;
+  object objects;
+  object externals;
+  bool failed;
+};
+
+class Clearer: public Heap::Walker {
+ public:
+  Clearer(object o): o(o) { }
+
+  virtual bool visit(unsigned offset) {
+    if (offset) {
+      fieldAtOffset<object>(o, offset * BytesPerWord) = 0;
+    }
+    return true;
+  }
+
+  object o;
+};
+
+object
+makeArchivedByteArray(Thread* t, const uint8_t*& p)
+{
+  unsigned length = read4(p);
+  object array = makeByteArray(t, length);
+  memcpy(&byteArrayBody(t, array, 0), p + 4, length);
+  p += 4 + pad(length, 4);
+  return array;
+}
+
+bool
+matches(Thread* t, object array, const uint8_t*& p)
+{
+  unsigned length = read4(p);
+  bool r = length == byteArrayLength(t, array)
+    and memcmp(&byteArrayBody(t, array, 0), p + 4, length) == 0;
+  p += 4 + pad(length, 4);
+  return r;
+}
+
+// resolves the externals of a record, returning false if any of them
+// no longer match what they were when it was written
+bool
+resolveExternals(Thread* t, object loader, const uint8_t*& p,
+                 object externals, Machine::Type throwType)
+{
+  PROTECT(t, loader);
+  PROTECT(t, externals);
+
+  for (unsigned i = 0; i < arrayLength(t, externals); ++i) {
+    object value;
+    switch (read4(p)) {
+    case ExternalClass: {
+      uint32_t digest = read4(p + 4);
+      p += 8;
+      object name = makeArchivedByteArray(t, p);
+      value = resolveClass(t, loader, name, true, throwType);
+      if (classDigest(t, value) != digest) {
+        return false;
+      }
+    } break;
+
+    case ExternalMethod: {
+      unsigned owner = read4(p + 4);
+      unsigned offset = read4(p + 8);
+      p += 12;
+      if (owner >= i) {
+        return false;
+      }
+
+      object vtable = classVirtualTable(t, arrayBody(t, externals, owner));
+      if (vtable == 0 or offset >= arrayLength(t, vtable)) {
+        return false;
+      }
+
+      value = arrayBody(t, vtable, offset);
+      if (not (matches(t, methodName(t, value), p)
+               and matches(t, methodSpec(t, value), p)))
+      {
+        return false;
+      }
+    } break;
+
+    case ExternalString: {
+      unsigned length = read4(p + 4);
+      object array = makeCharArray(t, length);
+      memcpy(&charArrayBody(t, array, 0), p + 8, length * 2);
+      p += 8 + pad(length * 2, 4);
+      value = intern(t, t->m->classpath->makeString(t, array, 0, length));
+    } break;
+
+    case ExternalLoader:
+      value = loader;
+      p += 4;
+      break;
+
+    case ExternalClassTable: {
+      unsigned owner = read4(p + 4);
+      unsigned kind = read4(p + 8);
+      p += 12;
+      if (owner >= i) {
+        return false;
+      }
+
+      object c = arrayBody(t, externals, owner);
+      switch (kind) {
+      case VirtualTable: value = classVirtualTable(t, c); break;
+      case InterfaceTable: value = classInterfaceTable(t, c); break;
+      case ObjectMask: value = classObjectMask(t, c); break;
+      default: return false;
+      }
+    } break;
+
+    default:
+      return false;
+    }
+
+    set(t, externals, ArrayBody + (i * BytesPerWord), value);
+  }
+
+  return true;
+}
+
+void
+write(ClassArchive* a, FILE* out, uint32_t digest, Vector* elements)
+{
+  unsigned capacity = 16;
+  while (capacity < a->recordCount * 2) {
+    capacity *= 2;
+  }
+
+  Vector table(a->s, a->allocator, 1024);
+  table.append(elements->data, elements->length());
+
+  IndexEntry* index = static_cast<IndexEntry*>
+    (table.allocate(capacity * sizeof(IndexEntry)));
+  memset(index, 0, capacity * sizeof(IndexEntry));
+
+  unsigned offset = pad(sizeof(Header) + table.length(), 8);
+  for (ClassArchive::Record* r = a->records; r; r = r->next) {
+    const uint8_t* data = r->data.data;
+    const RecordHeader* h = reinterpret_cast<const RecordHeader*>(data);
+    uint32_t nameHash = hash(data + sizeof(RecordHeader), h->nameLength - 1);
+
+    unsigned i = nameHash & (capacity - 1);
+    while (index[i].offset) {
+      i = (i + 1) & (capacity - 1);
+    }
+
+    index[i].hash = nameHash;
+    index[i].offset = offset;
+    index[i].length = r->data.length();
+    index[i].checksum = hash(data, r->data.length());
+
+    offset = pad(offset + r->data.length(), 8);
+  }
+
+  Header header;
+  header.magic = Magic;
+  header.version = Version;
+  header.bytesPerWord = BytesPerWord;
+  header.typesDigest = digest;
+  header.elementsLength = elements->length();
+  header.indexCapacity = capacity;
+  header.checksum = hash(table.data, table.length());
+  header.pad = 0;
+
+  const uint8_t zero[8] = { 0 };
+
+  fwrite(&header, sizeof(Header), 1, out);
+  fwrite(table.data, table.length(), 1, out);
+
+  unsigned position = sizeof(Header) + table.length();
+  for (ClassArchive::Record* r = a->records; r; r = r->next) {
+    fwrite(zero, pad(position, 8) - position, 1, out);
+    position = pad(position, 8);
+    fwrite(r->data.data, r->data.length(), 1, out);
+    position += r->data.length();
+  }
+}
+
+} // namespace local
+
+} // namespace
+
+namespace vm {
+
+ClassArchive*
+makeClassArchive(System* s, Allocator* allocator, Finder* finder,
+                 const char* path)
+{
+  return new (allocator->allocate(sizeof(ClassArchive)))
+    ClassArchive(s, allocator, finder, local::copy(allocator, path));
+}
+
+void
+disposeClassArchive(ClassArchive* a)
+{
+  if (a->region) {
+    a->region->dispose();
+  }
+
+  for (ClassArchive::Record* r = a->records; r;) {
+    ClassArchive::Record* next = r->next;
+    r->data.dispose();
+    a->allocator->free(r, sizeof(ClassArchive::Record));
+    r = next;
+  }
+
+  a->allocator->free(a->path, strlen(a->path) + 1);
+  a->allocator->free(a, sizeof(ClassArchive));
+}
+
+const uint8_t*
+findArchivedClass(Thread* t, object loader, object spec)
+{
+  ClassArchive* a = t->m->classArchive;
+  if (a == 0 or loader != root(t, Machine::AppLoader)) {
+    return 0;
+  }
+
+  if (a->state == ClassArchive::Unopened) {
+    local::openArchive(t, a);
+  }
+
+  if (a->state != ClassArchive::Reading) {
+    return 0;
+  }
+
+  const uint8_t* start = a->region->start();
+  const local::Header* h = reinterpret_cast<const local::Header*>(start);
+  const local::IndexEntry* index = reinterpret_cast<const local::IndexEntry*>
+    (start + sizeof(local::Header) + h->elementsLength);
+  unsigned capacity = h->indexCapacity;
+
+  unsigned nameLength = byteArrayLength(t, spec);
+  const uint8_t* name = reinterpret_cast<const uint8_t*>
+    (&byteArrayBody(t, spec, 0));
+  uint32_t nameHash = hash(name, nameLength - 1);
+
+  for (unsigned i = nameHash & (capacity - 1), n = 0;
+       index[i].offset and n < capacity;
+       i = (i + 1) & (capacity - 1), ++n)
+  {
+    const local::IndexEntry* e = index + i;
+    if (e->hash == nameHash
+        and e->offset % BytesPerWord == 0
+        and e->offset <= a->region->length()
+        and e->length >= sizeof(local::RecordHeader)
+        and e->length <= a->region->length() - e->offset)
+    {
+      const uint8_t* record = start + e->offset;
+      const local::RecordHeader* rh
+        = reinterpret_cast<const local::RecordHeader*>(record);
+
+      if (rh->nameLength == nameLength
+          and memcmp(record + sizeof(local::RecordHeader), name, nameLength)
+          == 0)
+      {
+        if (hash(record, e->length) == e->checksum) {
+          return record;
+        } else {
+          return 0;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+object
+installArchivedClass(Thread* t, object loader, const uint8_t* record,
+                     Machine::Type throwType)
+{
+  PROTECT(t, loader);
+
+  const local::RecordHeader* h
+    = reinterpret_cast<const local::RecordHeader*>(record);
+
+  if (h->objectCount == 0) {
+    return 0;
+  }
+
+  const uint8_t* p = record + sizeof(local::RecordHeader)
+    + pad(h->nameLength, 4);
+
+  object externals = makeArray(t, h->externalCount);
+  PROTECT(t, externals);
+
+  if (not local::resolveExternals(t, loader, p, externals, throwType)) {
+    return 0;
+  }
+
+  p = record + pad(p - record);
+
+  object objects = makeArray(t, h->objectCount);
+  PROTECT(t, objects);
+
+  THREAD_RUNTIME_ARRAY(t, const uint8_t*, bodies, h->objectCount);
+
+  for (unsigned i = 0; i < h->objectCount; ++i) {
+    const local::ObjectHeader* oh
+      = reinterpret_cast<const local::ObjectHeader*>(p);
+
+    if (oh->type >= arrayLength(t, t->m->types) or oh->size == 0) {
+      return 0;
+    }
+
+    object type = arrayBody(t, t->m->types, oh->type);
+    if (i == 0 and type != vm::type(t, Machine::ClassType)) {
+      return 0;
+    }
+
+    const uint8_t* body = p + sizeof(local::ObjectHeader);
+    RUNTIME_ARRAY_BODY(bodies)[i] = body;
+
+    object o = allocate
+      (t, oh->size * BytesPerWord,
+       classObjectMask(t, type) != 0
+       or type == vm::type(t, Machine::SingletonType));
+
+    memcpy(reinterpret_cast<uintptr_t*>(o) + 1, body,
+           (oh->size - 1) * BytesPerWord);
+    // the type may have moved during allocation
+    setObjectClass(t, o, arrayBody(t, t->m->types, oh->type));
+
+    local::Clearer clearer(o);
+    walk(t, &clearer, o, 0);
+
+    if (oh->flags & local::InternedFlag) {
+      o = internByteArray(t, o);
+    }
+
+    set(t, objects, ArrayBody + (i * BytesPerWord), o);
+
+    p = body + ((oh->size - 1) * BytesPerWord);
+  }
+
+  for (unsigned i = 0; i < h->objectCount; ++i) {
+    object o = arrayBody(t, objects, i);
+    local::Decoder decoder
+      (t, o, RUNTIME_ARRAY_BODY(bodies)[i], objects, externals);
+    walk(t, &decoder, o, 0);
+    if (decoder.failed) {
+      return 0;
+    }
+  }
+
+  object class_ = arrayBody(t, objects, 0);
+  PROTECT(t, class_);
+
+  if (h->poolIndex >= h->objectCount) {
+    return 0;
+  }
+
+  object pool = arrayBody(t, objects, h->poolIndex);
+  PROTECT(t, pool);
+
+  // the superclass may have been initialized since the class was
+  // archived, so recompute whether this one still needs to be
+  classVmFlags(t, class_) &= ~NeedInitFlag;
+
+  object methodTable = classMethodTable(t, class_);
+  if (methodTable) {
+    for (unsigned i = 0; i < arrayLength(t, methodTable); ++i) {
+      object method = arrayBody(t, methodTable, i);
+      if (methodVmFlags(t, method) & ClassInitFlag) {
+        classVmFlags(t, class_) |= NeedInitFlag;
+      }
+    }
+  }
+
+  if (classSuper(t, class_)) {
+    classVmFlags(t, class_)
+      |= (classVmFlags(t, classSuper(t, class_)) & NeedInitFlag);
+  }
+
+  for (unsigned i = 0; i < h->objectCount; ++i) {
+    object o = arrayBody(t, objects, i);
+    if (objectClass(t, o) == type(t, Machine::MethodType)) {
+      t->m->processor->initMethod(t, o);
+    }
+  }
+
+  return installClass(t, class_, pool);
+}
+
+void
+recordArchivedClass(Thread* t, object class_, object pool)
+{
+  ClassArchive* a = t->m->classArchive;
+  if (a == 0 or classLoader(t, class_) != root(t, Machine::AppLoader)) {
+    return;
+  }
+
+  if (a->state == ClassArchive::Unopened) {
+    local::openArchive(t, a);
+  }
+
+  if (a->state != ClassArchive::Recording) {
+    return;
+  }
+
+  ClassArchive::Record* r = new
+    (a->allocator->allocate(sizeof(ClassArchive::Record)))
+    ClassArchive::Record(a->s, a->allocator, a->records);
+
+  local::Writer writer(t, a, class_);
+  if (writer.write(pool, &(r->data))) {
+    a->records = r;
+    ++ a->recordCount;
+  } else {
+    r->data.dispose();
+    a->allocator->free(r, sizeof(ClassArchive::Record));
+  }
+}
+
+void
+writeClassArchive(Thread* t)
+{
+  ClassArchive* a = t->m->classArchive;
+
+  ACQUIRE(t, t->m->classLock);
+
+  if (a->state != ClassArchive::Recording or a->recordCount == 0) {
+    return;
+  }
+
+  a->state = ClassArchive::Disabled;
+
+  unsigned length = strlen(a->path);
+  THREAD_RUNTIME_ARRAY(t, char, temporary, length + 5);
+  memcpy(RUNTIME_ARRAY_BODY(temporary), a->path, length);
+  memcpy(RUNTIME_ARRAY_BODY(temporary) + length, ".tmp", 5);
+
+  Vector elements(a->s, a->allocator, 1024);
+  if (not local::describeClassPath(a->s, a->finder->path(), &elements)) {
+    return;
+  }
+
+  uint32_t digest = local::typesDigest(t);
+
+  ENTER(t, Thread::IdleState);
+
+  FILE* out = vm::fopen(RUNTIME_ARRAY_BODY(temporary), "wb");
+  if (out) {
+    local::write(a, out, digest, &elements);
+
+    bool success = ferror(out) == 0;
+    if (fclose(out) != 0) {
+      success = false;
+    }
+
+    if (success and rename(RUNTIME_ARRAY_BODY(temporary), a->path) != 0) {
+      // rename won't replace an existing file on some systems
+      remove(a->path);
+      success = rename(RUNTIME_ARRAY_BODY(temporary), a->path) == 0;
+    }
+
+    if (not success) {
+      remove(RUNTIME_ARRAY_BODY(temporary));
+    }
+  }
+}
+
+} // namespace vm
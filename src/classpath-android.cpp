@@ -305,7 +305,7 @@ class MyClasspath : public Classpath {
 
     THREAD_RESOURCE0(t, {
         vm::acquire(t, t->javaThread);
-        t->flags &= ~Thread::ActiveFlag;
+        atomicAnd(&(t->flags), ~Thread::ActiveFlag);
         vm::notifyAll(t, t->javaThread);
         vm::release(t, t->javaThread);
     });
@@ -1047,8 +1047,8 @@ Avian_java_lang_VMThread_sleep
 (Thread* t, object, uintptr_t* arguments)
 {
   int64_t milliseconds; memcpy(&milliseconds, arguments, 8);
-  if (arguments[2] > 0) ++ milliseconds;
-  if (milliseconds <= 0) milliseconds = 1;
+  int64_t nanoseconds = timeoutInNanoseconds(milliseconds, arguments[2]);
+  if (nanoseconds <= 0) nanoseconds = 1;
 
   if (threadSleepLock(t, t->javaThread) == 0) {
     object lock = makeJobject(t);
@@ -1056,7 +1056,7 @@ Avian_java_lang_VMThread_sleep
   }
 
   acquire(t, threadSleepLock(t, t->javaThread));
-  vm::wait(t, threadSleepLock(t, t->javaThread), milliseconds);
+  vm::wait(t, threadSleepLock(t, t->javaThread), nanoseconds);
   release(t, threadSleepLock(t, t->javaThread));
 }
 
@@ -1169,8 +1169,10 @@ Avian_java_lang_Object_wait
 (Thread* t, object, uintptr_t* arguments)
 {
   jlong milliseconds; memcpy(&milliseconds, arguments + 1, sizeof(jlong));
+  jint nanoseconds = arguments[3];
 
-  wait(t, reinterpret_cast<object>(arguments[0]), milliseconds);
+  wait(t, reinterpret_cast<object>(arguments[0]),
+       timeoutInNanoseconds(milliseconds, nanoseconds));
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -1638,7 +1640,7 @@ extern "C" JNIEXPORT int64_t JNICALL
 Avian_java_lang_System_nanoTime
 (Thread* t, object, uintptr_t*)
 {
-  return t->m->system->now() * 1000 * 1000;
+  return t->m->system->nanoTime();
 }
 
 extern "C" JNIEXPORT int64_t JNICALL
@@ -236,13 +236,14 @@ Avian_java_lang_Object_getVMClass
 }
 
 extern "C" JNIEXPORT void JNICALL
-Avian_java_lang_Object_wait
+Avian_java_lang_Object_timedWait
 (Thread* t, object, uintptr_t* arguments)
 {
   object this_ = reinterpret_cast<object>(arguments[0]);
   int64_t milliseconds; memcpy(&milliseconds, arguments + 1, 8);
+  int32_t nanoseconds = arguments[3];
 
-  vm::wait(t, this_, milliseconds);
+  vm::wait(t, this_, timeoutInNanoseconds(milliseconds, nanoseconds));
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -532,6 +533,13 @@ Avian_java_lang_System_arraycopy
             arguments[4]);
 }
 
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_lang_System_nanoTime
+(Thread* t, object, uintptr_t*)
+{
+  return t->m->system->nanoTime();
+}
+
 extern "C" JNIEXPORT int64_t JNICALL
 Avian_java_lang_System_identityHashCode
 (Thread* t, object, uintptr_t* arguments)
@@ -568,18 +576,32 @@ Avian_java_lang_Runtime_gc
 
 extern "C" JNIEXPORT int64_t JNICALL
 Avian_java_lang_Runtime_freeMemory
-(Thread*, object, uintptr_t*)
+(Thread* t, object, uintptr_t*)
 {
-  // todo
-  return 0;
+  // committed space in the older generations which no object occupies
+  // yet; everything else in the footprint is either live, garbage
+  // awaiting collection, or a thread-local allocation chunk
+  Heap::Statistics s;
+  t->m->heap->statistics(&s);
+  uint64_t unused = (s.gen1Capacity - s.gen1Bytes)
+    + (s.gen2Capacity - s.gen2Bytes);
+  return unused < s.footprint ? unused : s.footprint;
 }
 
 extern "C" JNIEXPORT int64_t JNICALL
 Avian_java_lang_Runtime_totalMemory
-(Thread*, object, uintptr_t*)
+(Thread* t, object, uintptr_t*)
+{
+  Heap::Statistics s;
+  t->m->heap->statistics(&s);
+  return s.footprint;
+}
+
+extern "C" JNIEXPORT int64_t JNICALL
+Avian_java_lang_Runtime_maxMemory
+(Thread* t, object, uintptr_t*)
 {
-  // todo
-  return 0;
+  return t->m->heap->limit();
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -610,7 +610,7 @@ class MyClasspath : public Classpath {
 
     THREAD_RESOURCE0(t, {
         vm::acquire(t, t->javaThread);
-        t->flags &= ~Thread::ActiveFlag;
+        atomicAnd(&(t->flags), ~Thread::ActiveFlag);
         vm::notifyAll(t, t->javaThread);
         vm::release(t, t->javaThread);
     });
@@ -2941,28 +2941,27 @@ Avian_sun_misc_Unsafe_park
 {
   bool absolute = arguments[1];
   int64_t time; memcpy(&time, arguments + 2, 8);
-  
-  int64_t then = t->m->system->now();
 
   if (absolute) {
-    time -= then;
+    // an absolute deadline is given in milliseconds since the epoch,
+    // which we convert to a relative time in nanoseconds so that the
+    // wait below is measured against the monotonic clock
+    time -= t->m->system->now();
     if (time <= 0) {
       return;
     }
-  } else if (time) {
-    // if not absolute, interpret time as nanoseconds, but make sure
-    // it doesn't become zero when we convert to milliseconds, since
-    // zero is interpreted as infinity below
-    time = (time / (1000 * 1000)) + 1;
+    time = timeoutInNanoseconds(time);
   }
 
+  int64_t then = t->m->system->nanoTime();
+
   monitorAcquire(t, local::interruptLock(t, t->javaThread));
   while (time >= 0
          and (not (threadUnparked(t, t->javaThread)
                    or monitorWait
                    (t, local::interruptLock(t, t->javaThread), time))))
   {
-    int64_t now = t->m->system->now();
+    int64_t now = t->m->system->nanoTime();
     time -= now - then;
     then = now;
     
@@ -3012,7 +3011,7 @@ jvmWait(Thread* t, uintptr_t* arguments)
   jobject o = reinterpret_cast<jobject>(arguments[0]);
   jlong milliseconds; memcpy(&milliseconds, arguments + 1, sizeof(jlong));
 
-  vm::wait(t, *o, milliseconds);
+  vm::wait(t, *o, timeoutInNanoseconds(milliseconds));
 
   return 1;
 }
@@ -3104,7 +3103,7 @@ EXPORT(JVM_CurrentTimeMillis)(Thread* t, jclass)
 extern "C" JNIEXPORT jlong JNICALL
 EXPORT(JVM_NanoTime)(Thread* t, jclass)
 {
-  return t->m->system->now() * 1000 * 1000;
+  return t->m->system->nanoTime();
 }
 
 uint64_t
@@ -3292,13 +3291,16 @@ EXPORT(JVM_TraceMethodCalls)(jboolean) { abort(); }
 extern "C" JNIEXPORT jlong JNICALL
 EXPORT(JVM_TotalMemory)()
 {
-  return 0;
+  return local::globalMachine->heap->limit();
 }
 
 extern "C" JNIEXPORT jlong JNICALL
 EXPORT(JVM_FreeMemory)()
 {
-  return 0;
+  Heap::Statistics s;
+  local::globalMachine->heap->statistics(&s);
+  return s.footprint < local::globalMachine->heap->limit()
+    ? local::globalMachine->heap->limit() - s.footprint : 0;
 }
 
 extern "C" JNIEXPORT jlong JNICALL
@@ -3514,7 +3516,8 @@ jvmSleep(Thread* t, uintptr_t* arguments)
   }
 
   acquire(t, threadSleepLock(t, t->javaThread));
-  vm::wait(t, threadSleepLock(t, t->javaThread), milliseconds);
+  vm::wait(t, threadSleepLock(t, t->javaThread),
+           timeoutInNanoseconds(milliseconds));
   release(t, threadSleepLock(t, t->javaThread));
 
   return 1;
@@ -1844,6 +1844,10 @@ compile(Context* c, uintptr_t stackOverflowHandler, unsigned stackLimitOffset)
   Block* firstBlock = block(c, c->firstEvent);
   Block* block = firstBlock;
 
+  if (FurthestUse) {
+    numberEvents(c);
+  }
+
   if (stackOverflowHandler) {
     a->checkStackOverflow(stackOverflowHandler, stackLimitOffset);
   }
@@ -2163,8 +2167,11 @@ class MyCompiler: public Compiler {
 
     unsigned base = frameBase(&c);
     c.frameResources[base + c.arch->returnAddressOffset()].reserved = true;
-    c.frameResources[base + c.arch->framePointerOffset()].reserved
-      = UseFramePointer;
+    if (UseFramePointer) {
+      // without a frame pointer, framePointerOffset may alias the
+      // return address, which must stay reserved
+      c.frameResources[base + c.arch->framePointerOffset()].reserved = true;
+    }
 
     // leave room for logical instruction -1
     unsigned codeSize = sizeof(LogicalInstruction*) * (logicalCodeLength + 1);
@@ -2562,6 +2569,10 @@ class MyCompiler: public Compiler {
                       static_cast<Value*>(index), handler);
   }
 
+  virtual void checkNull(Operand* object) {
+    appendNullCheck(&c, static_cast<Value*>(object));
+  }
+
   virtual void store(unsigned srcSize, Operand* src, unsigned dstSize,
                      Operand* dst)
   {
@@ -2941,6 +2952,30 @@ class MyCompiler: public Compiler {
       (&c, lir::FloatSquareRoot, size, static_cast<Value*>(a), size, result);
     return result;
   }
+
+  virtual Operand* ffloor(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == lir::ValueFloat);
+    Value* result = value(&c, lir::ValueFloat);
+    appendTranslate
+      (&c, lir::FloatFloor, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* fceil(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == lir::ValueFloat);
+    Value* result = value(&c, lir::ValueFloat);
+    appendTranslate
+      (&c, lir::FloatCeil, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
+
+  virtual Operand* frint(unsigned size, Operand* a) {
+    assert(&c, static_cast<Value*>(a)->type == lir::ValueFloat);
+    Value* result = value(&c, lir::ValueFloat);
+    appendTranslate
+      (&c, lir::FloatRint, size, static_cast<Value*>(a), size, result);
+    return result;
+  }
   
   virtual Operand* f2f(unsigned aSize, unsigned resSize, Operand* a) {
     assert(&c, static_cast<Value*>(a)->type == lir::ValueFloat);
@@ -90,7 +90,7 @@ Event::Event(Context* c):
   stackAfter(0), localsAfter(0), promises(0), reads(0),
   junctionSites(0), snapshots(0), predecessors(0), successors(0),
   visitLinks(0), block(0), logicalInstruction(c->logicalCode[c->logicalIp]),
-  readCount(0)
+  readCount(0), sequence(0)
 { }
 
 void Event::addRead(Context* c, Value* v, Read* r) {
@@ -1601,6 +1601,51 @@ appendBoundsCheck(Context* c, Value* object, unsigned lengthOffset,
   append(c, new(c->zone) BoundsCheckEvent(c, object, lengthOffset, index, handler));
 }
 
+class NullCheckEvent: public Event {
+ public:
+  NullCheckEvent(Context* c, Value* object):
+    Event(c), object(object)
+  {
+    this->addRead(c, object, generalRegisterMask(c));
+  }
+
+  virtual const char* name() {
+    return "NullCheckEvent";
+  }
+
+  virtual void compile(Context* c) {
+    // we only care about the memory access, which will fault if the
+    // object is null, so the branch goes to the next instruction
+    // either way:
+    assert(c, object->source->type(c) == lir::RegisterOperand);
+    MemorySite header(static_cast<RegisterSite*>(object->source)->number,
+                      0, lir::NoRegister, 1);
+    header.acquired = true;
+
+    CodePromise* nextPromise = compiler::codePromise
+      (c, static_cast<Promise*>(0));
+
+    ConstantSite zero(resolvedPromise(c, 0));
+    ConstantSite next(nextPromise);
+    apply(c, lir::JumpIfEqual,
+      vm::TargetBytesPerWord, &zero, &zero,
+      vm::TargetBytesPerWord, &header, &header,
+      vm::TargetBytesPerWord, &next, &next);
+
+    nextPromise->offset = c->assembler->offset();
+
+    popRead(c, this, object);
+  }
+
+  Value* object;
+};
+
+void
+appendNullCheck(Context* c, Value* object)
+{
+  append(c, new(c->zone) NullCheckEvent(c, object));
+}
+
 
 class FrameSiteEvent: public Event {
  public:
@@ -72,6 +72,7 @@ class Event {
   Block* block;
   LogicalInstruction* logicalInstruction;
   unsigned readCount;
+  unsigned sequence;
 };
 
 class StubReadPair {
@@ -155,6 +156,9 @@ void
 appendBoundsCheck(Context* c, Value* object, unsigned lengthOffset,
                   Value* index, intptr_t handler);
 
+void
+appendNullCheck(Context* c, Value* object);
+
 void
 appendFrameSite(Context* c, Value* value, int index);
 
@@ -15,6 +15,7 @@
 #include "codegen/compiler/site.h"
 #include "codegen/compiler/resource.h"
 #include "codegen/compiler/read.h"
+#include "codegen/compiler/event.h"
 
 namespace avian {
 namespace codegen {
@@ -29,6 +30,76 @@ RegisterAllocator::RegisterAllocator(Aborter* a, const RegisterFile* registerFil
 unsigned totalFrameSize(Context* c);
 Read* live(Context* c UNUSED, Value* v);
 
+// The furthest-use mode (see FurthestUse in regalloc.h) keeps the
+// greedy, cost-based choice of sites, but numbers events in program
+// order so that it can break ties between equally costly registers
+// and, when none is free, evict the occupant whose next use is
+// furthest away rather than spill the value being placed.
+
+const unsigned NoUse = ~static_cast<unsigned>(0);
+
+void
+numberEvents(Context* c)
+{
+  unsigned sequence = 0;
+  for (Event* e = c->firstEvent; e; e = e->next) {
+    e->sequence = sequence++;
+  }
+}
+
+unsigned
+nextUse(Context* c, Value* v)
+{
+  if (v == 0) {
+    return NoUse;
+  }
+
+  Read* r = live(c, v);
+  if (r == 0 or r->event == 0) {
+    return NoUse;
+  } else {
+    return r->event->sequence;
+  }
+}
+
+unsigned
+lastUse(Context* c UNUSED, Value* v)
+{
+  unsigned end = 0;
+  Value* p = v;
+  do {
+    if (valid(p->reads)) {
+      Event* e = p->lastRead->event;
+      if (e == 0) {
+        return NoUse;
+      } else if (e->sequence > end) {
+        end = e->sequence;
+      }
+    }
+    p = p->buddy;
+  } while (p != v);
+
+  return end;
+}
+
+// Given two resources of equal cost, returns true if a is the better
+// choice, which is the one whose occupant is next used furthest away.
+bool
+preferResource(Context* c, Resource* a, Resource* b)
+{
+  return nextUse(c, a->value) > nextUse(c, b->value);
+}
+
+// Returns true if, instead of spilling the specified value, we should
+// evict the occupant of the specified resource because the occupant
+// won't be needed again until after the value is dead.
+bool
+evictOccupant(Context* c, Value* v, Resource* r)
+{
+  return v and r->value and live(c, v)
+    and nextUse(c, r->value) > lastUse(c, v);
+}
+
 unsigned
 resourceCost(Context* c, Value* v, Resource* r, SiteMask mask,
              CostCalculator* costCalculator)
@@ -71,6 +142,12 @@ pickRegisterTarget(Context* c, int i, Value* v, uint32_t mask, int* target,
     } else if (myCost < *cost) {
       *cost = myCost;
       *target = i;
+    } else if (FurthestUse
+               and myCost == *cost
+               and myCost < Target::Impossible
+               and preferResource(c, r, c->registerResources + *target))
+    {
+      *target = i;
     }
   }
   return false;
@@ -137,7 +214,14 @@ pickFrameTarget(Context* c, Value* v, CostCalculator* costCalculator)
 
       if (mine.cost == Target::MinimumFrameCost) {
         return mine;
-      } else if (mine.cost < best.cost) {
+      } else if (mine.cost < best.cost
+                 or (FurthestUse
+                     and mine.cost == best.cost
+                     and mine.cost < Target::Impossible
+                     and preferResource
+                     (c, c->frameResources + mine.index,
+                      c->frameResources + best.index)))
+      {
         best = mine;
       }
     }
@@ -157,9 +241,15 @@ pickAnyFrameTarget(Context* c, Value* v, CostCalculator* costCalculator)
     Target mine(i, lir::MemoryOperand, frameCost(c, v, i, costCalculator));
     if (mine.cost == Target::MinimumFrameCost) {
       return mine;
-    } else if (mine.cost < best.cost) {
+    } else if (mine.cost < best.cost
+               or (FurthestUse
+                   and mine.cost == best.cost
+                   and mine.cost < Target::Impossible
+                   and preferResource
+                   (c, c->frameResources + i, c->frameResources + best.index)))
+    {
       best = mine;
-    }    
+    }
   }
 
   return best;
@@ -174,6 +264,18 @@ pickTarget(Context* c, Value* value, const SiteMask& mask,
     Target mine = pickRegisterTarget
       (c, value, mask.registerMask, costCalculator);
 
+    if (FurthestUse
+        and registerPenalty == 0
+        and (mask.typeMask & (1 << lir::MemoryOperand))
+        and mine.cost >= Target::StealPenalty
+        and mine.cost <= Target::StealUniquePenalty
+        and evictOccupant(c, value, c->registerResources + mine.index))
+    {
+      // the occupant's next use comes after this value is dead, so
+      // spill the occupant rather than this value
+      mine.cost = Target::MinimumFrameCost;
+    }
+
     mine.cost += registerPenalty;
     if (mine.cost == Target::MinimumRegisterCost) {
       return mine;
@@ -286,6 +388,14 @@ pickTarget(Context* c, Read* read, bool intersectRead,
     // site:
     best = pickAnyFrameTarget(c, value, costCalculator);
     assert(c, best.cost <= 3);
+  } else if (FurthestUse and best.cost >= Target::StealUniquePenalty) {
+    // rather than evict the only copy of another value, which would
+    // then have to evict another in turn, spill this value to a free
+    // frame slot
+    Target mine = pickAnyFrameTarget(c, value, costCalculator);
+    if (mine.cost < best.cost) {
+      best = mine;
+    }
   }
 
   if (best.cost == Target::Impossible) {
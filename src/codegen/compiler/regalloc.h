@@ -33,6 +33,11 @@ class SiteMask;
 class Resource;
 class Read;
 
+#ifdef AVIAN_FURTHEST_USE
+const bool FurthestUse = true;
+#else
+const bool FurthestUse = false;
+#endif
 
 class RegisterAllocator {
 public:
@@ -104,6 +109,15 @@ Target
 pickTarget(Context* c, Read* read, bool intersectRead,
            unsigned registerReserveCount, CostCalculator* costCalculator);
 
+void
+numberEvents(Context* c);
+
+unsigned
+nextUse(Context* c, Value* v);
+
+unsigned
+lastUse(Context* c, Value* v);
+
 } // namespace regalloc
 } // namespace codegen
 } // namespace avian
@@ -357,6 +357,9 @@ class MyArchitecture: public Architecture {
       break;
 
     case lir::Absolute:
+    case lir::FloatFloor:
+    case lir::FloatCeil:
+    case lir::FloatRint:
       *thunk = true;
       break;
 
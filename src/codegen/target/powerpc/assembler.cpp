@@ -458,6 +458,9 @@ class MyArchitecture: public Architecture {
     case lir::Absolute:
     case lir::FloatAbsolute:
     case lir::FloatSquareRoot:
+    case lir::FloatFloor:
+    case lir::FloatCeil:
+    case lir::FloatRint:
     case lir::FloatNegate:
     case lir::Float2Float:
     case lir::Float2Int:
@@ -401,6 +401,9 @@ class MyArchitecture: public Architecture {
     case lir::FloatAbsolute:
     case lir::FloatNegate:
     case lir::FloatSquareRoot:
+    case lir::FloatFloor:
+    case lir::FloatCeil:
+    case lir::FloatRint:
       return false;
 
     case lir::Negate:
@@ -489,6 +492,18 @@ class MyArchitecture: public Architecture {
       }
       break;
 
+    case lir::FloatFloor:
+    case lir::FloatCeil:
+    case lir::FloatRint:
+      if (useSSE41(&c)) {
+        aMask.typeMask = (1 << lir::RegisterOperand);
+        aMask.registerMask = (static_cast<uint64_t>(FloatRegisterMask) << 32)
+          | FloatRegisterMask;
+      } else {
+        *thunk = true;
+      }
+      break;
+
     case lir::Float2Float:
       if (useSSE(&c)) {
         aMask.typeMask = (1 << lir::RegisterOperand) | (1 << lir::MemoryOperand);
@@ -574,6 +589,9 @@ class MyArchitecture: public Architecture {
 
     case lir::FloatNegate:
     case lir::FloatSquareRoot:
+    case lir::FloatFloor:
+    case lir::FloatCeil:
+    case lir::FloatRint:
     case lir::Float2Float:
     case lir::Int2Float:
       bMask.typeMask = (1 << lir::RegisterOperand);
@@ -36,6 +36,19 @@ bool useSSE(ArchitectureContext* c) {
   }
 }
 
+bool useSSE41(ArchitectureContext* c) {
+  // unlike SSE 2, this is not implied by amd64
+  if (useSSE(c) and c->useNativeFeatures) {
+    static int supported = -1;
+    if (supported == -1) {
+      supported = detectFeature(0x80000, 0); // SSE 4.1
+    }
+    return supported;
+  } else {
+    return false;
+  }
+}
+
 } // namespace x86
 } // namespace codegen
 } // namespace avian
@@ -105,6 +105,10 @@ void populateTables(ArchitectureContext* c) {
   bo[index(c, lir::FloatSquareRoot, R, R)] = CAST2(floatSqrtRR);
   bo[index(c, lir::FloatSquareRoot, M, R)] = CAST2(floatSqrtMR);
 
+  bo[index(c, lir::FloatFloor, R, R)] = CAST2(floatFloorRR);
+  bo[index(c, lir::FloatCeil, R, R)] = CAST2(floatCeilRR);
+  bo[index(c, lir::FloatRint, R, R)] = CAST2(floatRintRR);
+
   bo[index(c, lir::MoveZ, R, R)] = CAST2(moveZRR);
   bo[index(c, lir::MoveZ, M, R)] = CAST2(moveZMR);
   bo[index(c, lir::MoveZ, C, R)] = CAST2(moveCR);
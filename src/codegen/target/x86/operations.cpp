@@ -1392,6 +1392,39 @@ void floatSqrtMR(Context* c, unsigned aSize, lir::Memory* a,
   floatMemOp(c, aSize, a, 4, b, 0x51);
 }
 
+// emits roundss or roundsd (SSE 4.1) with the specified rounding
+// mode, suppressing the precision exception
+void floatRoundRR(Context* c, unsigned aSize, lir::Register* a,
+                  lir::Register* b, uint8_t mode)
+{
+  assert(c, isFloatReg(a) and isFloatReg(b));
+
+  opcode(c, 0x66);
+  maybeRex(c, 4, b, a);
+  opcode(c, 0x0f, 0x3a);
+  opcode(c, aSize == 4 ? 0x0a : 0x0b);
+  modrm(c, 0xc0, a, b);
+  c->code.append(0x08 | mode);
+}
+
+void floatFloorRR(Context* c, unsigned aSize, lir::Register* a,
+            unsigned bSize UNUSED, lir::Register* b)
+{
+  floatRoundRR(c, aSize, a, b, 0x01);
+}
+
+void floatCeilRR(Context* c, unsigned aSize, lir::Register* a,
+            unsigned bSize UNUSED, lir::Register* b)
+{
+  floatRoundRR(c, aSize, a, b, 0x02);
+}
+
+void floatRintRR(Context* c, unsigned aSize, lir::Register* a,
+            unsigned bSize UNUSED, lir::Register* b)
+{
+  floatRoundRR(c, aSize, a, b, 0x00);
+}
+
 void floatAddRR(Context* c, unsigned aSize, lir::Register* a,
            unsigned bSize UNUSED, lir::Register* b)
 {
@@ -209,6 +209,15 @@ void floatSqrtRR(Context* c, unsigned aSize, lir::Register* a,
 void floatSqrtMR(Context* c, unsigned aSize, lir::Memory* a,
             unsigned bSize UNUSED, lir::Register* b);
 
+void floatFloorRR(Context* c, unsigned aSize, lir::Register* a,
+            unsigned bSize UNUSED, lir::Register* b);
+
+void floatCeilRR(Context* c, unsigned aSize, lir::Register* a,
+            unsigned bSize UNUSED, lir::Register* b);
+
+void floatRintRR(Context* c, unsigned aSize, lir::Register* a,
+            unsigned bSize UNUSED, lir::Register* b);
+
 void floatAddRR(Context* c, unsigned aSize, lir::Register* a,
            unsigned bSize UNUSED, lir::Register* b);
 
@@ -54,6 +54,11 @@ const bool DebugIntrinsics = false;
 
 const bool CheckArrayBounds = true;
 
+// poll Thread::SafepointFlag on backward branches, so that a thread
+// entering the exclusive state need not wait for loops which never
+// allocate to finish
+const bool SafepointPolls = true;
+
 #ifdef AVIAN_CONTINUATIONS
 const bool Continuations = true;
 #else
@@ -66,6 +71,14 @@ const unsigned InitialZoneCapacityInBytes = 64 * 1024;
 
 const unsigned ExecutableAreaSizeInBytes = 30 * 1024 * 1024;
 
+// lookupswitches with at least this many cases, whose keys make up at
+// least a quarter of the range they span, are compiled as jump tables:
+const unsigned LookupSwitchTableThreshold = 4;
+
+// other lookupswitches with at most this many cases are compiled as a
+// sequence of compares, and the rest as a call to lookUpAddress:
+const unsigned LookupSwitchCompareLimit = 8;
+
 enum Root {
   CallTable,
   MethodTree,
@@ -73,6 +86,8 @@ enum Root {
   ObjectPools,
   StaticTableArray,
   VirtualThunks,
+  DispatchThunks,
+  DevirtualizedCalls,
   ReceiveMethod,
   WindMethod,
   RewindMethod
@@ -872,6 +887,7 @@ class TraceElement: public avian::codegen::TraceHandler {
   static const unsigned VirtualCall = 1 << 0;
   static const unsigned TailCall    = 1 << 1;
   static const unsigned LongCall    = 1 << 2;
+  static const unsigned Devirtualized = 1 << 3;
 
   TraceElement(Context* context, unsigned ip, object target, unsigned flags,
                TraceElement* next, unsigned mapSize):
@@ -978,7 +994,7 @@ enum Thunk {
 #undef THUNK
 };
 
-const unsigned ThunkCount = gcIfNecessaryThunk + 1;
+const unsigned ThunkCount = primitiveArraysEqualThunk + 1;
 
 intptr_t
 getThunk(MyThread* t, Thunk thunk);
@@ -1070,6 +1086,18 @@ class Context {
           assert(t, resultSize == 8);
           return local::getThunk(t, squareRootDoubleThunk);
 
+        case avian::codegen::lir::FloatFloor:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, floorDoubleThunk);
+
+        case avian::codegen::lir::FloatCeil:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, ceilDoubleThunk);
+
+        case avian::codegen::lir::FloatRint:
+          assert(t, resultSize == 8);
+          return local::getThunk(t, rintDoubleThunk);
+
         case avian::codegen::lir::Float2Float:
           assert(t, resultSize == 4);
           return local::getThunk(t, doubleToFloatThunk);
@@ -2295,6 +2323,15 @@ stackOverflowThunk(MyThread* t);
 uintptr_t
 virtualThunk(MyThread* t, unsigned index);
 
+uintptr_t
+dispatchThunk(MyThread* t, unsigned index);
+
+void
+recordDevirtualizedCall(MyThread* t, object node);
+
+void
+updateOverrides(MyThread* t, object c);
+
 bool
 unresolved(MyThread* t, uintptr_t methodAddress);
 
@@ -2314,6 +2351,36 @@ tryInitClass(MyThread* t, object class_)
   initClass(t, class_);
 }
 
+bool
+useLongJump(MyThread* t, uintptr_t target);
+
+uintptr_t
+returnThunk(MyThread* t);
+
+void
+updateCall(MyThread* t, avian::codegen::lir::UnaryOperation op,
+           void* returnAddress, void* target);
+
+void
+tryInitClassAndPatch(MyThread* t, object class_)
+{
+  void* ip = getIp(t);
+
+  initClass(t, class_);
+
+  // Once the class is fully initialized (as opposed to merely being
+  // initialized by this thread further up the stack), the barrier
+  // which brought us here has nothing more to do, so we redirect it
+  // to a stub which returns immediately:
+  if ((classVmFlags(t, class_) & NeedInitFlag) == 0) {
+    updateCall
+      (t, useLongJump(t, getThunk(t, tryInitClassAndPatchThunk))
+       ? avian::codegen::lir::AlignedLongCall
+       : avian::codegen::lir::AlignedCall,
+       ip, reinterpret_cast<void*>(returnThunk(t)));
+  }
+}
+
 void
 compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
         object method);
@@ -2589,6 +2656,110 @@ squareRootDouble(uint64_t a)
   return doubleToBits(sqrt(bitsToDouble(a)));
 }
 
+uint64_t
+floorDouble(uint64_t a)
+{
+  return doubleToBits(floor(bitsToDouble(a)));
+}
+
+uint64_t
+ceilDouble(uint64_t a)
+{
+  return doubleToBits(ceil(bitsToDouble(a)));
+}
+
+uint64_t
+rintDouble(uint64_t a)
+{
+  return doubleToBits(rint(bitsToDouble(a)));
+}
+
+uint64_t
+sinDouble(uint64_t a)
+{
+  return doubleToBits(sin(bitsToDouble(a)));
+}
+
+uint64_t
+cosDouble(uint64_t a)
+{
+  return doubleToBits(cos(bitsToDouble(a)));
+}
+
+uint64_t
+tanDouble(uint64_t a)
+{
+  return doubleToBits(tan(bitsToDouble(a)));
+}
+
+uint64_t
+asinDouble(uint64_t a)
+{
+  return doubleToBits(asin(bitsToDouble(a)));
+}
+
+uint64_t
+acosDouble(uint64_t a)
+{
+  return doubleToBits(acos(bitsToDouble(a)));
+}
+
+uint64_t
+atanDouble(uint64_t a)
+{
+  return doubleToBits(atan(bitsToDouble(a)));
+}
+
+uint64_t
+sinhDouble(uint64_t a)
+{
+  return doubleToBits(sinh(bitsToDouble(a)));
+}
+
+uint64_t
+coshDouble(uint64_t a)
+{
+  return doubleToBits(cosh(bitsToDouble(a)));
+}
+
+uint64_t
+tanhDouble(uint64_t a)
+{
+  return doubleToBits(tanh(bitsToDouble(a)));
+}
+
+uint64_t
+expDouble(uint64_t a)
+{
+  return doubleToBits(exp(bitsToDouble(a)));
+}
+
+uint64_t
+logDouble(uint64_t a)
+{
+  return doubleToBits(log(bitsToDouble(a)));
+}
+
+uint64_t
+powDouble(uint64_t a, uint64_t b)
+{
+  return doubleToBits(pow(bitsToDouble(a), bitsToDouble(b)));
+}
+
+// these return their arguments unchanged, and are used to move bits
+// between floating point and general purpose registers
+uint64_t
+reinterpretInt(int32_t a)
+{
+  return static_cast<uint32_t>(a);
+}
+
+uint64_t
+reinterpretLong(uint64_t a)
+{
+  return a;
+}
+
 uint64_t
 doubleToFloat(int64_t a)
 {
@@ -3266,6 +3437,263 @@ gcIfNecessary(MyThread* t)
   }
 }
 
+void
+pollSafepoint(MyThread* t)
+{
+  safepoint(t);
+}
+
+uint64_t
+getNanoTime(MyThread* t)
+{
+  return t->m->system->nanoTime();
+}
+
+void
+copyArray(MyThread* t, object src, int32_t srcOffset, object dst,
+          int32_t dstOffset, int32_t length)
+{
+  arrayCopy(t, src, srcOffset, dst, dstOffset, length);
+}
+
+// The following helpers lean on memcmp, memchr and memset wherever
+// the data allow it, since the C library implements those using the
+// widest vector instructions the processor supports.
+
+template <class T>
+unsigned
+mismatch(const T* a, const T* b, unsigned length)
+{
+  const unsigned BlockLength = 64 / sizeof(T);
+
+  unsigned i = 0;
+  while (i + BlockLength <= length
+         and memcmp(a + i, b + i, BlockLength * sizeof(T)) == 0)
+  {
+    i += BlockLength;
+  }
+
+  while (i < length and a[i] == b[i]) ++ i;
+
+  return i;
+}
+
+// returns the index of the first of the specified number of
+// characters at which the two strings differ, or that number if none
+// do
+unsigned
+stringMismatch(Thread* t, object a, object b, unsigned length)
+{
+  object ad = stringData(t, a);
+  object bd = stringData(t, b);
+  bool aBytes = objectClass(t, ad) == type(t, Machine::ByteArrayType);
+  bool bBytes = objectClass(t, bd) == type(t, Machine::ByteArrayType);
+
+  if (aBytes and bBytes) {
+    return mismatch(&byteArrayBody(t, ad, stringOffset(t, a)),
+                    &byteArrayBody(t, bd, stringOffset(t, b)), length);
+  } else if (not (aBytes or bBytes)) {
+    return mismatch(&charArrayBody(t, ad, stringOffset(t, a)),
+                    &charArrayBody(t, bd, stringOffset(t, b)), length);
+  } else {
+    unsigned i = 0;
+    while (i < length and stringCharAt(t, a, i) == stringCharAt(t, b, i)) {
+      ++ i;
+    }
+    return i;
+  }
+}
+
+// computes the same hash as String.hashCode, but four characters at
+// a time, so that the multiplications don't all depend on each other
+template <class T>
+uint32_t
+stringBodyHash(const T* s, unsigned length)
+{
+  const uint32_t P1 = 31;
+  const uint32_t P2 = P1 * 31;
+  const uint32_t P3 = P2 * 31;
+  const uint32_t P4 = P3 * 31;
+
+  uint32_t h = 0;
+  unsigned i = 0;
+  for (; i + 4 <= length; i += 4) {
+    h = (h * P4)
+      + (static_cast<uint16_t>(s[i]) * P3)
+      + (static_cast<uint16_t>(s[i + 1]) * P2)
+      + (static_cast<uint16_t>(s[i + 2]) * P1)
+      + static_cast<uint16_t>(s[i + 3]);
+  }
+
+  for (; i < length; ++i) {
+    h = (h * 31) + static_cast<uint16_t>(s[i]);
+  }
+
+  return h;
+}
+
+uint64_t
+stringEquals(MyThread* t, object s, object o)
+{
+  if (UNLIKELY(s == 0)) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+
+  if (s == o) {
+    return true;
+  } else if (o and objectClass(t, o) == type(t, Machine::StringType)) {
+    unsigned length = stringLength(t, s);
+    return stringLength(t, o) == length
+      and stringMismatch(t, s, o, length) == length;
+  } else {
+    return false;
+  }
+}
+
+int64_t
+stringCompare(MyThread* t, object a, object b)
+{
+  if (UNLIKELY(a == 0 or b == 0)) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+
+  if (a == b) {
+    return 0;
+  }
+
+  int32_t aLength = stringLength(t, a);
+  int32_t bLength = stringLength(t, b);
+  unsigned end = aLength < bLength ? aLength : bLength;
+
+  unsigned i = stringMismatch(t, a, b, end);
+  if (i < end) {
+    return stringCharAt(t, a, i) - stringCharAt(t, b, i);
+  } else {
+    return aLength - bLength;
+  }
+}
+
+int64_t
+stringHashCode64(MyThread* t, object s)
+{
+  if (UNLIKELY(s == 0)) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+
+  if (stringHashCode(t, s) == 0 and stringLength(t, s)) {
+    object data = stringData(t, s);
+    if (objectClass(t, data) == type(t, Machine::ByteArrayType)) {
+      stringHashCode(t, s) = stringBodyHash
+        (&byteArrayBody(t, data, stringOffset(t, s)), stringLength(t, s));
+    } else {
+      stringHashCode(t, s) = stringBodyHash
+        (&charArrayBody(t, data, stringOffset(t, s)), stringLength(t, s));
+    }
+  }
+
+  return static_cast<int32_t>(stringHashCode(t, s));
+}
+
+int64_t
+stringIndexOf(MyThread* t, object s, int32_t c, int32_t start)
+{
+  if (UNLIKELY(s == 0)) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+
+  int32_t length = stringLength(t, s);
+
+  if (start < 0) {
+    start = 0;
+  }
+
+  if (c >= 0x10000 and c <= 0x10FFFF) {
+    // supplementary characters are stored as surrogate pairs
+    uint16_t high = 0xD800 + ((c - 0x10000) >> 10);
+    uint16_t low = 0xDC00 + ((c - 0x10000) & 0x3FF);
+    for (int32_t i = start; i < length - 1; ++i) {
+      if (stringCharAt(t, s, i) == high and stringCharAt(t, s, i + 1) == low)
+      {
+        return i;
+      }
+    }
+    return -1;
+  } else if (c < 0 or c > 0xFFFF or start >= length) {
+    return -1;
+  }
+
+  object data = stringData(t, s);
+  if (objectClass(t, data) == type(t, Machine::ByteArrayType)) {
+    // each byte is sign-extended to make a character, so only these
+    // characters can appear
+    if (c < 0x80 or c >= 0xFF80) {
+      const int8_t* body = &byteArrayBody(t, data, stringOffset(t, s));
+      const void* p = memchr(body + start, c & 0xFF, length - start);
+      if (p) {
+        return static_cast<const int8_t*>(p) - body;
+      }
+    }
+  } else {
+    const uint16_t* body = &charArrayBody(t, data, stringOffset(t, s));
+    for (int32_t i = start; i < length; ++i) {
+      if (body[i] == c) {
+        return i;
+      }
+    }
+  }
+
+  return -1;
+}
+
+void
+fillArray(MyThread* t, object array, int32_t value)
+{
+  if (UNLIKELY(array == 0)) {
+    throwNew(t, Machine::NullPointerExceptionType);
+  }
+
+  uintptr_t length = fieldAtOffset<uintptr_t>(array, BytesPerWord);
+
+  switch (classArrayElementSize(t, objectClass(t, array))) {
+  case 1:
+    memset(&fieldAtOffset<uint8_t>(array, ArrayBody), value, length);
+    break;
+
+  case 2: {
+    uint16_t* body = &fieldAtOffset<uint16_t>(array, ArrayBody);
+    for (uintptr_t i = 0; i < length; ++i) {
+      body[i] = value;
+    }
+  } break;
+
+  case 4: {
+    int32_t* body = &fieldAtOffset<int32_t>(array, ArrayBody);
+    for (uintptr_t i = 0; i < length; ++i) {
+      body[i] = value;
+    }
+  } break;
+
+  default: abort(t);
+  }
+}
+
+uint64_t
+primitiveArraysEqual(MyThread* t, object a, object b)
+{
+  if (a == b) {
+    return true;
+  } else if (a == 0 or b == 0) {
+    return false;
+  }
+
+  uintptr_t length = fieldAtOffset<uintptr_t>(a, BytesPerWord);
+
+  return length == fieldAtOffset<uintptr_t>(b, BytesPerWord)
+    and memcmp(&fieldAtOffset<uint8_t>(a, ArrayBody),
+               &fieldAtOffset<uint8_t>(b, ArrayBody),
+               length * classArrayElementSize(t, objectClass(t, a))) == 0;
+}
+
 unsigned
 resultSize(MyThread* t, unsigned code)
 {
@@ -3381,6 +3809,37 @@ useLongJump(MyThread* t, uintptr_t target)
     or (target < start && (end - target) > reach);
 }
 
+void
+compileInitBarrier(MyThread* t, Frame* frame, object class_)
+{
+  avian::codegen::Compiler* c = frame->c;
+
+  unsigned flags;
+  Thunk thunk;
+  if (frame->context->bootContext) {
+    // code in the boot image is never patched, so it must make the
+    // check every time
+    flags = 0;
+    thunk = tryInitClassThunk;
+  } else {
+    // the call must be aligned so we can patch it atomically later:
+    flags = Compiler::Aligned;
+    thunk = tryInitClassAndPatchThunk;
+
+    if (useLongJump(t, getThunk(t, thunk))) {
+      flags |= Compiler::LongJumpOrCall;
+    }
+  }
+
+  c->call
+    (c->constant(getThunk(t, thunk), Compiler::AddressType),
+     flags,
+     frame->trace(0, 0),
+     0,
+     Compiler::VoidType,
+     2, c->register_(t->arch->thread()), frame->append(class_));
+}
+
 Compiler::Operand*
 compileDirectInvoke(MyThread* t, Frame* frame, object target, bool tailCall,
                     bool useThunk, unsigned rSize, avian::codegen::Promise* addressPromise)
@@ -3510,33 +3969,94 @@ compileDirectInvoke(MyThread* t, Frame* frame, object target, bool tailCall)
   return tailCall;
 }
 
-unsigned
-methodReferenceParameterFootprint(Thread* t, object reference, bool isStatic)
+bool
+isFinal(MyThread* t, object target)
 {
-  return parameterFootprint
-    (t, reinterpret_cast<const char*>
-     (&byteArrayBody(t, referenceSpec(t, reference), 0)), isStatic);
+  return (methodFlags(t, target) & ACC_FINAL)
+    or (classFlags(t, methodClass(t, target)) & ACC_FINAL);
 }
 
-int
-methodReferenceReturnCode(Thread* t, object reference)
+bool
+devirtualizable(MyThread* t, Frame* frame, object target, bool tailCall)
 {
-  unsigned parameterCount;
-  unsigned returnCode;
-  scanMethodSpec
-    (t, reinterpret_cast<const char*>
-     (&byteArrayBody(t, referenceSpec(t, reference), 0)), &parameterCount,
-     &returnCode);
-
-  return returnCode;
+  // Unlike a final method, a method which merely hasn't been
+  // overridden yet may be overridden by a class loaded later, at
+  // which point we patch any direct calls to it (see
+  // invalidateDevirtualizedCalls).  That only works for calls we
+  // can find and patch, so we leave tail calls and calls from
+  // ahead-of-time compiled code alone.
+  return frame->context->bootContext == 0
+    and (not (avian::codegen::TailCalls and tailCall))
+    and (methodVmFlags(t, target) & OverriddenFlag) == 0
+    and (methodFlags(t, target) & (ACC_ABSTRACT | ACC_NATIVE)) == 0;
 }
 
 void
-compileReferenceInvoke(MyThread* t, Frame* frame, Compiler::Operand* method,
-                       object reference, bool isStatic, bool tailCall)
+compileDevirtualizedInvoke(MyThread* t, Frame* frame, object target)
 {
-  unsigned parameterFootprint
-    = methodReferenceParameterFootprint(t, reference, isStatic);
+  avian::codegen::Compiler* c = frame->c;
+
+  uintptr_t address;
+  if (unresolved(t, methodAddress(t, target))
+      or classNeedsInit(t, methodClass(t, target)))
+  {
+    address = defaultThunk(t);
+  } else {
+    address = methodAddress(t, target);
+  }
+
+  // the call must be aligned so we can patch it atomically later:
+  unsigned flags = Compiler::Aligned;
+  unsigned traceFlags = TraceElement::Devirtualized;
+  if (useLongJump(t, methodAddress(t, target))) {
+    flags |= Compiler::LongJumpOrCall;
+    traceFlags |= TraceElement::LongCall;
+  }
+
+  unsigned rSize = resultSize(t, methodReturnCode(t, target));
+
+  Compiler::Operand* result = c->stackCall
+    (c->constant(address, Compiler::AddressType),
+     flags,
+     frame->trace(target, traceFlags),
+     rSize,
+     operandTypeForFieldCode(t, methodReturnCode(t, target)),
+     methodParameterFootprint(t, target));
+
+  frame->pop(methodParameterFootprint(t, target));
+
+  if (rSize) {
+    pushReturnValue(t, frame, methodReturnCode(t, target), result);
+  }
+}
+
+unsigned
+methodReferenceParameterFootprint(Thread* t, object reference, bool isStatic)
+{
+  return parameterFootprint
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, referenceSpec(t, reference), 0)), isStatic);
+}
+
+int
+methodReferenceReturnCode(Thread* t, object reference)
+{
+  unsigned parameterCount;
+  unsigned returnCode;
+  scanMethodSpec
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, referenceSpec(t, reference), 0)), &parameterCount,
+     &returnCode);
+
+  return returnCode;
+}
+
+void
+compileReferenceInvoke(MyThread* t, Frame* frame, Compiler::Operand* method,
+                       object reference, bool isStatic, bool tailCall)
+{
+  unsigned parameterFootprint
+    = methodReferenceParameterFootprint(t, reference, isStatic);
 
   int returnCode = methodReferenceReturnCode(t, reference);
 
@@ -3755,6 +4275,54 @@ isReferenceTailCall(MyThread* t, object code, unsigned ip, object caller,
     (t, code, ip, caller, methodReferenceReturnCode(t, calleeReference));
 }
 
+// Returns true if a branch from the instruction ending at ip to newIp
+// closes a loop, and so must poll for a safepoint.
+bool
+isBackEdge(unsigned ip, unsigned newIp)
+{
+  return SafepointPolls and newIp < ip;
+}
+
+unsigned
+invertBranch(unsigned instruction)
+{
+  switch (instruction) {
+  case ifeq: return ifne;
+  case ifne: return ifeq;
+  case iflt: return ifge;
+  case ifge: return iflt;
+  case ifgt: return ifle;
+  case ifle: return ifgt;
+  case if_icmpeq: return if_icmpne;
+  case if_icmpne: return if_icmpeq;
+  case if_icmplt: return if_icmpge;
+  case if_icmpge: return if_icmplt;
+  case if_icmpgt: return if_icmple;
+  case if_icmple: return if_icmpgt;
+  case if_acmpeq: return if_acmpne;
+  case if_acmpne: return if_acmpeq;
+  case ifnull: return ifnonnull;
+  case ifnonnull: return ifnull;
+  default: return instruction;
+  }
+}
+
+// Returns where a conditional branch from the instruction ending at ip
+// to newIp should jump.  A branch which closes a loop is inverted to
+// jump to the next instruction instead, so that the code following it
+// can poll before going round again.
+Compiler::Operand*
+branchTarget(Frame* frame, unsigned ip, unsigned newIp,
+             unsigned* instruction)
+{
+  if (isBackEdge(ip, newIp)) {
+    *instruction = invertBranch(*instruction);
+    return frame->machineIp(ip);
+  } else {
+    return frame->machineIp(newIp);
+  }
+}
+
 bool
 integerBranch(MyThread* t, Frame* frame, object code, unsigned& ip,
               unsigned size, Compiler::Operand* a, Compiler::Operand* b,
@@ -3770,7 +4338,7 @@ integerBranch(MyThread* t, Frame* frame, object code, unsigned& ip,
   uint32_t newIp = (ip - 3) + offset;
   assert(t, newIp < codeLength(t, code));
   
-  Compiler::Operand* target = frame->machineIp(newIp);
+  Compiler::Operand* target = branchTarget(frame, ip, newIp, &instruction);
 
   switch (instruction) {
   case ifeq:
@@ -3820,6 +4388,14 @@ floatBranch(MyThread* t, Frame* frame, object code, unsigned& ip,
   uint32_t offset = codeReadInt16(t, code, ip);
   uint32_t newIp = (ip - 3) + offset;
   assert(t, newIp < codeLength(t, code));
+
+  if (isBackEdge(ip, newIp)) {
+    // unordered operands make the float branches awkward to invert,
+    // so loops closed by one of these compare via a thunk and branch
+    // on the result instead
+    ip -= 3;
+    return false;
+  }
   
   Compiler::Operand* target = frame->machineIp(newIp);
 
@@ -3880,6 +4456,39 @@ popLongAddress(Frame* frame)
     (8, 8, frame->popLong(), TargetBytesPerWord);
 }
 
+// returns the thunk which computes the named java.lang.Math function
+// of one double, or ThunkCount if there is none
+Thunk
+mathThunk(MyThread* t, object name)
+{
+  const struct {
+    const char* name;
+    Thunk thunk;
+  } table[] = {
+    { "sin", sinDoubleThunk },
+    { "cos", cosDoubleThunk },
+    { "tan", tanDoubleThunk },
+    { "asin", asinDoubleThunk },
+    { "acos", acosDoubleThunk },
+    { "atan", atanDoubleThunk },
+    { "sinh", sinhDoubleThunk },
+    { "cosh", coshDoubleThunk },
+    { "tanh", tanhDoubleThunk },
+    { "exp", expDoubleThunk },
+    { "log", logDoubleThunk }
+  };
+
+  for (unsigned i = 0; i < sizeof(table) / sizeof(table[0]); ++i) {
+    if (::strcmp(reinterpret_cast<char*>(&byteArrayBody(t, name, 0)),
+                 table[i].name) == 0)
+    {
+      return table[i].thunk;
+    }
+  }
+
+  return static_cast<Thunk>(ThunkCount);
+}
+
 bool
 intrinsic(MyThread* t, Frame* frame, object target)
 {
@@ -3907,6 +4516,230 @@ intrinsic(MyThread* t, Frame* frame, object target)
         frame->pushInt(c->fabs(4, frame->popInt()));
         return true;
       }
+    } else if (MATCH(methodName(t, target), "floor")
+               and MATCH(methodSpec(t, target), "(D)D"))
+    {
+      frame->pushLong(c->ffloor(8, frame->popLong()));
+      return true;
+    } else if (MATCH(methodName(t, target), "ceil")
+               and MATCH(methodSpec(t, target), "(D)D"))
+    {
+      frame->pushLong(c->fceil(8, frame->popLong()));
+      return true;
+    } else if (MATCH(methodName(t, target), "rint")
+               and MATCH(methodSpec(t, target), "(D)D"))
+    {
+      frame->pushLong(c->frint(8, frame->popLong()));
+      return true;
+#ifdef AVIAN_CLASSPATH_avian
+    } else if (MATCH(methodName(t, target), "round")) {
+      // same as (long) Math.floor(v + 0.5) or (int) Math.floor(v + 0.5),
+      // which is how our Math implements it.  Other class libraries
+      // round values just below 0.5 and large odd values differently,
+      // so we leave their Math.round alone.
+      Compiler::Operand* half = c->constant
+        (doubleToBits(0.5), Compiler::FloatType);
+      if (MATCH(methodSpec(t, target), "(D)J")) {
+        frame->pushLong
+          (c->f2i(8, 8, c->ffloor(8, c->fadd(8, half, frame->popLong()))));
+        return true;
+      } else if (MATCH(methodSpec(t, target), "(F)I")) {
+        frame->pushInt
+          (c->f2i(8, 4, c->ffloor
+                  (8, c->fadd(8, half, c->f2f(4, 8, frame->popInt())))));
+        return true;
+      }
+#endif // AVIAN_CLASSPATH_avian
+    } else if (MATCH(methodName(t, target), "pow")
+               and MATCH(methodSpec(t, target), "(DD)D"))
+    {
+      Compiler::Operand* b = frame->popLong();
+      Compiler::Operand* a = frame->popLong();
+
+      // libm functions neither allocate nor throw, so we call them
+      // directly without a trace
+      frame->pushLong
+        (c->call
+         (c->constant(getThunk(t, powDoubleThunk), Compiler::AddressType),
+          0, 0, 8, Compiler::FloatType, 4,
+          static_cast<Compiler::Operand*>(0), a,
+          static_cast<Compiler::Operand*>(0), b));
+      return true;
+    } else if (MATCH(methodSpec(t, target), "(D)D")) {
+      Thunk thunk = mathThunk(t, methodName(t, target));
+      if (thunk != ThunkCount) {
+        frame->pushLong
+          (c->call
+           (c->constant(getThunk(t, thunk), Compiler::AddressType),
+            0, 0, 8, Compiler::FloatType, 2,
+            static_cast<Compiler::Operand*>(0), frame->popLong()));
+        return true;
+      }
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/Double"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(methodName(t, target), "doubleToRawLongBits")
+        and MATCH(methodSpec(t, target), "(D)J"))
+    {
+      frame->pushLong
+        (c->call
+         (c->constant(getThunk(t, reinterpretLongThunk), Compiler::AddressType),
+          0, 0, 8, Compiler::IntegerType, 2,
+          static_cast<Compiler::Operand*>(0), frame->popLong()));
+      return true;
+    } else if (MATCH(methodName(t, target), "longBitsToDouble")
+               and MATCH(methodSpec(t, target), "(J)D"))
+    {
+      frame->pushLong
+        (c->call
+         (c->constant(getThunk(t, reinterpretLongThunk), Compiler::AddressType),
+          0, 0, 8, Compiler::FloatType, 2,
+          static_cast<Compiler::Operand*>(0), frame->popLong()));
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/Float"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(methodName(t, target), "floatToRawIntBits")
+        and MATCH(methodSpec(t, target), "(F)I"))
+    {
+      frame->pushInt
+        (c->call
+         (c->constant(getThunk(t, reinterpretIntThunk), Compiler::AddressType),
+          0, 0, 4, Compiler::IntegerType, 1, frame->popInt()));
+      return true;
+    } else if (MATCH(methodName(t, target), "intBitsToFloat")
+               and MATCH(methodSpec(t, target), "(I)F"))
+    {
+      frame->pushInt
+        (c->call
+         (c->constant(getThunk(t, reinterpretIntThunk), Compiler::AddressType),
+          0, 0, 4, Compiler::FloatType, 1, frame->popInt()));
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/System"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(methodName(t, target), "nanoTime")
+        and MATCH(methodSpec(t, target), "()J"))
+    {
+      // call straight into the system clock, skipping the JNI
+      // transition and the trace a native method would need
+      frame->pushLong
+        (c->call
+         (c->constant(getThunk(t, getNanoTimeThunk), Compiler::AddressType),
+          0,
+          0,
+          8,
+          Compiler::IntegerType,
+          1, c->register_(t->arch->thread())));
+      return true;
+    } else if (MATCH(methodName(t, target), "arraycopy")
+               and MATCH(methodSpec(t, target),
+                         "(Ljava/lang/Object;ILjava/lang/Object;II)V"))
+    {
+      Compiler::Operand* length = frame->popInt();
+      Compiler::Operand* dstOffset = frame->popInt();
+      Compiler::Operand* dst = frame->popObject();
+      Compiler::Operand* srcOffset = frame->popInt();
+      Compiler::Operand* src = frame->popObject();
+
+      c->call
+        (c->constant(getThunk(t, copyArrayThunk), Compiler::AddressType),
+         0,
+         frame->trace(0, 0),
+         0,
+         Compiler::VoidType,
+         6, c->register_(t->arch->thread()), src, srcOffset, dst, dstOffset,
+         length);
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/String"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(methodName(t, target), "equals")
+        and MATCH(methodSpec(t, target), "(Ljava/lang/Object;)Z"))
+    {
+      Compiler::Operand* o = frame->popObject();
+      Compiler::Operand* s = frame->popObject();
+
+      frame->pushInt
+        (c->call
+         (c->constant(getThunk(t, stringEqualsThunk), Compiler::AddressType),
+          0, frame->trace(0, 0), 4, Compiler::IntegerType,
+          3, c->register_(t->arch->thread()), s, o));
+      return true;
+    } else if (MATCH(methodName(t, target), "compareTo")
+               and MATCH(methodSpec(t, target), "(Ljava/lang/String;)I"))
+    {
+      Compiler::Operand* b = frame->popObject();
+      Compiler::Operand* a = frame->popObject();
+
+      frame->pushInt
+        (c->call
+         (c->constant(getThunk(t, stringCompareThunk), Compiler::AddressType),
+          0, frame->trace(0, 0), 4, Compiler::IntegerType,
+          3, c->register_(t->arch->thread()), a, b));
+      return true;
+    } else if (MATCH(methodName(t, target), "hashCode")
+               and MATCH(methodSpec(t, target), "()I"))
+    {
+      Compiler::Operand* s = frame->popObject();
+
+      frame->pushInt
+        (c->call
+         (c->constant
+          (getThunk(t, stringHashCode64Thunk), Compiler::AddressType),
+          0, frame->trace(0, 0), 4, Compiler::IntegerType,
+          2, c->register_(t->arch->thread()), s));
+      return true;
+    } else if (MATCH(methodName(t, target), "indexOf")
+               and (MATCH(methodSpec(t, target), "(I)I")
+                    or MATCH(methodSpec(t, target), "(II)I")))
+    {
+      Compiler::Operand* start;
+      if (MATCH(methodSpec(t, target), "(II)I")) {
+        start = frame->popInt();
+      } else {
+        start = c->constant(0, Compiler::IntegerType);
+      }
+      Compiler::Operand* ch = frame->popInt();
+      Compiler::Operand* s = frame->popObject();
+
+      frame->pushInt
+        (c->call
+         (c->constant(getThunk(t, stringIndexOfThunk), Compiler::AddressType),
+          0, frame->trace(0, 0), 4, Compiler::IntegerType,
+          4, c->register_(t->arch->thread()), s, ch, start));
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/util/Arrays"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(methodName(t, target), "fill")
+        and (MATCH(methodSpec(t, target), "([BB)V")
+             or MATCH(methodSpec(t, target), "([CC)V")
+             or MATCH(methodSpec(t, target), "([II)V")))
+    {
+      Compiler::Operand* value = frame->popInt();
+      Compiler::Operand* array = frame->popObject();
+
+      c->call
+        (c->constant(getThunk(t, fillArrayThunk), Compiler::AddressType),
+         0, frame->trace(0, 0), 0, Compiler::VoidType,
+         3, c->register_(t->arch->thread()), array, value);
+      return true;
+    } else if (MATCH(methodName(t, target), "equals")
+               and (MATCH(methodSpec(t, target), "([B[B)Z")
+                    or MATCH(methodSpec(t, target), "([C[C)Z")
+                    or MATCH(methodSpec(t, target), "([I[I)Z")))
+    {
+      Compiler::Operand* b = frame->popObject();
+      Compiler::Operand* a = frame->popObject();
+
+      frame->pushInt
+        (c->call
+         (c->constant
+          (getThunk(t, primitiveArraysEqualThunk), Compiler::AddressType),
+          0, 0, 4, Compiler::IntegerType,
+          3, c->register_(t->arch->thread()), a, b));
+      return true;
     }
   } else if (UNLIKELY(MATCH(className, "sun/misc/Unsafe"))) {
     avian::codegen::Compiler* c = frame->c;
@@ -4136,6 +4969,205 @@ class SwitchState {
   unsigned index;
 };
 
+class LookupState {
+ public:
+  LookupState(unsigned count,
+              unsigned defaultIp,
+              Compiler::Operand* key):
+    state(0),
+    count(count),
+    defaultIp(defaultIp),
+    key(key),
+    index(0)
+  { }
+
+  Frame* frame() {
+    return reinterpret_cast<Frame*>
+      (reinterpret_cast<uint8_t*>(this) - pad(count * 8) - pad(sizeof(Frame)));
+  }
+
+  // pairs of keys and target ips
+  uint32_t* pairTable() {
+    return reinterpret_cast<uint32_t*>
+      (reinterpret_cast<uint8_t*>(this) - pad(count * 8));
+  }
+
+  Compiler::State* state;
+  unsigned count;
+  unsigned defaultIp;
+  Compiler::Operand* key;
+  unsigned index;
+};
+
+avian::codegen::Promise*
+appendJumpTable(Frame* frame, uint32_t* ipTable, unsigned count)
+{
+  avian::codegen::Compiler* c = frame->c;
+
+  avian::codegen::Promise* start = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    avian::codegen::Promise* p = c->poolAppendPromise
+      (frame->addressPromise(c->machineIp(ipTable[i])));
+    if (i == 0) {
+      start = p;
+    }
+  }
+
+  return start;
+}
+
+class CastState {
+ public:
+  CastState(Compiler::Operand* instance, unsigned index, unsigned nextIp,
+            bool instanceOf):
+    state(0),
+    instance(instance),
+    index(index),
+    nextIp(nextIp),
+    step(0),
+    instanceOf(instanceOf)
+  { }
+
+  Frame* frame() {
+    return reinterpret_cast<Frame*>
+      (reinterpret_cast<uint8_t*>(this) - pad(sizeof(Frame)));
+  }
+
+  Compiler::State* state;
+  Compiler::Operand* instance;
+  unsigned index;
+  unsigned nextIp;
+  unsigned step;
+  bool instanceOf;
+};
+
+bool
+isFinalClass(MyThread* t, object class_)
+{
+  return (classFlags(t, class_) & ACC_FINAL)
+    and classArrayDimensions(t, class_) == 0;
+}
+
+Compiler::Operand*
+loadInstanceClass(avian::codegen::Compiler* c, Compiler::Operand* instance)
+{
+  return c->and_
+    (TargetBytesPerWord, c->constant(TargetPointerMask, Compiler::IntegerType),
+     c->load(TargetBytesPerWord, TargetBytesPerWord, c->memory
+             (instance, Compiler::ObjectType, 0, 0, 1), TargetBytesPerWord));
+}
+
+// Emits the next of the inline checks done for a checkcast or
+// instanceof of a resolved class, each of which branches to the next
+// instruction if it succeeds, leaving 1 or 0 on the stack for
+// instanceof.  Returns false if there are no more checks to do.
+bool
+compileCastCheck(MyThread* t, Frame* frame, CastState* s)
+{
+  avian::codegen::Compiler* c = frame->c;
+  Context* context = frame->context;
+
+  object class_ = resolveClassInPool
+    (t, context->method, s->index - 1, false);
+
+  Compiler::Operand* expected;
+  Compiler::Operand* actual;
+  int result;
+  switch (s->step++) {
+  case 0:
+    expected = c->constant(0, Compiler::ObjectType);
+    actual = s->instance;
+    result = 0;
+    break;
+
+  case 1:
+    expected = frame->append(class_);
+    actual = loadInstanceClass(c, s->instance);
+    result = 1;
+    break;
+
+  case 2: {
+    if (isFinalClass(t, class_)) {
+      return false;
+    }
+
+    int depth = primarySuperDepth(t, class_);
+    Compiler::Operand* instanceClass = loadInstanceClass(c, s->instance);
+
+    expected = frame->append(class_);
+    actual = c->load
+      (TargetBytesPerWord, TargetBytesPerWord,
+       depth >= 0
+       ? c->memory
+       (c->load
+        (TargetBytesPerWord, TargetBytesPerWord, c->memory
+         (instanceClass, Compiler::ObjectType, TargetClassPrimarySupers, 0, 1),
+         TargetBytesPerWord), Compiler::ObjectType,
+        TargetArrayBody + (depth * TargetBytesPerWord), 0, 1)
+       : c->memory
+       (instanceClass, Compiler::ObjectType, TargetClassSecondarySuperCache,
+        0, 1),
+       TargetBytesPerWord);
+    result = 1;
+  } break;
+
+  default:
+    return false;
+  }
+
+  if (s->instanceOf) {
+    frame->pushInt(c->constant(result, Compiler::IntegerType));
+  }
+
+  c->jumpIfEqual
+    (TargetBytesPerWord, expected, actual, frame->machineIp(s->nextIp));
+
+  if (s->instanceOf) {
+    c->save(1, s->instance);
+  }
+
+  s->state = c->saveState();
+
+  return true;
+}
+
+// Emits what's left of a checkcast or instanceof of a resolved class
+// once the inline checks have failed.
+void
+compileCastCall(MyThread* t, Frame* frame, CastState* s)
+{
+  avian::codegen::Compiler* c = frame->c;
+  Context* context = frame->context;
+
+  object class_ = resolveClassInPool
+    (t, context->method, s->index - 1, false);
+
+  if (s->instanceOf) {
+    if (isFinalClass(t, class_) or primarySuperDepth(t, class_) >= 0) {
+      // the inline checks were conclusive
+      frame->pushInt(c->constant(0, Compiler::IntegerType));
+    } else {
+      frame->pushInt
+        (c->call
+         (c->constant(getThunk(t, instanceOf64Thunk), Compiler::AddressType),
+          0, frame->trace(0, 0), 4, Compiler::IntegerType,
+          3, c->register_(t->arch->thread()), frame->append(class_),
+          s->instance));
+    }
+  } else {
+    // either the instance is not of the specified class, in which case
+    // this will throw, or it's a subtype we haven't cached yet
+    c->call
+      (c->constant(getThunk(t, checkCastThunk), Compiler::AddressType),
+       0,
+       frame->trace(0, 0),
+       0,
+       Compiler::VoidType,
+       3, c->register_(t->arch->thread()), frame->append(class_),
+       s->instance);
+  }
+}
+
 void
 compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         int exceptionHandlerStart = -1)
@@ -4146,7 +5178,11 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
     Unsubroutine,
     Untable0,
     Untable1,
-    Unswitch
+    Unswitch,
+    Unlookup,
+    Uncast,
+    Unpoll0,
+    Unpoll1
   };
 
   Frame* frame = initialFrame;
@@ -4491,26 +5527,23 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
 
       object class_ = resolveClassInPool(t, context->method, index - 1, false);
 
-      object argument;
-      Thunk thunk;
+      Compiler::Operand* instance = c->peek(1, 0);
+
       if (LIKELY(class_)) {
-        argument = class_;
-        thunk = checkCastThunk;
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = checkCastFromReferenceThunk;
+        new (stack.push(sizeof(CastState))) CastState
+          (instance, index, ip, false);
+        goto castloop;
       }
 
-      Compiler::Operand* instance = c->peek(1, 0);
-
       c->call
-        (c->constant(getThunk(t, thunk), Compiler::AddressType),
+        (c->constant
+         (getThunk(t, checkCastFromReferenceThunk), Compiler::AddressType),
          0,
          frame->trace(0, 0),
          0,
          Compiler::VoidType,
-         3, c->register_(t->arch->thread()), frame->append(argument),
-         instance);
+         3, c->register_(t->arch->thread()),
+         frame->append(makePair(t, context->method, reference)), instance);
     } break;
 
     case d2f: {
@@ -4761,15 +5794,7 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
           if (fieldClass(t, field) != methodClass(t, context->method)
               and classNeedsInit(t, fieldClass(t, field)))
           {
-            c->call
-              (c->constant
-               (getThunk(t, tryInitClassThunk), Compiler::AddressType),
-               0,
-               frame->trace(0, 0),
-               0,
-               Compiler::VoidType,
-               2, c->register_(t->arch->thread()),
-               frame->append(fieldClass(t, field)));
+            compileInitBarrier(t, frame, fieldClass(t, field));
           }
 
           table = frame->append(classStaticTable(t, fieldClass(t, field)));
@@ -4906,18 +5931,22 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
 
     case goto_: {
       uint32_t offset = codeReadInt16(t, code, ip);
-      uint32_t newIp = (ip - 3) + offset;
+      newIp = (ip - 3) + offset;
       assert(t, newIp < codeLength(t, code));
 
+      if (isBackEdge(ip, newIp)) goto poll;
+
       c->jmp(frame->machineIp(newIp));
       ip = newIp;
     } break;
 
     case goto_w: {
       uint32_t offset = codeReadInt32(t, code, ip);
-      uint32_t newIp = (ip - 5) + offset;
+      newIp = (ip - 5) + offset;
       assert(t, newIp < codeLength(t, code));
 
+      if (isBackEdge(ip, newIp)) goto poll;
+
       c->jmp(frame->machineIp(newIp));
       ip = newIp;
     } break;
@@ -5009,7 +6038,8 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         
       Compiler::Operand* a = frame->popObject();
       Compiler::Operand* b = frame->popObject();
-      Compiler::Operand* target = frame->machineIp(newIp);
+      Compiler::Operand* target = branchTarget
+        (frame, ip, newIp, &instruction);
 
       if (instruction == if_acmpeq) {
         c->jumpIfEqual(TargetBytesPerWord, a, b, target);
@@ -5030,7 +6060,8 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         
       Compiler::Operand* a = frame->popInt();
       Compiler::Operand* b = frame->popInt();
-      Compiler::Operand* target = frame->machineIp(newIp);
+      Compiler::Operand* target = branchTarget
+        (frame, ip, newIp, &instruction);
 
       switch (instruction) {
       case if_icmpeq:
@@ -5066,7 +6097,8 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       newIp = (ip - 3) + offset;
       assert(t, newIp < codeLength(t, code));
 
-      Compiler::Operand* target = frame->machineIp(newIp);
+      Compiler::Operand* target = branchTarget
+        (frame, ip, newIp, &instruction);
 
       Compiler::Operand* a = c->constant(0, Compiler::IntegerType);
       Compiler::Operand* b = frame->popInt();
@@ -5103,7 +6135,8 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
 
       Compiler::Operand* a = c->constant(0, Compiler::ObjectType);
       Compiler::Operand* b = frame->popObject();
-      Compiler::Operand* target = frame->machineIp(newIp);
+      Compiler::Operand* target = branchTarget
+        (frame, ip, newIp, &instruction);
 
       if (instruction == ifnull) {
         c->jumpIfEqual(TargetBytesPerWord, a, b, target);
@@ -5171,22 +6204,19 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
 
       Compiler::Operand* instance = frame->popObject();
 
-      object argument;
-      Thunk thunk;
       if (LIKELY(class_)) {
-        argument = class_;
-        thunk = instanceOf64Thunk;
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = instanceOfFromReferenceThunk;
+        new (stack.push(sizeof(CastState))) CastState
+          (instance, index, ip, true);
+        goto castloop;
       }
 
       frame->pushInt
         (c->call
-         (c->constant(getThunk(t, thunk), Compiler::AddressType),
+         (c->constant
+          (getThunk(t, instanceOfFromReferenceThunk), Compiler::AddressType),
           0, frame->trace(0, 0), 4, Compiler::IntegerType,
-          3, c->register_(t->arch->thread()), frame->append(argument),
-          instance));
+          3, c->register_(t->arch->thread()),
+          frame->append(makePair(t, context->method, reference)), instance));
     } break;
 
     case invokeinterface: {
@@ -5328,9 +6358,22 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         if (not intrinsic(t, frame, target)) {
           bool tailCall = isTailCall(t, code, ip, context->method, target);
 
-          if (LIKELY(methodVirtual(t, target))) {
-            unsigned parameterFootprint = methodParameterFootprint(t, target);
+          unsigned parameterFootprint = methodParameterFootprint(t, target);
+
+          if (methodVirtual(t, target) and isFinal(t, target)) {
+            // a direct call skips the null check we'd otherwise get
+            // for free by dereferencing the instance's class, so we
+            // must do it explicitly:
+            c->checkNull(c->peek(1, parameterFootprint - 1));
+
+            compileDirectInvoke(t, frame, target, tailCall);
+          } else if (methodVirtual(t, target)
+                     and devirtualizable(t, frame, target, tailCall))
+          {
+            c->checkNull(c->peek(1, parameterFootprint - 1));
 
+            compileDevirtualizedInvoke(t, frame, target);
+          } else if (LIKELY(methodVirtual(t, target))) {
             unsigned offset = TargetClassVtable
               + (methodOffset(t, target) * TargetBytesPerWord);
 
@@ -5674,6 +6717,67 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       int32_t pairCount = codeReadInt32(t, code, ip);
 
       if (pairCount) {
+        // keys are sorted, so the first and last give the range
+        unsigned keyIndex = ip;
+        int32_t bottom = codeReadInt32(t, code, keyIndex);
+        keyIndex = ip + ((pairCount - 1) * 8);
+        int32_t top = codeReadInt32(t, code, keyIndex);
+        int64_t range = static_cast<int64_t>(top) - bottom + 1;
+
+        if (static_cast<unsigned>(pairCount) >= LookupSwitchTableThreshold
+            and range <= static_cast<int64_t>(pairCount) * 4)
+        {
+          unsigned count = range;
+          uint32_t* ipTable = static_cast<uint32_t*>
+            (stack.push(sizeof(uint32_t) * count));
+          for (unsigned i = 0; i < count; ++i) {
+            ipTable[i] = defaultIp;
+          }
+
+          for (int32_t i = 0; i < pairCount; ++i) {
+            unsigned index = ip + (i * 8);
+            int32_t key = codeReadInt32(t, code, index);
+            uint32_t newIp = base + codeReadInt32(t, code, index);
+            assert(t, newIp < codeLength(t, code));
+
+            ipTable[key - bottom] = newIp;
+          }
+
+          avian::codegen::Promise* start = appendJumpTable
+            (frame, ipTable, count);
+          assert(t, start);
+
+          c->jumpIfLess(4, c->constant(bottom, Compiler::IntegerType), key,
+                        frame->machineIp(defaultIp));
+
+          c->save(1, key);
+
+          new (stack.push(sizeof(SwitchState))) SwitchState
+            (c->saveState(), count, defaultIp, key, start, bottom, top);
+
+          stack.pushValue(Untable0);
+          ip = defaultIp;
+          goto start;
+        } else if (static_cast<unsigned>(pairCount)
+                   <= LookupSwitchCompareLimit)
+        {
+          uint32_t* pairTable = static_cast<uint32_t*>
+            (stack.push(sizeof(uint32_t) * pairCount * 2));
+          for (int32_t i = 0; i < pairCount; ++i) {
+            unsigned index = ip + (i * 8);
+            pairTable[i * 2] = codeReadInt32(t, code, index);
+            uint32_t newIp = base + codeReadInt32(t, code, index);
+            assert(t, newIp < codeLength(t, code));
+
+            pairTable[(i * 2) + 1] = newIp;
+          }
+
+          new (stack.push(sizeof(LookupState))) LookupState
+            (pairCount, defaultIp, key);
+
+          goto lookuploop;
+        }
+
         Compiler::Operand* default_ = frame->addressOperand
           (frame->addressPromise(c->machineIp(defaultIp)));
 
@@ -5943,15 +7047,7 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
           {
             PROTECT(t, field);
 
-            c->call
-              (c->constant
-               (getThunk(t, tryInitClassThunk), Compiler::AddressType),
-               0,
-               frame->trace(0, 0),
-               0,
-               Compiler::VoidType,
-               2, c->register_(t->arch->thread()),
-               frame->append(fieldClass(t, field)));
+            compileInitBarrier(t, frame, fieldClass(t, field));
           }
 
           staticTable = classStaticTable(t, fieldClass(t, field));      
@@ -6203,7 +7299,6 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
       int32_t bottom = codeReadInt32(t, code, ip);
       int32_t top = codeReadInt32(t, code, ip);
         
-      avian::codegen::Promise* start = 0;
       unsigned count = top - bottom + 1;
       uint32_t* ipTable = static_cast<uint32_t*>
         (stack.push(sizeof(uint32_t) * count));
@@ -6213,13 +7308,9 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
         assert(t, newIp < codeLength(t, code));
 
         ipTable[i] = newIp;
-
-        avian::codegen::Promise* p = c->poolAppendPromise
-          (frame->addressPromise(c->machineIp(newIp)));
-        if (i == 0) {
-          start = p;
-        }
       }
+
+      avian::codegen::Promise* start = appendJumpTable(frame, ipTable, count);
       assert(t, start);
 
       Compiler::Operand* key = frame->popInt();
@@ -6366,10 +7457,97 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
     frame->endSubroutine(start);
   } goto loop;
 
+  case Unlookup: {
+    LookupState* s = static_cast<LookupState*>
+      (stack.peek(sizeof(LookupState)));
+
+    frame = s->frame();
+
+    c->restoreState(s->state);
+  } goto lookuploop;
+
+  case Uncast: {
+    CastState* s = static_cast<CastState*>(stack.peek(sizeof(CastState)));
+
+    frame = s->frame();
+
+    c->restoreState(s->state);
+
+    if (s->instanceOf) {
+      frame->popInt();
+    }
+  } goto castloop;
+
+  case Unpoll0:
+    newIp = stack.popValue();
+    c->restoreState(reinterpret_cast<Compiler::State*>(stack.popValue()));
+    frame = static_cast<Frame*>(stack.peek(sizeof(Frame)));
+    goto poll;
+
+  case Unpoll1: {
+    ip = stack.popValue();
+    c->restoreState(reinterpret_cast<Compiler::State*>(stack.popValue()));
+    frame = static_cast<Frame*>(stack.peek(sizeof(Frame)));
+
+    c->call
+      (c->constant(getThunk(t, pollSafepointThunk), Compiler::AddressType),
+       0,
+       frame->trace(0, 0),
+       0,
+       Compiler::VoidType,
+       1, c->register_(t->arch->thread()));
+
+    c->jmp(frame->machineIp(ip));
+  } goto loop;
+
   default:
     abort(t);
   }
 
+ lookuploop: {
+    LookupState* s = static_cast<LookupState*>
+      (stack.peek(sizeof(LookupState)));
+
+    if (s->index < s->count) {
+      uint32_t* pair = s->pairTable() + (s->index++ * 2);
+      int32_t key = pair[0];
+      ip = pair[1];
+
+      c->jumpIfEqual(4, c->constant(key, Compiler::IntegerType), s->key,
+                     frame->machineIp(ip));
+
+      c->save(1, s->key);
+      s->state = c->saveState();
+
+      stack.pushValue(Unlookup);
+      goto start;
+    } else {
+      ip = s->defaultIp;
+      unsigned count = s->count * 8;
+      stack.pop(sizeof(LookupState));
+      stack.pop(count);
+      frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
+      goto loop;
+    }
+  }
+
+ castloop: {
+    CastState* s = static_cast<CastState*>(stack.peek(sizeof(CastState)));
+
+    ip = s->nextIp;
+
+    if (compileCastCheck(t, frame, s)) {
+      stack.pushValue(Uncast);
+      goto start;
+    } else {
+      compileCastCall(t, frame, s);
+
+      stack.pop(sizeof(CastState));
+      frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
+      goto loop;
+    }
+  }
+
  switchloop: {
     SwitchState* s = static_cast<SwitchState*>
       (stack.peek(sizeof(SwitchState)));
@@ -6389,11 +7567,37 @@ compile(MyThread* t, Frame* initialFrame, unsigned initialIp,
   }
 
  branch:
+  if (isBackEdge(ip, newIp)) {
+    // the branch was inverted by branchTarget, so it leaves the loop
+    // if taken; compile that path first and poll on the other
+    stack.pushValue(reinterpret_cast<uintptr_t>(c->saveState()));
+    stack.pushValue(newIp);
+    stack.pushValue(Unpoll0);
+    goto start;
+  }
+
   stack.pushValue(reinterpret_cast<uintptr_t>(c->saveState()));
   stack.pushValue(ip);
   stack.pushValue(Unbranch);
   ip = newIp;
   goto start;
+
+ poll:
+  // go straight round the loop unless the safepoint flag is set, and
+  // otherwise call pollSafepointThunk first (see Unpoll1)
+  c->jumpIfEqual
+    (4, c->constant(0, Compiler::IntegerType), c->and_
+     (4, c->constant(Thread::SafepointFlag, Compiler::IntegerType), c->load
+      (4, 4, c->memory
+       (c->register_(t->arch->thread()), Compiler::AddressType,
+        TARGET_THREAD_FLAGS), TargetBytesPerWord)),
+     frame->machineIp(newIp));
+
+  stack.pushValue(reinterpret_cast<uintptr_t>(c->saveState()));
+  stack.pushValue(newIp);
+  stack.pushValue(Unpoll1);
+  ip = newIp;
+  goto start;
 }
 
 FILE* compileLog = 0;
@@ -6402,6 +7606,9 @@ void
 logCompile(MyThread* t, const void* code, unsigned size, const char* class_,
            const char* name, const char* spec);
 
+void
+logCompile(MyThread* t, const void* code, unsigned size, object method);
+
 int
 resolveIpForwards(Context* context, int start, int end)
 {
@@ -7351,9 +8558,15 @@ finish(MyThread* t, FixedAllocator* allocator, Context* context)
         RUNTIME_ARRAY_BODY(elements)[index++] = p;
 
         if (p->target) {
-          insertCallNode
-            (t, makeCallNode
-             (t, p->address->value(), p->target, p->flags, 0));
+          object node = makeCallNode
+            (t, p->address->value(), p->target, p->flags, 0);
+          PROTECT(t, node);
+
+          insertCallNode(t, node);
+
+          if (p->flags & TraceElement::Devirtualized) {
+            recordDevirtualizedCall(t, node);
+          }
         }
       }
     }
@@ -7374,14 +8587,7 @@ finish(MyThread* t, FixedAllocator* allocator, Context* context)
     set(t, methodCode(t, context->method), CodePool, map);
   }
 
-  logCompile
-    (t, start, codeSize,
-     reinterpret_cast<const char*>
-     (&byteArrayBody(t, className(t, methodClass(t, context->method)), 0)),
-     reinterpret_cast<const char*>
-     (&byteArrayBody(t, methodName(t, context->method), 0)),
-     reinterpret_cast<const char*>
-     (&byteArrayBody(t, methodSpec(t, context->method), 0)));
+  logCompile(t, start, codeSize, context->method);
 
   // for debugging:
   if (false and
@@ -7616,7 +8822,8 @@ invokeNativeFast(MyThread* t, object method, void* function)
 }
 
 uint64_t
-invokeNativeSlow(MyThread* t, object method, void* function)
+invokeNativeSlow(MyThread* t, object method, void* function,
+                 unsigned directWords, unsigned directReferences)
 {
   PROTECT(t, method);
 
@@ -7651,40 +8858,56 @@ invokeNativeSlow(MyThread* t, object method, void* function)
   }
   RUNTIME_ARRAY_BODY(types)[typeOffset++] = POINTER_TYPE;
 
-  MethodSpecIterator it
-    (t, reinterpret_cast<const char*>
-     (&byteArrayBody(t, methodSpec(t, method), 0)));
-  
-  while (it.hasNext()) {
-    unsigned type = RUNTIME_ARRAY_BODY(types)[typeOffset++]
-      = fieldType(t, fieldCode(t, *it.next()));
-
-    switch (type) {
-    case INT8_TYPE:
-    case INT16_TYPE:
-    case INT32_TYPE:
-    case FLOAT_TYPE:
-      RUNTIME_ARRAY_BODY(args)[argOffset++] = *(sp++);
-      break;
-
-    case INT64_TYPE:
-    case DOUBLE_TYPE: {
-      memcpy(RUNTIME_ARRAY_BODY(args) + argOffset, sp, 8);
-      argOffset += (8 / BytesPerWord);
-      sp += 2;
-    } break;
-
-    case POINTER_TYPE: {
-      if (*sp) {
+  if (directWords) {
+    // every parameter occupies exactly one slot, so there is no need
+    // to consult the method spec
+    for (unsigned i = 0; argOffset < directWords; ++i) {
+      if ((directReferences & (1 << i)) == 0) {
+        RUNTIME_ARRAY_BODY(args)[argOffset++] = *sp;
+      } else if (*sp) {
         RUNTIME_ARRAY_BODY(args)[argOffset++]
           = reinterpret_cast<uintptr_t>(sp);
       } else {
         RUNTIME_ARRAY_BODY(args)[argOffset++] = 0;
       }
       ++ sp;
-    } break;
+    }
+  } else {
+    MethodSpecIterator it
+      (t, reinterpret_cast<const char*>
+       (&byteArrayBody(t, methodSpec(t, method), 0)));
+  
+    while (it.hasNext()) {
+      unsigned type = RUNTIME_ARRAY_BODY(types)[typeOffset++]
+        = fieldType(t, fieldCode(t, *it.next()));
+
+      switch (type) {
+      case INT8_TYPE:
+      case INT16_TYPE:
+      case INT32_TYPE:
+      case FLOAT_TYPE:
+        RUNTIME_ARRAY_BODY(args)[argOffset++] = *(sp++);
+        break;
 
-    default: abort(t);
+      case INT64_TYPE:
+      case DOUBLE_TYPE: {
+        memcpy(RUNTIME_ARRAY_BODY(args) + argOffset, sp, 8);
+        argOffset += (8 / BytesPerWord);
+        sp += 2;
+      } break;
+
+      case POINTER_TYPE: {
+        if (*sp) {
+          RUNTIME_ARRAY_BODY(args)[argOffset++]
+            = reinterpret_cast<uintptr_t>(sp);
+        } else {
+          RUNTIME_ARRAY_BODY(args)[argOffset++] = 0;
+        }
+        ++ sp;
+      } break;
+
+      default: abort(t);
+      }
     }
   }
 
@@ -7714,13 +8937,18 @@ invokeNativeSlow(MyThread* t, object method, void* function)
     t->checkpoint->noThrow = true;
     THREAD_RESOURCE(t, bool, noThrow, t->checkpoint->noThrow = noThrow);
 
-    result = t->m->system->call
-      (function,
-       RUNTIME_ARRAY_BODY(args),
-       RUNTIME_ARRAY_BODY(types),
-       count,
-       footprint * BytesPerWord,
-       returnType);
+    if (directWords) {
+      result = callNativeDirect
+        (t, function, RUNTIME_ARRAY_BODY(args), directWords);
+    } else {
+      result = t->m->system->call
+        (function,
+         RUNTIME_ARRAY_BODY(args),
+         RUNTIME_ARRAY_BODY(types),
+         count,
+         footprint * BytesPerWord,
+         returnType);
+    }
   }
 
   if (methodFlags(t, method) & ACC_SYNCHRONIZED) {
@@ -7792,7 +9020,9 @@ invokeNative2(MyThread* t, object method)
   if (nativeFast(t, native)) {
     return invokeNativeFast(t, method, nativeFunction(t, native));
   } else {
-    return invokeNativeSlow(t, method, nativeFunction(t, native));
+    return invokeNativeSlow
+      (t, method, nativeFunction(t, native), nativeDirectWords(t, native),
+       nativeDirectReferences(t, native));
   }
 }
 
@@ -8066,6 +9296,12 @@ walkContinuationBody(MyThread* t, Heap::Walker* w, object c, int start)
 
   object method = static_cast<object>
     (t->m->heap->follow(continuationMethod(t, c)));
+
+  // frameMapSizeInBits and findFrameMap read the method's code and
+  // frame map table directly, so tell the heap we depend on those too
+  object code = static_cast<object>(t->m->heap->follow(methodCode(t, method)));
+  t->m->heap->follow(codePool(t, code));
+
   int count = frameMapSizeInBits(t, method);
 
   if (count) {
@@ -8719,6 +9955,61 @@ isVirtualThunk(MyThread* t, void* ip);
 bool
 isThunkUnsafeStack(MyThread* t, void* ip);
 
+// sets up c, a trace context for target, from the register values
+// captured by System::visit when it interrupted target
+void
+initInterruptedContext(MyThread* t, MyThread* target,
+                       MyThread::TraceContext* c, void* ip, void* stack,
+                       void* link)
+{
+  if (methodForIp(t, ip)) {
+    // we caught the thread in Java code - use the register values
+    c->ip = ip;
+    c->stack = stack;
+    c->methodIsMostRecent = true;
+  } else if (target->transition) {
+    // we caught the thread in native code while in the middle
+    // of updating the context fields (MyThread::stack, etc.)
+    static_cast<MyThread::Context&>(*c) = *(target->transition);
+  } else if (isVmInvokeUnsafeStack(ip)) {
+    // we caught the thread in native code just after returning
+    // from java code, but before clearing MyThread::stack
+    // (which now contains a garbage value), and the most recent
+    // Java frame, if any, can be found in
+    // MyThread::continuation or MyThread::trace
+    c->ip = 0;
+    c->stack = 0;
+  } else if (target->stack
+             and (not isThunkUnsafeStack(t, ip))
+             and (not isVirtualThunk(t, ip)))
+  {
+    // we caught the thread in a thunk or native code, and the
+    // saved stack pointer indicates the most recent Java frame
+    // on the stack
+    c->ip = getIp(target);
+    c->stack = target->stack;
+  } else if (isThunk(t, ip) or isVirtualThunk(t, ip)) {
+    // we caught the thread in a thunk where the stack register
+    // indicates the most recent Java frame on the stack
+
+    // On e.g. x86, the return address will have already been
+    // pushed onto the stack, in which case we use getIp to
+    // retrieve it.  On e.g. PowerPC and ARM, it will be in the
+    // link register.  Note that we can't just check if the link
+    // argument is null here, since we use ecx/rcx as a
+    // pseudo-link register on x86 for the purpose of tail
+    // calls.
+    c->ip = t->arch->hasLinkRegister() ? link : getIp(t, link, stack);
+    c->stack = stack;
+  } else {
+    // we caught the thread in native code, and the most recent
+    // Java frame, if any, can be found in
+    // MyThread::continuation or MyThread::trace
+    c->ip = 0;
+    c->stack = 0;
+  }
+}
+
 void
 boot(MyThread* t, BootImage* image, uint8_t* code);
 
@@ -8748,6 +10039,46 @@ public:
   Processor::CompilationHandler* handler;
 };
 
+// records the name of each method compiled in this run, one per line,
+// so that the next run can compile them ahead of their first use
+class ProfileRecorder: public Processor::CompilationHandler {
+ public:
+  ProfileRecorder(Allocator* allocator, FILE* out):
+    allocator(allocator), out(out)
+  { }
+
+  virtual void compiled(const void*, unsigned, unsigned, const char* name) {
+    // thunks have no class, and are compiled at startup anyway
+    if (strncmp(name, "(null).", 7) != 0 and strchr(name, '(')) {
+      fprintf(out, "%s\n", name);
+      // keep the profile complete even if this run doesn't shut down
+      // cleanly
+      fflush(out);
+    }
+  }
+
+  virtual void lineNumbers(const void*, const char*, const uint64_t*,
+                           unsigned)
+  { }
+
+  virtual void dispose() {
+    fclose(out);
+    allocator->free(this, sizeof(*this));
+  }
+
+  Allocator* allocator;
+  FILE* out;
+};
+
+enum PrecompileResult {
+  Unavailable,
+  Precompiled,
+  Pending
+};
+
+uint64_t
+precompileMethod(Thread* t, uintptr_t* arguments);
+
 template<class T, class C>
 int checkConstant(MyThread* t, size_t expected, T C::* field, const char* name) {
   size_t actual = reinterpret_cast<uint8_t*>(&(t->*field)) - reinterpret_cast<uint8_t*>(t);
@@ -8801,8 +10132,11 @@ class MyProcessor: public Processor {
                         FixedSizeOfArithmeticException),
     codeAllocator(s, 0, 0),
     callTableSize(0),
+    returnThunk(0),
     useNativeFeatures(useNativeFeatures),
-    compilationHandlers(0)
+    compilationHandlers(0),
+    profile(0),
+    profileSize(0)
   {
     thunkTable[compileMethodIndex] = voidPointer(local::compileMethod);
     thunkTable[compileVirtualMethodIndex] = voidPointer(compileVirtualMethod);
@@ -8838,6 +10172,7 @@ class MyProcessor: public Processor {
 
     int mismatches =
       checkConstant(t, TARGET_THREAD_EXCEPTION, &Thread::exception, "TARGET_THREAD_EXCEPTION") +
+      checkConstant(t, TARGET_THREAD_FLAGS, &Thread::flags, "TARGET_THREAD_FLAGS") +
       checkConstant(t, TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT, &MyThread::exceptionStackAdjustment, "TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT") +
       checkConstant(t, TARGET_THREAD_EXCEPTIONOFFSET, &MyThread::exceptionOffset, "TARGET_THREAD_EXCEPTIONOFFSET") +
       checkConstant(t, TARGET_THREAD_EXCEPTIONHANDLER, &MyThread::exceptionHandler, "TARGET_THREAD_EXCEPTIONHANDLER") +
@@ -8887,6 +10222,15 @@ class MyProcessor: public Processor {
        offset, 0, 0, name, spec, addendum, class_, code);
   }
 
+  virtual void
+  initMethod(vm::Thread* t, object method)
+  {
+    object code = methodCode(t, method);
+    if (code) {
+      codeCompiled(t, code) = local::defaultThunk(static_cast<MyThread*>(t));
+    }
+  }
+
   virtual object
   makeClass(vm::Thread* t,
             uint16_t flags,
@@ -8910,7 +10254,7 @@ class MyProcessor: public Processor {
     return vm::makeClass
       (t, flags, vmFlags, fixedSize, arrayElementSize, arrayDimensions,
        0, objectMask, name, sourceFile, super, interfaceTable, virtualTable,
-       fieldTable, methodTable, staticTable, addendum, loader, 0,
+       fieldTable, methodTable, staticTable, addendum, loader, 0, 0, 0,
        vtableLength);
   }
 
@@ -8923,6 +10267,8 @@ class MyProcessor: public Processor {
         (virtualThunk(static_cast<MyThread*>(t), i));
       classVtable(t, c, i) = thunk;
     }
+
+    updateOverrides(static_cast<MyThread*>(t), c);
   }
 
   virtual void
@@ -9167,6 +10513,10 @@ class MyProcessor: public Processor {
 
     compilationHandlers->dispose(allocator);
 
+    if (profile) {
+      allocator->free(profile, profileSize + 1);
+    }
+
     s->handleSegFault(0);
 
     allocator->free(this, sizeof(*this));
@@ -9185,53 +10535,7 @@ class MyProcessor: public Processor {
 
       virtual void visit(void* ip, void* stack, void* link) {
         MyThread::TraceContext c(target, link);
-
-        if (methodForIp(t, ip)) {
-          // we caught the thread in Java code - use the register values
-          c.ip = ip;
-          c.stack = stack;
-          c.methodIsMostRecent = true;
-        } else if (target->transition) {
-          // we caught the thread in native code while in the middle
-          // of updating the context fields (MyThread::stack, etc.)
-          static_cast<MyThread::Context&>(c) = *(target->transition);
-        } else if (isVmInvokeUnsafeStack(ip)) {
-          // we caught the thread in native code just after returning
-          // from java code, but before clearing MyThread::stack
-          // (which now contains a garbage value), and the most recent
-          // Java frame, if any, can be found in
-          // MyThread::continuation or MyThread::trace
-          c.ip = 0;
-          c.stack = 0;
-        } else if (target->stack
-                   and (not isThunkUnsafeStack(t, ip))
-                   and (not isVirtualThunk(t, ip)))
-        {
-          // we caught the thread in a thunk or native code, and the
-          // saved stack pointer indicates the most recent Java frame
-          // on the stack
-          c.ip = getIp(target);
-          c.stack = target->stack;
-        } else if (isThunk(t, ip) or isVirtualThunk(t, ip)) {
-          // we caught the thread in a thunk where the stack register
-          // indicates the most recent Java frame on the stack
-          
-          // On e.g. x86, the return address will have already been
-          // pushed onto the stack, in which case we use getIp to
-          // retrieve it.  On e.g. PowerPC and ARM, it will be in the
-          // link register.  Note that we can't just check if the link
-          // argument is null here, since we use ecx/rcx as a
-          // pseudo-link register on x86 for the purpose of tail
-          // calls.
-          c.ip = t->arch->hasLinkRegister() ? link : getIp(t, link, stack);
-          c.stack = stack;
-        } else {
-          // we caught the thread in native code, and the most recent
-          // Java frame, if any, can be found in
-          // MyThread::continuation or MyThread::trace
-          c.ip = 0;
-          c.stack = 0;
-        }
+        initInterruptedContext(t, target, &c, ip, stack, link);
 
         if (ensure(t, traceSize(target))) {
           atomicOr(&(t->flags), Thread::TracingFlag);
@@ -9257,6 +10561,32 @@ class MyProcessor: public Processor {
     return visitor.trace ? visitor.trace : makeObjectArray(t, 0);
   }
 
+  virtual void sampleStack(Thread* vmt, Thread* vmTarget, StackVisitor* v) {
+    MyThread* t = static_cast<MyThread*>(vmt);
+    MyThread* target = static_cast<MyThread*>(vmTarget);
+
+    class Visitor: public System::ThreadVisitor {
+     public:
+      Visitor(MyThread* t, MyThread* target, StackVisitor* v):
+        t(t), target(target), v(v)
+      { }
+
+      virtual void visit(void* ip, void* stack, void* link) {
+        MyThread::TraceContext c(target, link);
+        initInterruptedContext(t, target, &c, ip, stack, link);
+
+        MyStackWalker walker(target);
+        walker.walk(v);
+      }
+
+      MyThread* t;
+      MyThread* target;
+      StackVisitor* v;
+    } visitor(t, target, v);
+
+    t->m->system->visit(t->systemThread, target->systemThread, &visitor);
+  }
+
   virtual void initialize(BootImage* image, uint8_t* code, unsigned capacity) {
     bootImage = image;
     codeAllocator.base = code;
@@ -9281,6 +10611,49 @@ class MyProcessor: public Processor {
     *addresses = bootContext.addresses;
   }
 
+  virtual unsigned precompile(Thread* t) {
+    unsigned pending = 0;
+    for (unsigned i = 0; i < profileSize;) {
+      char* entry = profile + i;
+      unsigned length = strlen(entry);
+      if (length) {
+        uintptr_t arguments[] = { reinterpret_cast<uintptr_t>(entry) };
+
+        uint64_t result = vm::run(t, precompileMethod, arguments);
+        if (t->exception) {
+          t->exception = 0;
+        }
+
+        if (result == Pending) {
+          ++ pending;
+        } else {
+          // compiled, or not worth trying again
+          entry[0] = 0;
+        }
+      }
+      i += length + 1;
+    }
+
+    return pending;
+  }
+
+  void readProfile(const char* path) {
+    System::Region* region;
+    if (s->success(s->map(&region, path))) {
+      profileSize = region->length();
+      profile = static_cast<char*>(allocator->allocate(profileSize + 1));
+      memcpy(profile, region->start(), profileSize);
+      region->dispose();
+
+      for (unsigned i = 0; i < profileSize; ++i) {
+        if (profile[i] == '\n') {
+          profile[i] = 0;
+        }
+      }
+      profile[profileSize] = 0;
+    }
+  }
+
   virtual void visitRoots(Thread* t, HeapWalker* w) {
     bootImage->methodTree = w->visitRoot(root(t, MethodTree));
     bootImage->methodTreeSentinal = w->visitRoot(root(t, MethodTreeSentinal));
@@ -9323,6 +10696,28 @@ class MyProcessor: public Processor {
   }
 
   virtual void boot(Thread* t, BootImage* image, uint8_t* code) {
+    const char* perf = findProperty(t, "avian.jit.perf");
+    if (perf) {
+      CompilationHandler* handler = makePerfCompilationHandler
+        (s, allocator, perf);
+      if (handler) {
+        addCompilationHandler(handler);
+      }
+    }
+
+    const char* profilePath = findProperty(t, "avian.jit.profile");
+    if (profilePath) {
+      // read the previous run's profile before starting this one's
+      readProfile(profilePath);
+
+      FILE* out = vm::fopen(profilePath, "wb");
+      if (out) {
+        addCompilationHandler
+          (new (allocator->allocate(sizeof(ProfileRecorder)))
+           ProfileRecorder(allocator, out));
+      }
+    }
+
 #if !defined(AVIAN_AOT_ONLY)
     if (codeAllocator.base == 0) {
       codeAllocator.base = static_cast<uint8_t*>
@@ -9426,9 +10821,12 @@ class MyProcessor: public Processor {
   ThunkCollection thunks;
   ThunkCollection bootThunks;
   unsigned callTableSize;
+  uintptr_t returnThunk;
   bool useNativeFeatures;
   void* thunkTable[dummyIndex + 1];
   CompilationHandlerList* compilationHandlers;
+  char* profile;
+  unsigned profileSize;
 };
 
 const char*
@@ -9474,8 +10872,86 @@ logCompile(MyThread* t, const void* code, unsigned size, const char* class_,
 
   MyProcessor* p = static_cast<MyProcessor*>(t->m->processor);
   for(CompilationHandlerList* h = p->compilationHandlers; h; h = h->next) {
-    h->handler->compiled(code, 0, 0, RUNTIME_ARRAY_BODY(completeName));
+    h->handler->compiled(code, size, 0, RUNTIME_ARRAY_BODY(completeName));
+  }
+}
+
+void
+logCompile(MyThread* t, const void* code, unsigned size, object method)
+{
+  MyProcessor* p = static_cast<MyProcessor*>(t->m->processor);
+  object lineNumberTable = codeLineNumberTable(t, methodCode(t, method));
+  if (p->compilationHandlers and lineNumberTable) {
+    object sourceFile = classSourceFile(t, methodClass(t, method));
+    const char* sourceFileName = sourceFile
+      ? reinterpret_cast<const char*>(&byteArrayBody(t, sourceFile, 0))
+      : stringOrNull(0);
+
+    for(CompilationHandlerList* h = p->compilationHandlers; h; h = h->next) {
+      h->handler->lineNumbers
+        (code, sourceFileName, &lineNumberTableBody(t, lineNumberTable, 0),
+         lineNumberTableLength(t, lineNumberTable));
+    }
+  }
+
+  logCompile
+    (t, code, size,
+     reinterpret_cast<const char*>
+     (&byteArrayBody(t, className(t, methodClass(t, method)), 0)),
+     reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodName(t, method), 0)),
+     reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodSpec(t, method), 0)));
+}
+
+uint64_t
+precompileMethod(Thread* vmt, uintptr_t* arguments)
+{
+  MyThread* t = static_cast<MyThread*>(vmt);
+  const char* entry = reinterpret_cast<const char*>(arguments[0]);
+
+  // entries have the form class.name(spec), as passed to logCompile
+  const char* dot = strchr(entry, '.');
+  const char* paren = dot ? strchr(dot, '(') : 0;
+  if (paren == 0) {
+    return Unavailable;
+  }
+
+  object className = makeByteArray(t, dot - entry + 1);
+  memcpy(&byteArrayBody(t, className, 0), entry, dot - entry);
+
+  object class_ = resolveClass
+    (t, root(t, Machine::AppLoader), className, false);
+  if (class_ == 0) {
+    return Unavailable;
+  }
+
+  // compiling a method initializes its class, and we must not run a
+  // static initializer any earlier than the program would have
+  if (classNeedsInit(t, class_)) {
+    return Pending;
+  }
+
+  PROTECT(t, class_);
+
+  object name = makeByteArray(t, paren - dot);
+  memcpy(&byteArrayBody(t, name, 0), dot + 1, paren - dot - 1);
+  PROTECT(t, name);
+
+  object spec = makeByteArray(t, "%s", paren);
+
+  object method = findMethodInClass(t, class_, name, spec);
+  if (method == 0
+      or methodCode(t, method) == 0
+      or (methodFlags(t, method) & ACC_NATIVE)
+      or methodAddress(t, method) != defaultThunk(t))
+  {
+    return Unavailable;
   }
+
+  compile(t, codeAllocator(t), 0, method);
+
+  return Precompiled;
 }
 
 void*
@@ -9508,6 +10984,26 @@ compileMethod2(MyThread* t, void* ip)
     address = methodAddress(t, target);
   }
 
+  if (callNodeFlags(t, node) & TraceElement::Devirtualized) {
+    // The target may have been overridden since this call site was
+    // compiled, in which case the site has already been (or is about
+    // to be) patched to dispatch through the vtable, and we must not
+    // undo that.
+    ACQUIRE(t, t->m->classLock);
+
+    if (methodVmFlags(t, target) & OverriddenFlag) {
+      return reinterpret_cast<void*>
+        (dispatchThunk(t, methodOffset(t, target)));
+    }
+
+    updateCall(t, callNodeFlags(t, node) & TraceElement::LongCall
+               ? avian::codegen::lir::AlignedLongCall
+               : avian::codegen::lir::AlignedCall,
+               updateIp, reinterpret_cast<void*>(address));
+
+    return reinterpret_cast<void*>(address);
+  }
+
   if (updateCaller) {
     avian::codegen::lir::UnaryOperation op;
     if (callNodeFlags(t, node) & TraceElement::LongCall) {
@@ -9877,13 +11373,7 @@ fixupMethods(Thread* t, object map, BootImage* image UNUSED, uint8_t* code)
             logCompile
               (static_cast<MyThread*>(t),
                reinterpret_cast<uint8_t*>(methodCompiled(t, method)),
-               methodCompiledSize(t, method),
-               reinterpret_cast<char*>
-               (&byteArrayBody(t, className(t, methodClass(t, method)), 0)),
-               reinterpret_cast<char*>
-               (&byteArrayBody(t, methodName(t, method), 0)),
-               reinterpret_cast<char*>
-               (&byteArrayBody(t, methodSpec(t, method), 0)));
+               methodCompiledSize(t, method), method);
           }
         }
       }
@@ -9928,6 +11418,69 @@ fixupVirtualThunks(MyThread* t, uint8_t* code)
   }
 }
 
+void
+logBootThunk(MyThread* t, const MyProcessor::Thunk& thunk, const char* name)
+{
+  logCompile(t, thunk.start, thunk.length, 0, name, 0);
+}
+
+void
+logBootMethods(MyThread* t, object map)
+{
+  for (HashMapIterator it(t, map); it.hasMore();) {
+    object c = tripleSecond(t, it.next());
+
+    if (classMethodTable(t, c)) {
+      for (unsigned i = 0; i < arrayLength(t, classMethodTable(t, c)); ++i) {
+        object method = arrayBody(t, classMethodTable(t, c), i);
+        if (methodCode(t, method)) {
+          logCompile
+            (t, reinterpret_cast<uint8_t*>(methodCompiled(t, method)),
+             methodCompiledSize(t, method), method);
+        }
+      }
+    }
+  }
+}
+
+// reports code which came from the boot image rather than the JIT
+// (and so was never passed to logCompile) to any compilation
+// handlers, e.g. so that perf can symbolize it
+void
+logBootImage(MyThread* t)
+{
+  MyProcessor* p = processor(t);
+
+  logBootThunk(t, p->bootThunks.default_, "bootDefault");
+  logBootThunk(t, p->bootThunks.defaultVirtual, "bootDefaultVirtual");
+  logBootThunk(t, p->bootThunks.native, "bootNative");
+  logBootThunk(t, p->bootThunks.aioob, "bootAioob");
+  logBootThunk(t, p->bootThunks.stackOverflow, "bootStackOverflow");
+
+  { uint8_t* start = p->bootThunks.table.start;
+
+#define THUNK(s)                                                        \
+    logCompile(t, start, p->bootThunks.table.length, 0, "boot_" #s, 0); \
+    start += p->bootThunks.table.length;
+#include "thunks.cpp"
+#undef THUNK
+  }
+
+  for (unsigned i = 0; i < wordArrayLength(t, root(t, VirtualThunks)); i += 2)
+  {
+    uintptr_t start = wordArrayBody(t, root(t, VirtualThunks), i);
+    if (start) {
+      logCompile
+        (t, reinterpret_cast<uint8_t*>(start),
+         wordArrayBody(t, root(t, VirtualThunks), i + 1), 0,
+         "bootVirtualThunk", 0);
+    }
+  }
+
+  logBootMethods(t, classLoaderMap(t, root(t, Machine::BootLoader)));
+  logBootMethods(t, classLoaderMap(t, root(t, Machine::AppLoader)));
+}
+
 void
 boot(MyThread* t, BootImage* image, uint8_t* code)
 {
@@ -10031,6 +11584,10 @@ boot(MyThread* t, BootImage* image, uint8_t* code)
   image->initialized = true;
 
   setRoot(t, Machine::BootstrapClassMap, makeHashMap(t, 0, 0));
+
+  if (p->compilationHandlers) {
+    logBootImage(t);
+  }
 }
 
 intptr_t
@@ -10395,6 +11952,228 @@ virtualThunk(MyThread* t, unsigned index)
   return wordArrayBody(t, root(t, VirtualThunks), index * 2);
 }
 
+uintptr_t
+compileDispatchThunk(MyThread* t, unsigned index, unsigned* size)
+{
+  Context context(t);
+  avian::codegen::Assembler* a = context.assembler;
+
+  // This does the same vtable lookup as an ordinary virtual call
+  // site, using the receiver found on the stack, for use by call
+  // sites which were compiled as direct calls but can no longer be.
+
+  lir::Register target(t->arch->virtualCallTarget());
+  lir::Memory instance
+    (t->arch->stack(),
+     (t->arch->frameFooterSize() + t->arch->frameReturnAddressSize())
+     * TargetBytesPerWord);
+
+  a->apply(lir::Move,
+           OperandInfo(TargetBytesPerWord, lir::MemoryOperand, &instance),
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target));
+
+  lir::Memory header(target.low, 0);
+
+  a->apply(lir::Move,
+           OperandInfo(TargetBytesPerWord, lir::MemoryOperand, &header),
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target));
+
+  avian::codegen::ResolvedPromise maskPromise(TargetPointerMask);
+  lir::Constant mask(&maskPromise);
+
+  a->apply(lir::And,
+           OperandInfo(TargetBytesPerWord, lir::ConstantOperand, &mask),
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target),
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target));
+
+  lir::Memory entry
+    (target.low, TargetClassVtable + (index * TargetBytesPerWord));
+
+  a->apply(lir::Move,
+           OperandInfo(TargetBytesPerWord, lir::MemoryOperand, &entry),
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target));
+
+  a->apply(lir::Jump,
+           OperandInfo(TargetBytesPerWord, lir::RegisterOperand, &target));
+
+  *size = a->endBlock(false)->resolve(0, 0);
+
+  uint8_t* start = static_cast<uint8_t*>
+    (codeAllocator(t)->allocate(*size, TargetBytesPerWord));
+
+  a->setDestination(start);
+  a->write();
+
+  const char* const dispatchThunkBaseName = "dispatchThunk";
+  const size_t dispatchThunkBaseNameLength = strlen(dispatchThunkBaseName);
+  const size_t maxIntStringLength = 10;
+
+  THREAD_RUNTIME_ARRAY(t, char, dispatchThunkName,
+                       dispatchThunkBaseNameLength + maxIntStringLength);
+
+  sprintf(RUNTIME_ARRAY_BODY(dispatchThunkName), "%s%d",
+          dispatchThunkBaseName, index);
+
+  logCompile(t, start, *size, 0, RUNTIME_ARRAY_BODY(dispatchThunkName), 0);
+
+  return reinterpret_cast<uintptr_t>(start);
+}
+
+uintptr_t
+returnThunk(MyThread* t)
+{
+  MyProcessor* p = processor(t);
+
+  ACQUIRE(t, t->m->classLock);
+
+  if (p->returnThunk == 0) {
+    Context context(t);
+    avian::codegen::Assembler* a = context.assembler;
+
+    a->apply(lir::Return);
+
+    unsigned size = a->endBlock(false)->resolve(0, 0);
+
+    uint8_t* start = static_cast<uint8_t*>
+      (codeAllocator(t)->allocate(size, TargetBytesPerWord));
+
+    a->setDestination(start);
+    a->write();
+
+    logCompile(t, start, size, 0, "return", 0);
+
+    p->returnThunk = reinterpret_cast<uintptr_t>(start);
+  }
+
+  return p->returnThunk;
+}
+
+uintptr_t
+dispatchThunk(MyThread* t, unsigned index)
+{
+  ACQUIRE(t, t->m->classLock);
+
+  if (root(t, DispatchThunks) == 0
+      or wordArrayLength(t, root(t, DispatchThunks)) <= index)
+  {
+    object newArray = makeWordArray(t, nextPowerOfTwo(index + 1));
+    if (root(t, DispatchThunks)) {
+      memcpy(&wordArrayBody(t, newArray, 0),
+             &wordArrayBody(t, root(t, DispatchThunks), 0),
+             wordArrayLength(t, root(t, DispatchThunks)) * BytesPerWord);
+    }
+    setRoot(t, DispatchThunks, newArray);
+  }
+
+  if (wordArrayBody(t, root(t, DispatchThunks), index) == 0) {
+    unsigned size;
+    wordArrayBody(t, root(t, DispatchThunks), index)
+      = compileDispatchThunk(t, index, &size);
+  }
+
+  return wordArrayBody(t, root(t, DispatchThunks), index);
+}
+
+void
+patchDevirtualizedCall(MyThread* t, object node, object method)
+{
+  PROTECT(t, node);
+
+  void* thunk = reinterpret_cast<void*>
+    (dispatchThunk(t, methodOffset(t, method)));
+
+  updateCall(t, callNodeFlags(t, node) & TraceElement::LongCall
+             ? avian::codegen::lir::AlignedLongCall
+             : avian::codegen::lir::AlignedCall,
+             reinterpret_cast<void*>(callNodeAddress(t, node)), thunk);
+}
+
+void
+recordDevirtualizedCall(MyThread* t, object node)
+{
+  // the caller must hold the class lock, which is what keeps this
+  // from racing with updateOverrides
+
+  object method = callNodeTarget(t, node);
+
+  if (methodVmFlags(t, method) & OverriddenFlag) {
+    // overridden while the caller was being compiled
+    patchDevirtualizedCall(t, node, method);
+    return;
+  }
+
+  PROTECT(t, node);
+  PROTECT(t, method);
+
+  if (root(t, DevirtualizedCalls) == 0) {
+    setRoot(t, DevirtualizedCalls, makeHashMap(t, 0, 0));
+  }
+
+  object list = hashMapFind
+    (t, root(t, DevirtualizedCalls), method, objectHash, objectEqual);
+
+  list = makePair(t, node, list);
+
+  hashMapInsertOrReplace
+    (t, root(t, DevirtualizedCalls), method, list, objectHash, objectEqual);
+}
+
+void
+invalidateDevirtualizedCalls(MyThread* t, object method)
+{
+  if (root(t, DevirtualizedCalls) == 0) {
+    return;
+  }
+
+  PROTECT(t, method);
+
+  object list = hashMapRemove
+    (t, root(t, DevirtualizedCalls), method, objectHash, objectEqual);
+
+  PROTECT(t, list);
+
+  for (; list; list = pairSecond(t, list)) {
+    patchDevirtualizedCall(t, pairFirst(t, list), method);
+  }
+}
+
+void
+updateOverrides(MyThread* t, object c)
+{
+  // Any method in the superclass's vtable which is replaced in this
+  // class's vtable can no longer be assumed to be the only
+  // implementation of its vtable slot.  Since this happens before
+  // any instance of the class can exist, patching the direct calls
+  // to such methods now is enough to keep them correct.
+
+  if ((classFlags(t, c) & ACC_INTERFACE) or classSuper(t, c) == 0) {
+    return;
+  }
+
+  object vtable = classVirtualTable(t, c);
+  object superVtable = classVirtualTable(t, classSuper(t, c));
+
+  if (vtable == 0 or superVtable == 0 or vtable == superVtable) {
+    return;
+  }
+
+  PROTECT(t, vtable);
+  PROTECT(t, superVtable);
+
+  for (unsigned i = 0; i < arrayLength(t, superVtable); ++i) {
+    object method = arrayBody(t, superVtable, i);
+    if (arrayBody(t, vtable, i) != method
+        and (methodVmFlags(t, method) & OverriddenFlag) == 0)
+    {
+      ACQUIRE(t, t->m->classLock);
+
+      methodVmFlags(t, method) |= OverriddenFlag;
+
+      invalidateDevirtualizedCalls(t, method);
+    }
+  }
+}
+
 void
 compile(MyThread* t, FixedAllocator* allocator, BootContext* bootContext,
         object method)
@@ -22,11 +22,29 @@ namespace {
 
 namespace local {
 
-const unsigned Top = ~static_cast<unsigned>(0);
+const uintptr_t Top = ~static_cast<uintptr_t>(0);
 
 const unsigned InitialGen2CapacityInBytes = 4 * 1024 * 1024;
 const unsigned InitialTenuredFixieCeilingInBytes = 4 * 1024 * 1024;
 
+// fixies at least this large are carved out of runs of pages mapped
+// directly from the system (the large object space) rather than being
+// allocated one by one from the system allocator:
+const uintptr_t LargeObjectThresholdInBytes = 64 * 1024;
+
+// size classes start at LargeObjectThresholdInBytes and go up in
+// quarters of a power of two, so no more than a quarter of a slot is
+// wasted.  Anything bigger than the largest class gets a run to
+// itself:
+const unsigned LargeObjectClassCount = 36;
+
+// runs for a size class hold as many slots as fit in this size:
+const uintptr_t LargeObjectRunSizeInBytes = 1024 * 1024;
+
+// how many bytes of empty runs to keep mapped for reuse (their
+// contents are discarded, so they cost address space but not memory):
+const uintptr_t LargeObjectRetainedBytes = 16 * 1024 * 1024;
+
 const bool Verbose = false;
 const bool Verbose2 = false;
 const bool Debug = false;
@@ -58,14 +76,16 @@ class Context;
 
 Aborter* getAborter(Context* c);
 
-void* tryAllocate(Context* c, unsigned size);
-void* allocate(Context* c, unsigned size);
-void* allocate(Context* c, unsigned size, bool limit);
-void free(Context* c, const void* p, unsigned size);
+void* tryAllocate(Context* c, uintptr_t size);
+void* allocate(Context* c, uintptr_t size);
+void* allocate(Context* c, uintptr_t size, bool limit);
+void free(Context* c, const void* p, uintptr_t size);
+void* tryAllocateLarge(Context* c, uintptr_t size);
+void freeLarge(Context* c, void* p);
 
 #ifdef USE_ATOMIC_OPERATIONS
 inline void
-markBitAtomic(uintptr_t* map, unsigned i)
+markBitAtomic(uintptr_t* map, uintptr_t i)
 {
   uintptr_t* p = map + wordOf(i);
   uintptr_t v = static_cast<uintptr_t>(1) << bitOf(i);
@@ -76,6 +96,67 @@ markBitAtomic(uintptr_t* map, unsigned i)
 }
 #endif // USE_ATOMIC_OPERATIONS
 
+inline unsigned
+bitCount(uintptr_t v)
+{
+#ifdef __GNUC__
+  return __builtin_popcountll(v);
+#else
+  unsigned n = 0;
+  for (; v; v &= v - 1) ++ n;
+  return n;
+#endif
+}
+
+// growable stack of pointers, used for the gen2 mark stack and the
+// list of root slots which must be updated after compaction.  Since
+// these grow during a collection, push returns false instead of
+// aborting when there is no memory left to grow them, and the caller
+// must make do without.
+class Stack {
+ public:
+  Stack(): data(0), size(0), capacity(0) { }
+
+  bool push(Context* c, void* p) {
+    if (size == capacity) {
+      uintptr_t newCapacity = capacity ? capacity * 2 : 1024;
+      void** newData = static_cast<void**>
+        (local::allocate(c, newCapacity * BytesPerWord, false));
+      if (newData == 0) {
+        return false;
+      }
+
+      if (data) {
+        memcpy(newData, data, size * BytesPerWord);
+        local::free(c, data, capacity * BytesPerWord);
+      }
+
+      data = newData;
+      capacity = newCapacity;
+    }
+
+    data[size++] = p;
+    return true;
+  }
+
+  void* pop() {
+    return data[--size];
+  }
+
+  void dispose(Context* c) {
+    if (data) {
+      local::free(c, data, capacity * BytesPerWord);
+    }
+    data = 0;
+    size = 0;
+    capacity = 0;
+  }
+
+  void** data;
+  uintptr_t size;
+  uintptr_t capacity;
+};
+
 inline void*
 get(void* o, unsigned offsetInWords)
 {
@@ -109,10 +190,10 @@ class Segment {
     class Iterator {
      public:
       Map* map;
-      unsigned index;
-      unsigned limit;
+      uintptr_t index;
+      uintptr_t limit;
       
-      Iterator(Map* map, unsigned start, unsigned end):
+      Iterator(Map* map, uintptr_t start, uintptr_t end):
         map(map)
       {
         assert(map->segment->context, map->bitsPerRecord == 1);
@@ -128,9 +209,9 @@ class Segment {
       }
 
       bool hasMore() {
-        unsigned word = wordOf(index);
+        uintptr_t word = wordOf(index);
         unsigned bit = bitOf(index);
-        unsigned wordLimit = wordOf(limit);
+        uintptr_t wordLimit = wordOf(limit);
         unsigned bitLimit = bitOf(limit);
 
         for (; word <= wordLimit and (word < wordLimit or bit < bitLimit);
@@ -158,7 +239,7 @@ class Segment {
         return false;
       }
       
-      unsigned next() {
+      uintptr_t next() {
         assert(map->segment->context, hasMore());
         assert(map->segment->context, map->segment);
 
@@ -212,31 +293,32 @@ class Segment {
       }
     }
 
-    unsigned calculateOffset(unsigned capacity) {
-      unsigned n = 0;
+    uintptr_t calculateOffset(uintptr_t capacity) {
+      uintptr_t n = 0;
       if (child) n += child->calculateFootprint(capacity);
       return n;
     }
 
-    static unsigned calculateSize(Context* c UNUSED, unsigned capacity,
-                                  unsigned scale, unsigned bitsPerRecord)
+    static uintptr_t calculateSize(Context* c UNUSED, uintptr_t capacity,
+                                   unsigned scale, unsigned bitsPerRecord)
     {
-      unsigned result
-        = ceilingDivide(ceilingDivide(capacity, scale) * bitsPerRecord, BitsPerWord);
+      uintptr_t result
+        = ceilingDivideWord
+        (ceilingDivideWord(capacity, scale) * bitsPerRecord, BitsPerWord);
       assert(c, result);
       return result;
     }
 
-    unsigned calculateSize(unsigned capacity) {
+    uintptr_t calculateSize(uintptr_t capacity) {
       return calculateSize(segment->context, capacity, scale, bitsPerRecord);
     }
 
-    unsigned size() {
+    uintptr_t size() {
       return calculateSize(segment->capacity());
     }
 
-    unsigned calculateFootprint(unsigned capacity) {
-      unsigned n = calculateSize(capacity);
+    uintptr_t calculateFootprint(uintptr_t capacity) {
+      uintptr_t n = calculateSize(capacity);
       if (child) n += child->calculateFootprint(capacity);
       return n;
     }
@@ -253,33 +335,33 @@ class Segment {
       if (child) child->replaceWith(m->child);
     }
 
-    unsigned indexOf(unsigned segmentIndex) {
+    uintptr_t indexOf(uintptr_t segmentIndex) {
       return (segmentIndex / scale) * bitsPerRecord;
     }
 
-    unsigned indexOf(void* p) {
+    uintptr_t indexOf(void* p) {
       assert(segment->context, segment->almostContains(p));
       assert(segment->context, segment->capacity());
       return indexOf(segment->indexOf(p));
     }
 
-    void clearBit(unsigned i) {
+    void clearBit(uintptr_t i) {
       assert(segment->context, wordOf(i) < size());
 
       vm::clearBit(data, i);
     }
 
-    void setBit(unsigned i) {
+    void setBit(uintptr_t i) {
       assert(segment->context, wordOf(i) < size());
 
       vm::markBit(data, i);
     }
 
-    void clearOnlyIndex(unsigned index) {
+    void clearOnlyIndex(uintptr_t index) {
       clearBits(data, bitsPerRecord, index);
     }
 
-    void clearOnly(unsigned segmentIndex) {
+    void clearOnly(uintptr_t segmentIndex) {
       clearOnlyIndex(indexOf(segmentIndex));
     }
 
@@ -292,11 +374,11 @@ class Segment {
       if (child) child->clear(p);
     }
 
-    void setOnlyIndex(unsigned index, unsigned v = 1) {
+    void setOnlyIndex(uintptr_t index, unsigned v = 1) {
       setBits(data, bitsPerRecord, index, v);
     }
 
-    void setOnly(unsigned segmentIndex, unsigned v = 1) {
+    void setOnly(uintptr_t segmentIndex, unsigned v = 1) {
       setOnlyIndex(indexOf(segmentIndex), v);
     }
 
@@ -326,11 +408,11 @@ class Segment {
 
   Context* context;
   uintptr_t* data;
-  unsigned position_;
-  unsigned capacity_;
+  uintptr_t position_;
+  uintptr_t capacity_;
   Map* map;
 
-  Segment(Context* context, Map* map, unsigned desired, unsigned minimum):
+  Segment(Context* context, Map* map, uintptr_t desired, uintptr_t minimum):
     context(context),
     data(0),
     position_(0),
@@ -352,7 +434,7 @@ class Segment {
 
         if (data == 0) {
           if (capacity_ > minimum) {
-            capacity_ = avg(minimum, capacity_);
+            capacity_ = minimum + ((capacity_ - minimum) / 2);
             if (capacity_ == 0) {
               break;
             }
@@ -370,8 +452,8 @@ class Segment {
     }
   }
 
-  Segment(Context* context, Map* map, uintptr_t* data, unsigned position,
-          unsigned capacity):
+  Segment(Context* context, Map* map, uintptr_t* data, uintptr_t position,
+          uintptr_t capacity):
     context(context),
     data(data),
     position_(position),
@@ -383,20 +465,20 @@ class Segment {
     }
   }
 
-  unsigned footprint(unsigned capacity) {
+  uintptr_t footprint(uintptr_t capacity) {
     return capacity
       + (map and capacity ? map->calculateFootprint(capacity) : 0);
   }
 
-  unsigned capacity() {
+  uintptr_t capacity() {
     return capacity_;
   }
 
-  unsigned position() {
+  uintptr_t position() {
     return position_;
   }
 
-  unsigned remaining() {
+  uintptr_t remaining() {
     return capacity() - position();
   }
 
@@ -433,12 +515,12 @@ class Segment {
     return contains(p) or p == data + position();
   }
 
-  void* get(unsigned offset) {
+  void* get(uintptr_t offset) {
     assert(context, offset <= position());
     return data + offset;
   }
 
-  unsigned indexOf(void* p) {
+  uintptr_t indexOf(void* p) {
     assert(context, almostContains(p));
     return static_cast<uintptr_t*>(p) - data;
   }
@@ -467,6 +549,7 @@ class Fixie {
   static const unsigned Marked = 1 << 1;
   static const unsigned Dirty = 1 << 2;
   static const unsigned Dead = 1 << 3;
+  static const unsigned Large = 1 << 4;
 
   Fixie(Context* c, unsigned size, bool hasMask, Fixie** handle,
         bool immortal):
@@ -479,7 +562,8 @@ class Fixie {
     memset(mask(), 0, maskSize(size, hasMask));
     add(c, handle);
     if (DebugFixies) {
-      fprintf(stderr, "make fixie %p of size %d\n", this, totalSize());
+      fprintf(stderr, "make fixie %p of size %lu\n", this,
+              static_cast<unsigned long>(totalSize()));
     }
   }
 
@@ -530,15 +614,16 @@ class Fixie {
     return body_ + size;
   }
 
-  static unsigned maskSize(unsigned size, bool hasMask) {
-    return hasMask * ceilingDivide(size, BitsPerWord) * BytesPerWord;
+  static uintptr_t maskSize(unsigned size, bool hasMask) {
+    return hasMask * ceilingDivideWord(size, BitsPerWord) * BytesPerWord;
   }
 
-  static unsigned totalSize(unsigned size, bool hasMask) {
-    return sizeof(Fixie) + (size * BytesPerWord) + maskSize(size, hasMask);
+  static uintptr_t totalSize(unsigned size, bool hasMask) {
+    return sizeof(Fixie) + (static_cast<uintptr_t>(size) * BytesPerWord)
+      + maskSize(size, hasMask);
   }
 
-  unsigned totalSize() {
+  uintptr_t totalSize() {
     return totalSize(size, hasMask());
   }
 
@@ -570,6 +655,10 @@ class Fixie {
     }
   }
 
+  bool large() {
+    return (flags & Large) != 0;
+  }
+
   bool dead() {
     return (flags & Dead) != 0;
   }
@@ -599,12 +688,64 @@ fixie(void* body)
   return static_cast<Fixie*>(body) - 1;
 }
 
+// a run of pages in the large object space, divided into equal slots,
+// each of which holds a fixie preceded by a pointer back to the run
+class LargeRun {
+ public:
+  LargeRun(LargeRun* next, uint8_t* start, uintptr_t slotSize,
+           unsigned sizeClass, unsigned slotCount):
+    next(next),
+    start(start),
+    slotSize(slotSize),
+    sizeClass(sizeClass),
+    slotCount(slotCount),
+    liveCount(0),
+    occupied(0)
+  { }
+
+  uintptr_t size() {
+    return slotSize * slotCount;
+  }
+
+  bool full() {
+    return liveCount == slotCount;
+  }
+
+  LargeRun* next;
+  uint8_t* start;
+  uintptr_t slotSize;
+  unsigned sizeClass;
+  unsigned slotCount;
+  unsigned liveCount;
+  uintptr_t occupied; // one bit per slot
+};
+
+// a block of memory which would otherwise have been freed or reused
+// after a collection, but which still holds at least one pinned
+// object (see visitPins)
+class Retained {
+ public:
+  Retained(Retained* next, void* start, uintptr_t size):
+    next(next),
+    start(start),
+    size(size)
+  { }
+
+  bool contains(void* p) {
+    return p >= start and p < static_cast<uint8_t*>(start) + size;
+  }
+
+  Retained* next;
+  void* start;
+  uintptr_t size; // in bytes
+};
+
 void
 free(Context* c, Fixie** fixies, bool resetImmortal = false);
 
 class Context {
  public:
-  Context(System* system, unsigned limit):
+  Context(System* system, uintptr_t limit):
     system(system),
     client(0),
     count(0),
@@ -631,6 +772,14 @@ class Context {
     nextHeapMap(&nextGen2, 1, nextPageMap.scale * 1024, &nextPageMap, true),
     nextGen2(this, &nextHeapMap, 0, 0),
 
+    markMap(&gen2, 1, 1, 0, false),
+    marking(false),
+    markedCount(0),
+    markOverflow(false),
+    compactTarget(0),
+    compactRanks(0),
+    compactForwards(0),
+
     gen2Base(0),
     incomingFootprint(0),
     tenureFootprint(0),
@@ -651,13 +800,32 @@ class Context {
     markedFixies(0),
     visitedFixies(0),
 
+    largeRetained(0),
+
+    pinLock(0),
+    pinnedYoung(0),
+    pinnedYoungCount(0),
+    pinnedYoungCapacity(0),
+    pinnedGen2(false),
+    retained(0),
+
     lastCollectionTime(system->now()),
     totalCollectionTime(0),
-    totalTime(0)
+    totalTime(0),
+
+    promotedFootprint(0),
+    eventLog(0)
   {
     if (not system->success(system->make(&lock))) {
       system->abort();
     }
+
+    if (not system->success(system->make(&pinLock))) {
+      system->abort();
+    }
+
+    memset(&statistics, 0, sizeof(Heap::Statistics));
+    memset(largeRuns, 0, sizeof(largeRuns));
   }
 
   void dispose() {
@@ -665,6 +833,28 @@ class Context {
     nextGen1.dispose();
     gen2.dispose();
     nextGen2.dispose();
+
+    for (unsigned i = 0; i <= LargeObjectClassCount; ++i) {
+      while (largeRuns[i]) {
+        LargeRun* r = largeRuns[i];
+        largeRuns[i] = r->next;
+
+        system->freePages(r->start, r->size());
+        system->free(r);
+      }
+    }
+
+    while (retained) {
+      Retained* r = retained;
+      retained = r->next;
+
+      free(this, r->start, r->size);
+      free(this, r, sizeof(Retained));
+    }
+
+    pins.dispose(this);
+
+    pinLock->dispose();
     lock->dispose();
   }
 
@@ -677,8 +867,8 @@ class Context {
   System* system;
   Heap::Client* client;
 
-  unsigned count;
-  unsigned limit;
+  uintptr_t count;
+  uintptr_t limit;
 
   System::Mutex* lock;
 
@@ -701,18 +891,34 @@ class Context {
   Segment::Map nextHeapMap;
   Segment nextGen2;
 
-  unsigned gen2Base;
+  // state for major collections, which mark gen2 in place and then
+  // slide the survivors together (see compact below).  The mark bits
+  // live in a side map over gen2, while pointerMap, which is rebuilt
+  // from scratch afterwards anyway, records the objects which must
+  // not move.  markOverflow is set when a marked object couldn't be
+  // pushed on the mark stack, and so must be found by rescanning.
+  Segment::Map markMap;
+  bool marking;
+  uintptr_t markedCount;
+  bool markOverflow;
+  Stack markStack;
+  Stack rootSlots;
+  Segment* compactTarget;
+  uintptr_t* compactRanks;
+  uintptr_t* compactForwards;
+
+  uintptr_t gen2Base;
   
-  unsigned incomingFootprint;
-  unsigned tenureFootprint;
-  unsigned gen1Padding;
-  unsigned tenurePadding;
-  unsigned gen2Padding;
+  uintptr_t incomingFootprint;
+  uintptr_t tenureFootprint;
+  uintptr_t gen1Padding;
+  uintptr_t tenurePadding;
+  uintptr_t gen2Padding;
 
-  unsigned fixieTenureFootprint;
-  unsigned untenuredFixieFootprint;
-  unsigned tenuredFixieFootprint;
-  unsigned tenuredFixieCeiling;
+  uintptr_t fixieTenureFootprint;
+  uintptr_t untenuredFixieFootprint;
+  uintptr_t tenuredFixieFootprint;
+  uintptr_t tenuredFixieCeiling;
 
   Heap::CollectionType mode;
 
@@ -722,9 +928,32 @@ class Context {
   Fixie* markedFixies;
   Fixie* visitedFixies;
 
+  LargeRun* largeRuns[LargeObjectClassCount + 1];
+  uintptr_t largeRetained;
+
+  // objects the client has pinned (e.g. for the duration of a JNI
+  // critical region), once per pin.  Guarded by pinLock, although
+  // the client promises not to change them during a collection.
+  System::Mutex* pinLock;
+  Stack pins;
+
+  // for the duration of a collection, the pinned objects which would
+  // otherwise have been copied, sorted by address, and whether any
+  // pinned objects are in gen2:
+  void** pinnedYoung;
+  uintptr_t pinnedYoungCount;
+  uintptr_t pinnedYoungCapacity;
+  bool pinnedGen2;
+
+  Retained* retained;
+
   int64_t lastCollectionTime;
   int64_t totalCollectionTime;
   int64_t totalTime;
+
+  uintptr_t promotedFootprint;
+  Heap::Statistics statistics;
+  FILE* eventLog;
 };
 
 const char*
@@ -747,18 +976,24 @@ inline Aborter* getAborter(Context* c) {
   return c->system;
 }
 
-inline unsigned
+inline uintptr_t
 minimumNextGen1Capacity(Context* c)
 {
-  return c->gen1.position() - c->tenureFootprint + c->incomingFootprint
-    + c->gen1Padding;
+  uintptr_t n = c->gen1.position() + c->incomingFootprint + c->gen1Padding;
+
+  if (c->mode == Heap::MinorCollection) {
+    return n - c->tenureFootprint;
+  } else {
+    // a major collection compacts gen2 in place, so objects due for
+    // tenure stay in gen1 until the next minor collection
+    return n + c->tenurePadding;
+  }
 }
 
-inline unsigned
-minimumNextGen2Capacity(Context* c)
+inline uintptr_t
+minimumNextGen2Capacity(Context* c, uintptr_t live)
 {
-  return c->gen2.position() + c->tenureFootprint + c->tenurePadding
-    + c->gen2Padding;
+  return live + c->tenureFootprint + c->tenurePadding + c->gen2Padding;
 }
 
 inline bool
@@ -774,19 +1009,19 @@ initNextGen1(Context* c)
   new (&(c->nextAgeMap)) Segment::Map
     (&(c->nextGen1), max(1, log(TenureThreshold)), 1, 0, false);
 
-  unsigned minimum = minimumNextGen1Capacity(c);
-  unsigned desired = minimum;
+  uintptr_t minimum = minimumNextGen1Capacity(c);
+  uintptr_t desired = minimum;
 
   new (&(c->nextGen1)) Segment(c, &(c->nextAgeMap), desired, minimum);
 
   if (Verbose2) {
-    fprintf(stderr, "init nextGen1 to %d bytes\n",
-            c->nextGen1.capacity() * BytesPerWord);
+    fprintf(stderr, "init nextGen1 to %lld bytes\n",
+            static_cast<long long>(c->nextGen1.capacity() * BytesPerWord));
   }
 }
 
 inline void
-initNextGen2(Context* c)
+initNextGen2(Context* c, uintptr_t desired, uintptr_t minimum)
 {
   new (&(c->nextPointerMap)) Segment::Map
     (&(c->nextGen2), 1, 1, 0, true);
@@ -798,22 +1033,11 @@ initNextGen2(Context* c)
   new (&(c->nextHeapMap)) Segment::Map
     (&(c->nextGen2), 1, c->pageMap.scale * 1024, &(c->nextPageMap), true);
 
-  unsigned minimum = minimumNextGen2Capacity(c);
-  unsigned desired = minimum;
-
-  if (not oversizedGen2(c)) {
-    desired *= 2;
-  }
-
-  if (desired < InitialGen2CapacityInBytes / BytesPerWord) {
-    desired = InitialGen2CapacityInBytes / BytesPerWord;
-  }
-
   new (&(c->nextGen2)) Segment(c, &(c->nextHeapMap), desired, minimum);
 
   if (Verbose2) {
-    fprintf(stderr, "init nextGen2 to %d bytes\n",
-            c->nextGen2.capacity() * BytesPerWord);
+    fprintf(stderr, "init nextGen2 to %lld bytes\n",
+            static_cast<long long>(c->nextGen2.capacity() * BytesPerWord));
   }
 }
 
@@ -828,7 +1052,94 @@ fresh(Context* c, void* o)
 inline bool
 wasCollected(Context* c, void* o)
 {
-  return o and (not fresh(c, o)) and fresh(c, get(o, 0));
+  // gen2 objects are never copied during a collection (major
+  // collections move them afterwards, in compact), so their first
+  // word is always a header
+  return o and (not c->gen2.contains(o)) and (not fresh(c, o))
+    and fresh(c, get(o, 0));
+}
+
+inline bool
+marked(Context* c, void* o)
+{
+  return c->markMap.get(o) != 0;
+}
+
+// whether the client has used o as metadata (e.g. a class or an
+// object mask) during this collection, in which case it must stay put
+// while compacting in place
+inline bool
+pinned(Context* c, void* o)
+{
+  return c->pointerMap.get(o) != 0;
+}
+
+// whether the client has pinned o and it lies somewhere we would
+// otherwise copy it from (i.e. not in gen2 or among the fixies), in
+// which case it must be left where it is.  Only meaningful during a
+// collection.
+inline bool
+pinnedYoung(Context* c, void* o)
+{
+  uintptr_t bottom = 0;
+  uintptr_t top = c->pinnedYoungCount;
+  while (bottom < top) {
+    uintptr_t middle = bottom + ((top - bottom) / 2);
+    void* p = c->pinnedYoung[middle];
+    if (p == o) {
+      return true;
+    } else if (p < o) {
+      bottom = middle + 1;
+    } else {
+      top = middle;
+    }
+  }
+  return false;
+}
+
+void*
+forward(Context* c, void* o)
+{
+  assert(c, marked(c, o));
+
+  if (c->compactForwards == 0) {
+    // we had no memory for the forwarding table, so either nothing
+    // moves or each object was copied to the new segment and left a
+    // pointer to its copy behind (see compact)
+    return c->compactTarget == &(c->gen2) ? o : get(o, 0);
+  }
+
+  uintptr_t index = c->gen2.indexOf(o);
+  uintptr_t word = wordOf(index);
+  uintptr_t before = c->markMap.data[word]
+    & ((static_cast<uintptr_t>(1) << bitOf(index)) - 1);
+
+  return c->compactTarget->data
+    + c->compactForwards[c->compactRanks[word] + bitCount(before)];
+}
+
+// returns the new address of the word at p, which lies within a live
+// gen2 object
+void*
+forwardInterior(Context* c, void* p)
+{
+  uintptr_t index = c->gen2.indexOf(p);
+  uintptr_t word = wordOf(index);
+  uintptr_t bits = c->markMap.data[word]
+    & ((static_cast<uintptr_t>(2) << bitOf(index)) - 1);
+
+  while (bits == 0) {
+    assert(c, word);
+    bits = c->markMap.data[-- word];
+  }
+
+  unsigned bit = BitsPerWord - 1;
+  while ((bits & (static_cast<uintptr_t>(1) << bit)) == 0) -- bit;
+
+  uintptr_t start = ::indexOf(word, bit);
+
+  return static_cast<uintptr_t*>(forward(c, c->gen2.get(start)))
+    + (index - start);
 }
 
 inline void*
@@ -877,7 +1188,12 @@ free(Context* c, Fixie** fixies, bool resetImmortal)
       if (DebugFixies) {
         fprintf(stderr, "free fixie %p\n", f);
       }
-      free(c, f, f->totalSize());
+
+      if (f->large()) {
+        freeLarge(c, f);
+      } else {
+        free(c, f, f->totalSize());
+      }
     }
   }
 }
@@ -927,6 +1243,8 @@ sweepFixies(Context* c)
       ++ f->age;
       if (f->age > FixieTenureThreshold) {
         f->age = FixieTenureThreshold;
+      } else if (static_cast<unsigned>(f->age) == FixieTenureThreshold) {
+        c->promotedFootprint += f->totalSize();
       } else if (static_cast<unsigned>(f->age + 1) == FixieTenureThreshold) {
         c->fixieTenureFootprint += f->totalSize();
       }
@@ -955,9 +1273,10 @@ sweepFixies(Context* c)
     f->marked(false);
   }
 
-  c->tenuredFixieCeiling = max
-    (c->tenuredFixieFootprint * 2,
-     InitialTenuredFixieCeilingInBytes);
+  c->tenuredFixieCeiling = c->tenuredFixieFootprint * 2;
+  if (c->tenuredFixieCeiling < InitialTenuredFixieCeilingInBytes) {
+    c->tenuredFixieCeiling = InitialTenuredFixieCeilingInBytes;
+  }
 }
 
 inline void*
@@ -980,29 +1299,32 @@ copy2(Context* c, void* o)
 {
   unsigned size = c->client->copiedSizeInWords(o);
 
-  if (c->gen2.contains(o)) {
-    assert(c, c->mode == Heap::MajorCollection);
+  assert(c, not c->gen2.contains(o));
 
-    return copyTo(c, &(c->nextGen2), o, size);
-  } else if (c->gen1.contains(o)) {
+  if (c->gen1.contains(o)) {
     unsigned age = c->ageMap.get(o);
-    if (age == TenureThreshold) {
-      if (c->mode == Heap::MinorCollection) {
-        assert(c, c->gen2.remaining() >= size);
+    if (age == TenureThreshold and c->mode == Heap::MinorCollection) {
+      c->promotedFootprint += size * BytesPerWord;
 
-        if (c->gen2Base == Top) {
-          c->gen2Base = c->gen2.position();
-        }
+      assert(c, c->gen2.remaining() >= size);
 
-        return copyTo(c, &(c->gen2), o, size);
-      } else {
-        return copyTo(c, &(c->nextGen2), o, size);
+      if (c->gen2Base == Top) {
+        c->gen2Base = c->gen2.position();
       }
+
+      return copyTo(c, &(c->gen2), o, size);
     } else {
+      // during a major collection, objects which have reached the
+      // tenure threshold stay where they are until the next minor
+      // collection, since gen2 is being compacted in place
       o = copyTo(c, &(c->nextGen1), o, size);
 
-      c->nextAgeMap.setOnly(o, age + 1);
-      if (age + 1 == TenureThreshold) {
+      if (age < TenureThreshold) {
+        ++ age;
+      }
+
+      c->nextAgeMap.setOnly(o, age);
+      if (age == TenureThreshold) {
         c->tenureFootprint += size;
       }
 
@@ -1058,19 +1380,48 @@ update3(Context* c, void* o, bool* needsVisit)
   } else if (immortalHeapContains(c, o)) {
     *needsVisit = false;
     return o;    
+  } else if (pinnedYoung(c, o)) {
+    // visited by visitPins.  Note that we must check this before
+    // wasCollected, since the object's class may have moved, making
+    // its header look like a forwarding pointer.
+    *needsVisit = false;
+    return o;
   } else if (wasCollected(c, o)) {
     *needsVisit = false;
     return follow(c, o);
+  } else if (fresh(c, o)) {
+    // the client may visit a slot more than once (e.g. the finalize
+    // queue, which it builds from slots it has already visited)
+    *needsVisit = false;
+    return o;
   } else {
     *needsVisit = true;
     return copy(c, o);
   }
 }
 
+void
+mark(Context* c, void* o)
+{
+  if (not marked(c, o)) {
+    c->markMap.setOnly(o);
+    ++ c->markedCount;
+
+    if (not c->markStack.push(c, o)) {
+      // visitMarked will find it by rescanning gen2
+      c->markOverflow = true;
+    }
+  }
+}
+
 void*
 update2(Context* c, void* o, bool* needsVisit)
 {
-  if (c->mode == Heap::MinorCollection and c->gen2.contains(o)) {
+  if (c->gen2.contains(o)) {
+    if (c->mode == Heap::MajorCollection) {
+      mark(c, o);
+    }
+
     *needsVisit = false;
     return o;
   }
@@ -1109,21 +1460,10 @@ markClean(Context* c, Fixie* f)
 void
 updateHeapMap(Context* c, void* p, void* target, unsigned offset, void* result)
 {
-  Segment* seg;
-  Segment::Map* map;
-
-  if (c->mode == Heap::MinorCollection) {
-    seg = &(c->gen2);
-    map = &(c->heapMap);
-  } else {
-    seg = &(c->nextGen2);
-    map = &(c->nextHeapMap);
-  }
-
   if (not (immortalHeapContains(c, result)
            or (c->client->isFixed(result)
                and fixie(result)->age >= FixieTenureThreshold)
-           or seg->contains(result)))
+           or c->gen2.contains(result)))
   {
     if (target and c->client->isFixed(target)) {
       Fixie* f = fixie(target);
@@ -1138,13 +1478,16 @@ updateHeapMap(Context* c, void* p, void* target, unsigned offset, void* result)
         f->dirty(true);
         markBit(f->mask(), offset);
       }
-    } else if (seg->contains(p)) {
-      if (Debug) {        
+    } else if (c->mode == Heap::MinorCollection and c->gen2.contains(p)) {
+      // (a major collection rebuilds the whole map once it has
+      // compacted gen2)
+
+      if (Debug) {
         fprintf(stderr, "mark %p (%s) at %p (%s)\n",
                 result, segment(c, result), p, segment(c, p));
       }
 
-      map->set(p);
+      c->heapMap.set(p);
     }
   }
 }
@@ -1161,6 +1504,20 @@ update(Context* c, void** p, void* target, unsigned offset, bool* needsVisit)
 
   if (result) {
     updateHeapMap(c, p, target, offset, result);
+
+    if (target == 0
+        and c->mode == Heap::MajorCollection
+        and c->gen2.contains(result))
+    {
+      // this slot belongs to the client rather than to an object we
+      // will walk later, so remember it for updating after compaction.
+      // If we can't, the object must stay where it is, which means
+      // compacting in place.
+      if (not c->rootSlots.push(c, p)) {
+        c->pointerMap.setOnly(result);
+        c->pinnedGen2 = true;
+      }
+    }
   }
 
   return result;
@@ -1563,11 +1920,151 @@ visitMarkedFixies(Context* c)
     c->client->walk(f->body(), &w);
 
     f->move(c, &(c->visitedFixies));
-  }  
+  }
+}
+
+void
+visitGen2(Context* c, void* o)
+{
+  if (Debug) {
+    fprintf(stderr, "visit gen2 object %p\n", o);
+  }
+
+  class Walker: public Heap::Walker {
+   public:
+    Walker(Context* c, void* o):
+      c(c), o(o)
+    { }
+
+    virtual bool visit(unsigned offset) {
+      local::collect(c, o, offset);
+      return true;
+    }
+
+    Context* c;
+    void* o;
+  } w(c, o);
+
+  c->client->walk(o, &w);
+}
+
+void
+visitMarkedGen2(Context* c)
+{
+  while (c->markStack.size) {
+    visitGen2(c, c->markStack.pop());
+  }
+}
+
+// visits every marked gen2 object again, which is harmless for those
+// already visited and catches those we couldn't push on the mark stack
+void
+visitOverflowedGen2(Context* c)
+{
+  if (Verbose2) {
+    fprintf(stderr, "mark stack overflow; rescanning gen2\n");
+  }
+
+  c->markOverflow = false;
+
+  for (Segment::Map::Iterator it(&(c->markMap), 0, c->gen2.position());
+       it.hasMore();)
+  {
+    visitGen2(c, c->gen2.get(it.next()));
+    visitMarkedGen2(c);
+  }
+}
+
+void
+clearMaps(Segment::Map* map)
+{
+  for (; map; map = map->child) {
+    memset(map->data, 0, map->size() * BytesPerWord);
+  }
+}
+
+void
+initMarking(Context* c)
+{
+  c->markedCount = 0;
+  c->markOverflow = false;
+
+  if (c->gen2.capacity()) {
+    c->markMap.data = static_cast<uintptr_t*>
+      (allocate(c, c->markMap.size() * BytesPerWord));
+    memset(c->markMap.data, 0, c->markMap.size() * BytesPerWord);
+
+    // the heap map is rebuilt after compaction, so its bottom level is
+    // free to record pinned objects until then
+    clearMaps(&(c->heapMap));
+  }
+
+  c->marking = true;
+}
+
+// Marking must be complete whenever the client regains control, since
+// it may then ask which objects are reachable.
+void
+visitMarked(Context* c)
+{
+  do {
+    visitMarkedFixies(c);
+    visitMarkedGen2(c);
+
+    if (c->markOverflow) {
+      visitOverflowedGen2(c);
+    }
+  } while (c->markedFixies or c->markOverflow);
+}
+
+// Treats pinned objects as roots.  Those which would otherwise have
+// been copied are instead visited where they are, while the rest
+// (which only move when compacting gen2) are visited like any other
+// root and kept in place if gen2 is compacted.
+void
+visitPins(Context* c)
+{
+  for (uintptr_t i = 0; i < c->pinnedYoungCount; ++i) {
+    void* o = c->pinnedYoung[i];
+
+    if (Debug) {
+      fprintf(stderr, "visit pinned object %p\n", o);
+    }
+
+    class Walker: public Heap::Walker {
+     public:
+      Walker(Context* c, void* o):
+        c(c), o(o)
+      { }
+
+      virtual bool visit(unsigned offset) {
+        local::collect(c, o, offset);
+        return true;
+      }
+
+      Context* c;
+      void* o;
+    } w(c, o);
+
+    c->client->walk(o, &w);
+  }
+
+  for (uintptr_t i = 0; i < c->pins.size; ++i) {
+    void** p = c->pins.data + i;
+    if (not pinnedYoung(c, *p)) {
+      if (c->mode == Heap::MajorCollection and c->gen2.contains(*p)) {
+        c->pointerMap.setOnly(*p);
+      }
+
+      collect(c, p);
+    }
+  }
+
+  visitMarked(c);
 }
 
 void
-collect(Context* c, Segment::Map* map, unsigned start, unsigned end,
+collect(Context* c, Segment::Map* map, uintptr_t start, uintptr_t end,
         bool* dirty, bool expectDirty UNUSED)
 {
   bool wasDirty UNUSED = false;
@@ -1575,8 +2072,8 @@ collect(Context* c, Segment::Map* map, unsigned start, unsigned end,
     wasDirty = true;
     if (map->child) {
       assert(c, map->scale > 1);
-      unsigned s = it.next();
-      unsigned e = s + map->scale;
+      uintptr_t s = it.next();
+      uintptr_t e = s + map->scale;
 
       map->clearOnly(s);
       bool childDirty = false;
@@ -1618,11 +2115,13 @@ collect2(Context* c)
 
   if (c->mode == Heap::MajorCollection) {
     c->gen2Padding = 0;
+
+    initMarking(c);
   }
 
   if (c->mode == Heap::MinorCollection and c->gen2.position()) {
-    unsigned start = 0;
-    unsigned end = start + c->gen2.position();
+    uintptr_t start = 0;
+    uintptr_t end = start + c->gen2.position();
     bool dirty;
     collect(c, &(c->heapMap), start, end, &dirty, false);
   }
@@ -1637,63 +2136,549 @@ collect2(Context* c)
 
     virtual void visit(void* p) {
       local::collect(c, static_cast<void**>(p));
-      visitMarkedFixies(c);
+      visitMarked(c);
     }
 
     Context* c;
   } v(c);
 
+  visitPins(c);
+
   c->client->visitRoots(&v);
+
+  c->marking = false;
 }
 
-void
-collect(Context* c)
+// Decides where each marked gen2 object will go, in address order,
+// filling in compactForwards (indexed by the object's rank among the
+// marked objects) and compactRanks (the rank of the first marked
+// object in each word of the mark map).  Returns the resulting
+// position of the target segment.
+uintptr_t
+computeForwarding(Context* c, Segment* target)
 {
-  if (oversizedGen2(c)
-      or c->tenureFootprint + c->tenurePadding > c->gen2.remaining()
-      or c->fixieTenureFootprint + c->tenuredFixieFootprint
-      > c->tenuredFixieCeiling)
+  bool inPlace = target == &(c->gen2);
+  uintptr_t position = 0;
+  uintptr_t rank = 0;
+  uintptr_t nextWord = 0;
+
+  for (Segment::Map::Iterator it(&(c->markMap), 0, c->gen2.position());
+       it.hasMore();)
   {
-    if (Verbose) {
-      if (oversizedGen2(c)) {
-        fprintf(stderr, "oversized gen2 causes ");
-      } else if (c->tenureFootprint + c->tenurePadding > c->gen2.remaining())
-      {
-        fprintf(stderr, "undersized gen2 causes ");
-      } else {
-        fprintf(stderr, "fixie ceiling causes ");
-      }
+    uintptr_t index = it.next();
+    void* o = c->gen2.get(index);
+
+    for (uintptr_t word = wordOf(index); nextWord <= word; ++ nextWord) {
+      c->compactRanks[nextWord] = rank;
     }
 
-    c->mode = Heap::MajorCollection;
-  }
+    // an object which would not move keeps its size, since its
+    // identity hash (if taken) is still valid.  Otherwise, it may grow
+    // by a word, which is safe because it moves by at least that much.
+    uintptr_t to;
+    unsigned size;
+    if (inPlace and (position == index or pinned(c, o))) {
+      assert(c, position <= index);
 
-  int64_t then;
-  if (Verbose) {
-    if (c->mode == Heap::MajorCollection) {
-      fprintf(stderr, "major collection\n");
+      to = index;
+      size = c->client->sizeInWords(o);
     } else {
-      fprintf(stderr, "minor collection\n");
+      to = position;
+      size = c->client->copiedSizeInWords(o);
     }
 
-    then = c->system->now();
+    c->compactForwards[rank++] = to;
+    position = to + size;
   }
 
-  initNextGen1(c);
-
-  if (c->mode == Heap::MajorCollection) {
-    initNextGen2(c);
-  }
+  assert(c, rank == c->markedCount);
 
-  collect2(c);
+  return position;
+}
 
-  c->gen1.replaceWith(&(c->nextGen1));
-  if (c->mode == Heap::MajorCollection) {
+int
+compareSlots(const void* a, const void* b)
+{
+  uintptr_t x = reinterpret_cast<uintptr_t>(*static_cast<void* const*>(a));
+  uintptr_t y = reinterpret_cast<uintptr_t>(*static_cast<void* const*>(b));
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+void
+updateRootSlots(Context* c)
+{
+  Stack* s = &(c->rootSlots);
+
+  // the client may have visited a slot more than once, but we must
+  // only update each one once
+  qsort(s->data, s->size, BytesPerWord, compareSlots);
+
+  for (uintptr_t i = 0; i < s->size; ++i) {
+    if (i and s->data[i] == s->data[i - 1]) {
+      continue;
+    }
+
+    void** p = static_cast<void**>(s->data[i]);
+    if (c->gen2.contains(p)) {
+      // e.g. a "nogc" field of a live gen2 object
+      p = static_cast<void**>(forwardInterior(c, p));
+    }
+
+    void* o = maskAlignedPointer(*p);
+    if (c->gen2.contains(o)) {
+      set(p, forward(c, o));
+    }
+  }
+}
+
+// updates any pointers to gen2 objects in o, recording in map (if
+// non-null) the locations of any pointers to young objects
+void
+updatePointers(Context* c, void* o, Segment::Map* map)
+{
+  class Walker: public Heap::Walker {
+   public:
+    Walker(Context* c, void* o, Segment::Map* map):
+      c(c), o(o), map(map)
+    { }
+
+    virtual bool visit(unsigned offset) {
+      void** p = getp(o, offset);
+      void* target = maskAlignedPointer(*p);
+
+      if (c->gen2.contains(target)) {
+        set(p, forward(c, target));
+      } else if (map
+                 and target
+                 and (c->nextGen1.contains(target)
+                      or pinnedYoung(c, target)
+                      or (c->client->isFixed(target)
+                          and fixie(target)->age < FixieTenureThreshold)))
+      {
+        map->set(p);
+      }
+
+      return true;
+    }
+
+    Context* c;
+    void* o;
+    Segment::Map* map;
+  } w(c, o, map);
+
+  c->client->walk(o, &w);
+}
+
+// Second half of a major collection: having marked the live gen2
+// objects in place, slide them towards the start of gen2 and update
+// every pointer to them.  Objects the client has read as metadata
+// during marking are left where they are, so that it can still find
+// classes and object masks while we move their instances.  If gen2
+// needs to grow or shrink substantially, the survivors are instead
+// compacted into a new segment of the desired size.
+//
+// If there is no memory for the forwarding tables, we fall back to
+// copying the survivors into a new segment as a copying collector
+// would, leaving a pointer to each copy in the first word of the
+// original.  The client never reads that word of an object it uses
+// as metadata, so the originals still serve as such until the old
+// segment is freed.  If some of gen2 is pinned, though, everything
+// must stay where it is until the next major collection.
+void
+compact(Context* c)
+{
+  uintptr_t words = ceilingDivideWord(c->gen2.position(), BitsPerWord);
+  if (words) {
+    c->compactRanks = static_cast<uintptr_t*>
+      (allocate(c, words * BytesPerWord, false));
+  }
+
+  if (c->markedCount) {
+    c->compactForwards = static_cast<uintptr_t*>
+      (allocate(c, c->markedCount * BytesPerWord, false));
+  }
+
+  bool sliding = (words == 0 or c->compactRanks)
+    and (c->markedCount == 0 or c->compactForwards);
+
+  c->compactTarget = &(c->gen2);
+
+  uintptr_t live;
+  if (sliding) {
+    live = computeForwarding(c, c->compactTarget);
+  } else {
+    if (c->compactRanks) {
+      free(c, c->compactRanks, words * BytesPerWord);
+      c->compactRanks = 0;
+    }
+
+    if (c->compactForwards) {
+      free(c, c->compactForwards, c->markedCount * BytesPerWord);
+      c->compactForwards = 0;
+    }
+
+    if (c->pinnedGen2) {
+      live = c->gen2.position();
+    } else {
+      live = 0;
+      for (Segment::Map::Iterator it(&(c->markMap), 0, c->gen2.position());
+           it.hasMore();)
+      {
+        live += c->client->copiedSizeInWords(c->gen2.get(it.next()));
+      }
+    }
+  }
+
+  uintptr_t minimum = minimumNextGen2Capacity(c, live);
+  uintptr_t desired = minimum * 2;
+  if (desired < InitialGen2CapacityInBytes / BytesPerWord) {
+    desired = InitialGen2CapacityInBytes / BytesPerWord;
+  }
+
+  // pinned objects can't move to a new segment, so if there are any
+  // in gen2 we compact in place regardless, even if that means gen2
+  // can't grow until they are unpinned
+  if ((not c->pinnedGen2)
+      and ((not sliding)
+           or c->gen2.capacity() < minimum
+           or (c->gen2.capacity() > (InitialGen2CapacityInBytes / BytesPerWord)
+               and live < (c->gen2.capacity() / 4)
+               and desired < c->gen2.capacity())))
+  {
+    initNextGen2(c, desired, minimum);
+
+    c->compactTarget = &(c->nextGen2);
+
+    if (sliding) {
+      live = computeForwarding(c, c->compactTarget);
+      c->nextGen2.position_ = live;
+    }
+  }
+
+  if (Verbose2) {
+    fprintf(stderr, "compact %lld live bytes of gen2 %s%s\n",
+            static_cast<long long>(live * BytesPerWord),
+            c->compactTarget == &(c->gen2) ? "in place" : "into new segment",
+            sliding ? "" : " without forwarding tables");
+  }
+
+  { uintptr_t rank = 0;
+    for (Segment::Map::Iterator it(&(c->markMap), 0, c->gen2.position());
+         it.hasMore();)
+    {
+      void* o = c->gen2.get(it.next());
+
+      if (sliding) {
+        void* dst = c->compactTarget->data + c->compactForwards[rank++];
+
+        if (dst != o) {
+          // note that the source and destination may overlap
+          c->client->copy(o, dst);
+        }
+      } else if (c->compactTarget != &(c->gen2)) {
+        void* dst = copyTo
+          (c, c->compactTarget, o, c->client->copiedSizeInWords(o));
+
+        fieldAtOffset<void*>(o, 0) = dst;
+      }
+    }
+  }
+
+  Segment::Map* map;
+  if (c->compactTarget == &(c->gen2)) {
+    if (c->gen2.capacity()) {
+      clearMaps(&(c->heapMap));
+    }
+    map = &(c->heapMap);
+  } else {
+    map = &(c->nextHeapMap);
+  }
+
+  updateRootSlots(c);
+
+  { uintptr_t rank = 0;
+    for (Segment::Map::Iterator it(&(c->markMap), 0, c->gen2.position());
+         it.hasMore();)
+    {
+      void* o = c->gen2.get(it.next());
+      updatePointers
+        (c, sliding ? c->compactTarget->data + c->compactForwards[rank++]
+         : forward(c, o), map);
+    }
+  }
+
+  for (uintptr_t i = 0; i < c->nextGen1.position();) {
+    void* o = c->nextGen1.get(i);
+    i += c->client->sizeInWords(o);
+    updatePointers(c, o, 0);
+  }
+
+  for (Fixie* f = c->visitedFixies; f; f = f->next) {
+    updatePointers(c, f->body(), 0);
+  }
+
+  for (uintptr_t i = 0; i < c->pinnedYoungCount; ++i) {
+    updatePointers(c, c->pinnedYoung[i], 0);
+  }
+
+  if (c->markMap.data) {
+    free(c, c->markMap.data, c->markMap.size() * BytesPerWord);
+    c->markMap.data = 0;
+  }
+
+  if (c->compactRanks) {
+    free(c, c->compactRanks, words * BytesPerWord);
+    c->compactRanks = 0;
+  }
+
+  if (c->compactForwards) {
+    free(c, c->compactForwards, c->markedCount * BytesPerWord);
+    c->compactForwards = 0;
+  }
+
+  c->markStack.dispose(c);
+  c->rootSlots.dispose(c);
+
+  if (c->compactTarget == &(c->gen2)) {
+    c->gen2.position_ = live;
+  } else {
     c->gen2.replaceWith(&(c->nextGen2));
   }
 
+  c->compactTarget = 0;
+}
+
+// Sorts out, at the start of a collection, which pinned objects need
+// special treatment (see visitPins).
+void
+preparePins(Context* c)
+{
+  c->pinnedYoungCount = 0;
+  c->pinnedGen2 = false;
+
+  if (c->pins.size == 0) {
+    return;
+  }
+
+  c->pinnedYoungCapacity = c->pins.size;
+  c->pinnedYoung = static_cast<void**>
+    (allocate(c, c->pinnedYoungCapacity * BytesPerWord));
+
+  for (uintptr_t i = 0; i < c->pins.size; ++i) {
+    void* o = c->pins.data[i];
+    if (c->gen2.contains(o)) {
+      c->pinnedGen2 = true;
+    } else if (not (c->client->isFixed(o) or immortalHeapContains(c, o))) {
+      c->pinnedYoung[c->pinnedYoungCount++] = o;
+    }
+  }
+
+  qsort(c->pinnedYoung, c->pinnedYoungCount, BytesPerWord, compareSlots);
+
+  // an object pinned more than once need only be visited once
+  uintptr_t unique = 0;
+  for (uintptr_t i = 0; i < c->pinnedYoungCount; ++i) {
+    if (unique == 0 or c->pinnedYoung[i] != c->pinnedYoung[unique - 1]) {
+      c->pinnedYoung[unique++] = c->pinnedYoung[i];
+    }
+  }
+  c->pinnedYoungCount = unique;
+}
+
+bool
+holdsPins(Context* c, void* start, uintptr_t size)
+{
+  for (uintptr_t i = 0; i < c->pins.size; ++i) {
+    void* p = c->pins.data[i];
+    if (p >= start and p < static_cast<uint8_t*>(start) + size) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// takes ownership of the specified block (allocated from this heap)
+// if it holds any pinned objects
+bool
+retainIfPinned(Context* c, void* start, uintptr_t size)
+{
+  if (holdsPins(c, start, size)) {
+    if (Verbose2) {
+      fprintf(stderr, "retain %lld bytes at %p for pinned objects\n",
+              static_cast<long long>(size), start);
+    }
+
+    c->retained = new (allocate(c, sizeof(Retained)))
+      Retained(c->retained, start, size);
+
+    return true;
+  } else {
+    return false;
+  }
+}
+
+// Called at the end of a collection, after which gen1 will be freed
+// and replaced with nextGen1.  Any live objects in retained memory
+// have been evacuated by now, except for pinned ones, so we release
+// whatever no longer holds any of those.
+void
+finishPins(Context* c)
+{
+  if (c->pinnedYoungCount
+      and retainIfPinned
+      (c, c->gen1.data, c->gen1.footprint(c->gen1.capacity()) * BytesPerWord))
+  {
+    // keep gen1 from freeing its memory when it is replaced
+    c->gen1.data = 0;
+  }
+
+  for (Retained** p = &(c->retained); *p;) {
+    Retained* r = *p;
+    if (not holdsPins(c, r->start, r->size)) {
+      *p = r->next;
+
+      free(c, r->start, r->size);
+      free(c, r, sizeof(Retained));
+    } else {
+      p = &(r->next);
+    }
+  }
+
+  if (c->pinnedYoung) {
+    free(c, c->pinnedYoung, c->pinnedYoungCapacity * BytesPerWord);
+    c->pinnedYoung = 0;
+  }
+
+  c->pinnedYoungCount = 0;
+  c->pinnedGen2 = false;
+}
+
+const char*
+collectionReason(Context* c)
+{
+  if (c->mode == Heap::MajorCollection) {
+    return "requested";
+  } else if (oversizedGen2(c)) {
+    return "oversized-gen2";
+  } else if (c->tenureFootprint + c->tenurePadding > c->gen2.remaining()) {
+    return "undersized-gen2";
+  } else if (c->fixieTenureFootprint + c->tenuredFixieFootprint
+             > c->tenuredFixieCeiling)
+  {
+    return "fixie-ceiling";
+  } else {
+    return "minor";
+  }
+}
+
+void
+recordCollection(Context* c, const char* reason, int64_t pause)
+{
+  Heap::Statistics* s = &(c->statistics);
+
+  if (c->mode == Heap::MajorCollection) {
+    ++ s->majorCollectionCount;
+  } else {
+    ++ s->minorCollectionCount;
+  }
+
+  s->totalPauseTime += pause;
+  s->lastPauseTime = pause;
+  if (static_cast<uint64_t>(pause) > s->maxPauseTime) {
+    s->maxPauseTime = pause;
+  }
+
+  s->promotedBytes += c->promotedFootprint;
+
+  s->gen1Bytes = c->gen1.position() * BytesPerWord;
+  s->gen1Capacity = c->gen1.capacity() * BytesPerWord;
+  s->gen2Bytes = c->gen2.position() * BytesPerWord;
+  s->gen2Capacity = c->gen2.capacity() * BytesPerWord;
+  s->untenuredFixieBytes = c->untenuredFixieFootprint;
+  s->tenuredFixieBytes = c->tenuredFixieFootprint;
+
+  unsigned bucket = 0;
+  for (int64_t micros = pause / 1000;
+       micros and bucket < Heap::Statistics::PauseHistogramSize - 1;
+       micros >>= 1)
+  {
+    ++ bucket;
+  }
+  ++ s->pauseHistogram[bucket];
+
+  if (c->eventLog) {
+    fprintf(c->eventLog,
+            "{\"type\": \"%s\", \"reason\": \"%s\", "
+            "\"pause\": %lld, \"promoted\": %llu, "
+            "\"gen1\": %llu, \"gen1Capacity\": %llu, "
+            "\"gen2\": %llu, \"gen2Capacity\": %llu, "
+            "\"untenuredFixies\": %llu, \"tenuredFixies\": %llu, "
+            "\"footprint\": %llu, \"limit\": %llu}\n",
+            c->mode == Heap::MajorCollection ? "major" : "minor",
+            reason,
+            static_cast<long long>(pause),
+            static_cast<unsigned long long>(c->promotedFootprint),
+            static_cast<unsigned long long>(s->gen1Bytes),
+            static_cast<unsigned long long>(s->gen1Capacity),
+            static_cast<unsigned long long>(s->gen2Bytes),
+            static_cast<unsigned long long>(s->gen2Capacity),
+            static_cast<unsigned long long>(c->untenuredFixieFootprint),
+            static_cast<unsigned long long>(c->tenuredFixieFootprint),
+            static_cast<unsigned long long>(c->count),
+            static_cast<unsigned long long>(c->limit));
+    fflush(c->eventLog);
+  }
+}
+
+void
+collect(Context* c)
+{
+  const char* reason = collectionReason(c);
+
+  if (oversizedGen2(c)
+      or c->tenureFootprint + c->tenurePadding > c->gen2.remaining()
+      or c->fixieTenureFootprint + c->tenuredFixieFootprint
+      > c->tenuredFixieCeiling)
+  {
+    if (Verbose and c->mode == Heap::MinorCollection) {
+      fprintf(stderr, "%s causes ", reason);
+    }
+
+    c->mode = Heap::MajorCollection;
+  }
+
+  int64_t start = c->system->nanoTime();
+  c->promotedFootprint = 0;
+
+  int64_t then;
+  if (Verbose) {
+    if (c->mode == Heap::MajorCollection) {
+      fprintf(stderr, "major collection\n");
+    } else {
+      fprintf(stderr, "minor collection\n");
+    }
+
+    then = c->system->now();
+  }
+
+  initNextGen1(c);
+
+  preparePins(c);
+
+  collect2(c);
+
+  if (c->mode == Heap::MajorCollection) {
+    compact(c);
+  }
+
+  finishPins(c);
+
+  c->gen1.replaceWith(&(c->nextGen1));
+
   sweepFixies(c);
 
+  recordCollection(c, reason, c->system->nanoTime() - start);
+
   if (Verbose) {
     int64_t now = c->system->now();
     int64_t collection = now - then;
@@ -1713,32 +2698,32 @@ collect(Context* c)
             static_cast<int>(c->totalTime - c->totalCollectionTime));
 
     fprintf(stderr,
-            " -             gen1: %8d/%8d bytes\n",
-            c->gen1.position() * BytesPerWord,
-            c->gen1.capacity() * BytesPerWord);
+            " -             gen1: %8lld/%8lld bytes\n",
+            static_cast<long long>(c->gen1.position() * BytesPerWord),
+            static_cast<long long>(c->gen1.capacity() * BytesPerWord));
 
     fprintf(stderr,
-            " -             gen2: %8d/%8d bytes\n",
-            c->gen2.position() * BytesPerWord,
-            c->gen2.capacity() * BytesPerWord);
+            " -             gen2: %8lld/%8lld bytes\n",
+            static_cast<long long>(c->gen2.position() * BytesPerWord),
+            static_cast<long long>(c->gen2.capacity() * BytesPerWord));
 
     fprintf(stderr,
-            " - untenured fixies:          %8d bytes\n",
-            c->untenuredFixieFootprint);
+            " - untenured fixies:          %8lld bytes\n",
+            static_cast<long long>(c->untenuredFixieFootprint));
 
     fprintf(stderr,
-            " -   tenured fixies:          %8d bytes\n",
-            c->tenuredFixieFootprint);
+            " -   tenured fixies:          %8lld bytes\n",
+            static_cast<long long>(c->tenuredFixieFootprint));
   }
 }
 
 void*
-allocate(Context* c, unsigned size, bool limit)
+allocate(Context* c, uintptr_t size, bool limit)
 {
   ACQUIRE(c->lock);
 
   if (DebugAllocation) {
-    size = pad(size) + 2 * BytesPerWord;
+    size = padWord(size) + 2 * BytesPerWord;
   }
 
   if ((not limit) or size + c->count < c->limit) {
@@ -1759,13 +2744,13 @@ allocate(Context* c, unsigned size, bool limit)
 }
 
 void*
-tryAllocate(Context* c, unsigned size)
+tryAllocate(Context* c, uintptr_t size)
 {
   return allocate(c, size, true);
 }
 
 void*
-allocate(Context* c, unsigned size)
+allocate(Context* c, uintptr_t size)
 {
   void* p = allocate(c, size, false);
   expect(c->system, p);
@@ -1774,12 +2759,12 @@ allocate(Context* c, unsigned size)
 }
 
 void
-free(Context* c, const void* p, unsigned size)
+free(Context* c, const void* p, uintptr_t size)
 {
   ACQUIRE(c->lock);
 
   if (DebugAllocation) {
-    size = pad(size) + 2 * BytesPerWord;
+    size = padWord(size) + 2 * BytesPerWord;
 
     memset(const_cast<void*>(p), 0xFE, size - (2 * BytesPerWord));
 
@@ -1798,14 +2783,132 @@ free(Context* c, const void* p, unsigned size)
 }
 
 void
-free_(Context* c, const void* p, unsigned size)
+free_(Context* c, const void* p, uintptr_t size)
 {
   free(c, p, size);
 }
 
+uintptr_t
+largeObjectClassSize(unsigned sizeClass)
+{
+  return (LargeObjectThresholdInBytes << (sizeClass / 4)) / 4
+    * (4 + (sizeClass % 4));
+}
+
+unsigned
+largeObjectClass(uintptr_t size)
+{
+  unsigned i = 0;
+  while (i < LargeObjectClassCount and size > largeObjectClassSize(i)) {
+    ++ i;
+  }
+  return i;
+}
+
+void*
+tryAllocateLarge(Context* c, uintptr_t size)
+{
+  ACQUIRE(c->lock);
+
+  // make room for the pointer back to the run
+  size += BytesPerWord;
+
+  unsigned sizeClass = largeObjectClass(size);
+  uintptr_t slotSize = sizeClass == LargeObjectClassCount
+    ? ceilingDivideWord(size, LargeObjectThresholdInBytes / 4)
+    * (LargeObjectThresholdInBytes / 4)
+    : largeObjectClassSize(sizeClass);
+
+  if (slotSize + c->count >= c->limit) {
+    return 0;
+  }
+
+  LargeRun* r = c->largeRuns[sizeClass];
+  while (r and r->full()) r = r->next;
+
+  if (r == 0) {
+    unsigned slotCount = sizeClass == LargeObjectClassCount
+      ? 1 : max(1, LargeObjectRunSizeInBytes / slotSize);
+
+    uint8_t* start = static_cast<uint8_t*>
+      (c->system->tryAllocatePages(slotCount * slotSize));
+    if (start == 0) {
+      return 0;
+    }
+
+    void* p = c->system->tryAllocate(sizeof(LargeRun));
+    if (p == 0) {
+      c->system->freePages(start, slotCount * slotSize);
+      return 0;
+    }
+
+    r = new (p) LargeRun
+      (c->largeRuns[sizeClass], start, slotSize, sizeClass, slotCount);
+    c->largeRuns[sizeClass] = r;
+
+    if (Verbose2) {
+      fprintf(stderr, "map large object run %p of %d slots of %d bytes\n",
+              start, slotCount, static_cast<int>(slotSize));
+    }
+  } else if (r->liveCount == 0) {
+    c->largeRetained -= r->size();
+  }
+
+  unsigned index = 0;
+  while (r->occupied & (static_cast<uintptr_t>(1) << index)) ++ index;
+
+  r->occupied |= static_cast<uintptr_t>(1) << index;
+  ++ r->liveCount;
+  c->count += slotSize;
+
+  uintptr_t* slot = reinterpret_cast<uintptr_t*>(r->start + (index * slotSize));
+  slot[0] = reinterpret_cast<uintptr_t>(r);
+
+  return slot + 1;
+}
+
+void
+freeLarge(Context* c, void* p)
+{
+  ACQUIRE(c->lock);
+
+  uintptr_t* slot = static_cast<uintptr_t*>(p) - 1;
+  LargeRun* r = reinterpret_cast<LargeRun*>(slot[0]);
+  unsigned index = (reinterpret_cast<uint8_t*>(slot) - r->start)
+    / r->slotSize;
+
+  assert(c, r->occupied & (static_cast<uintptr_t>(1) << index));
+
+  r->occupied &= ~(static_cast<uintptr_t>(1) << index);
+  -- r->liveCount;
+  c->count -= r->slotSize;
+
+  if (r->liveCount == 0
+      and (r->sizeClass == LargeObjectClassCount
+           or c->largeRetained + r->size() > LargeObjectRetainedBytes))
+  {
+    LargeRun** rp = &(c->largeRuns[r->sizeClass]);
+    while (*rp != r) rp = &((*rp)->next);
+    *rp = r->next;
+
+    if (Verbose2) {
+      fprintf(stderr, "unmap large object run %p\n", r->start);
+    }
+
+    c->system->freePages(r->start, r->size());
+    c->system->free(r);
+  } else {
+    c->system->discardPages(slot, r->slotSize);
+
+    if (r->liveCount == 0) {
+      c->largeRetained += r->size();
+    }
+  }
+}
+
 class MyHeap: public Heap {
  public:
-  MyHeap(System* system, unsigned limit):
+  MyHeap(System* system, uintptr_t limit):
     c(system, limit)
   { }
 
@@ -1819,7 +2922,7 @@ class MyHeap: public Heap {
     c.immortalHeapEnd = start + sizeInWords;
   }
 
-  virtual unsigned limit() {
+  virtual uintptr_t limit() {
     return c.limit;
   }
 
@@ -1839,7 +2942,16 @@ class MyHeap: public Heap {
     free_(&c, p, size);
   }
 
-  virtual void collect(CollectionType type, unsigned incomingFootprint) {
+  virtual void setEventLog(FILE* log) {
+    c.eventLog = log;
+  }
+
+  virtual void statistics(Statistics* s) {
+    *s = c.statistics;
+    s->footprint = c.count;
+  }
+
+  virtual void collect(CollectionType type, uintptr_t incomingFootprint) {
     c.mode = type;
     c.incomingFootprint = incomingFootprint;
 
@@ -1847,7 +2959,7 @@ class MyHeap: public Heap {
   }
 
   void* tryAllocateFixed(Allocator* allocator, unsigned sizeInWords,
-                         bool objectMask, unsigned* totalInBytes,
+                         bool objectMask, uintptr_t* totalInBytes,
                          Fixie** handle, bool immortal)
   {
     *totalInBytes = 0;
@@ -1856,22 +2968,46 @@ class MyHeap: public Heap {
       return 0;
     }
 
-    unsigned total = Fixie::totalSize(sizeInWords, objectMask);
-    void* p = allocator->tryAllocate(total);
+    uintptr_t total = Fixie::totalSize(sizeInWords, objectMask);
+
+    // large, mortal fixies allocated on our own behalf come from the
+    // large object space, while everything else (e.g. immortal fixies
+    // allocated in executable memory) is left to the allocator we were
+    // given
+    bool large = allocator == this and (not immortal)
+      and total >= LargeObjectThresholdInBytes;
+
+    if ((not large) and total != static_cast<unsigned>(total)) {
+      // the allocator we were given can't express a size this big
+      return 0;
+    }
+
+    void* p = large
+      ? local::tryAllocateLarge(&c, total) : allocator->tryAllocate(total);
+
     if (p == 0) {
       return 0;
     } else if (limitExceeded()) {
-      allocator->free(p, total);
+      if (large) {
+        local::freeLarge(&c, p);
+      } else {
+        allocator->free(p, total);
+      }
       return 0;
     } else {
       *totalInBytes = total;
-      return (new (p) Fixie(&c, sizeInWords, objectMask, handle, immortal))
-        ->body();
+
+      Fixie* f = new (p) Fixie(&c, sizeInWords, objectMask, handle, immortal);
+      if (large) {
+        f->flags |= Fixie::Large;
+      }
+
+      return f->body();
     }
   }
 
   virtual void* tryAllocateFixed(Allocator* allocator, unsigned sizeInWords,
-                                 bool objectMask, unsigned* totalInBytes)
+                                 bool objectMask, uintptr_t* totalInBytes)
   {
     return tryAllocateFixed
       (allocator, sizeInWords, objectMask, totalInBytes, &(c.fixies), false);
@@ -1879,7 +3015,7 @@ class MyHeap: public Heap {
 
   virtual void* tryAllocateImmortalFixed(Allocator* allocator,
                                          unsigned sizeInWords, bool objectMask,
-                                         unsigned* totalInBytes)
+                                         uintptr_t* totalInBytes)
   {
     return tryAllocateFixed
       (allocator, sizeInWords, objectMask, totalInBytes, 0, true);
@@ -1891,14 +3027,13 @@ class MyHeap: public Heap {
     if (c.client->isFixed(p)) {
       return fixie(p)->age >= FixieTenureThreshold;
     } else {
-      return c.gen2.contains(p) or c.nextGen2.contains(p);
+      return c.gen2.contains(p);
     }
   }
 
   bool targetNeedsMark(void* target) {
     return target
       and not c.gen2.contains(target)
-      and not c.nextGen2.contains(target)
       and not immortalHeapContains(&c, target)
       and not (c.client->isFixed(target)
                and fixie(target)->age >= FixieTenureThreshold);
@@ -1935,13 +3070,7 @@ class MyHeap: public Heap {
 
         if (dirty) markDirty(&c, f);
       } else {
-        Segment::Map* map;
-        if (c.gen2.contains(p)) {
-          map = &(c.heapMap);
-        } else {
-          assert(&c, c.nextGen2.contains(p));
-          map = &(c.nextHeapMap);
-        }
+        Segment::Map* map = &(c.heapMap);
 
         for (unsigned i = 0; i < count; ++i) {
           void** target = static_cast<void**>(p) + offset + i;
@@ -1974,6 +3103,17 @@ class MyHeap: public Heap {
   virtual void* follow(void* p) {
     if (p == 0 or c.client->isFixed(p)) {
       return p;
+    } else if (c.gen2.contains(p)) {
+      // gen2 objects stay where they are until marking is complete,
+      // and only move afterwards if the client hasn't asked for them
+      // here
+      if (c.marking) {
+        c.pointerMap.setOnly(p);
+      }
+
+      return p;
+    } else if (pinnedYoung(&c, p)) {
+      return p;
     } else if (wasCollected(&c, p)) {
       if (Debug) {
         fprintf(stderr, "follow %p (%s) to %p (%s)\n",
@@ -1991,6 +3131,29 @@ class MyHeap: public Heap {
     killFixies(&c);
   }
 
+  virtual void pin(void* p) {
+    ACQUIRE(c.pinLock);
+
+    expect(c.system, c.pins.push(&c, p));
+  }
+
+  virtual void unpin(void* p) {
+    ACQUIRE(c.pinLock);
+
+    for (uintptr_t i = c.pins.size; i > 0; --i) {
+      if (c.pins.data[i - 1] == p) {
+        c.pins.data[i - 1] = c.pins.data[-- c.pins.size];
+        return;
+      }
+    }
+
+    abort(&c);
+  }
+
+  virtual bool retain(void* p, unsigned sizeInBytes) {
+    return retainIfPinned(&c, p, sizeInBytes);
+  }
+
   virtual Status status(void* p) {
     p = maskAlignedPointer(p);
 
@@ -2005,13 +3168,13 @@ class MyHeap: public Heap {
            : Tenured);
     } else if (c.nextGen1.contains(p)) {
       return Reachable;
-    } else if (c.nextGen2.contains(p)
-               or immortalHeapContains(&c, p)
-               or (c.gen2.contains(p)
-                   and (c.mode == Heap::MinorCollection
-                        or c.gen2.indexOf(p) >= c.gen2Base)))
-    {
+    } else if (immortalHeapContains(&c, p)) {
       return Tenured;
+    } else if (c.gen2.contains(p)) {
+      return c.mode == Heap::MinorCollection or marked(&c, p)
+        ? Tenured : Unreachable;
+    } else if (pinnedYoung(&c, p)) {
+      return Reachable;
     } else if (wasCollected(&c, p)) {
       return Reachable;
     } else {
@@ -2043,7 +3206,7 @@ class MyHeap: public Heap {
 namespace vm {
 
 Heap*
-makeHeap(System* system, unsigned limit)
+makeHeap(System* system, uintptr_t limit)
 {  
   return new (system->tryAllocate(sizeof(local::MyHeap)))
     local::MyHeap(system, limit);
@@ -1,4 +1,4 @@
-/* Copyright (c) 2008-2010, Avian Contributors
+/* Copyright (c) 2008-2014, Avian Contributors
 
    Permission to use, copy, modify, and/or distribute this software
    for any purpose with or without fee is hereby granted, provided
@@ -10,6 +10,7 @@
 
 #include "avian/machine.h"
 #include "avian/heapwalk.h"
+#include "avian/zlib-custom.h"
 
 using namespace vm;
 
@@ -25,29 +26,187 @@ enum {
   Pop
 };
 
-void
-write1(FILE* out, uint8_t v)
-{
-  size_t n UNUSED = fwrite(&v, 1, 1, out);
-}
+// see the "HPROF Agent" section of the JDK documentation for the
+// format written here
+enum {
+  HprofString = 0x01,
+  HprofLoadClass = 0x02,
+  HprofStackTrace = 0x05,
+  HprofHeapDumpSegment = 0x1C,
+  HprofHeapDumpEnd = 0x2C
+};
 
-void
-write4(FILE* out, uint32_t v)
-{
-  uint8_t b[] = { static_cast<uint8_t>( v >> 24        ),
-                  static_cast<uint8_t>((v >> 16) & 0xFF),
-                  static_cast<uint8_t>((v >>  8) & 0xFF),
-                  static_cast<uint8_t>( v        & 0xFF) };
+enum {
+  HprofRootUnknown = 0xFF,
+  HprofClassDump = 0x20,
+  HprofInstanceDump = 0x21,
+  HprofObjectArrayDump = 0x22,
+  HprofPrimitiveArrayDump = 0x23
+};
 
-  size_t n UNUSED = fwrite(b, 4, 1, out);
-}
+enum {
+  HprofObject = 2,
+  HprofBoolean = 4,
+  HprofChar = 5,
+  HprofFloat = 6,
+  HprofDouble = 7,
+  HprofByte = 8,
+  HprofShort = 9,
+  HprofInt = 10,
+  HprofLong = 11
+};
 
-void
-writeString(FILE* out, int8_t* p, unsigned size)
-{
-  write4(out, size);
-  size_t n UNUSED = fwrite(p, size, 1, out);
-}
+const unsigned HprofStackTraceSerial = 1;
+
+const unsigned BufferSize = 64 * 1024;
+
+// heap dump records are buffered until they reach this size
+const unsigned SegmentSize = 1024 * 1024;
+
+class Buffer {
+ public:
+  Buffer(Allocator* allocator):
+    allocator(allocator), data(0), length(0), capacity(0)
+  { }
+
+  ~Buffer() {
+    if (data) {
+      allocator->free(data, capacity);
+    }
+  }
+
+  void append(const void* p, unsigned size) {
+    if (length + size > capacity) {
+      unsigned newCapacity = max(capacity * 2, length + size + BufferSize);
+      uint8_t* newData = static_cast<uint8_t*>
+        (allocator->allocate(newCapacity));
+      if (data) {
+        memcpy(newData, data, length);
+        allocator->free(data, capacity);
+      }
+      data = newData;
+      capacity = newCapacity;
+    }
+
+    memcpy(data + length, p, size);
+    length += size;
+  }
+
+  void append1(uint8_t v) {
+    append(&v, 1);
+  }
+
+  // multibyte values are written in big endian order
+  void append2(uint16_t v) {
+    uint8_t b[] = { static_cast<uint8_t>(v >> 8),
+                    static_cast<uint8_t>(v & 0xFF) };
+    append(b, 2);
+  }
+
+  void append4(uint32_t v) {
+    uint8_t b[] = { static_cast<uint8_t>( v >> 24        ),
+                    static_cast<uint8_t>((v >> 16) & 0xFF),
+                    static_cast<uint8_t>((v >>  8) & 0xFF),
+                    static_cast<uint8_t>( v        & 0xFF) };
+    append(b, 4);
+  }
+
+  void append8(uint64_t v) {
+    append4(v >> 32);
+    append4(v & 0xFFFFFFFF);
+  }
+
+  void appendID(uintptr_t v) {
+    if (BytesPerWord == 8) {
+      append8(v);
+    } else {
+      append4(v);
+    }
+  }
+
+  Allocator* allocator;
+  uint8_t* data;
+  unsigned length;
+  unsigned capacity;
+};
+
+// writes to a file through a large buffer, optionally compressing the
+// output in gzip format
+class Output: public Buffer {
+ public:
+  Output(Allocator* allocator, FILE* out, bool compress):
+    Buffer(allocator), out(out), chunk(0), compress(compress),
+    failed(false)
+  {
+    if (compress) {
+      chunk = static_cast<uint8_t*>(allocator->allocate(BufferSize));
+      memset(&zStream, 0, sizeof(z_stream));
+      // 15 bits of window plus 16 selects gzip rather than zlib
+      // framing
+      failed = deflateInit2(&zStream, Z_DEFAULT_COMPRESSION, 15 + 16)
+        != Z_OK;
+    }
+  }
+
+  void write(const void* p, unsigned size) {
+    append(p, size);
+    checkpoint();
+  }
+
+  void checkpoint() {
+    if (length >= BufferSize) {
+      drain(false);
+    }
+  }
+
+  void drain(bool finish) {
+    if (compress) {
+      if (not failed) {
+        zStream.next_in = data;
+        zStream.avail_in = length;
+
+        int r;
+        do {
+          zStream.next_out = chunk;
+          zStream.avail_out = BufferSize;
+
+          r = deflate(&zStream, finish ? Z_FINISH : Z_NO_FLUSH);
+
+          unsigned size = BufferSize - zStream.avail_out;
+          if (size and fwrite(chunk, size, 1, out) != 1) {
+            failed = true;
+          }
+        } while ((not failed)
+                 and (zStream.avail_in
+                      or (finish and r == Z_OK)
+                      or zStream.avail_out == 0));
+
+        if (r != Z_OK and r != Z_STREAM_END and r != Z_BUF_ERROR) {
+          failed = true;
+        }
+      }
+    } else if (length and fwrite(data, length, 1, out) != 1) {
+      failed = true;
+    }
+
+    length = 0;
+  }
+
+  bool finish() {
+    drain(true);
+    if (compress) {
+      deflateEnd(&zStream);
+      allocator->free(chunk, BufferSize);
+    }
+    return not failed;
+  }
+
+  FILE* out;
+  z_stream zStream;
+  uint8_t* chunk;
+  bool compress;
+  bool failed;
+};
 
 unsigned
 objectSize(Thread* t, object o)
@@ -55,40 +214,46 @@ objectSize(Thread* t, object o)
   return extendedSize(t, o, baseSize(t, o, objectClass(t, o)));
 }
 
-} // namespace local
-
-} // namespace
-
-namespace vm {
+bool
+endsWith(const char* s, const char* suffix)
+{
+  unsigned length = strlen(s);
+  unsigned suffixLength = strlen(suffix);
+  return length >= suffixLength
+    and strcmp(s + length - suffixLength, suffix) == 0;
+}
 
 void
-dumpHeap(Thread* t, FILE* out)
+dumpAvian(Thread* t, Output* out)
 {
   class Visitor: public HeapVisitor {
    public:
-    Visitor(Thread* t, FILE* out): t(t), out(out), nextNumber(1) { }
+    Visitor(Thread* t, Output* out): t(t), out(out), nextNumber(1) { }
 
     virtual void root() {
-      write1(out, local::Root);      
+      out->append1(local::Root);
     }
 
     virtual unsigned visitNew(object p) {
       if (p) {
         unsigned number = nextNumber++;
-        local::write4(out, number);
+        out->append4(number);
 
-        local::write1(out, local::Size);
-        local::write4(out, local::objectSize(t, p));
+        out->append1(local::Size);
+        out->append4(local::objectSize(t, p));
 
         if (objectClass(t, p) == type(t, Machine::ClassType)) {
           object name = className(t, p);
           if (name) {
-            local::write1(out, local::ClassName);
-            local::writeString(out, &byteArrayBody(t, name, 0),
-                               byteArrayLength(t, name) - 1);
+            out->append1(local::ClassName);
+            out->append4(byteArrayLength(t, name) - 1);
+            out->append(&byteArrayBody(t, name, 0),
+                        byteArrayLength(t, name) - 1);
           }
         }
 
+        out->checkpoint();
+
         return number;
       } else {
         return 0;
@@ -96,19 +261,19 @@ dumpHeap(Thread* t, FILE* out)
     }
 
     virtual void visitOld(object, unsigned number) {
-      local::write4(out, number);      
+      out->append4(number);
     }
 
     virtual void push(object, unsigned, unsigned) {
-      local::write1(out, local::Push);
+      out->append1(local::Push);
     }
 
     virtual void pop() {
-      local::write1(out, local::Pop);
+      out->append1(local::Pop);
     }
 
     Thread* t;
-    FILE* out;
+    Output* out;
     unsigned nextNumber;
   } visitor(t, out);
 
@@ -117,4 +282,446 @@ dumpHeap(Thread* t, FILE* out)
   w->dispose();
 }
 
+// collects the offsets of the reference fields of an object
+class ReferenceCollector: public Heap::Walker {
+ public:
+  ReferenceCollector(Buffer* offsets): offsets(offsets), count(0) { }
+
+  virtual bool visit(unsigned offset) {
+    if (offset) {
+      offsets->append(&offset, sizeof(unsigned));
+      ++ count;
+    }
+    return true;
+  }
+
+  Buffer* offsets;
+  unsigned count;
+};
+
+// Writes the heap in HPROF format.  Objects are identified by their
+// addresses, which can't change while the dump is being written.  VM
+// internal objects, whose classes have names starting with "vm::",
+// have no Java field layout, so they are written as arrays of their
+// references in order to preserve the shape of the object graph.
+// Strings which don't correspond to a byte array on the heap are
+// given odd identifiers, which can't be mistaken for addresses.
+class HprofVisitor: public HeapVisitor {
+ public:
+  HprofVisitor(Thread* t, Output* out):
+    t(t), out(out), segment(t->m->heap), offsets(t->m->heap),
+    isRoot(false), nextNumber(1), classSerial(1), slotNamesWritten(0)
+  { }
+
+  uintptr_t id(object o) {
+    return reinterpret_cast<uintptr_t>(o);
+  }
+
+  object reference(object o, unsigned offset) {
+    return static_cast<object>
+      (maskAlignedPointer(fieldAtOffset<void*>(o, offset)));
+  }
+
+  void writeRecord(uint8_t tag, unsigned length) {
+    out->append1(tag);
+    out->append4(0); // time
+    out->append4(length);
+  }
+
+  void writeString(uintptr_t id, const void* p, unsigned length) {
+    writeRecord(HprofString, BytesPerWord + length);
+    out->appendID(id);
+    out->write(p, length);
+  }
+
+  void writeString(object array) {
+    writeString(id(array), &byteArrayBody(t, array, 0),
+                byteArrayLength(t, array) - 1);
+  }
+
+  uintptr_t slotName(unsigned slot) {
+    return (slot << 2) | 3;
+  }
+
+  void writeSlotNames(unsigned count) {
+    for (; slotNamesWritten < count; ++ slotNamesWritten) {
+      char name[32];
+      vm::snprintf(name, 32, "<vm slot %d>", slotNamesWritten);
+      writeString(slotName(slotNamesWritten), name, strlen(name));
+    }
+  }
+
+  void flushSegment() {
+    if (segment.length) {
+      writeRecord(HprofHeapDumpSegment, segment.length);
+      out->write(segment.data, segment.length);
+      segment.length = 0;
+    }
+  }
+
+  void finishRecord() {
+    if (segment.length >= SegmentSize) {
+      flushSegment();
+    }
+  }
+
+  bool internal(object c) {
+    object name = className(t, c);
+    return name == 0
+      or strncmp(reinterpret_cast<const char*>(&byteArrayBody(t, name, 0)),
+                 "vm::", 4) == 0;
+  }
+
+  uint8_t hprofType(unsigned code) {
+    switch (code) {
+    case ByteField: return HprofByte;
+    case CharField: return HprofChar;
+    case DoubleField: return HprofDouble;
+    case FloatField: return HprofFloat;
+    case IntField: return HprofInt;
+    case LongField: return HprofLong;
+    case ShortField: return HprofShort;
+    case BooleanField: return HprofBoolean;
+    default: return HprofObject;
+    }
+  }
+
+  void appendValue(Buffer* b, object o, unsigned offset, unsigned code) {
+    switch (code) {
+    case ByteField:
+    case BooleanField:
+      b->append1(fieldAtOffset<uint8_t>(o, offset));
+      break;
+
+    case CharField:
+    case ShortField:
+      b->append2(fieldAtOffset<uint16_t>(o, offset));
+      break;
+
+    case FloatField:
+    case IntField:
+      b->append4(fieldAtOffset<uint32_t>(o, offset));
+      break;
+
+    case DoubleField:
+    case LongField:
+      b->append8(fieldAtOffset<uint64_t>(o, offset));
+      break;
+
+    default:
+      b->appendID(id(reference(o, offset)));
+      break;
+    }
+  }
+
+  unsigned fieldCount(object c, bool static_) {
+    unsigned count = 0;
+    object table = classFieldTable(t, c);
+    if (table) {
+      for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+        object field = arrayBody(t, table, i);
+        if (((fieldFlags(t, field) & ACC_STATIC) != 0) == static_) {
+          ++ count;
+        }
+      }
+    }
+    return count;
+  }
+
+  void dumpClass(object c) {
+    bool internal = this->internal(c);
+
+    uintptr_t nameID;
+    object name = className(t, c);
+    if (internal) {
+      // name the class as an array of its instances' references
+      const char* s = name
+        ? reinterpret_cast<const char*>(&byteArrayBody(t, name, 0)) + 4
+        : "unknown";
+      unsigned length = strlen(s);
+      THREAD_RUNTIME_ARRAY(t, char, n, length + 13);
+      memcpy(RUNTIME_ARRAY_BODY(n), "[Lavian/vm/", 11);
+      memcpy(RUNTIME_ARRAY_BODY(n) + 11, s, length);
+      RUNTIME_ARRAY_BODY(n)[length + 11] = ';';
+
+      nameID = id(c) | 1;
+      writeString(nameID, RUNTIME_ARRAY_BODY(n), length + 12);
+    } else {
+      nameID = id(name);
+      writeString(name);
+    }
+
+    writeRecord(HprofLoadClass, 8 + (BytesPerWord * 2));
+    out->append4(classSerial++);
+    out->appendID(id(c));
+    out->append4(HprofStackTraceSerial);
+    out->appendID(nameID);
+
+    // the VM's own references from the class are written as extra
+    // static fields so that what they refer to stays reachable
+    offsets.length = 0;
+    ReferenceCollector collector(&offsets);
+    walk(t, &collector, c, 0);
+    writeSlotNames(collector.count);
+
+    object table = classFieldTable(t, c);
+    object staticTable = classStaticTable(t, c);
+    unsigned staticCount = staticTable ? fieldCount(c, true) : 0;
+    unsigned instanceCount = internal ? 0 : fieldCount(c, false);
+
+    segment.append1(HprofClassDump);
+    segment.appendID(id(c));
+    segment.append4(HprofStackTraceSerial);
+    segment.appendID(id(classSuper(t, c)));
+    segment.appendID(id(classLoader(t, c)));
+    segment.appendID(0); // signers
+    segment.appendID(0); // protection domain
+    segment.appendID(0); // reserved
+    segment.appendID(0); // reserved
+    segment.append4(internal ? 0 : classFixedSize(t, c));
+    segment.append2(0); // constant pool
+
+    segment.append2(staticCount + collector.count);
+    if (staticCount) {
+      for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+        object field = arrayBody(t, table, i);
+        if (fieldFlags(t, field) & ACC_STATIC) {
+          writeString(fieldName(t, field));
+          segment.appendID(id(fieldName(t, field)));
+          segment.append1(hprofType(fieldCode(t, field)));
+          appendValue(&segment, staticTable, fieldOffset(t, field),
+                      fieldCode(t, field));
+        }
+      }
+    }
+
+    for (unsigned i = 0; i < collector.count; ++i) {
+      unsigned offset = reinterpret_cast<unsigned*>(offsets.data)[i];
+      segment.appendID(slotName(i));
+      segment.append1(HprofObject);
+      segment.appendID(id(reference(c, offset * BytesPerWord)));
+    }
+
+    segment.append2(instanceCount);
+    if (instanceCount) {
+      for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+        object field = arrayBody(t, table, i);
+        if ((fieldFlags(t, field) & ACC_STATIC) == 0) {
+          writeString(fieldName(t, field));
+          segment.appendID(id(fieldName(t, field)));
+          segment.append1(hprofType(fieldCode(t, field)));
+        }
+      }
+    }
+  }
+
+  void dumpInstance(object o, object c) {
+    unsigned size = 0;
+    for (object s = c; s; s = classSuper(t, s)) {
+      object table = classFieldTable(t, s);
+      if (table) {
+        for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+          object field = arrayBody(t, table, i);
+          if ((fieldFlags(t, field) & ACC_STATIC) == 0) {
+            size += fieldSize(t, fieldCode(t, field));
+          }
+        }
+      }
+    }
+
+    segment.append1(HprofInstanceDump);
+    segment.appendID(id(o));
+    segment.append4(HprofStackTraceSerial);
+    segment.appendID(id(c));
+    segment.append4(size);
+
+    // fields are listed starting with those declared by the class
+    // itself and ending with those declared by java.lang.Object
+    for (object s = c; s; s = classSuper(t, s)) {
+      object table = classFieldTable(t, s);
+      if (table) {
+        for (unsigned i = 0; i < arrayLength(t, table); ++i) {
+          object field = arrayBody(t, table, i);
+          if ((fieldFlags(t, field) & ACC_STATIC) == 0) {
+            appendValue(&segment, o, fieldOffset(t, field),
+                        fieldCode(t, field));
+          }
+        }
+      }
+    }
+  }
+
+  void dumpReferences(object o, object c) {
+    offsets.length = 0;
+    ReferenceCollector collector(&offsets);
+    walk(t, &collector, o, 0);
+
+    segment.append1(HprofObjectArrayDump);
+    segment.appendID(id(o));
+    segment.append4(HprofStackTraceSerial);
+    segment.append4(collector.count);
+    segment.appendID(id(c));
+
+    for (unsigned i = 0; i < collector.count; ++i) {
+      unsigned offset = reinterpret_cast<unsigned*>(offsets.data)[i];
+      segment.appendID(id(reference(o, offset * BytesPerWord)));
+    }
+  }
+
+  void dumpArray(object o, object c, int8_t elementType) {
+    unsigned length = fieldAtOffset<uintptr_t>(o, BytesPerWord);
+    unsigned elementSize = classArrayElementSize(t, c);
+    unsigned start = BytesPerWord * 2;
+
+    if (elementType == 'L' or elementType == '[') {
+      segment.append1(HprofObjectArrayDump);
+      segment.appendID(id(o));
+      segment.append4(HprofStackTraceSerial);
+      segment.append4(length);
+      segment.appendID(id(c));
+
+      for (unsigned i = 0; i < length; ++i) {
+        segment.appendID(id(reference(o, start + (i * BytesPerWord))));
+      }
+    } else {
+      unsigned code = fieldCode(t, elementType);
+
+      segment.append1(HprofPrimitiveArrayDump);
+      segment.appendID(id(o));
+      segment.append4(HprofStackTraceSerial);
+      segment.append4(length);
+      segment.append1(hprofType(code));
+
+      if (elementSize == 1) {
+        segment.append(&fieldAtOffset<uint8_t>(o, start), length);
+      } else {
+        for (unsigned i = 0; i < length; ++i) {
+          appendValue(&segment, o, start + (i * elementSize), code);
+        }
+      }
+    }
+  }
+
+  void dumpObject(object o) {
+    object c = objectClass(t, o);
+    if (c == type(t, Machine::ClassType)) {
+      dumpClass(o);
+    } else if (internal(c)) {
+      dumpReferences(o, c);
+    } else if (classArrayElementSize(t, c)
+               and byteArrayBody(t, className(t, c), 0) == '[')
+    {
+      dumpArray(o, c, byteArrayBody(t, className(t, c), 1));
+    } else {
+      dumpInstance(o, c);
+    }
+
+    finishRecord();
+  }
+
+  void visitRoot(object o) {
+    if (isRoot) {
+      isRoot = false;
+      if (o) {
+        segment.append1(HprofRootUnknown);
+        segment.appendID(id(o));
+      }
+    }
+  }
+
+  virtual void root() {
+    isRoot = true;
+  }
+
+  virtual unsigned visitNew(object p) {
+    visitRoot(p);
+    if (p) {
+      dumpObject(p);
+      return nextNumber++;
+    } else {
+      return 0;
+    }
+  }
+
+  virtual void visitOld(object p, unsigned) {
+    visitRoot(p);
+  }
+
+  virtual void push(object, unsigned, unsigned) { }
+
+  virtual void pop() { }
+
+  void dump() {
+    const char* magic = "JAVA PROFILE 1.0.2";
+    out->append(magic, strlen(magic) + 1);
+    out->append4(BytesPerWord);
+    out->append8(t->m->system->now());
+
+    writeRecord(HprofStackTrace, 12);
+    out->append4(HprofStackTraceSerial);
+    out->append4(0); // thread serial
+    out->append4(0); // frame count
+
+    HeapWalker* w = makeHeapWalker(t, this);
+    w->visitAllRoots();
+    w->dispose();
+
+    flushSegment();
+    writeRecord(HprofHeapDumpEnd, 0);
+  }
+
+  Thread* t;
+  Output* out;
+  Buffer segment;
+  Buffer offsets;
+  bool isRoot;
+  unsigned nextNumber;
+  unsigned classSerial;
+  unsigned slotNamesWritten;
+};
+
+bool
+writeDump(Thread* t, const char* path)
+{
+  FILE* file = vm::fopen(path, "wb");
+  if (file == 0) {
+    return false;
+  }
+
+  const char* format = findProperty(t, "avian.heap.dump.format");
+  bool hprof = format
+    ? strcmp(format, "hprof") == 0
+    : (endsWith(path, ".hprof") or endsWith(path, ".hprof.gz"));
+
+  bool success;
+  { Output out(t->m->heap, file, endsWith(path, ".gz"));
+
+    if (hprof) {
+      HprofVisitor(t, &out).dump();
+    } else {
+      dumpAvian(t, &out);
+    }
+
+    success = out.finish();
+  }
+
+  if (fclose(file) != 0) {
+    success = false;
+  }
+
+  return success;
+}
+
+} // namespace local
+
+} // namespace
+
+namespace vm {
+
+bool
+dumpHeap(Thread* t, const char* path)
+{
+  return local::writeDump(t, path);
+}
+
 } // namespace vm
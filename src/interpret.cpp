@@ -545,7 +545,8 @@ marshalArguments(Thread* t, uintptr_t* args, uint8_t* types, unsigned sp,
 }
 
 unsigned
-invokeNativeSlow(Thread* t, object method, void* function)
+invokeNativeSlow(Thread* t, object method, void* function,
+                 unsigned directWords, unsigned directReferences)
 {
   PROTECT(t, method);
 
@@ -584,9 +585,23 @@ invokeNativeSlow(Thread* t, object method, void* function)
   }
   RUNTIME_ARRAY_BODY(types)[typeOffset++] = POINTER_TYPE;
 
-  marshalArguments
-    (t, RUNTIME_ARRAY_BODY(args) + argOffset,
-     RUNTIME_ARRAY_BODY(types) + typeOffset, sp, method, false);
+  if (directWords) {
+    for (unsigned i = 0; argOffset < directWords; ++i) {
+      if ((directReferences & (1 << i)) == 0) {
+        RUNTIME_ARRAY_BODY(args)[argOffset++] = peekInt(t, sp++);
+      } else {
+        object* v = reinterpret_cast<object*>(t->stack + ((sp++) * 2) + 1);
+        if (*v == 0) {
+          v = 0;
+        }
+        RUNTIME_ARRAY_BODY(args)[argOffset++] = reinterpret_cast<uintptr_t>(v);
+      }
+    }
+  } else {
+    marshalArguments
+      (t, RUNTIME_ARRAY_BODY(args) + argOffset,
+       RUNTIME_ARRAY_BODY(types) + typeOffset, sp, method, false);
+  }
 
   unsigned returnCode = methodReturnCode(t, method);
   unsigned returnType = fieldType(t, returnCode);
@@ -604,13 +619,18 @@ invokeNativeSlow(Thread* t, object method, void* function)
     t->checkpoint->noThrow = true;
     THREAD_RESOURCE(t, bool, noThrow, t->checkpoint->noThrow = noThrow);
 
-    result = t->m->system->call
-      (function,
-       RUNTIME_ARRAY_BODY(args),
-       RUNTIME_ARRAY_BODY(types),
-       count,
-       footprint * BytesPerWord,
-       returnType);
+    if (directWords) {
+      result = callNativeDirect
+        (t, function, RUNTIME_ARRAY_BODY(args), directWords);
+    } else {
+      result = t->m->system->call
+        (function,
+         RUNTIME_ARRAY_BODY(args),
+         RUNTIME_ARRAY_BODY(types),
+         count,
+         footprint * BytesPerWord,
+         returnType);
+    }
   }
 
   if (DebugRun) {
@@ -668,7 +688,9 @@ invokeNative(Thread* t, object method)
 
     return methodReturnCode(t, method);
   } else {
-    return invokeNativeSlow(t, method, nativeFunction(t, native));
+    return invokeNativeSlow
+      (t, method, nativeFunction(t, native), nativeDirectWords(t, native),
+       nativeDirectReferences(t, native));
   }
 }
 
@@ -782,6 +804,10 @@ interpret3(Thread* t, const int base)
   initClass(t, methodClass(t, frameMethod(t, frame)));
 
  loop:
+  if (UNLIKELY(t->flags & Thread::SafepointFlag)) {
+    safepoint(t);
+  }
+
   instruction = codeBody(t, code, ip++);
 
   if (DebugRun) {
@@ -2974,6 +3000,12 @@ class MyProcessor: public Processor {
        offset, 0, 0, name, spec, addendum, class_, code);
   }
 
+  virtual void
+  initMethod(vm::Thread*, object)
+  {
+    // ignore
+  }
+
   virtual object
   makeClass(vm::Thread* t,
             uint16_t flags,
@@ -2997,7 +3029,7 @@ class MyProcessor: public Processor {
     return vm::makeClass
       (t, flags, vmFlags, fixedSize, arrayElementSize, arrayDimensions, 0,
        objectMask, name, sourceFile, super, interfaceTable, virtualTable,
-       fieldTable, methodTable, addendum, staticTable, loader, 0, 0);
+       fieldTable, methodTable, addendum, staticTable, loader, 0, 0, 0, 0);
   }
 
   virtual void
@@ -3185,6 +3217,10 @@ class MyProcessor: public Processor {
     return makeObjectArray(t, 0);
   }
 
+  virtual void sampleStack(vm::Thread*, vm::Thread*, StackVisitor*) {
+    // not implemented
+  }
+
   virtual void initialize(BootImage*, uint8_t*, unsigned) {
     abort(s);
   }
@@ -3199,6 +3235,10 @@ class MyProcessor: public Processor {
     abort(s);
   }
 
+  virtual unsigned precompile(vm::Thread*) {
+    return 0;
+  }
+
   virtual void visitRoots(vm::Thread*, HeapWalker*) {
     abort(s);
   }
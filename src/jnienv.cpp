@@ -162,20 +162,18 @@ GetStringRegion(Thread* t, jstring s, jsize start, jsize length, jchar* dst)
 const jchar* JNICALL
 GetStringCritical(Thread* t, jstring s, jboolean* isCopy)
 {
-  if (t->criticalLevel == 0) {
-    enter(t, Thread::ActiveState);
-  }
-
-  ++ t->criticalLevel;
+  ENTER(t, Thread::ActiveState);
 
-  if (isCopy) {
-    *isCopy = true;
-  }
-  
   object data = stringData(t, *s);
   if (objectClass(t, data) == type(t, Machine::ByteArrayType)) {
     return GetStringChars(t, s, isCopy);
   } else {
+    pin(t, data);
+
+    if (isCopy) {
+      *isCopy = false;
+    }
+
     return &charArrayBody(t, data, stringOffset(t, *s));
   }
 }
@@ -183,12 +181,13 @@ GetStringCritical(Thread* t, jstring s, jboolean* isCopy)
 void JNICALL
 ReleaseStringCritical(Thread* t, jstring s, const jchar* chars)
 {
-  if (objectClass(t, stringData(t, *s)) == type(t, Machine::ByteArrayType)) {
-    ReleaseStringChars(t, s, chars);
-  }
+  ENTER(t, Thread::ActiveState);
 
-  if ((-- t->criticalLevel) == 0) {
-    enter(t, Thread::IdleState);
+  object data = stringData(t, *s);
+  if (objectClass(t, data) == type(t, Machine::ByteArrayType)) {
+    ReleaseStringChars(t, s, chars);
+  } else {
+    unpin(t, data);
   }
 }
 
@@ -3145,27 +3144,27 @@ SetDoubleArrayRegion(Thread* t, jdoubleArray array, jint offset, jint length,
 void* JNICALL
 GetPrimitiveArrayCritical(Thread* t, jarray array, jboolean* isCopy)
 {
-  if (t->criticalLevel == 0) {
-    enter(t, Thread::ActiveState);
-  }
+  ENTER(t, Thread::ActiveState);
+
+  expect(t, *array);
+
+  // rather than blocking collections until the array is released, we
+  // pin it so it stays where it is
+  pin(t, *array);
 
-  ++ t->criticalLevel;
-  
   if (isCopy) {
-    *isCopy = true;
+    *isCopy = false;
   }
 
-  expect(t, *array);
-
   return reinterpret_cast<uintptr_t*>(*array) + 2;
 }
 
 void JNICALL
-ReleasePrimitiveArrayCritical(Thread* t, jarray, void*, jint)
+ReleasePrimitiveArrayCritical(Thread* t, jarray array, void*, jint)
 {
-  if ((-- t->criticalLevel) == 0) {
-    enter(t, Thread::IdleState);
-  }
+  ENTER(t, Thread::ActiveState);
+
+  unpin(t, *array);
 }
 
 uint64_t
@@ -3474,23 +3473,32 @@ struct JavaVMInitArgs {
   jboolean ignoreUnrecognized;
 };
 
-int
+uintptr_t
 parseSize(const char* s)
 {
   unsigned length = strlen(s);
-  RUNTIME_ARRAY(char, buffer, length + 1);
   if (length == 0) {
     return 0;
-  } else if (s[length - 1] == 'k' or s[length - 1] == 'K') {
-    memcpy(RUNTIME_ARRAY_BODY(buffer), s, length - 1);
-    RUNTIME_ARRAY_BODY(buffer)[length - 1] = 0;
-    return atoi(RUNTIME_ARRAY_BODY(buffer)) * 1024;
-  } else if (s[length - 1] == 'm' or s[length - 1] == 'M') {
-    memcpy(RUNTIME_ARRAY_BODY(buffer), s, length - 1);
-    RUNTIME_ARRAY_BODY(buffer)[length - 1] = 0;
-    return atoi(RUNTIME_ARRAY_BODY(buffer)) * 1024 * 1024;
+  }
+
+  uint64_t scale;
+  switch (s[length - 1]) {
+  case 'k': case 'K': scale = 1024; break;
+  case 'm': case 'M': scale = 1024 * 1024; break;
+  case 'g': case 'G': scale = 1024 * 1024 * 1024; break;
+  default: scale = 1; break;
+  }
+
+  uint64_t value = strtoull(s, 0, 10);
+
+  // saturate rather than wrap if the requested size is larger than
+  // the address space, leaving the allocator to fail gracefully when
+  // the memory actually runs out
+  const uint64_t limit = static_cast<uintptr_t>(~static_cast<uintptr_t>(0));
+  if (value > limit / scale) {
+    return limit;
   } else {
-    return atoi(s);
+    return value * scale;
   }
 }
 
@@ -3533,6 +3541,18 @@ boot(Thread* t, uintptr_t*)
 
   t->m->classpath->boot(t);
 
+  if (findProperty(t, "avian.profile")) {
+    t->m->processor->invoke
+      (t, root(t, Machine::BootLoader), "avian/Machine", "startProfiler",
+       "()V", 0);
+  }
+
+  if (findProperty(t, "avian.jit.profile")) {
+    t->m->processor->invoke
+      (t, root(t, Machine::BootLoader), "avian/Machine", "startPrecompiler",
+       "()V", 0);
+  }
+
   enter(t, Thread::IdleState);
 
   return 1;
@@ -3776,7 +3796,7 @@ JNI_CreateJavaVM(Machine** m, Thread** t, void* args)
 {
   local::JavaVMInitArgs* a = static_cast<local::JavaVMInitArgs*>(args);
 
-  unsigned heapLimit = 0;
+  uintptr_t heapLimit = 0;
   unsigned stackLimit = 0;
   const char* bootLibraries = 0;
   const char* classpath = 0;
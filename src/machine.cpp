@@ -172,6 +172,33 @@ disposeNoRemove(Thread* m, Thread* o)
   dispose(m, o, false);
 }
 
+void
+armSafepoint(Thread* m, Thread* o)
+{
+  if (o != m) {
+    atomicOr(&(o->flags), Thread::SafepointFlag);
+  }
+}
+
+void
+disarmSafepoint(Thread*, Thread* o)
+{
+  atomicAnd(&(o->flags), ~Thread::SafepointFlag);
+}
+
+void
+recordSafepoint(Thread* t, int64_t start)
+{
+  uint64_t time = t->m->system->nanoTime() - start;
+
+  ++ t->m->safepointCount;
+  t->m->safepointTotalTime += time;
+  t->m->safepointLastTime = time;
+  if (time > t->m->safepointMaxTime) {
+    t->m->safepointMaxTime = time;
+  }
+}
+
 void
 interruptDaemon(Thread* m, Thread* o)
 {
@@ -282,8 +309,6 @@ killZombies(Thread* t, Thread* o)
 unsigned
 footprint(Thread* t)
 {
-  expect(t, t->criticalLevel == 0);
-
   unsigned n = t->heapOffset + t->heapIndex + t->backupHeapIndex;
 
   for (Thread* c = t->child; c; c = c->peer) {
@@ -307,6 +332,8 @@ visitRoots(Thread* t, Heap::Visitor* v)
     }
   }
 
+  visitSamples(t, v);
+
   for (Thread* c = t->child; c; c = c->peer) {
     visitRoots(c, v);
   }
@@ -655,17 +682,31 @@ postVisit(Thread* t, Heap::Visitor* v)
       }
     }
   }
+
+  // the finalize queue is built from pointers copied out of slots
+  // visited above, so visit its links too in order that the heap can
+  // update them if it moves the finalizers after this
+  for (object* p = &(m->finalizeQueue); *p; p = &finalizerNext(t, *p)) {
+    v->visit(p);
+  }
 }
 
 void
 postCollect(Thread* t)
 {
+  if (t->m->heap->retain(t->defaultHeap, ThreadHeapSizeInBytes)) {
+    // a pinned object still lives here, so the heap has taken this
+    // block over and we need a new one
+    t->defaultHeap = static_cast<uintptr_t*>
+      (t->m->heap->allocate(ThreadHeapSizeInBytes));
+  } else {
 #ifdef VM_STRESS
-  t->m->heap->free(t->defaultHeap, ThreadHeapSizeInBytes);
-  t->defaultHeap = static_cast<uintptr_t*>
-    (t->m->heap->allocate(ThreadHeapSizeInBytes));
-  memset(t->defaultHeap, 0, ThreadHeapSizeInBytes);
+    t->m->heap->free(t->defaultHeap, ThreadHeapSizeInBytes);
+    t->defaultHeap = static_cast<uintptr_t*>
+      (t->m->heap->allocate(ThreadHeapSizeInBytes));
+    memset(t->defaultHeap, 0, ThreadHeapSizeInBytes);
 #endif
+  }
 
   if (t->heap == t->defaultHeap) {
     memset(t->defaultHeap, 0, t->heapIndex * BytesPerWord);
@@ -687,7 +728,7 @@ postCollect(Thread* t)
   if (t->flags & Thread::UseBackupHeapFlag) {
     memset(t->backupHeap, 0, ThreadBackupHeapSizeInBytes);
 
-    t->flags &= ~Thread::UseBackupHeapFlag;
+    atomicAnd(&(t->flags), ~Thread::UseBackupHeapFlag);
     t->backupHeapIndex = 0;
   }
 
@@ -855,6 +896,10 @@ removeByteArray(Thread* t, object o)
     (t, root(t, Machine::ByteArrayMap), o, byteArrayHash, objectEqual);
 }
 
+} // namespace
+
+namespace vm {
+
 object
 internByteArray(Thread* t, object array)
 {
@@ -873,6 +918,10 @@ internByteArray(Thread* t, object array)
   }
 }
 
+} // namespace vm
+
+namespace {
+
 unsigned
 parsePoolEntry(Thread* t, Stream& s, uint32_t* index, object pool, unsigned i)
 {
@@ -1279,17 +1328,29 @@ parseFieldTable(Thread* t, Stream& s, object class_, object pool)
         if (flags & ACC_FINAL) {
           classVmFlags(t, class_) |= HasFinalMemberFlag;
         }
+      }
 
-        while (memberOffset % size) {
-          ++ memberOffset;
-        }
+      set(t, fieldTable, ArrayBody + (i * BytesPerWord), field);
+    }
 
-        fieldOffset(t, field) = memberOffset;
+    // lay out the instance fields in the order given by
+    // fieldLayoutGroup, so that little space is lost to padding
+    for (unsigned group = 0; group < FieldLayoutGroupCount; ++group) {
+      for (unsigned i = 0; i < count; ++i) {
+        object field = arrayBody(t, fieldTable, i);
+        if ((fieldFlags(t, field) & ACC_STATIC) == 0
+            and fieldLayoutGroup(t, fieldCode(t, field)) == group)
+        {
+          unsigned size = fieldSize(t, fieldCode(t, field));
+          while (memberOffset % size) {
+            ++ memberOffset;
+          }
 
-        memberOffset += size;
-      }
+          fieldOffset(t, field) = memberOffset;
 
-      set(t, fieldTable, ArrayBody + (i * BytesPerWord), field);
+          memberOffset += size;
+        }
+      }
     }
 
     set(t, class_, ClassFieldTable, fieldTable);
@@ -2365,6 +2426,10 @@ updateBootstrapClass(Thread* t, object bootstrapClass, object class_)
   set(t, bootstrapClass, ClassAddendum, classAddendum(t, class_));
 
   updateClassTables(t, bootstrapClass, class_);
+
+  // the bootstrap class may have turned out to be an interface, in
+  // which case it must not appear in its own display
+  initPrimarySupers(t, bootstrapClass);
 }
 
 object
@@ -2409,6 +2474,8 @@ makeArrayClass(Thread* t, object loader, unsigned dimensions, object spec,
 
   PROTECT(t, c);
 
+  initPrimarySupers(t, c);
+
   t->m->processor->initVtable(t, c);
 
   return c;
@@ -2760,6 +2827,13 @@ boot(Thread* t)
   set(t, type(t, Machine::DoubleArrayType), ClassInterfaceTable,
       root(t, Machine::ArrayInterfaceTable));
 
+  for (unsigned i = 0; i < TypeCount; ++i) {
+    object c = type(t, static_cast<Machine::Type>(i));
+    if (c and classPrimarySupers(t, c) == 0) {
+      initPrimarySupers(t, c);
+    }
+  }
+
   m->processor->boot(t, 0, 0);
 
   { object bootCode = makeCode(t, 0, 0, 0, 0, 0, 0, 0, 1);
@@ -2794,13 +2868,18 @@ class HeapClient: public Heap::Client {
     return objectFixed(m->rootThread, static_cast<object>(p));
   }
 
-  virtual unsigned sizeInWords(void* p) {
+  // the heap always passes objects at their current location, so we
+  // need not follow them.  Only metadata read through them (classes
+  // and object masks) goes through Heap::follow, which is how the heap
+  // knows not to move it while compacting.
+
+  virtual uintptr_t sizeInWords(void* p) {
     Thread* t = m->rootThread;
 
-    object o = static_cast<object>(m->heap->follow(maskAlignedPointer(p)));
+    object o = static_cast<object>(maskAlignedPointer(p));
 
-    unsigned n = baseSize(t, o, static_cast<object>
-                          (m->heap->follow(objectClass(t, o))));
+    uintptr_t n = baseSize(t, o, static_cast<object>
+                           (m->heap->follow(objectClass(t, o))));
 
     if (objectExtended(t, o)) {
       ++ n;
@@ -2812,7 +2891,7 @@ class HeapClient: public Heap::Client {
   virtual unsigned copiedSizeInWords(void* p) {
     Thread* t = m->rootThread;
 
-    object o = static_cast<object>(m->heap->follow(maskAlignedPointer(p)));
+    object o = static_cast<object>(maskAlignedPointer(p));
     assert(t, not objectFixed(t, o));
 
     unsigned n = baseSize(t, o, static_cast<object>
@@ -2828,7 +2907,7 @@ class HeapClient: public Heap::Client {
   virtual void copy(void* srcp, void* dstp) {
     Thread* t = m->rootThread;
 
-    object src = static_cast<object>(m->heap->follow(maskAlignedPointer(srcp)));
+    object src = static_cast<object>(maskAlignedPointer(srcp));
     assert(t, not objectFixed(t, src));
 
     object class_ = static_cast<object>
@@ -2836,20 +2915,23 @@ class HeapClient: public Heap::Client {
 
     unsigned base = baseSize(t, src, class_);
     unsigned n = extendedSize(t, src, base);
+    bool hashed = hashTaken(t, src);
+    uint32_t hash = hashed ? takeHash(t, src) : 0;
 
     object dst = static_cast<object>(dstp);
 
-    memcpy(dst, src, n * BytesPerWord);
+    // the heap may slide an object over itself when compacting
+    memmove(dst, src, n * BytesPerWord);
 
-    if (hashTaken(t, src)) {
+    if (hashed) {
       alias(dst, 0) &= PointerMask;
       alias(dst, 0) |= ExtendedMark;
-      extendedWord(t, dst, base) = takeHash(t, src);
+      extendedWord(t, dst, base) = hash;
     }
   }
 
   virtual void walk(void* p, Heap::Walker* w) {
-    object o = static_cast<object>(m->heap->follow(maskAlignedPointer(p)));
+    object o = static_cast<object>(maskAlignedPointer(p));
     ::walk(m->rootThread, w, o, 0);
   }
 
@@ -2885,7 +2967,9 @@ doCollect(Thread* t, Heap::CollectionType type)
   killZombies(t, m->rootThread);
 
   for (unsigned i = 0; i < m->heapPoolIndex; ++i) {
-    m->heap->free(m->heapPool[i], ThreadHeapSizeInBytes);
+    if (not m->heap->retain(m->heapPool[i], ThreadHeapSizeInBytes)) {
+      m->heap->free(m->heapPool[i], ThreadHeapSizeInBytes);
+    }
   }
   m->heapPoolIndex = 0;
 
@@ -3019,6 +3103,8 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   shutdownLock(0),
   libraries(0),
   errorLog(0),
+  gcLog(0),
+  classArchive(0),
   bootimage(0),
   types(0),
   roots(0),
@@ -3032,10 +3118,26 @@ Machine::Machine(System* system, Heap* heap, Finder* bootFinder,
   triedBuiltinOnLoad(false),
   dumpedHeapOnOOM(false),
   alive(true),
-  heapPoolIndex(0)
+  heapPoolIndex(0),
+  safepointCount(0),
+  safepointTotalTime(0),
+  safepointMaxTime(0),
+  safepointLastTime(0)
 {
   heap->setClient(heapClient);
 
+  const char* gcLogPath = findProperty(this, "avian.gc.log");
+  if (gcLogPath) {
+    gcLog = vm::fopen(gcLogPath, "wb");
+    heap->setEventLog(gcLog);
+  }
+
+  const char* classArchivePath = findProperty(this, "avian.class.archive");
+  if (classArchivePath and appFinder) {
+    classArchive = makeClassArchive
+      (system, heap, appFinder, classArchivePath);
+  }
+
   populateJNITables(&javaVMVTable, &jniEnvVTable);
 
   const char* bootstrapProperty = findProperty(this, BOOTSTRAP_PROPERTY);
@@ -3106,6 +3208,15 @@ Machine::dispose()
 
   heap->free(properties, sizeof(const char*) * propertyCount);
 
+  if (gcLog) {
+    heap->setEventLog(0);
+    fclose(gcLog);
+  }
+
+  if (classArchive) {
+    disposeClassArchive(classArchive);
+  }
+
   static_cast<HeapClient*>(heapClient)->dispose();
 
   heap->free(this, sizeof(*this));
@@ -3119,7 +3230,6 @@ Thread::Thread(Machine* m, object javaThread, Thread* parent):
   child(0),
   waitNext(0),
   state(NoState),
-  criticalLevel(0),
   systemThread(0),
   lock(0),
   javaThread(javaThread),
@@ -3133,7 +3243,8 @@ Thread::Thread(Machine* m, object javaThread, Thread* parent):
               (m->heap->allocate(ThreadHeapSizeInBytes))),
   heap(defaultHeap),
   backupHeapIndex(0),
-  flags(ActiveFlag)
+  flags(ActiveFlag),
+  profileBuffer(0)
 { }
 
 void
@@ -3250,6 +3361,8 @@ Thread::dispose()
 
   m->heap->free(defaultHeap, ThreadHeapSizeInBytes);
 
+  disposeSamples(this);
+
   m->processor->dispose(this);
 }
 
@@ -3316,6 +3429,10 @@ shutDown(Thread* t)
 
     visitAll(t, t->m->rootThread, interruptDaemon);
   }
+
+  if (t->m->classArchive) {
+    writeClassArchive(t);
+  }
 }
 
 void
@@ -3364,12 +3481,20 @@ enter(Thread* t, Thread::State s)
 
     t->state = Thread::ExclusiveState;
     t->m->exclusive = t;
-    
+
+    // threads spinning in compiled loops won't reach allocate3, so we
+    // ask them to stop at their next poll instead
+    visitAll(t, t->m->rootThread, armSafepoint);
+
     STORE_LOAD_MEMORY_BARRIER;
 
+    int64_t start = t->m->system->nanoTime();
+
     while (t->m->activeCount > 1) {
       t->m->stateLock->wait(t->systemThread, 0);
     }
+
+    recordSafepoint(t, start);
   } break;
 
   case Thread::IdleState:
@@ -3398,6 +3523,7 @@ enter(Thread* t, Thread::State s)
     case Thread::ExclusiveState: {
       assert(t, t->m->exclusive == t);
       t->m->exclusive = 0;
+      visitAll(t, t->m->rootThread, disarmSafepoint);
     } break;
 
     case Thread::ActiveState: break;
@@ -3446,6 +3572,7 @@ enter(Thread* t, Thread::State s)
 
         t->state = s;
         t->m->exclusive = 0;
+        visitAll(t, t->m->rootThread, disarmSafepoint);
 
         t->m->stateLock->notifyAll(t->systemThread);
       } break;
@@ -3498,32 +3625,45 @@ enter(Thread* t, Thread::State s)
   }
 }
 
+void
+safepoint(Thread* t)
+{
+  ACQUIRE_RAW(t, t->m->stateLock);
+
+  while (t->m->exclusive and t->m->exclusive != t) {
+    ENTER(t, Thread::IdleState);
+
+    while (t->m->exclusive) {
+      t->m->stateLock->wait(t->systemThread, 0);
+    }
+  }
+}
+
 object
-allocate2(Thread* t, unsigned sizeInBytes, bool objectMask)
+allocate2(Thread* t, uintptr_t sizeInBytes, bool objectMask)
 {
   return allocate3
     (t, t->m->heap,
-     ceilingDivide(sizeInBytes, BytesPerWord) > ThreadHeapSizeInWords ?
+     ceilingDivideWord(sizeInBytes, BytesPerWord) > ThreadHeapSizeInWords ?
      Machine::FixedAllocation : Machine::MovableAllocation,
      sizeInBytes, objectMask);
 }
 
 object
 allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
-          unsigned sizeInBytes, bool objectMask)
+          uintptr_t sizeInBytes, bool objectMask)
 {
-  expect(t, t->criticalLevel == 0);
-
   if (UNLIKELY(t->flags & Thread::UseBackupHeapFlag)) {
-    expect(t,  t->backupHeapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
+    expect(t, t->backupHeapIndex
+           + ceilingDivideWord(sizeInBytes, BytesPerWord)
            <= ThreadBackupHeapSizeInWords);
     
     object o = reinterpret_cast<object>(t->backupHeap + t->backupHeapIndex);
-    t->backupHeapIndex += ceilingDivide(sizeInBytes, BytesPerWord);
+    t->backupHeapIndex += ceilingDivideWord(sizeInBytes, BytesPerWord);
     fieldAtOffset<object>(o, 0) = 0;
     return o;
   } else if (UNLIKELY(t->flags & Thread::TracingFlag)) {
-    expect(t, t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
+    expect(t, t->heapIndex + ceilingDivideWord(sizeInBytes, BytesPerWord)
            <= ThreadHeapSizeInWords);
     return allocateSmall(t, sizeInBytes);
   }
@@ -3543,7 +3683,7 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
   do {
     switch (type) {
     case Machine::MovableAllocation:
-      if (t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
+      if (t->heapIndex + ceilingDivideWord(sizeInBytes, BytesPerWord)
           > ThreadHeapSizeInWords)
       {
         t->heap = 0;
@@ -3585,7 +3725,7 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
       throw_(t, root(t, Machine::OutOfMemoryError));
     }
   } while (type == Machine::MovableAllocation
-           and t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
+           and t->heapIndex + ceilingDivideWord(sizeInBytes, BytesPerWord)
            > ThreadHeapSizeInWords);
 
   switch (type) {
@@ -3594,10 +3734,11 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
   }
 
   case Machine::FixedAllocation: {
-    unsigned total;
+    uintptr_t total;
     object o = static_cast<object>
       (t->m->heap->tryAllocateFixed
-       (allocator, ceilingDivide(sizeInBytes, BytesPerWord), objectMask, &total));
+       (allocator, ceilingDivideWord(sizeInBytes, BytesPerWord), objectMask,
+        &total));
 
     if (o) {
       memset(o, 0, sizeInBytes);
@@ -3613,10 +3754,11 @@ allocate3(Thread* t, Allocator* allocator, Machine::AllocationType type,
   }
 
   case Machine::ImmortalAllocation: {
-    unsigned total;
+    uintptr_t total;
     object o = static_cast<object>
       (t->m->heap->tryAllocateImmortalFixed
-       (allocator, ceilingDivide(sizeInBytes, BytesPerWord), objectMask, &total));
+       (allocator, ceilingDivideWord(sizeInBytes, BytesPerWord), objectMask,
+        &total));
 
     if (o) {
       memset(o, 0, sizeInBytes);
@@ -3829,13 +3971,8 @@ resolveBootstrap(Thread* t, uintptr_t* arguments)
 }
 
 bool
-isAssignableFrom(Thread* t, object a, object b)
+isSecondarySuper(Thread* t, object a, object b)
 {
-  assert(t, a);
-  assert(t, b);
-
-  if (a == b) return true;
-
   if (classFlags(t, a) & ACC_INTERFACE) {
     if (classVmFlags(t, b) & BootstrapFlag) {
       uintptr_t arguments[] = { reinterpret_cast<uintptr_t>(className(t, b)) };
@@ -3873,6 +4010,31 @@ isAssignableFrom(Thread* t, object a, object b)
   return false;
 }
 
+bool
+isAssignableFrom(Thread* t, object a, object b)
+{
+  assert(t, a);
+  assert(t, b);
+
+  if (a == b) return true;
+
+  int depth = primarySuperDepth(t, a);
+  if (depth >= 0 and classPrimarySupers(t, b)) {
+    return arrayBody(t, classPrimarySupers(t, b), depth) == a;
+  }
+
+  if (classSecondarySuperCache(t, b) == a) {
+    return true;
+  }
+
+  if (isSecondarySuper(t, a, b)) {
+    set(t, b, ClassSecondarySuperCache, a);
+    return true;
+  } else {
+    return false;
+  }
+}
+
 bool
 instanceOf(Thread* t, object class_, object o)
 {
@@ -3883,6 +4045,49 @@ instanceOf(Thread* t, object class_, object o)
   }
 }
 
+void
+initPrimarySupers(Thread* t, object class_)
+{
+  PROTECT(t, class_);
+
+  object superSupers = 0;
+  unsigned depth = 0;
+  object super = classSuper(t, class_);
+  if (super) {
+    if (classPrimarySupers(t, super) == 0) {
+      initPrimarySupers(t, super);
+    }
+
+    superSupers = classPrimarySupers(t, super);
+    while (depth < PrimarySuperCount and arrayBody(t, superSupers, depth)) {
+      ++ depth;
+    }
+  }
+
+  PROTECT(t, superSupers);
+
+  object supers;
+  if ((classFlags(t, class_) & ACC_INTERFACE) == 0
+      and classArrayDimensions(t, class_) == 0
+      and depth < PrimarySuperCount)
+  {
+    supers = makeArray(t, PrimarySuperCount);
+    if (depth) {
+      memcpy(&arrayBody(t, supers, 0), &arrayBody(t, superSupers, 0),
+             depth * BytesPerWord);
+    }
+    set(t, supers, ArrayBody + (depth * BytesPerWord), class_);
+  } else if (superSupers) {
+    // interfaces, arrays, and classes too deep to be recorded can share
+    // their superclass's display since they don't appear in it
+    supers = superSupers;
+  } else {
+    supers = makeArray(t, PrimarySuperCount);
+  }
+
+  set(t, class_, ClassPrimarySupers, supers);
+}
+
 object
 classInitializer(Thread* t, object class_)
 {
@@ -3981,7 +4186,7 @@ primitiveSize(Thread* t, unsigned code)
 
 object
 parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
-           Machine::Type throwType)
+           Machine::Type throwType, bool archive)
 {
   PROTECT(t, loader);
 
@@ -4033,6 +4238,8 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
                             0, // static table
                             loader,
                             0, // source
+                            0, // primary supers
+                            0, // secondary super cache
                             0);// vtable length
   PROTECT(t, class_);
   
@@ -4062,6 +4269,19 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
 
   parseAttributeTable(t, s, class_, pool);
 
+  if (archive) {
+    recordArchivedClass(t, class_, pool);
+  }
+
+  return installClass(t, class_, pool);
+}
+
+object
+installClass(Thread* t, object class_, object pool)
+{
+  PROTECT(t, class_);
+  PROTECT(t, pool);
+
   object vtable = classVirtualTable(t, class_);
   unsigned vtableLength = (vtable ? arrayLength(t, vtable) : 0);
 
@@ -4087,6 +4307,8 @@ parseClass(Thread* t, object loader, const uint8_t* data, unsigned size,
 
   PROTECT(t, real);
 
+  initPrimarySupers(t, real);
+
   t->m->processor->initVtable(t, real);
 
   updateClassTables(t, real, class_);
@@ -4112,7 +4334,19 @@ runParseClass(Thread* t, uintptr_t* arguments)
   Machine::Type throwType = static_cast<Machine::Type>(arguments[2]);
 
   return reinterpret_cast<uintptr_t>
-    (parseClass(t, loader, region->start(), region->length(), throwType));
+    (parseClass(t, loader, region->start(), region->length(), throwType,
+                true));
+}
+
+uint64_t
+runInstallArchivedClass(Thread* t, uintptr_t* arguments)
+{
+  object loader = reinterpret_cast<object>(arguments[0]);
+  const uint8_t* record = reinterpret_cast<const uint8_t*>(arguments[1]);
+  Machine::Type throwType = static_cast<Machine::Type>(arguments[2]);
+
+  return reinterpret_cast<uintptr_t>
+    (installArchivedClass(t, loader, record, throwType));
 }
 
 object
@@ -4149,9 +4383,24 @@ resolveSystemClass(Thread* t, object loader, object spec, bool throw_,
              ".class",
              7);
 
-      System::Region* region = static_cast<Finder*>
-        (systemClassLoaderFinder(t, loader))->find
-        (RUNTIME_ARRAY_BODY(file));
+      // classes found in the class archive are installed from there
+      // without reading or parsing their class files
+      const uint8_t* record = findArchivedClass(t, loader, spec);
+      if (record) {
+        uintptr_t arguments[] = { reinterpret_cast<uintptr_t>(loader),
+                                  reinterpret_cast<uintptr_t>(record),
+                                  static_cast<uintptr_t>(throwType) };
+
+        class_ = reinterpret_cast<object>
+          (runRaw(t, runInstallArchivedClass, arguments));
+      }
+
+      System::Region* region = 0;
+      if (class_ == 0 and t->exception == 0) {
+        region = static_cast<Finder*>
+          (systemClassLoaderFinder(t, loader))->find
+          (RUNTIME_ARRAY_BODY(file));
+      }
 
       if (region) {
         if (Verbose) {
@@ -4167,17 +4416,6 @@ resolveSystemClass(Thread* t, object loader, object spec, bool throw_,
           // parse class file
           class_ = reinterpret_cast<object>
             (runRaw(t, runParseClass, arguments));
-
-          if (UNLIKELY(t->exception)) {
-            if (throw_) {
-              object e = t->exception;
-              t->exception = 0;
-              vm::throw_(t, e);
-            } else {
-              t->exception = 0;
-              return 0;
-            }
-          }
         }
 
         if (Verbose) {
@@ -4185,7 +4423,20 @@ resolveSystemClass(Thread* t, object loader, object spec, bool throw_,
                   &byteArrayBody(t, spec, 0),
                   class_);
         }
+      }
 
+      if (UNLIKELY(t->exception)) {
+        if (throw_) {
+          object e = t->exception;
+          t->exception = 0;
+          vm::throw_(t, e);
+        } else {
+          t->exception = 0;
+          return 0;
+        }
+      }
+
+      if (class_) {
         { const char* source = static_cast<Finder*>
             (systemClassLoaderFinder(t, loader))->sourceUrl
             (RUNTIME_ARRAY_BODY(file));
@@ -4528,6 +4779,66 @@ makeObjectArray(Thread* t, object elementClass, unsigned count)
   return array;
 }
 
+bool
+compatibleArrayTypes(Thread* t, object a, object b)
+{
+  return classArrayElementSize(t, a)
+    and classArrayElementSize(t, b)
+    and (a == b
+         or (not ((classVmFlags(t, a) & PrimitiveFlag)
+                  or (classVmFlags(t, b) & PrimitiveFlag))));
+}
+
+void
+arrayCopy(Thread* t, object src, int32_t srcOffset, object dst,
+          int32_t dstOffset, int32_t length)
+{
+  if (LIKELY(src and dst)) {
+    if (LIKELY(compatibleArrayTypes
+               (t, objectClass(t, src), objectClass(t, dst))))
+    {
+      unsigned elementSize = classArrayElementSize(t, objectClass(t, src));
+
+      if (LIKELY(elementSize)) {
+        intptr_t sl = fieldAtOffset<uintptr_t>(src, BytesPerWord);
+        intptr_t dl = fieldAtOffset<uintptr_t>(dst, BytesPerWord);
+        if (LIKELY(length > 0)) {
+          if (LIKELY(srcOffset >= 0 and srcOffset + length <= sl and
+                     dstOffset >= 0 and dstOffset + length <= dl))
+          {
+            uint8_t* sbody = &fieldAtOffset<uint8_t>(src, ArrayBody);
+            uint8_t* dbody = &fieldAtOffset<uint8_t>(dst, ArrayBody);
+            if (src == dst) {
+              memmove(dbody + (dstOffset * elementSize),
+                      sbody + (srcOffset * elementSize),
+                      length * elementSize);
+            } else {
+              memcpy(dbody + (dstOffset * elementSize),
+                     sbody + (srcOffset * elementSize),
+                     length * elementSize);
+            }
+
+            if (classObjectMask(t, objectClass(t, dst))) {
+              mark(t, dst, ArrayBody + (dstOffset * BytesPerWord), length);
+            }
+
+            return;
+          } else {
+            throwNew(t, Machine::IndexOutOfBoundsExceptionType);
+          }
+        } else {
+          return;
+        }
+      }
+    }
+  } else {
+    throwNew(t, Machine::NullPointerExceptionType);
+    return;
+  }
+
+  throwNew(t, Machine::ArrayStoreExceptionType);
+}
+
 object
 findFieldInClass(Thread* t, object class_, object name, object spec)
 {
@@ -4700,11 +5011,7 @@ collect(Thread* t, Heap::CollectionType type)
     t->m->dumpedHeapOnOOM = true;
     const char* path = findProperty(t, "avian.heap.dump");
     if (path) {
-      FILE* out = vm::fopen(path, "wb");
-      if (out) {
-        dumpHeap(t, out);
-        fclose(out);
-      }
+      dumpHeap(t, path);
     }
   }
 #endif//AVIAN_HEAPDUMP
@@ -5130,10 +5437,14 @@ populateMultiArray(Thread* t, object array, int32_t* counts,
     (t, classLoader(t,  objectClass(t, array)), elementSpec);
   PROTECT(t, class_);
 
+  unsigned elementSize = classArrayElementSize(t, class_);
+  checkArraySize(t, counts[index + 1], elementSize, ArrayBody);
+
   for (int32_t i = 0; i < counts[index]; ++i) {
     object a = makeArray
-      (t, ceilingDivide
-       (counts[index + 1] * classArrayElementSize(t, class_), BytesPerWord));
+      (t, ceilingDivideWord
+       (static_cast<uintptr_t>(counts[index + 1]) * elementSize,
+        BytesPerWord));
     arrayLength(t, a) = counts[index + 1];
     setObjectClass(t, a, class_);
     set(t, array, ArrayBody + (i * BytesPerWord), a);
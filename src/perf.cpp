@@ -0,0 +1,307 @@
+/* Copyright (c) 2008-2013, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "avian/machine.h"
+
+#ifdef __linux__
+#  include "unistd.h"
+#  include "fcntl.h"
+#  include "time.h"
+#  include "sys/mman.h"
+#  include "sys/syscall.h"
+#endif
+
+using namespace vm;
+
+namespace {
+
+namespace local {
+
+#ifdef __linux__
+
+// see tools/perf/Documentation/jitdump-specification.txt in the
+// Linux kernel source tree for the format written here
+
+const uint32_t JitDumpMagic = 0x4A695444;
+const uint32_t JitDumpVersion = 1;
+
+enum {
+  JitCodeLoad = 0,
+  JitCodeDebugInfo = 2
+};
+
+#if (defined ARCH_x86_32)
+const uint32_t ElfMachine = 3; // EM_386
+#elif (defined ARCH_x86_64)
+const uint32_t ElfMachine = 62; // EM_X86_64
+#elif (defined ARCH_arm)
+const uint32_t ElfMachine = 40; // EM_ARM
+#elif (defined ARCH_powerpc)
+const uint32_t ElfMachine = 20; // EM_PPC
+#else
+const uint32_t ElfMachine = 0;
+#endif
+
+struct JitDumpHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t totalSize;
+  uint32_t elfMachine;
+  uint32_t pad1;
+  uint32_t pid;
+  uint64_t timestamp;
+  uint64_t flags;
+};
+
+struct JitDumpRecord {
+  uint32_t id;
+  uint32_t totalSize;
+  uint64_t timestamp;
+};
+
+struct JitDumpCodeLoad {
+  JitDumpRecord record;
+  uint32_t pid;
+  uint32_t tid;
+  uint64_t vma;
+  uint64_t codeAddress;
+  uint64_t codeSize;
+  uint64_t codeIndex;
+};
+
+struct JitDumpDebugInfo {
+  JitDumpRecord record;
+  uint64_t codeAddress;
+  uint64_t entryCount;
+};
+
+struct JitDumpDebugEntry {
+  uint64_t address;
+  int32_t line;
+  int32_t discriminator;
+};
+
+uint64_t
+timestamp()
+{
+  // perf must be run with "-k mono" so that its sample times use the
+  // same clock as the records written here
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (static_cast<uint64_t>(ts.tv_sec) * 1000 * 1000 * 1000)
+    + ts.tv_nsec;
+}
+
+class PerfCompilationHandler: public Processor::CompilationHandler {
+ public:
+  PerfCompilationHandler(Allocator* allocator, System::Mutex* lock, FILE* map,
+                         FILE* dump, void* marker, unsigned markerSize):
+    allocator(allocator),
+    lock(lock),
+    map(map),
+    dump(dump),
+    marker(marker),
+    markerSize(markerSize),
+    pid(getpid()),
+    codeIndex(0)
+  { }
+
+  virtual void lineNumbers(const void* code, const char* sourceFile,
+                           const uint64_t* table, unsigned count)
+  {
+    if (dump == 0 or count == 0) {
+      return;
+    }
+
+    unsigned nameSize = strlen(sourceFile) + 1;
+
+    JitDumpDebugInfo info;
+    info.record.id = JitCodeDebugInfo;
+    info.record.totalSize = sizeof(JitDumpDebugInfo)
+      + (count * (sizeof(JitDumpDebugEntry) + nameSize));
+    info.record.timestamp = timestamp();
+    info.codeAddress = reinterpret_cast<uintptr_t>(code);
+    info.entryCount = count;
+
+    lock->acquire();
+
+    fwrite(&info, sizeof(JitDumpDebugInfo), 1, dump);
+
+    for (unsigned i = 0; i < count; ++i) {
+      JitDumpDebugEntry entry;
+      entry.address = reinterpret_cast<uintptr_t>(code)
+        + lineNumberIp(table[i]);
+      entry.line = lineNumberLine(table[i]);
+      entry.discriminator = 0;
+
+      fwrite(&entry, sizeof(JitDumpDebugEntry), 1, dump);
+      fwrite(sourceFile, nameSize, 1, dump);
+    }
+
+    lock->release();
+  }
+
+  virtual void compiled(const void* code, unsigned size,
+                        unsigned frameSize UNUSED, const char* name)
+  {
+    if (size == 0) {
+      return;
+    }
+
+    lock->acquire();
+
+    if (map) {
+      fprintf(map, "%lx %x %s\n",
+              static_cast<unsigned long>(reinterpret_cast<uintptr_t>(code)),
+              size, name);
+      fflush(map);
+    }
+
+    if (dump) {
+      unsigned nameSize = strlen(name) + 1;
+
+      JitDumpCodeLoad load;
+      load.record.id = JitCodeLoad;
+      load.record.totalSize = sizeof(JitDumpCodeLoad) + nameSize + size;
+      load.record.timestamp = timestamp();
+      load.pid = pid;
+      load.tid = syscall(SYS_gettid);
+      load.vma = reinterpret_cast<uintptr_t>(code);
+      load.codeAddress = reinterpret_cast<uintptr_t>(code);
+      load.codeSize = size;
+      load.codeIndex = codeIndex++;
+
+      fwrite(&load, sizeof(JitDumpCodeLoad), 1, dump);
+      fwrite(name, nameSize, 1, dump);
+      fwrite(code, size, 1, dump);
+      fflush(dump);
+    }
+
+    lock->release();
+  }
+
+  virtual void dispose() {
+    if (map) {
+      fclose(map);
+    }
+
+    if (dump) {
+      munmap(marker, markerSize);
+      fclose(dump);
+    }
+
+    lock->dispose();
+
+    allocator->free(this, sizeof(*this));
+  }
+
+  Allocator* allocator;
+  System::Mutex* lock;
+  FILE* map;
+  FILE* dump;
+  void* marker;
+  unsigned markerSize;
+  uint32_t pid;
+  uint64_t codeIndex;
+};
+
+FILE*
+openJitDump(void** marker, unsigned markerSize)
+{
+  const unsigned Size = 64;
+  char path[Size];
+  vm::snprintf(path, Size, "/tmp/jit-%d.dump", getpid());
+
+  int fd = ::open(path, O_CREAT | O_TRUNC | O_RDWR, 0666);
+  if (fd < 0) {
+    return 0;
+  }
+
+  // perf record notices the dump file by way of this mapping, so it
+  // must be executable and stay in place for the life of the process
+  *marker = mmap(0, markerSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+  if (*marker == MAP_FAILED) {
+    ::close(fd);
+    return 0;
+  }
+
+  FILE* dump = fdopen(fd, "wb");
+  if (dump == 0) {
+    munmap(*marker, markerSize);
+    ::close(fd);
+    return 0;
+  }
+
+  JitDumpHeader header;
+  header.magic = JitDumpMagic;
+  header.version = JitDumpVersion;
+  header.totalSize = sizeof(JitDumpHeader);
+  header.elfMachine = ElfMachine;
+  header.pad1 = 0;
+  header.pid = getpid();
+  header.timestamp = timestamp();
+  header.flags = 0;
+
+  fwrite(&header, sizeof(JitDumpHeader), 1, dump);
+  fflush(dump);
+
+  return dump;
+}
+
+#endif // __linux__
+
+} // namespace local
+
+} // namespace
+
+namespace vm {
+
+Processor::CompilationHandler*
+makePerfCompilationHandler(System* s UNUSED, Allocator* allocator UNUSED,
+                           const char* mode UNUSED)
+{
+#ifdef __linux__
+  // "true" asks for both outputs; anything unrecognized, including
+  // "false", asks for neither
+  bool both = strcmp(mode, "true") == 0;
+  bool wantMap = both or strcmp(mode, "map") == 0;
+  bool wantDump = both or strcmp(mode, "jitdump") == 0;
+
+  FILE* map = 0;
+  if (wantMap) {
+    const unsigned Size = 64;
+    char path[Size];
+    vm::snprintf(path, Size, "/tmp/perf-%d.map", getpid());
+    map = vm::fopen(path, "w");
+  }
+
+  void* marker = 0;
+  unsigned markerSize = sysconf(_SC_PAGESIZE);
+  FILE* dump = 0;
+  if (wantDump) {
+    dump = local::openJitDump(&marker, markerSize);
+  }
+
+  if (map == 0 and dump == 0) {
+    return 0;
+  }
+
+  System::Mutex* lock;
+  expect(s, s->success(s->make(&lock)));
+
+  return new (allocator->allocate(sizeof(local::PerfCompilationHandler)))
+    local::PerfCompilationHandler
+    (allocator, lock, map, dump, marker, markerSize);
+#else
+  return 0;
+#endif
+}
+
+} // namespace vm
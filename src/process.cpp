@@ -210,12 +210,12 @@ resolveNativeMethod(Thread* t, object method)
 {
   void* p = resolveNativeMethod(t, method, "Avian_", 6, 3);
   if (p) {
-    return makeNative(t, p, true);
+    return makeNative(t, p, true, 0, 0);
   }
 
   p = resolveNativeMethod(t, method, "Java_", 5, -1);
   if (p) {
-    return makeNative(t, p, false);
+    return makeJniNative(t, method, p);
   }
 
   return 0;
@@ -225,6 +225,60 @@ resolveNativeMethod(Thread* t, object method)
 
 namespace vm {
 
+object
+makeJniNative(Thread* t, object method, void* function)
+{
+  PROTECT(t, method);
+
+  // determine once, rather than on every call, whether the method may
+  // be invoked via callNativeDirect: that requires that every
+  // parameter fit in a word and be passed in integer registers, so
+  // floating point and long parameters disqualify it, as does a
+  // floating point return value.  directReferences has a bit set for
+  // each parameter which is a reference and must therefore be passed
+  // as a handle.
+  unsigned words = 2;
+  unsigned references = 0;
+  bool direct = true;
+
+  MethodSpecIterator it
+    (t, reinterpret_cast<const char*>
+     (&byteArrayBody(t, methodSpec(t, method), 0)));
+
+  while (direct and it.hasNext()) {
+    switch (fieldCode(t, *it.next())) {
+    case ObjectField:
+      if (words < MaxDirectNativeWords) {
+        references |= 1 << (words - 2);
+      }
+      break;
+
+    case ByteField:
+    case BooleanField:
+    case CharField:
+    case ShortField:
+    case IntField:
+      break;
+
+    default:
+      direct = false;
+      break;
+    }
+
+    ++ words;
+  }
+
+  unsigned returnCode = methodReturnCode(t, method);
+  if ((not direct) or words > MaxDirectNativeWords
+      or returnCode == FloatField or returnCode == DoubleField)
+  {
+    words = 0;
+    references = 0;
+  }
+
+  return makeNative(t, function, false, words, references);
+}
+
 void
 resolveNative(Thread* t, object method)
 {
@@ -0,0 +1,203 @@
+/* Copyright (c) 2008-2014, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "avian/machine.h"
+
+using namespace vm;
+
+namespace {
+
+namespace local {
+
+// capacity of each thread's sample buffer, in words
+const unsigned BufferCapacity = 8 * 1024;
+
+// deeper stacks are truncated to their innermost frames
+const unsigned MaxDepth = 64;
+
+} // namespace local
+
+} // namespace
+
+namespace vm {
+
+// A ring of samples taken from one thread.  Each sample is a frame
+// count followed by that many methods, innermost first.  The sampler
+// appends at head and drainSamples consumes from tail; both only
+// ever grow and are reduced modulo the capacity on access.  Samples
+// are only appended or consumed with Machine::stateLock held, which
+// also keeps the sampled thread from exiting in the meantime.  The
+// methods are visited as roots until they are consumed, so they stay
+// valid across collections.
+class ProfileBuffer {
+ public:
+  unsigned head;
+  unsigned tail;
+  uintptr_t body[local::BufferCapacity];
+};
+
+} // namespace vm
+
+namespace {
+
+namespace local {
+
+uintptr_t&
+bufferWord(ProfileBuffer* b, unsigned index)
+{
+  return b->body[index % BufferCapacity];
+}
+
+bool
+sampleThread(Thread* t, Thread* target)
+{
+  ProfileBuffer* b = target->profileBuffer;
+  if (b == 0) {
+    b = static_cast<ProfileBuffer*>
+      (t->m->heap->tryAllocate(sizeof(ProfileBuffer)));
+    if (b == 0) {
+      return false;
+    }
+
+    b->head = b->tail = 0;
+    target->profileBuffer = b;
+  }
+
+  class Visitor: public Processor::StackVisitor {
+   public:
+    Visitor(): count(0) { }
+
+    virtual bool visit(Processor::StackWalker* walker) {
+      frames[count++] = walker->method();
+      return count < MaxDepth;
+    }
+
+    object frames[MaxDepth];
+    unsigned count;
+  } v;
+
+  t->m->processor->sampleStack(t, target, &v);
+
+  // if the buffer is full, the sample is dropped; the caller drains
+  // the buffers well before that should happen
+  if (v.count and BufferCapacity - (b->head - b->tail) > v.count) {
+    bufferWord(b, b->head) = v.count;
+    for (unsigned i = 0; i < v.count; ++i) {
+      bufferWord(b, b->head + 1 + i) = reinterpret_cast<uintptr_t>
+        (v.frames[i]);
+    }
+    b->head += v.count + 1;
+  }
+
+  return (b->head - b->tail) * 2 >= BufferCapacity;
+}
+
+bool
+sampleThreads(Thread* t, Thread* target)
+{
+  bool full = false;
+  for (Thread* p = target; p; p = p->peer) {
+    // only threads running Java code are sampled; threads which are
+    // blocked, sleeping or in native code are idle
+    if (p != t and p->state == Thread::ActiveState and p->javaThread) {
+      if (sampleThread(t, p)) {
+        full = true;
+      }
+    }
+
+    if (p->child and sampleThreads(t, p->child)) {
+      full = true;
+    }
+  }
+  return full;
+}
+
+void
+drainSamples(Thread* t, Thread* target, object array, unsigned* index)
+{
+  unsigned capacity = objectArrayLength(t, array);
+  for (Thread* p = target; p; p = p->peer) {
+    ProfileBuffer* b = p->profileBuffer;
+    if (b) {
+      while (b->tail != b->head) {
+        unsigned count = bufferWord(b, b->tail);
+        if (*index + count + 2 > capacity) {
+          return;
+        }
+
+        set(t, array, ArrayBody + ((*index)++ * BytesPerWord),
+            p->javaThread);
+
+        for (unsigned i = 0; i < count; ++i) {
+          set(t, array, ArrayBody + ((*index)++ * BytesPerWord),
+              reinterpret_cast<object>(bufferWord(b, b->tail + 1 + i)));
+        }
+
+        set(t, array, ArrayBody + ((*index)++ * BytesPerWord), 0);
+
+        b->tail += count + 1;
+      }
+    }
+
+    if (p->child) {
+      drainSamples(t, p->child, array, index);
+    }
+  }
+}
+
+} // namespace local
+
+} // namespace
+
+namespace vm {
+
+bool
+sampleThreads(Thread* t)
+{
+  ACQUIRE_RAW(t, t->m->stateLock);
+
+  return local::sampleThreads(t, t->m->rootThread);
+}
+
+unsigned
+drainSamples(Thread* t, object array)
+{
+  ACQUIRE_RAW(t, t->m->stateLock);
+
+  unsigned index = 0;
+  local::drainSamples(t, t->m->rootThread, array, &index);
+  return index;
+}
+
+void
+visitSamples(Thread* t, Heap::Visitor* v)
+{
+  ProfileBuffer* b = t->profileBuffer;
+  if (b) {
+    for (unsigned i = b->tail; i != b->head;) {
+      unsigned count = local::bufferWord(b, i);
+      for (unsigned j = 1; j <= count; ++j) {
+        v->visit(&local::bufferWord(b, i + j));
+      }
+      i += count + 1;
+    }
+  }
+}
+
+void
+disposeSamples(Thread* t)
+{
+  if (t->profileBuffer) {
+    t->m->heap->free(t->profileBuffer, sizeof(ProfileBuffer));
+    t->profileBuffer = 0;
+  }
+}
+
+} // namespace vm
@@ -17,6 +17,23 @@ THUNK(divideDouble)
 THUNK(moduloDouble)
 THUNK(negateDouble)
 THUNK(squareRootDouble)
+THUNK(floorDouble)
+THUNK(ceilDouble)
+THUNK(rintDouble)
+THUNK(sinDouble)
+THUNK(cosDouble)
+THUNK(tanDouble)
+THUNK(asinDouble)
+THUNK(acosDouble)
+THUNK(atanDouble)
+THUNK(sinhDouble)
+THUNK(coshDouble)
+THUNK(tanhDouble)
+THUNK(expDouble)
+THUNK(logDouble)
+THUNK(powDouble)
+THUNK(reinterpretInt)
+THUNK(reinterpretLong)
 THUNK(doubleToFloat)
 THUNK(doubleToInt)
 THUNK(doubleToLong)
@@ -70,3 +87,13 @@ THUNK(set)
 THUNK(getJClass64)
 THUNK(getJClassFromReference)
 THUNK(gcIfNecessary)
+THUNK(pollSafepoint)
+THUNK(getNanoTime)
+THUNK(tryInitClassAndPatch)
+THUNK(copyArray)
+THUNK(stringEquals)
+THUNK(stringCompare)
+THUNK(stringHashCode64)
+THUNK(stringIndexOf)
+THUNK(fillArray)
+THUNK(primitiveArraysEqual)
@@ -10,10 +10,14 @@
 
 #include <avian/vm/system/system.h>
 
+#include "avian/target.h"
+
 #include <avian/util/arg-parser.h>
 
 #include <avian/vm/codegen/lir.h>
 #include <avian/vm/codegen/assembler.h>
+#include <avian/vm/codegen/architecture.h>
+#include <avian/vm/codegen/compiler.h>
 #include <avian/vm/codegen/targets.h>
 #include <avian/vm/codegen/registers.h>
 
@@ -84,6 +88,80 @@ void generateCode(BasicEnv& env) {
   env.s->free(data);
 }
 
+class AuditClient: public Compiler::Client {
+ public:
+  virtual intptr_t getThunk(lir::UnaryOperation, unsigned) {
+    abort();
+  }
+
+  virtual intptr_t getThunk(lir::BinaryOperation, unsigned, unsigned) {
+    abort();
+  }
+
+  virtual intptr_t getThunk(lir::TernaryOperation, unsigned, unsigned,
+                            bool*)
+  {
+    abort();
+  }
+};
+
+// Compiles a block which keeps more values live than there are
+// registers, so the output depends on which register allocator was
+// built in (see the register-allocator option in the README).
+void compileCode(BasicEnv& env) {
+  const unsigned ValueCount = 24;
+  const unsigned CodeCapacity = 64 * 1024;
+
+  Zone zone(env.s, env.heap, 8192);
+  Assembler* a = env.arch->makeAssembler(env.heap, &zone);
+  AuditClient client;
+  Compiler* c = makeCompiler(env.s, a, &zone, &client);
+
+  c->init(1, 0, 0, env.arch->alignFrameSize(ValueCount));
+  c->startLogicalIp(0);
+
+  Compiler::Operand* base = c->register_(env.arch->thread());
+  Compiler::Operand* values[ValueCount];
+  for (unsigned i = 0; i < ValueCount; ++i) {
+    values[i] = c->load
+      (TargetBytesPerWord, TargetBytesPerWord,
+       c->memory(base, Compiler::IntegerType, i * TargetBytesPerWord),
+       TargetBytesPerWord);
+  }
+
+  Compiler::Operand* sum = c->constant(0, Compiler::IntegerType);
+  for (unsigned i = 0; i < ValueCount / 2; ++i) {
+    Compiler::Operand* product = c->mul
+      (TargetBytesPerWord, values[i], values[ValueCount - 1 - i]);
+
+    if (i % 4 == 1) {
+      product = c->div
+        (TargetBytesPerWord, c->constant(7, Compiler::IntegerType), product);
+    }
+
+    sum = c->add(TargetBytesPerWord, sum, product);
+  }
+
+  c->return_(TargetBytesPerWord, sum);
+
+  c->compile(0, 0);
+
+  uint8_t* data = static_cast<uint8_t*>(env.s->tryAllocate(CodeCapacity));
+  unsigned length = c->resolve(data);
+  expect(env.s, length <= CodeCapacity);
+  c->write();
+
+  printf("compiled length: %d\n", length);
+  for(unsigned i = 0; i < length; i++) {
+    printf("%02x ", data[i]);
+  }
+  printf("\n");
+
+  env.s->free(data);
+  c->dispose();
+  a->dispose();
+}
+
 class Arguments {
 public:
   const char* output;
@@ -111,6 +189,7 @@ int main(int argc, char** argv) {
   BasicEnv env;
 
   generateCode(env);
+  compileCode(env);
 
   return 0;
 }
\ No newline at end of file
@@ -427,6 +427,45 @@ makeCodeImage(Thread* t, Zone* zone, BootImage* image, uint8_t* code,
         object fields = allFields(t, typeMaps, c, &count, &array);
         PROTECT(t, fields);
 
+        // the VM lays out each class's instance fields in groups (see
+        // fieldLayoutGroup), so we must visit them in the same order
+        { object ordered = makeVector(t, 0, 0);
+          PROTECT(t, ordered);
+
+          for (unsigned start = 0; start < vectorSize(t, fields);) {
+            unsigned end = start;
+            while (end < vectorSize(t, fields) and vectorBody(t, fields, end)) {
+              ++ end;
+            }
+
+            for (unsigned i = start; i < end; ++i) {
+              object field = vectorBody(t, fields, i);
+              if (fieldFlags(t, field) & ACC_STATIC) {
+                ordered = vectorAppend(t, ordered, field);
+              }
+            }
+
+            for (unsigned group = 0; group < FieldLayoutGroupCount; ++group) {
+              for (unsigned i = start; i < end; ++i) {
+                object field = vectorBody(t, fields, i);
+                if ((fieldFlags(t, field) & ACC_STATIC) == 0
+                    and fieldLayoutGroup(t, fieldCode(t, field)) == group)
+                {
+                  ordered = vectorAppend(t, ordered, field);
+                }
+              }
+            }
+
+            if (end < vectorSize(t, fields)) {
+              ordered = vectorAppend(t, ordered, 0);
+            }
+
+            start = end + 1;
+          }
+
+          fields = ordered;
+        }
+
         THREAD_RUNTIME_ARRAY(t, Field, memberFields, count + 1);
 
         unsigned memberIndex;
@@ -1307,6 +1346,10 @@ writeBootImage2(Thread* t, OutputStream* bootimageOutput, OutputStream* codeOutp
       // printf("%ld %ld %s.%s%s\n", offset, offset + size, class_, name, spec);
     }
 
+    virtual void lineNumbers(const void*, const char*, const uint64_t*,
+                             unsigned)
+    { }
+
     virtual void dispose() {}
 
     DynamicArray<SymbolInfo> symbols;
@@ -290,6 +290,7 @@ class Type : public Object {
   const char* javaName;
   Object* super;
   List members;
+  List declaredMembers;
   List methods;
   bool overridesMethods;
 
@@ -302,6 +303,7 @@ class Type : public Object {
     o->javaName = javaName;
     o->super = 0;
     o->members.first = o->members.last = 0;
+    o->declaredMembers.first = o->declaredMembers.last = 0;
     o->methods.first = o->methods.last = 0;
     o->overridesMethods = false;
     return o;
@@ -344,6 +346,18 @@ typeMembers(Object* o)
   }
 }
 
+Object*
+typeDeclaredMembers(Object* o)
+{
+  switch (o->type) {
+  case Object::Type:
+    return static_cast<Type*>(o)->declaredMembers.first;
+
+  default:
+    UNREACHABLE;
+  }
+}
+
 Object*
 typeMethods(Object* o)
 {
@@ -368,16 +382,48 @@ typeOverridesMethods(Object* o)
   }
 }
 
+// constructor parameters follow the order in which members are
+// declared, which need not be the order in which they are laid out
+void
+declareMember(Object* o, Object* member)
+{
+  switch (o->type) {
+  case Object::Type:
+    assert(member->type == Object::Scalar);
+    static_cast<Type*>(o)->declaredMembers.append(member);
+    break;
+
+  default:
+    UNREACHABLE;
+  }
+}
+
+void
+layOutMember(Object* o, Object* member)
+{
+  switch (o->type) {
+  case Object::Type:
+    assert(member->type == Object::Scalar);
+    static_cast<Type*>(o)->members.append(member);
+    break;
+
+  default:
+    UNREACHABLE;
+  }
+}
+
 void
 addMember(Object* o, Object* member)
 {
   switch (o->type) {
   case Object::Type:
     if (member->type == Object::Array) {
-      static_cast<Type*>(o)->members.append
-        (Scalar::make(o, "uintptr_t", "length", BytesPerWord));
+      Object* length = Scalar::make(o, "uintptr_t", "length", BytesPerWord);
+      static_cast<Type*>(o)->members.append(length);
+      static_cast<Type*>(o)->declaredMembers.append(length);
     }
     static_cast<Type*>(o)->members.append(member);
+    static_cast<Type*>(o)->declaredMembers.append(member);
     break;
 
   default:
@@ -904,6 +950,21 @@ fieldType(const char* spec)
   }
 }
 
+unsigned
+fieldLayoutGroup(Object* member)
+{
+  if (equal(memberTypeName(member), "object")) {
+    return 1;
+  } else {
+    switch (memberSize(member)) {
+    case 8: return 0;
+    case 4: return 2;
+    case 2: return 3;
+    default: return 4;
+    }
+  }
+}
+
 void
 parseJavaClass(Object* type, Stream* s, Object* declarations)
 {
@@ -975,6 +1036,7 @@ parseJavaClass(Object* type, Stream* s, Object* declarations)
 //   }
 
   unsigned fieldCount = s->read2();
+  List members;
   for (unsigned i = 0; i < fieldCount; ++i) {
     unsigned flags = s->read2();
     unsigned nameIndex = s->read2();
@@ -999,7 +1061,18 @@ parseJavaClass(Object* type, Stream* s, Object* declarations)
       Object* member = Scalar::make
         (type, memberType, name, sizeOf(memberType));
 
-      addMember(type, member);
+      declareMember(type, member);
+      members.append(member);
+    }
+  }
+
+  // the VM lays out instance fields in groups (see fieldLayoutGroup in
+  // machine.h), so we must too
+  for (unsigned group = 0; group < FieldLayoutGroupCount; ++group) {
+    for (Object* p = members.first; p; p = cdr(p)) {
+      if (fieldLayoutGroup(car(p)) == group) {
+        layOutMember(type, car(p));
+      }
     }
   }
 
@@ -1142,10 +1215,11 @@ writeOffset(Output* out, Object* offset, bool allocationStyle = false)
       } break;
 
       case Object::Array: {
-        out->write("pad((");
         if (allocationStyle) {
+          out->write("padWord((");
           out->write("length");
         } else {
+          out->write("pad((");
           out->write(typeName(memberOwner(o)));
           out->write("Length");
           out->write("(o)");
@@ -1414,34 +1488,38 @@ obfuscate(const char* s)
 void
 writeConstructorParameters(Output* out, Object* t)
 {
-  for (MemberIterator it(t); it.hasMore();) {
-    Object* m = it.next();
-    switch (m->type) {
-    case Object::Scalar: {
-      out->write(", ");
-      out->write(memberTypeName(m));
-      out->write(" ");
-      out->write(obfuscate(memberName(m)));
-    } break;
-            
-    default: break;
-    }    
+  for (Object* types = derivationChain(t); types; types = cdr(types)) {
+    for (Object* p = typeDeclaredMembers(car(types)); p; p = cdr(p)) {
+      Object* m = car(p);
+      switch (m->type) {
+      case Object::Scalar: {
+        out->write(", ");
+        out->write(memberTypeName(m));
+        out->write(" ");
+        out->write(obfuscate(memberName(m)));
+      } break;
+
+      default: break;
+      }
+    }
   }
 }
 
 void
 writeConstructorArguments(Output* out, Object* t)
 {
-  for (MemberIterator it(t); it.hasMore();) {
-    Object* m = it.next();
-    switch (m->type) {
-    case Object::Scalar: {
-      out->write(", ");
-      out->write(obfuscate(memberName(m)));
-    } break;
-            
-    default: break;
-    }    
+  for (Object* types = derivationChain(t); types; types = cdr(types)) {
+    for (Object* p = typeDeclaredMembers(car(types)); p; p = cdr(p)) {
+      Object* m = car(p);
+      switch (m->type) {
+      case Object::Scalar: {
+        out->write(", ");
+        out->write(obfuscate(memberName(m)));
+      } break;
+
+      default: break;
+      }
+    }
   }
 }
 
@@ -1536,6 +1614,35 @@ writeInitializers(Output* out, Object* declarations)
   }
 }
 
+void
+writeArraySizeCheck(Output* out, Object* offset)
+{
+  Object* array = 0;
+  unsigned fixedSize = 0;
+  for (Object* p = offset; p; p = cdr(p)) {
+    Object* o = car(p);
+    switch (o->type) {
+    case Object::Number:
+      fixedSize += number(o);
+      break;
+
+    case Object::Array:
+      array = o;
+      break;
+
+    default: UNREACHABLE;
+    }
+  }
+
+  if (array) {
+    out->write("  checkArraySize(t, length, ");
+    out->write(arrayElementSize(array));
+    out->write(", ");
+    out->write(fixedSize);
+    out->write(");\n");
+  }
+}
+
 void
 writeConstructors(Output* out, Object* declarations)
 {
@@ -1571,6 +1678,8 @@ writeConstructors(Output* out, Object* declarations)
         }
       }
 
+      writeArraySizeCheck(out, typeOffset(o));
+
       out->write("  object o = allocate(t, ");
       writeOffset(out, typeOffset(o), true);
       if (hasObjectMask) {
@@ -16,6 +16,7 @@
 #ifdef __APPLE__
 #  include "CoreFoundation/CoreFoundation.h"
 #  include "sys/ucontext.h"
+#  include "mach/mach_time.h"
 #  undef assert
 #elif defined(__ANDROID__)
 #  include <asm/sigcontext.h>       /* for sigcontext */
@@ -141,6 +142,22 @@ pathOfExecutable(System* s, const char** retBuf, unsigned* size)
 
 const bool Verbose = false;
 
+void
+initCondition(pthread_cond_t* condition)
+{
+#ifdef __APPLE__
+  pthread_cond_init(condition, 0);
+#else
+  // time out against the same clock as System::nanoTime, so that
+  // timed waits aren't affected by changes to the wall clock
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(condition, &attributes);
+  pthread_condattr_destroy(&attributes);
+#endif
+}
+
 const unsigned Notified = 1 << 0;
 
 class MySystem: public System {
@@ -154,7 +171,7 @@ class MySystem: public System {
       flags(0)
     {
       pthread_mutex_init(&mutex, 0);
-      pthread_cond_init(&condition, 0);
+      initCondition(&condition);
     }
 
     virtual void interrupt() {
@@ -322,16 +339,19 @@ class MySystem: public System {
 #endif
     }
 
-    virtual void wait(System::Thread* context, int64_t time) {
-      wait(context, time, false);
+    virtual void wait(System::Thread* context, int64_t nanoseconds) {
+      wait(context, nanoseconds, false);
     }
 
-    virtual bool waitAndClearInterrupted(System::Thread* context, int64_t time)
+    virtual bool waitAndClearInterrupted(System::Thread* context,
+                                         int64_t nanoseconds)
     {
-      return wait(context, time, true);
+      return wait(context, nanoseconds, true);
     }
 
-    bool wait(System::Thread* context, int64_t time, bool clearInterrupted) {
+    bool wait(System::Thread* context, int64_t nanoseconds,
+              bool clearInterrupted)
+    {
       Thread* t = static_cast<Thread*>(context);
 
       if (owner_ == t) {
@@ -357,14 +377,31 @@ class MySystem: public System {
           pthread_mutex_unlock(&mutex);
 
           if (not interrupted) {
-            // pretend anything greater than one million years (in
-            // milliseconds) is infinity so as to avoid overflow:
-            if (time and time < INT64_C(31536000000000000)) {
-              int64_t then = s->now() + time;
-              timespec ts = { static_cast<long>(then / 1000),
-                              static_cast<long>((then % 1000) * 1000 * 1000) };
+            // pretend anything greater than one hundred years (in
+            // nanoseconds) is infinity so as to avoid overflow, and
+            // anything negative has already expired, since it would
+            // make an invalid timespec:
+            if (nanoseconds < 0) {
+              // don't wait at all
+            } else if (nanoseconds
+                       and nanoseconds < INT64_C(3153600000000000000))
+            {
+#ifdef __APPLE__
+              // Mac OS has no pthread_condattr_setclock, but it can
+              // wait for a relative time, which is just as good:
+              timespec ts = { static_cast<long>
+                              (nanoseconds / (1000 * 1000 * 1000)),
+                              static_cast<long>
+                              (nanoseconds % (1000 * 1000 * 1000)) };
+              int rv UNUSED = pthread_cond_timedwait_relative_np
+                (&(t->condition), &(t->mutex), &ts);
+#else
+              int64_t then = s->nanoTime() + nanoseconds;
+              timespec ts = { static_cast<long>(then / (1000 * 1000 * 1000)),
+                              static_cast<long>(then % (1000 * 1000 * 1000)) };
               int rv UNUSED = pthread_cond_timedwait
                 (&(t->condition), &(t->mutex), &ts);
+#endif
               expect(s, rv == 0 or rv == ETIMEDOUT or rv == EINTR);
             } else {
               int rv UNUSED = pthread_cond_wait(&(t->condition), &(t->mutex));
@@ -634,7 +671,7 @@ class MySystem: public System {
     }
   }
 
-  virtual void* tryAllocate(unsigned sizeInBytes) {
+  virtual void* tryAllocate(uintptr_t sizeInBytes) {
     return malloc(sizeInBytes);
   }
 
@@ -642,6 +679,22 @@ class MySystem: public System {
     if (p) ::free(const_cast<void*>(p));
   }
 
+  virtual void* tryAllocatePages(uintptr_t sizeInBytes) {
+    void* p = mmap(0, sizeInBytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANON, -1, 0);
+
+    return p == MAP_FAILED ? 0 : p;
+  }
+
+  virtual void discardPages(void* p, uintptr_t sizeInBytes) {
+    // the pages stay mapped, but the kernel is free to reclaim them
+    madvise(p, sizeInBytes, MADV_DONTNEED);
+  }
+
+  virtual void freePages(const void* p, uintptr_t sizeInBytes) {
+    munmap(const_cast<void*>(p), sizeInBytes);
+  }
+
   virtual void* tryAllocateExecutable(unsigned sizeInBytes) {
 #ifdef MAP_32BIT
     // map to the lower 32 bits of memory when possible so as to avoid
@@ -922,6 +975,22 @@ class MySystem: public System {
       (static_cast<int64_t>(tv.tv_usec) / 1000);
   }
 
+  virtual int64_t nanoTime() {
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase = { 0, 0 };
+    if (timebase.denom == 0) {
+      mach_timebase_info(&timebase);
+    }
+
+    return (mach_absolute_time() * timebase.numer) / timebase.denom;
+#else
+    timespec ts = { 0, 0 };
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000)
+      + ts.tv_nsec;
+#endif
+  }
+
   virtual void yield() {
     sched_yield();
   }
@@ -327,16 +327,19 @@ class MySystem: public System {
 #endif
     }
 
-    virtual void wait(System::Thread* context, int64_t time) {
-      wait(context, time, false);
+    virtual void wait(System::Thread* context, int64_t nanoseconds) {
+      wait(context, nanoseconds, false);
     }
 
-    virtual bool waitAndClearInterrupted(System::Thread* context, int64_t time)
+    virtual bool waitAndClearInterrupted(System::Thread* context,
+                                         int64_t nanoseconds)
     {
-      return wait(context, time, true);
+      return wait(context, nanoseconds, true);
     }
 
-    bool wait(System::Thread* context, int64_t time, bool clearInterrupted) {
+    bool wait(System::Thread* context, int64_t nanoseconds,
+              bool clearInterrupted)
+    {
       Thread* t = static_cast<Thread*>(context);
       assert(s, t);
 
@@ -375,7 +378,20 @@ class MySystem: public System {
             success = ReleaseMutex(t->mutex);
             assert(s, success);
 
-            r = WaitForSingleObject(t->event, (time ? time : INFINITE));
+            // WaitForSingleObject takes milliseconds, so round up
+            // rather than waiting for less time than requested:
+            DWORD milliseconds = INFINITE;
+            if (nanoseconds < 0) {
+              milliseconds = 0;
+            } else if (nanoseconds) {
+              int64_t m = (nanoseconds / (1000 * 1000))
+                + (nanoseconds % (1000 * 1000) ? 1 : 0);
+              if (m < INFINITE) {
+                milliseconds = m;
+              }
+            }
+
+            r = WaitForSingleObject(t->event, milliseconds);
             assert(s, r == WAIT_OBJECT_0 or r == WAIT_TIMEOUT);
 
             r = WaitForSingleObject(t->mutex, INFINITE);
@@ -688,7 +704,7 @@ class MySystem: public System {
     }
   }
 
-  virtual void* tryAllocate(unsigned sizeInBytes) {
+  virtual void* tryAllocate(uintptr_t sizeInBytes) {
     return malloc(sizeInBytes);
   }
 
@@ -696,6 +712,35 @@ class MySystem: public System {
     if (p) ::free(const_cast<void*>(p));
   }
 
+#if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+  virtual void* tryAllocatePages(uintptr_t sizeInBytes) {
+    return VirtualAlloc(0, sizeInBytes, MEM_COMMIT | MEM_RESERVE,
+                        PAGE_READWRITE);
+  }
+
+  virtual void discardPages(void* p, uintptr_t sizeInBytes) {
+    // the pages stay committed, but the system is free to reclaim them
+    VirtualAlloc(p, sizeInBytes, MEM_RESET, PAGE_READWRITE);
+  }
+
+  virtual void freePages(const void* p, uintptr_t) {
+    int r UNUSED = VirtualFree(const_cast<void*>(p), 0, MEM_RELEASE);
+    assert(this, r);
+  }
+#else
+  virtual void* tryAllocatePages(uintptr_t sizeInBytes) {
+    return malloc(sizeInBytes);
+  }
+
+  virtual void discardPages(void*, uintptr_t) {
+    // not supported
+  }
+
+  virtual void freePages(const void* p, uintptr_t) {
+    ::free(const_cast<void*>(p));
+  }
+#endif
+
   #if !defined(AVIAN_AOT_ONLY)
   virtual void* tryAllocateExecutable(unsigned sizeInBytes) {
     return VirtualAlloc
@@ -995,6 +1040,19 @@ class MySystem: public System {
              | time.dwLowDateTime) / 10000) - 11644473600000LL;
   }
 
+  virtual int64_t nanoTime() {
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    // split the conversion to avoid overflowing 64 bits:
+    int64_t seconds = counter.QuadPart / frequency.QuadPart;
+    int64_t remainder = counter.QuadPart % frequency.QuadPart;
+    return (seconds * 1000 * 1000 * 1000)
+      + ((remainder * 1000 * 1000 * 1000) / frequency.QuadPart);
+  }
+
   virtual void yield() {
 #if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
     SwitchToThread();
@@ -94,5 +94,54 @@ public class Arrays {
       java.util.Arrays.hashCode(a);
       java.util.Arrays.hashCode((Object[])null);
     }
+
+    { byte[] a = new byte[100];
+      byte[] b = new byte[100];
+      java.util.Arrays.fill(a, (byte) 7);
+      expect(! java.util.Arrays.equals(a, b));
+      java.util.Arrays.fill(b, (byte) 7);
+      expect(java.util.Arrays.equals(a, b));
+      b[99] = 8;
+      expect(! java.util.Arrays.equals(a, b));
+      expect(! java.util.Arrays.equals(a, new byte[99]));
+      expect(! java.util.Arrays.equals(a, null));
+      expect(java.util.Arrays.equals((byte[]) null, (byte[]) null));
+
+      int[] c = new int[33];
+      int[] d = new int[33];
+      java.util.Arrays.fill(c, -1);
+      System.arraycopy(c, 1, d, 0, 32);
+      expect(d[31] == -1 && d[32] == 0);
+      d[32] = -1;
+      expect(java.util.Arrays.equals(c, d));
+
+      char[] e = "overlapping".toCharArray();
+      System.arraycopy(e, 0, e, 4, 7);
+      expect(new String(e).equals("overoverlap"));
+
+      boolean threw = false;
+      try {
+        System.arraycopy(c, 30, d, 0, 4);
+      } catch (IndexOutOfBoundsException x) {
+        threw = true;
+      }
+      expect(threw);
+
+      threw = false;
+      try {
+        System.arraycopy(c, 0, e, 0, 1);
+      } catch (ArrayStoreException x) {
+        threw = true;
+      }
+      expect(threw);
+
+      threw = false;
+      try {
+        java.util.Arrays.fill((char[]) null, 'x');
+      } catch (NullPointerException x) {
+        threw = true;
+      }
+      expect(threw);
+    }
   }
 }
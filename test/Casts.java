@@ -0,0 +1,183 @@
+public class Casts {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private interface Shape { }
+
+  private interface Round extends Shape { }
+
+  private static class A { }
+  private static class B extends A implements Round { }
+  private static class C extends B { }
+  private static final class F extends C { }
+
+  // deeper than the primary supers display can record
+  private static class D1 extends C { }
+  private static class D2 extends D1 { }
+  private static class D3 extends D2 { }
+  private static class D4 extends D3 { }
+  private static class D5 extends D4 { }
+  private static class D6 extends D5 { }
+  private static class D7 extends D6 { }
+  private static class D8 extends D7 { }
+  private static class D9 extends D8 { }
+
+  private static boolean isA(Object o) {
+    return o instanceof A;
+  }
+
+  private static boolean isC(Object o) {
+    return o instanceof C;
+  }
+
+  private static boolean isF(Object o) {
+    return o instanceof F;
+  }
+
+  private static boolean isShape(Object o) {
+    return o instanceof Shape;
+  }
+
+  private static boolean isRound(Object o) {
+    return o instanceof Round;
+  }
+
+  private static boolean isD8(Object o) {
+    return o instanceof D8;
+  }
+
+  private static boolean isStrings(Object o) {
+    return o instanceof String[];
+  }
+
+  private static boolean isObjects(Object o) {
+    return o instanceof Object[];
+  }
+
+  private static int pick(int a, boolean b, int c) {
+    return b ? a : c;
+  }
+
+  private static boolean castFails(Object o, Class c) {
+    try {
+      c.cast(o);
+      return false;
+    } catch (ClassCastException e) {
+      return true;
+    }
+  }
+
+  private static boolean castToCFails(Object o) {
+    try {
+      C c = (C) o;
+      return false;
+    } catch (ClassCastException e) {
+      return true;
+    }
+  }
+
+  private static boolean castToRoundFails(Object o) {
+    try {
+      Round r = (Round) o;
+      return false;
+    } catch (ClassCastException e) {
+      return true;
+    }
+  }
+
+  private static boolean castToD8Fails(Object o) {
+    try {
+      D8 d = (D8) o;
+      return false;
+    } catch (ClassCastException e) {
+      return true;
+    }
+  }
+
+  public static void main(String[] args) {
+    Object a = new A();
+    Object b = new B();
+    Object c = new C();
+    Object f = new F();
+    Object d7 = new D7();
+    Object d9 = new D9();
+    Object s = "foo";
+    Object strings = new String[1];
+    Object objects = new Object[1];
+
+    // run each check more than once so that the secondary super cache
+    // gets both missed and hit
+    for (int i = 0; i < 3; ++i) {
+      expect(! isA(null));
+      expect(isA(a));
+      expect(isA(b));
+      expect(isA(f));
+      expect(isA(d9));
+      expect(! isA(s));
+      expect(! isA(strings));
+
+      expect(! isC(a));
+      expect(! isC(b));
+      expect(isC(c));
+      expect(isC(f));
+      expect(isC(d9));
+
+      expect(! isF(null));
+      expect(! isF(c));
+      expect(isF(f));
+
+      expect(! isShape(null));
+      expect(! isShape(a));
+      expect(isShape(b));
+      expect(isShape(d9));
+      expect(! isShape(s));
+      expect(isRound(f));
+      expect(! isRound(s));
+
+      expect(! isD8(null));
+      expect(! isD8(c));
+      expect(! isD8(d7));
+      expect(isD8(d9));
+
+      expect(isStrings(strings));
+      expect(! isStrings(objects));
+      expect(isObjects(strings));
+      expect(isObjects(objects));
+      expect(! isObjects(s));
+
+      expect(pick(1, isC(f), 2) == 1);
+      expect(pick(1, isC(a), 2) == 2);
+
+      expect(! castToCFails(null));
+      expect(! castToCFails(c));
+      expect(! castToCFails(d9));
+      expect(castToCFails(b));
+      expect(castToCFails(s));
+
+      expect(! castToRoundFails(b));
+      expect(! castToRoundFails(d9));
+      expect(castToRoundFails(a));
+
+      expect(! castToD8Fails(d9));
+      expect(castToD8Fails(d7));
+      expect(castToD8Fails(a));
+    }
+
+    String[] array = (String[]) (Object) new String[] { "bar" };
+    expect(array[0].equals("bar"));
+
+    expect(castFails(objects, String[].class));
+    expect(! castFails(strings, Object[].class));
+
+    expect(A.class.isAssignableFrom(D9.class));
+    expect(! D9.class.isAssignableFrom(A.class));
+    expect(Shape.class.isAssignableFrom(D9.class));
+    expect(Object.class.isAssignableFrom(Shape.class));
+    expect(! Shape.class.isAssignableFrom(Object.class));
+    expect(! Object.class.isAssignableFrom(int.class));
+    expect(! int.class.isAssignableFrom(Integer.class));
+    expect(Object[].class.isAssignableFrom(String[].class));
+    expect(Object.class.isInstance(strings));
+  }
+}
@@ -0,0 +1,316 @@
+import java.io.ByteArrayOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.util.zip.CRC32;
+
+public class ClassArchive {
+  private static final String[] Classes = {
+    "ClassArchive$Child",
+    "ClassArchive$Shape",
+    "ClassArchive$Square",
+    "ClassArchive$Rectangle",
+    "ClassArchive$Greeting"
+  };
+
+  private static final String Expected = "hello, archive 19 1 rectangle";
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  // the classes below are run from a jar in a separate VM
+  public static class Child {
+    public static void main(String[] args) {
+      Shape[] shapes = { new Square(3), new Rectangle(2, 5) };
+      int area = 0;
+      for (int i = 0; i < shapes.length; ++i) {
+        area += shapes[i].area();
+      }
+      System.out.println(Greeting.greet("archive") + " " + area + " "
+                         + Rectangle.count + " " + shapes[1].name());
+    }
+  }
+
+  public interface Shape {
+    public int area();
+
+    public String name();
+  }
+
+  public static class Square implements Shape {
+    private final int side;
+
+    public Square(int side) {
+      this.side = side;
+    }
+
+    public int side() {
+      return side;
+    }
+
+    public int area() {
+      return side * side;
+    }
+
+    public String name() {
+      return "square";
+    }
+  }
+
+  public static class Rectangle extends Square {
+    public static int count;
+
+    static {
+      count = 0;
+    }
+
+    private final int height;
+
+    public Rectangle(int width, int height) {
+      super(width);
+      this.height = height;
+      ++ count;
+    }
+
+    public int area() {
+      return side() * height;
+    }
+
+    public String name() {
+      return "rectangle";
+    }
+  }
+
+  public static class Greeting {
+    public static String greet(String name) {
+      return "hello, " + name;
+    }
+  }
+
+  private static byte[] read(InputStream in) throws IOException {
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    byte[] buffer = new byte[4096];
+    int c;
+    while ((c = in.read(buffer)) != -1) {
+      out.write(buffer, 0, c);
+    }
+    return out.toByteArray();
+  }
+
+  private static byte[] read(File file) throws IOException {
+    InputStream in = new FileInputStream(file);
+    try {
+      return read(in);
+    } finally {
+      in.close();
+    }
+  }
+
+  private static void write(File file, byte[] data, int length)
+    throws IOException
+  {
+    FileOutputStream out = new FileOutputStream(file);
+    try {
+      out.write(data, 0, length);
+    } finally {
+      out.close();
+    }
+  }
+
+  private static boolean equal(byte[] a, byte[] b) {
+    if (a.length != b.length) return false;
+    for (int i = 0; i < a.length; ++i) {
+      if (a[i] != b[i]) return false;
+    }
+    return true;
+  }
+
+  private static void write2(ByteArrayOutputStream out, int v) {
+    out.write(v);
+    out.write(v >>> 8);
+  }
+
+  private static void write4(ByteArrayOutputStream out, int v) {
+    write2(out, v);
+    write2(out, v >>> 16);
+  }
+
+  private static void writeHeader(ByteArrayOutputStream out, byte[] name,
+                                  byte[] data, int crc)
+  {
+    write2(out, 10); // version needed
+    write2(out, 0); // flags
+    write2(out, 0); // stored
+    write4(out, 0); // time and date
+    write4(out, crc);
+    write4(out, data.length);
+    write4(out, data.length);
+    write2(out, name.length);
+  }
+
+  // writes an uncompressed jar, returning the offset of each entry's
+  // data so the caller can corrupt it without touching the central
+  // directory
+  private static int[] writeJar(File file, String[] names, byte[][] data)
+    throws IOException
+  {
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    ByteArrayOutputStream directory = new ByteArrayOutputStream();
+    int[] offsets = new int[names.length];
+
+    for (int i = 0; i < names.length; ++i) {
+      byte[] name = names[i].getBytes();
+      CRC32 crc = new CRC32();
+      crc.update(data[i]);
+      int value = (int) crc.getValue();
+      int offset = out.size();
+
+      write4(out, 0x04034b50);
+      writeHeader(out, name, data[i], value);
+      write2(out, 0); // extra length
+      out.write(name, 0, name.length);
+      offsets[i] = out.size();
+      out.write(data[i], 0, data[i].length);
+
+      write4(directory, 0x02014b50);
+      write2(directory, 20); // version made by
+      writeHeader(directory, name, data[i], value);
+      write2(directory, 0); // extra length
+      write2(directory, 0); // comment length
+      write2(directory, 0); // disk number
+      write2(directory, 0); // internal attributes
+      write4(directory, 0); // external attributes
+      write4(directory, offset);
+      directory.write(name, 0, name.length);
+    }
+
+    int directoryOffset = out.size();
+    byte[] d = directory.toByteArray();
+    out.write(d, 0, d.length);
+
+    write4(out, 0x06054b50);
+    write2(out, 0); // disk number
+    write2(out, 0); // directory disk number
+    write2(out, names.length);
+    write2(out, names.length);
+    write4(out, d.length);
+    write4(out, directoryOffset);
+    write2(out, 0); // comment length
+
+    byte[] jar = out.toByteArray();
+    write(file, jar, jar.length);
+
+    return offsets;
+  }
+
+  // zeroes the data of each class file in a jar written by writeJar,
+  // leaving its size and central directory unchanged so that the
+  // archive still matches it
+  private static void corrupt(File jar, int[] offsets, byte[][] data)
+    throws IOException
+  {
+    byte[] jarData = read(jar);
+    for (int i = 0; i < Classes.length; ++i) {
+      for (int j = 0; j < data[i].length; ++j) {
+        jarData[offsets[i] + j] = 0;
+      }
+    }
+    write(jar, jarData, jarData.length);
+  }
+
+  private static String run(String vm, File jar, File archive)
+    throws Exception
+  {
+    Process p = Runtime.getRuntime().exec
+      (new String[] { vm, "-Davian.class.archive=" + archive.getPath(),
+                      "-cp", jar.getPath(), "ClassArchive$Child" });
+
+    String output = new String(read(p.getInputStream())).trim();
+    expect(p.waitFor() == 0);
+    return output;
+  }
+
+  public static void main(String[] args) throws Exception {
+    String vm = System.getProperty("avian.test.vm");
+    if (vm == null) {
+      // we need to start more VMs to test the archive, which only the
+      // test script tells us how to do
+      return;
+    }
+
+    File directory = new File(System.getProperty("java.class.path"));
+    String[] names = new String[Classes.length + 1];
+    byte[][] data = new byte[names.length][];
+    for (int i = 0; i < Classes.length; ++i) {
+      names[i] = Classes[i] + ".class";
+      data[i] = read(new File(directory, names[i]));
+    }
+    names[Classes.length] = "changed.txt";
+    data[Classes.length] = "changed".getBytes();
+
+    String[] classNames = new String[Classes.length];
+    System.arraycopy(names, 0, classNames, 0, Classes.length);
+
+    File jar = File.createTempFile("archive", ".jar");
+    File archive = File.createTempFile("archive", ".bin");
+    try {
+      archive.delete();
+
+      // the first run writes the archive
+      int[] offsets = writeJar(jar, classNames, data);
+      expect(run(vm, jar, archive).equals(Expected));
+      byte[] original = read(archive);
+      expect(original.length > 0);
+
+      // the second run must install every class from the archive,
+      // since their class files are no longer valid
+      corrupt(jar, offsets, data);
+      expect(run(vm, jar, archive).equals(Expected));
+      expect(equal(read(archive), original));
+
+      // an archive written for a different jar is ignored and replaced
+      offsets = writeJar(jar, names, data);
+      expect(run(vm, jar, archive).equals(Expected));
+      byte[] rewritten = read(archive);
+      expect(rewritten.length > 0);
+      expect(! equal(rewritten, original));
+
+      // a truncated archive is ignored and replaced
+      int truncated = rewritten.length / 2;
+      write(archive, rewritten, truncated);
+      expect(run(vm, jar, archive).equals(Expected));
+      rewritten = read(archive);
+      expect(rewritten.length > truncated);
+
+      // a record which fails its checksum is ignored in favor of the
+      // class file, and the rest of the archive is still used
+      byte[] corrupt = new byte[rewritten.length];
+      System.arraycopy(rewritten, 0, corrupt, 0, corrupt.length);
+      for (int i = corrupt.length - 64; i < corrupt.length; ++i) {
+        corrupt[i] = (byte) ~corrupt[i];
+      }
+      write(archive, corrupt, corrupt.length);
+      expect(run(vm, jar, archive).equals(Expected));
+      expect(equal(read(archive), corrupt));
+
+      // an archive of garbage is ignored and replaced, and the
+      // replacement is used by the next run
+      for (int i = 0; i < corrupt.length; ++i) {
+        corrupt[i] = (byte) (i * 31);
+      }
+      write(archive, corrupt, corrupt.length);
+      expect(run(vm, jar, archive).equals(Expected));
+      expect(! equal(read(archive), corrupt));
+
+      corrupt(jar, offsets, data);
+      expect(run(vm, jar, archive).equals(Expected));
+    } finally {
+      jar.delete();
+      archive.delete();
+      new File(archive.getPath() + ".tmp").delete();
+    }
+  }
+}
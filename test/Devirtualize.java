@@ -0,0 +1,100 @@
+public class Devirtualize {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Base {
+    public int value() {
+      return 1;
+    }
+
+    public void nothing() { }
+  }
+
+  // only loaded by name, so that it can't be loaded as a side effect
+  // of compiling the call sites below
+  static class Sub extends Base {
+    public int value() {
+      return 2;
+    }
+
+    public void nothing() {
+      throw new IllegalStateException();
+    }
+  }
+
+  private static final class Leaf {
+    public int value() {
+      return 3;
+    }
+
+    public void nothing() { }
+  }
+
+  private static int callValue(Base b) {
+    return b.value();
+  }
+
+  private static void callNothing(Base b) {
+    b.nothing();
+  }
+
+  private static int callValue(Leaf l) {
+    return l.value();
+  }
+
+  private static void callNothing(Leaf l) {
+    l.nothing();
+  }
+
+  private static boolean throwsNullPointer(Base b) {
+    try {
+      callNothing(b);
+      return false;
+    } catch (NullPointerException e) {
+      return true;
+    }
+  }
+
+  private static boolean throwsNullPointer(Leaf l) {
+    try {
+      callNothing(l);
+      return false;
+    } catch (NullPointerException e) {
+      return true;
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    Base base = new Base();
+    for (int i = 0; i < 100; ++i) {
+      expect(callValue(base) == 1);
+      callNothing(base);
+    }
+
+    expect(throwsNullPointer((Base) null));
+
+    Leaf leaf = new Leaf();
+    expect(callValue(leaf) == 3);
+    callNothing(leaf);
+    expect(throwsNullPointer((Leaf) null));
+
+    // loading an overriding class must redirect the call sites
+    // compiled above
+    Base sub = (Base) Class.forName("Devirtualize$Sub").newInstance();
+
+    expect(callValue(sub) == 2);
+    expect(callValue(base) == 1);
+
+    boolean threw = false;
+    try {
+      callNothing(sub);
+    } catch (IllegalStateException e) {
+      threw = true;
+    }
+    expect(threw);
+
+    callNothing(base);
+    expect(throwsNullPointer((Base) null));
+  }
+}
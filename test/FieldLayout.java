@@ -0,0 +1,89 @@
+import java.lang.reflect.Field;
+
+public class FieldLayout {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  // fields deliberately declared in an order which would need padding
+  // if laid out as written
+  private static class Base {
+    byte b1;
+    long l1;
+    Object o1;
+    short s1;
+    int i1;
+    byte b2;
+    double d1;
+    char c1;
+  }
+
+  private static class Derived extends Base {
+    boolean z1;
+    Object o2;
+    float f1;
+    long l2;
+    byte b3;
+  }
+
+  public static void main(String[] args) throws Exception {
+    Derived d = new Derived();
+    Object o = new Object();
+
+    d.b1 = 1;
+    d.l1 = 0x0102030405060708L;
+    d.o1 = o;
+    d.s1 = 3;
+    d.i1 = 4;
+    d.b2 = 5;
+    d.d1 = 6.5;
+    d.c1 = 'x';
+    d.z1 = true;
+    d.o2 = d;
+    d.f1 = 7.5f;
+    d.l2 = -8;
+    d.b3 = 9;
+
+    System.gc();
+
+    expect(d.b1 == 1);
+    expect(d.l1 == 0x0102030405060708L);
+    expect(d.o1 == o);
+    expect(d.s1 == 3);
+    expect(d.i1 == 4);
+    expect(d.b2 == 5);
+    expect(d.d1 == 6.5);
+    expect(d.c1 == 'x');
+    expect(d.z1);
+    expect(d.o2 == d);
+    expect(d.f1 == 7.5f);
+    expect(d.l2 == -8);
+    expect(d.b3 == 9);
+
+    // reflection must agree with compiled code about where each field is
+    Field f = Base.class.getDeclaredField("l1");
+    f.set(d, Long.valueOf(42));
+    expect(d.l1 == 42);
+    expect(f.getLong(d) == 42);
+
+    f = Base.class.getDeclaredField("d1");
+    expect(f.getDouble(d) == 6.5);
+
+    f = Base.class.getDeclaredField("c1");
+    expect(f.getChar(d) == 'x');
+
+    f = Derived.class.getDeclaredField("o2");
+    expect(f.get(d) == d);
+    f.set(d, o);
+    expect(d.o2 == o);
+
+    f = Derived.class.getDeclaredField("b3");
+    expect(f.getByte(d) == 9);
+
+    // declaration order is still what reflection reports
+    Field[] fields = Base.class.getDeclaredFields();
+    expect(fields.length == 8);
+    expect(fields[0].getName().equals("b1"));
+    expect(fields[7].getName().equals("c1"));
+  }
+}
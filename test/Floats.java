@@ -204,6 +204,30 @@ public class Floats {
     expect(Math.round(0.5d) == 1);
     expect(Math.round(1.0d) == 1);
     expect(Math.round(1.9d) == 2);
+    expect(Math.round(-0.5d) == 0);
+    expect(Math.round(2.5d) == 3);
+    expect(Math.round(-2.5f) == -2);
+    expect(Math.round(Double.NaN) == 0);
+    expect(Math.round(Float.NaN) == 0);
+
+    expect(Math.floor(-1.5) == -2.0);
+    expect(Math.ceil(-1.5) == -1.0);
+    expect(Math.rint(2.5) == 2.0);
+    expect(Math.rint(3.5) == 4.0);
+    expect(Double.doubleToRawLongBits(Math.ceil(-0.5))
+           == Double.doubleToRawLongBits(-0.0));
+    expect(Double.isNaN(Math.floor(Double.NaN)));
+
+    expect(Math.sin(0.0) == 0.0);
+    expect(Math.cos(0.0) == 1.0);
+    expect(Math.abs(Math.atan(1.0) * 4 - Math.PI) < 1e-12);
+    expect(Math.abs(Math.exp(Math.log(7.0)) - 7.0) < 1e-12);
+    expect(Math.pow(2.0, 10.0) == 1024.0);
+
+    expect(Double.longBitsToDouble(Double.doubleToRawLongBits(-1.25))
+           == -1.25);
+    expect(Float.intBitsToFloat(Float.floatToRawIntBits(-1.25f)) == -1.25f);
+    expect(Float.floatToRawIntBits(1.0f) == 0x3f800000);
 
     { float b = 1.0f;
       int blue = (int)(b * 255 + 0.5);
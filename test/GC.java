@@ -2,6 +2,10 @@ public class GC {
   private static final Integer cache[] = new Integer[100];
   private static final Integer MAX_INT_OBJ = new Integer(Integer.MAX_VALUE);
 
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
   private static Integer valueOf(int i) {
     try {
       return cache[i];
@@ -38,6 +42,36 @@ public class GC {
     }
   }
 
+  private static void mixedLarge() {
+    // large arrays of assorted sizes, some of which share runs in the
+    // large object space and some of which get one to themselves
+    int[] sizes = { 70 * 1024, 100 * 1024, 300 * 1024, 1024 * 1024,
+                    30 * 1024 * 1024 };
+    Object[][] kept = new Object[sizes.length][];
+
+    for (int i = 0; i < 16; ++i) {
+      for (int j = 0; j < sizes.length; ++j) {
+        Object[] a = new Object[sizes[j] / 8];
+        a[0] = new Integer(i);
+        a[a.length - 1] = new Integer(-i);
+
+        if (i % 4 == j % 4) {
+          kept[j] = a;
+        }
+      }
+
+      System.gc();
+    }
+
+    for (int j = 0; j < sizes.length; ++j) {
+      if (kept[j] != null) {
+        int i = ((Integer) kept[j][0]).intValue();
+        expect(i % 4 == j % 4);
+        expect(((Integer) kept[j][kept[j].length - 1]).intValue() == -i);
+      }
+    }
+  }
+
   private static void stackMap1(boolean predicate) {
     if (predicate) {
       Object a = null;
@@ -154,6 +188,147 @@ public class GC {
     }
   }
 
+  // allocates enough garbage to force several minor collections, so
+  // that whatever is reachable ends up in gen2
+  private static void tenure() {
+    for (int i = 0; i < 128 * 1024; ++i) {
+      byte[] garbage = new byte[256];
+    }
+  }
+
+  private static byte[] pattern(int seed, int length) {
+    byte[] array = new byte[length];
+    for (int i = 0; i < length; ++i) {
+      array[i] = (byte) (seed + i);
+    }
+    return array;
+  }
+
+  private static void expectPattern(byte[] array, int seed, int length) {
+    expect(array.length == length);
+    for (int i = 0; i < length; ++i) {
+      expect(array[i] == (byte) (seed + i));
+    }
+  }
+
+  private static void compactHashed(int stride) {
+    // objects whose identity hashes have been taken grow by a word
+    // when they move, which they must do without overwriting the
+    // objects after them
+    Object[] objects = new Object[4096];
+    for (int i = 0; i < objects.length; ++i) {
+      objects[i] = new Integer(i);
+    }
+
+    tenure();
+
+    int[] hashes = new int[objects.length];
+    for (int i = 0; i < objects.length; ++i) {
+      hashes[i] = System.identityHashCode(objects[i]);
+    }
+
+    // leave holes for the survivors to slide into
+    for (int i = 0; i < objects.length; i += stride) {
+      objects[i] = null;
+    }
+
+    for (int j = 0; j < 2; ++j) {
+      System.gc();
+
+      for (int i = 0; i < objects.length; ++i) {
+        if (objects[i] != null) {
+          expect(((Integer) objects[i]).intValue() == i);
+          expect(System.identityHashCode(objects[i]) == hashes[i]);
+        }
+      }
+    }
+  }
+
+  private static class Holder {
+    public Object[] fixed;
+    public byte[] data;
+  }
+
+  private static void compactFixed() {
+    // objects larger than a thread's allocation buffer are fixed, so
+    // they stay put while the gen2 objects they refer to move, and
+    // vice versa
+    Object[] fixed = new Object[32 * 1024];
+    Holder[] holders = new Holder[32];
+    for (int i = 0; i < fixed.length; ++i) {
+      fixed[i] = pattern(i, 24);
+
+      if (i % 1024 == 0) {
+        Holder h = new Holder();
+        h.fixed = new Object[16 * 1024];
+        h.fixed[0] = fixed[i];
+        h.data = pattern(-i, 100 * 1024);
+        holders[i / 1024] = h;
+      }
+    }
+
+    tenure();
+
+    for (int i = 0; i < fixed.length; i += 2) {
+      fixed[i] = null;
+    }
+
+    for (int j = 0; j < 2; ++j) {
+      System.gc();
+
+      for (int i = 1; i < fixed.length; i += 2) {
+        expectPattern((byte[]) fixed[i], i, 24);
+      }
+
+      for (int i = 0; i < holders.length; ++i) {
+        expectPattern((byte[]) holders[i].fixed[0], i * 1024, 24);
+        expectPattern(holders[i].data, -i * 1024, 100 * 1024);
+      }
+    }
+  }
+
+  private static void checkChunks(Object[][] chunks, int[] hashes,
+                                  int stride)
+  {
+    for (int i = 0; i < chunks.length; i += stride) {
+      expect(System.identityHashCode(chunks[i]) == hashes[i]);
+      for (int j = 0; j < chunks[i].length; ++j) {
+        expectPattern((byte[]) chunks[i][j], i + j, 200);
+      }
+    }
+  }
+
+  private static void resizeGen2() {
+    // keep much more than gen2 initially holds, so that it must move
+    // to a bigger segment, and then drop most of it, so that it moves
+    // to a smaller one
+    Object[][] chunks = new Object[80][];
+    int[] hashes = new int[chunks.length];
+    for (int i = 0; i < chunks.length; ++i) {
+      chunks[i] = new Object[1024];
+      hashes[i] = System.identityHashCode(chunks[i]);
+      for (int j = 0; j < chunks[i].length; ++j) {
+        chunks[i][j] = pattern(i + j, 200);
+      }
+    }
+
+    tenure();
+    System.gc();
+    checkChunks(chunks, hashes, 1);
+
+    for (int i = 0; i < chunks.length; ++i) {
+      if (i % 20 != 0) {
+        chunks[i] = null;
+      }
+    }
+
+    System.gc();
+    checkChunks(chunks, hashes, 20);
+
+    tenure();
+    checkChunks(chunks, hashes, 20);
+  }
+
   public static void main(String[] args) {
     valueOf(1000);
 
@@ -170,6 +345,8 @@ public class GC {
 
     large();
 
+    mixedLarge();
+
     array[0].toString();
     array[1].toString();
     array[2].toString();
@@ -197,6 +374,13 @@ public class GC {
 
     stackMap8(true);
     stackMap8(false);
+
+    compactHashed(2);
+    compactHashed(4096);
+
+    compactFixed();
+
+    resizeGen2();
   }
 
   private static class DummyException extends RuntimeException { }
@@ -0,0 +1,39 @@
+import avian.GCStatistics;
+import avian.Machine;
+
+public class GCTelemetry {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  public static void main(String[] args) {
+    GCStatistics before = Machine.getGCStatistics();
+
+    for (int i = 0; i < 1024; ++i) {
+      byte[] a = new byte[4 * 1024];
+    }
+
+    System.gc();
+
+    GCStatistics after = Machine.getGCStatistics();
+
+    expect(after.majorCollections > before.majorCollections);
+    expect(after.minorCollections >= before.minorCollections);
+    expect(after.totalPauseTime >= before.totalPauseTime);
+    expect(after.maxPauseTime >= after.lastPauseTime);
+    expect(after.footprint > 0);
+    expect(after.footprint <= after.limit);
+
+    long collections = 0;
+    for (int i = 0; i < after.pauseHistogram.length; ++i) {
+      collections += after.pauseHistogram[i];
+    }
+    expect(collections == after.minorCollections + after.majorCollections);
+
+    Runtime r = Runtime.getRuntime();
+    expect(r.totalMemory() > 0);
+    expect(r.maxMemory() > 0);
+    expect(r.freeMemory() >= 0);
+    expect(r.freeMemory() <= r.totalMemory());
+  }
+}
@@ -0,0 +1,185 @@
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+
+public class HeapDump {
+  private static final int Root = 0;
+  private static final int Size = 1;
+  private static final int ClassName = 2;
+  private static final int Push = 3;
+  private static final int Pop = 4;
+
+  private static final int HprofString = 0x01;
+  private static final int HprofHeapDumpSegment = 0x1C;
+  private static final int HprofHeapDumpEnd = 0x2C;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static byte[] read(File file) throws IOException {
+    byte[] data = new byte[(int) file.length()];
+    FileInputStream in = new FileInputStream(file);
+    try {
+      int offset = 0;
+      int c;
+      while (offset < data.length
+             && (c = in.read(data, offset, data.length - offset)) != -1)
+      {
+        offset += c;
+      }
+      expect(offset == data.length);
+    } finally {
+      in.close();
+    }
+    return data;
+  }
+
+  private static int readInt(byte[] data, int offset) {
+    return ((data[offset] & 0xFF) << 24)
+      | ((data[offset + 1] & 0xFF) << 16)
+      | ((data[offset + 2] & 0xFF) << 8)
+      | (data[offset + 3] & 0xFF);
+  }
+
+  private static boolean contains(byte[] data, int start, int end,
+                                  String s)
+  {
+    byte[] b = s.getBytes();
+    for (int i = start; i + b.length <= end; ++i) {
+      int j = 0;
+      while (j < b.length && data[i + j] == b[j]) ++ j;
+      if (j == b.length) return true;
+    }
+    return false;
+  }
+
+  private static boolean dump(File file) {
+    try {
+      avian.Machine.dumpHeap(file.getAbsolutePath());
+      return true;
+    } catch (UnsatisfiedLinkError e) {
+      // the VM was built without heapdump=true
+      return false;
+    }
+  }
+
+  private static void checkHprof(byte[] data) {
+    String magic = "JAVA PROFILE 1.0.2";
+    expect(new String(data, 0, magic.length()).equals(magic));
+    expect(data[magic.length()] == 0);
+
+    int offset = magic.length() + 1;
+    int idSize = readInt(data, offset);
+    expect(idSize == 4 || idSize == 8);
+
+    // skip the ID size and the timestamp
+    offset += 4 + 8;
+
+    // every record is a tag, a timestamp and a body length, and the
+    // lengths must account for the whole file
+    boolean sawSegment = false;
+    boolean sawClassName = false;
+    int tag = -1;
+    while (offset < data.length) {
+      expect(tag != HprofHeapDumpEnd);
+
+      expect(offset + 9 <= data.length);
+      tag = data[offset] & 0xFF;
+      int length = readInt(data, offset + 5);
+      offset += 9;
+      expect(length >= 0 && offset + length <= data.length);
+
+      if (tag == HprofString) {
+        if (contains(data, offset + idSize, offset + length, "HeapDump")) {
+          sawClassName = true;
+        }
+      } else if (tag == HprofHeapDumpSegment) {
+        expect(length > 0);
+        sawSegment = true;
+      } else if (tag == HprofHeapDumpEnd) {
+        expect(length == 0);
+      }
+
+      offset += length;
+    }
+
+    expect(offset == data.length);
+    expect(tag == HprofHeapDumpEnd);
+    expect(sawSegment);
+    expect(sawClassName);
+  }
+
+  private static void checkLegacy(byte[] data) {
+    // the stream starts with the first root and is made entirely of
+    // the flags read by extra.PrintDump
+    expect(data.length > 0);
+    expect(data[0] == Root);
+
+    boolean sawClassName = false;
+    int level = 0;
+    int offset = 0;
+    while (offset < data.length) {
+      int flag = data[offset++];
+      switch (flag) {
+      case Root:
+      case Size:
+        offset += 4;
+        break;
+
+      case ClassName: {
+        int length = readInt(data, offset);
+        offset += 4;
+        if (contains(data, offset, offset + length, "HeapDump")) {
+          sawClassName = true;
+        }
+        offset += length;
+      } break;
+
+      case Push:
+        ++ level;
+        offset += 4;
+        break;
+
+      case Pop:
+        -- level;
+        expect(level >= 0);
+        break;
+
+      default:
+        throw new RuntimeException("bad flag: " + flag);
+      }
+
+      expect(offset <= data.length);
+    }
+
+    expect(level == 0);
+    expect(sawClassName);
+  }
+
+  public static void main(String[] args) throws Exception {
+    File hprof = File.createTempFile("heap", ".hprof");
+    File legacy = File.createTempFile("heap", ".dump");
+    File compressed = File.createTempFile("heap", ".hprof.gz");
+    try {
+      if (! dump(hprof)) {
+        return;
+      }
+      checkHprof(read(hprof));
+
+      expect(dump(legacy));
+      checkLegacy(read(legacy));
+
+      expect(dump(compressed));
+      byte[] data = read(compressed);
+      expect(data.length > 10);
+      expect((data[0] & 0xFF) == 0x1f);
+      expect((data[1] & 0xFF) == 0x8b);
+      expect(data[2] == 8); // deflate
+    } finally {
+      hprof.delete();
+      legacy.delete();
+      compressed.delete();
+    }
+  }
+}
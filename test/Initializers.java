@@ -1,4 +1,8 @@
 public class Initializers {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
   private static class Static2 {
     public static String foo = "Static2.foo";
 
@@ -16,9 +20,48 @@ public class Initializers {
     }
   }
 
+  private static class Counted {
+    public static int initCount;
+    public static int value = 42;
+
+    static {
+      ++ initCount;
+    }
+  }
+
+  // each of these reads the other's field while it is being
+  // initialized, so the first access to either one must not be
+  // treated as having finished initializing it
+  private static class Cycle1 {
+    public static int value = Cycle2.value + 1;
+  }
+
+  private static class Cycle2 {
+    public static int value = Cycle1.value + 1;
+  }
+
+  private static int getValue() {
+    return Counted.value;
+  }
+
+  private static void setValue(int v) {
+    Counted.value = v;
+  }
+
   public static void main(String[] args) {
     Object x = new Object();
     System.out.println(Static1.foo);
     x.toString();
+
+    // the barriers in getValue and setValue must keep working after
+    // they have been patched out
+    for (int i = 0; i < 100; ++i) {
+      expect(getValue() == 42 + i);
+      setValue(getValue() + 1);
+    }
+    expect(Counted.initCount == 1);
+
+    expect(Cycle1.value == 2);
+    expect(Cycle2.value == 1);
   }
 }
@@ -59,6 +59,27 @@ public class JNI {
 
   private static native Object testLocalRef(Object o);
 
+  private static native int addInts(int a1, int a2, int a3, int a4, int a5,
+                                    int a6);
+
+  private static native int addManyInts(int a1, int a2, int a3, int a4, int a5,
+                                        int a6, int a7);
+
+  private static native int widen(byte b, short s, char c, boolean z);
+
+  private static native Object pick(int index, Object a, Object b, Object c);
+
+  private native boolean isSame(Object o);
+
+  private static native boolean collectWhileCritical(byte[] array);
+
+  private static void collect() {
+    for (int i = 0; i < 4; ++i) {
+      byte[] garbage = new byte[1024];
+      System.gc();
+    }
+  }
+
   public static int method242() { return 242; }
   
   public static final int field950 = 950;
@@ -112,5 +133,58 @@ public class JNI {
     { Object o = new Object();
       expect(testLocalRef(o) == o);
     }
+
+    expect(addInts(1, 2, 3, 4, 5, -6) == 9);
+    expect(addManyInts(1, 2, 3, 4, 5, 6, -7) == 14);
+    expect(widen((byte) -1, (short) -2, (char) 0xFFFF, true) == 0xFFFF - 2);
+
+    { Object a = new Object();
+      Object c = new Object();
+      expect(pick(0, a, null, c) == a);
+      expect(pick(1, a, null, c) == null);
+      expect(pick(2, a, null, c) == c);
+    }
+
+    { JNI jni = new JNI();
+      expect(jni.isSame(jni));
+      expect(! jni.isSame(new Object()));
+    }
+
+    // the array must neither move nor block the collection while
+    // native code holds it
+    { byte[] array = new byte[16];
+      expect(collectWhileCritical(array));
+      expect(array[0] == 42);
+
+      System.gc();
+      expect(array[0] == 42);
+    }
+
+    // likewise once the array has been tenured, even though the gen2
+    // objects around it would otherwise be compacted over it
+    { byte[][] arrays = new byte[1024][];
+      for (int i = 0; i < arrays.length; ++i) {
+        arrays[i] = new byte[16];
+        arrays[i][1] = (byte) i;
+      }
+
+      for (int i = 0; i < 128 * 1024; ++i) {
+        byte[] garbage = new byte[256];
+      }
+
+      for (int i = 0; i < arrays.length; i += 2) {
+        arrays[i] = null;
+      }
+
+      byte[] array = arrays[arrays.length / 2 + 1];
+      expect(collectWhileCritical(array));
+      expect(array[0] == 42);
+
+      System.gc();
+      expect(array[0] == 42);
+      for (int i = 1; i < arrays.length; i += 2) {
+        expect(arrays[i][1] == (byte) i);
+      }
+    }
   }
 }
@@ -0,0 +1,122 @@
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+import java.io.IOException;
+import java.io.InputStream;
+
+public class JitProfile {
+  private static final String WorkerEntry = "JitProfile$Worker.work(I)I";
+  private static final String LazyEntry = "JitProfile$Lazy.compute(I)I";
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static boolean contains(File profile, String entry)
+    throws IOException
+  {
+    BufferedReader in = new BufferedReader(new FileReader(profile));
+    try {
+      String line;
+      while ((line = in.readLine()) != null) {
+        if (line.equals(entry)) {
+          return true;
+        }
+      }
+      return false;
+    } finally {
+      in.close();
+    }
+  }
+
+  // the classes below are run in a separate VM
+  public static class Child {
+    public static boolean lazyInitialized;
+
+    public static void main(String[] args) throws Exception {
+      if (args[1].equals("replay")) {
+        File profile = new File(args[0]);
+
+        // the precompiler must compile Worker.work from the previous
+        // run's profile before we ever call it
+        for (int i = 0; i < 100 && ! contains(profile, WorkerEntry); ++i) {
+          Thread.sleep(100);
+        }
+        expect(contains(profile, WorkerEntry));
+
+        // but it must leave Lazy alone, since compiling Lazy.compute
+        // would run Lazy's static initializer early
+        Thread.sleep(500);
+        expect(! lazyInitialized);
+        expect(! contains(profile, LazyEntry));
+      }
+
+      System.out.println(Worker.work(6) + " " + Lazy.compute(7));
+      expect(lazyInitialized);
+    }
+  }
+
+  public static class Worker {
+    public static int work(int n) {
+      int sum = 0;
+      for (int i = 1; i <= n; ++i) {
+        sum += i * i;
+      }
+      return sum;
+    }
+  }
+
+  public static class Lazy {
+    static {
+      Child.lazyInitialized = true;
+    }
+
+    public static int compute(int n) {
+      return n * 3;
+    }
+  }
+
+  private static String run(String vm, File profile, String mode)
+    throws Exception
+  {
+    Process p = Runtime.getRuntime().exec
+      (new String[] { vm, "-Davian.jit.profile=" + profile.getPath(),
+                      "-cp", System.getProperty("java.class.path"),
+                      "JitProfile$Child", profile.getPath(), mode });
+
+    InputStream in = p.getInputStream();
+    StringBuilder sb = new StringBuilder();
+    int c;
+    while ((c = in.read()) != -1) {
+      sb.append((char) c);
+    }
+    expect(p.waitFor() == 0);
+    return sb.toString().trim();
+  }
+
+  public static void main(String[] args) throws Exception {
+    String vm = System.getProperty("avian.test.vm");
+    if (vm == null) {
+      // we need to start more VMs to test the profile, which only the
+      // test script tells us how to do
+      return;
+    }
+
+    File profile = File.createTempFile("jit", ".profile");
+    try {
+      expect(run(vm, profile, "record").equals("91 21"));
+
+      if (profile.length() == 0) {
+        // the interpreter doesn't record a profile
+        return;
+      }
+
+      expect(contains(profile, WorkerEntry));
+      expect(contains(profile, LazyEntry));
+
+      expect(run(vm, profile, "replay").equals("91 21"));
+    } finally {
+      profile.delete();
+    }
+  }
+}
@@ -0,0 +1,55 @@
+public class LargeHeap {
+  private static final long FourGigabytes = 4L * 1024 * 1024 * 1024;
+
+  private static final int ChunkSizeInLongs = 16 * 1024 * 1024;
+
+  private static final long ChunkSizeInBytes = ChunkSizeInLongs * 8L;
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static long used(Runtime runtime) {
+    return runtime.totalMemory() - runtime.freeMemory();
+  }
+
+  public static void main(String[] args) {
+    Runtime runtime = Runtime.getRuntime();
+    long max = runtime.maxMemory();
+
+    expect(max > 0);
+    expect(runtime.freeMemory() <= runtime.totalMemory());
+
+    // the rest only runs when the tests are run with a heap limit
+    // comfortably larger than 4GB (e.g. make test-heap-limit=8g test)
+    if (max < FourGigabytes + (FourGigabytes / 2)) {
+      return;
+    }
+
+    // allocate and hold on to slightly more than 4GB, so that the
+    // heap's footprint accounting must cross the 32-bit boundary
+    int count = (int) ((FourGigabytes / ChunkSizeInBytes) + 2);
+    long[][] chunks = new long[count][];
+    for (int i = 0; i < count; ++i) {
+      chunks[i] = new long[ChunkSizeInLongs];
+      chunks[i][0] = i;
+      chunks[i][ChunkSizeInLongs - 1] = -i;
+    }
+
+    expect(used(runtime) > FourGigabytes);
+
+    System.gc();
+
+    for (int i = 0; i < count; ++i) {
+      expect(chunks[i][0] == i);
+      expect(chunks[i][ChunkSizeInLongs - 1] == -i);
+    }
+
+    expect(used(runtime) > FourGigabytes);
+
+    chunks = null;
+    System.gc();
+
+    expect(used(runtime) < FourGigabytes);
+  }
+}
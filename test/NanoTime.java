@@ -0,0 +1,54 @@
+public class NanoTime {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static boolean throwsIllegalArgument(Object lock, long milliseconds,
+                                               int nanoseconds)
+    throws InterruptedException
+  {
+    try {
+      synchronized (lock) {
+        lock.wait(milliseconds, nanoseconds);
+      }
+      return false;
+    } catch (IllegalArgumentException e) {
+      return true;
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    long last = System.nanoTime();
+    for (int i = 0; i < 100000; ++i) {
+      long now = System.nanoTime();
+      expect(now >= last);
+      last = now;
+    }
+
+    // timed waits and sleeps shorter than a millisecond must return
+    // without waiting forever, and must not return early
+    Object lock = new Object();
+    long start = System.nanoTime();
+    for (int i = 0; i < 100; ++i) {
+      synchronized (lock) {
+        lock.wait(0, 1000);
+      }
+      Thread.sleep(0, 1000);
+    }
+    expect(System.nanoTime() - start >= 100 * 2 * 1000);
+
+    start = System.nanoTime();
+    Thread.sleep(20);
+    expect(System.nanoTime() - start >= 20L * 1000 * 1000);
+
+    start = System.nanoTime();
+    synchronized (lock) {
+      lock.wait(20, 500000);
+    }
+    expect(System.nanoTime() - start >= 20500L * 1000);
+
+    expect(throwsIllegalArgument(lock, -1, 0));
+    expect(throwsIllegalArgument(lock, 0, -1));
+    expect(throwsIllegalArgument(lock, 0, 1000000));
+  }
+}
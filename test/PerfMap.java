@@ -0,0 +1,117 @@
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileReader;
+import java.io.InputStream;
+
+public class PerfMap {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  // the class below is run in a separate VM
+  public static class Child {
+    public static void main(String[] args) throws Exception {
+      // the first field of /proc/self/stat is our process ID, which
+      // names the files the VM writes
+      InputStream in = new FileInputStream("/proc/self/stat");
+      StringBuilder sb = new StringBuilder();
+      try {
+        int c;
+        while ((c = in.read()) != -1 && c != ' ') {
+          sb.append((char) c);
+        }
+      } finally {
+        in.close();
+      }
+      System.out.println(sb.toString());
+    }
+  }
+
+  private static String run(String vm, String mode) throws Exception {
+    Process p = Runtime.getRuntime().exec
+      (new String[] { vm, "-Davian.jit.perf=" + mode,
+                      "-cp", System.getProperty("java.class.path"),
+                      "PerfMap$Child" });
+
+    InputStream in = p.getInputStream();
+    StringBuilder sb = new StringBuilder();
+    int c;
+    while ((c = in.read()) != -1) {
+      sb.append((char) c);
+    }
+    expect(p.waitFor() == 0);
+    return sb.toString().trim();
+  }
+
+  private static File map(String pid) {
+    return new File("/tmp/perf-" + pid + ".map");
+  }
+
+  private static File dump(String pid) {
+    return new File("/tmp/jit-" + pid + ".dump");
+  }
+
+  private static void checkMap(File map) throws Exception {
+    boolean found = false;
+    BufferedReader in = new BufferedReader(new FileReader(map));
+    try {
+      String line;
+      while ((line = in.readLine()) != null) {
+        // each line is a hex address, a hex size and a name
+        int first = line.indexOf(' ');
+        int second = line.indexOf(' ', first + 1);
+        expect(first > 0 && second > first + 1);
+        Long.parseLong(line.substring(0, first), 16);
+        expect(Integer.parseInt(line.substring(first + 1, second), 16) > 0);
+        if (line.substring(second + 1).startsWith("PerfMap$Child.main(")) {
+          found = true;
+        }
+      }
+    } finally {
+      in.close();
+    }
+    expect(found);
+  }
+
+  public static void main(String[] args) throws Exception {
+    String vm = System.getProperty("avian.test.vm");
+    if (vm == null || ! new File("/proc/self/stat").exists()) {
+      // we need to start more VMs to test the map, which only the test
+      // script tells us how to do, and perf maps are Linux-only
+      return;
+    }
+
+    String pid = run(vm, "map");
+    try {
+      if (! map(pid).exists()) {
+        // the interpreter doesn't write a map
+        return;
+      }
+      checkMap(map(pid));
+      expect(! dump(pid).exists());
+    } finally {
+      map(pid).delete();
+    }
+
+    pid = run(vm, "true");
+    try {
+      checkMap(map(pid));
+      expect(dump(pid).exists());
+    } finally {
+      map(pid).delete();
+      dump(pid).delete();
+    }
+
+    String[] off = { "false", "jitdump" };
+    for (int i = 0; i < off.length; ++i) {
+      pid = run(vm, off[i]);
+      try {
+        expect(! map(pid).exists());
+      } finally {
+        map(pid).delete();
+        dump(pid).delete();
+      }
+    }
+  }
+}
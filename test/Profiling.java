@@ -0,0 +1,90 @@
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+
+public class Profiling {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static volatile int sink;
+
+  private static void spin(long milliseconds) {
+    long end = System.currentTimeMillis() + milliseconds;
+    int n = 0;
+    while (System.currentTimeMillis() < end) {
+      for (int i = 0; i < 1000; ++i) {
+        n += i * 31;
+      }
+    }
+    sink = n;
+  }
+
+  private static boolean sleeping;
+
+  private static void sleep(Object lock) throws InterruptedException {
+    synchronized (lock) {
+      sleeping = true;
+      lock.notifyAll();
+      lock.wait();
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    File file = File.createTempFile("profile", ".txt");
+
+    // a waiting thread isn't using the CPU, so it must not be sampled
+    final Object lock = new Object();
+    Thread sleeper = new Thread() {
+        public void run() {
+          try {
+            Profiling.sleep(lock);
+          } catch (InterruptedException e) { }
+        }
+      };
+    sleeper.start();
+
+    // the sleeper only releases the lock by waiting on it
+    synchronized (lock) {
+      while (! sleeping) {
+        lock.wait();
+      }
+    }
+
+    avian.Machine.startProfiler(1, null);
+    try {
+      spin(200);
+      avian.Machine.dumpProfile(file.getPath());
+    } finally {
+      avian.Machine.stopProfiler();
+      sleeper.interrupt();
+      sleeper.join();
+    }
+
+    if (file.length() == 0) {
+      // the interpreter doesn't sample stacks
+      file.delete();
+      return;
+    }
+
+    boolean found = false;
+    BufferedReader in = new BufferedReader(new FileReader(file));
+    try {
+      String line;
+      while ((line = in.readLine()) != null) {
+        int space = line.lastIndexOf(' ');
+        expect(space > 0);
+        expect(Integer.parseInt(line.substring(space + 1)) > 0);
+        if (line.indexOf("Profiling.spin") >= 0) {
+          found = true;
+        }
+        expect(line.indexOf("Profiling.sleep") < 0);
+      }
+    } finally {
+      in.close();
+      file.delete();
+    }
+
+    expect(found);
+  }
+}
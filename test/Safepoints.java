@@ -0,0 +1,83 @@
+import avian.Machine;
+import avian.SafepointStatistics;
+
+public class Safepoints {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static volatile boolean done;
+  private static volatile int started;
+
+  // neither of these loops allocates or calls anything, so a collector
+  // can only stop them by way of their back-edge polls
+
+  private static int spinWhile(int[] array) {
+    int sum = 0;
+    int i = 0;
+    while (! done) {
+      sum += array[i];
+      i = (i + 1) & (array.length - 1);
+    }
+    return sum;
+  }
+
+  private static long spinForever(long[] array) {
+    long sum = 0;
+    for (int i = 0;; ++i) {
+      if (done) break;
+      sum += array[i & (array.length - 1)];
+    }
+    return sum;
+  }
+
+  public static void main(String[] args) throws Exception {
+    final int[] ints = new int[1024];
+    final long[] longs = new long[1024];
+    for (int i = 0; i < ints.length; ++i) {
+      ints[i] = i;
+      longs[i] = i;
+    }
+
+    Thread a = new Thread() {
+        public void run() {
+          synchronized (Safepoints.class) {
+            ++ started;
+          }
+          spinWhile(ints);
+        }
+      };
+
+    Thread b = new Thread() {
+        public void run() {
+          synchronized (Safepoints.class) {
+            ++ started;
+          }
+          spinForever(longs);
+        }
+      };
+
+    a.start();
+    b.start();
+
+    while (started < 2) {
+      Thread.sleep(1);
+    }
+
+    SafepointStatistics before = Machine.getSafepointStatistics();
+
+    // this would wait forever for the spinning threads without polls
+    System.gc();
+    System.gc();
+
+    SafepointStatistics after = Machine.getSafepointStatistics();
+
+    done = true;
+    a.join();
+    b.join();
+
+    expect(after.count >= before.count + 2);
+    expect(after.totalTime >= before.totalTime);
+    expect(after.maxTime >= after.lastTime);
+  }
+}
@@ -140,6 +140,49 @@ public class Strings {
     testDecode(false);
     testDecode(true);
 
+    { // literals are usually backed by bytes and these by chars, so
+      // this compares each representation with the other
+      String bytes = "the quick brown fox jumps over the lazy dog, twice";
+      String chars = new String(bytes.toCharArray());
+      String longer = new String((bytes + "!").toCharArray());
+
+      expect(bytes.equals(chars));
+      expect(chars.equals(bytes));
+      expect(! chars.equals(longer));
+      expect(! chars.equals(null));
+      expect(! chars.equals(new Object()));
+
+      expect(bytes.compareTo(chars) == 0);
+      expect(chars.compareTo(longer) < 0);
+      expect(longer.compareTo(chars) > 0);
+      expect(chars.compareTo(bytes.replace('z', 'y')) > 0);
+      expect("abc".compareTo("abd") == -1);
+
+      expect(bytes.hashCode() == chars.hashCode());
+      int h = 0;
+      for (int i = 0; i < chars.length(); ++i) h = (h * 31) + chars.charAt(i);
+      expect(chars.hashCode() == h);
+
+      expect(bytes.indexOf('d') == chars.indexOf('d'));
+      expect(chars.indexOf('d') == 40);
+      expect(chars.indexOf('t', 1) == 31);
+      expect(chars.indexOf('t', -5) == 0);
+      expect(chars.indexOf('t', 1000) == -1);
+      expect(chars.indexOf('#') == -1);
+      expect(bytes.indexOf(0x100 + 'd') == -1);
+
+      String supplementary = "x" + new String(Character.toChars(0x1F600));
+      expect(supplementary.indexOf(0x1F600) == 1);
+
+      boolean threw = false;
+      try {
+        chars.compareTo(null);
+      } catch (NullPointerException e) {
+        threw = true;
+      }
+      expect(threw);
+    }
+
     expect
       (java.text.MessageFormat.format
        ("{0} enjoy {1} {2}.  do {4}?  {4} do?",
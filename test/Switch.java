@@ -43,6 +43,65 @@ public class Switch {
     }
   }
 
+  // sparse enough for javac to use a lookupswitch, but dense enough
+  // for a jump table
+  private static int denseLookup(int k) {
+    switch (k) {
+    case 0:
+      return 10;
+    case 4:
+      return 14;
+    case 8:
+      return 18;
+    case 12:
+      return 22;
+    case 19:
+      return 29;
+    default:
+      return -1;
+    }
+  }
+
+  private static int extremeLookup(int k) {
+    switch (k) {
+    case Integer.MIN_VALUE:
+      return 1;
+    case 0:
+      return 2;
+    case Integer.MAX_VALUE:
+      return 3;
+    default:
+      return 4;
+    }
+  }
+
+  private static int sparseLookup(int k) {
+    switch (k) {
+    case -1000000:
+      return 1;
+    case -1000:
+      return 2;
+    case 1:
+      return 3;
+    case 100:
+      return 4;
+    case 1000:
+      return 5;
+    case 10000:
+      return 6;
+    case 100000:
+      return 7;
+    case 1000000:
+      return 8;
+    case 10000000:
+      return 9;
+    case 100000000:
+      return 10;
+    default:
+      return 0;
+    }
+  }
+
   private static void expect(boolean v) {
     if (! v) throw new RuntimeException();
   }
@@ -62,5 +121,28 @@ public class Switch {
     expect(lookup(47) == -47);
     expect(lookup(245) == 245);
     expect(lookup(246) == 91);
+
+    expect(denseLookup(0) == 10);
+    expect(denseLookup(4) == 14);
+    expect(denseLookup(8) == 18);
+    expect(denseLookup(12) == 22);
+    expect(denseLookup(19) == 29);
+    expect(denseLookup(1) == -1);
+    expect(denseLookup(18) == -1);
+    expect(denseLookup(-1) == -1);
+    expect(denseLookup(20) == -1);
+    expect(denseLookup(Integer.MIN_VALUE) == -1);
+
+    expect(extremeLookup(Integer.MIN_VALUE) == 1);
+    expect(extremeLookup(0) == 2);
+    expect(extremeLookup(Integer.MAX_VALUE) == 3);
+    expect(extremeLookup(Integer.MIN_VALUE + 1) == 4);
+    expect(extremeLookup(-1) == 4);
+
+    expect(sparseLookup(-1000000) == 1);
+    expect(sparseLookup(1) == 3);
+    expect(sparseLookup(100000000) == 10);
+    expect(sparseLookup(0) == 0);
+    expect(sparseLookup(99) == 0);
   }
 }
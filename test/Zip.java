@@ -3,8 +3,51 @@ import java.io.File;
 import java.util.Enumeration;
 import java.util.zip.ZipFile;
 import java.util.zip.ZipEntry;
+import java.util.zip.Deflater;
+import java.util.zip.Inflater;
 
 public class Zip {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  // compresses into and inflates out of the middle of larger arrays
+  // to check that the natives respect offsets
+  private static void roundTrip() throws Exception {
+    byte[] data = new byte[100000];
+    for (int i = 0; i < data.length; ++i) {
+      data[i] = (byte) (i % 251);
+    }
+
+    Deflater deflater = new Deflater();
+    deflater.setInput(data, 7, data.length - 7);
+    deflater.finish();
+
+    byte[] compressed = new byte[data.length];
+    int compressedLength = 3;
+    while (! deflater.finished()) {
+      compressedLength += deflater.deflate
+        (compressed, compressedLength,
+         Math.min(1024, compressed.length - compressedLength));
+    }
+    deflater.dispose();
+
+    Inflater inflater = new Inflater();
+    inflater.setInput(compressed, 3, compressedLength - 3);
+
+    byte[] result = new byte[data.length + 5];
+    int resultLength = 5;
+    while (! inflater.finished()) {
+      resultLength += inflater.inflate
+        (result, resultLength, Math.min(1000, result.length - resultLength));
+    }
+    inflater.dispose();
+
+    expect(resultLength == data.length - 2);
+    for (int i = 7; i < data.length; ++i) {
+      expect(result[i - 2] == data[i]);
+    }
+  }
 
   private static String findJar(File directory) {
     for (File file: directory.listFiles()) {
@@ -26,6 +69,8 @@ public class Zip {
   }
   
   public static void main(String[] args) throws Exception {
+    roundTrip();
+
     ZipFile file = new ZipFile
       (findJar(new File(System.getProperty("user.dir"))));
 
@@ -41,6 +86,7 @@ public class Zip {
           int c; while ((c = in.read(buffer)) != -1) size += c;
           System.out.println
             (entry.getName() + " " + entry.getCompressedSize() + " " + size);
+          expect(size == entry.getSize());
         } finally {
           in.close();
         }
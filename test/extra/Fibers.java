@@ -0,0 +1,150 @@
+package extra;
+
+import avian.Fiber;
+import avian.FiberScheduler;
+
+public class Fibers {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Counter {
+    private int value;
+
+    public synchronized void increment() {
+      ++ value;
+    }
+
+    public synchronized int get() {
+      return value;
+    }
+  }
+
+  // a chain of fibers, each of which waits for its predecessor to
+  // hand it a token before passing it on
+  private static void relay(FiberScheduler scheduler, int length)
+    throws Exception
+  {
+    final int[] tokens = new int[length + 1];
+    final Fiber[] fibers = new Fiber[length];
+    final Object lock = new Object();
+
+    for (int i = length - 1; i >= 0; --i) {
+      final int index = i;
+      fibers[i] = scheduler.spawn(new Runnable() {
+        public void run() {
+          while (true) {
+            synchronized (lock) {
+              if (tokens[index] != 0) break;
+            }
+            Fiber.park();
+          }
+
+          synchronized (lock) {
+            tokens[index + 1] = tokens[index] + 1;
+          }
+
+          if (index + 1 < fibers.length) {
+            fibers[index + 1].unpark();
+          }
+        }
+      });
+    }
+
+    synchronized (lock) {
+      tokens[0] = 1;
+    }
+    fibers[0].unpark();
+
+    fibers[length - 1].join();
+
+    synchronized (lock) {
+      expect(tokens[length] == length + 1);
+    }
+  }
+
+  private static void yielding(FiberScheduler scheduler, int count)
+    throws Exception
+  {
+    final Counter counter = new Counter();
+    Fiber[] fibers = new Fiber[count];
+
+    for (int i = 0; i < count; ++i) {
+      fibers[i] = scheduler.spawn(new Runnable() {
+        public void run() {
+          for (int j = 0; j < 10; ++j) {
+            counter.increment();
+            Fiber.yield();
+          }
+        }
+      });
+    }
+
+    for (int i = 0; i < count; ++i) {
+      fibers[i].join();
+      expect(fibers[i].exception() == null);
+    }
+
+    expect(counter.get() == count * 10);
+  }
+
+  private static void sleeping(FiberScheduler scheduler, int count)
+    throws Exception
+  {
+    final Counter counter = new Counter();
+    Fiber[] fibers = new Fiber[count];
+
+    long start = System.currentTimeMillis();
+    for (int i = 0; i < count; ++i) {
+      fibers[i] = scheduler.spawn(new Runnable() {
+        public void run() {
+          Fiber.sleep(50);
+          counter.increment();
+        }
+      });
+    }
+
+    for (int i = 0; i < count; ++i) {
+      fibers[i].join();
+    }
+
+    expect(counter.get() == count);
+    expect(System.currentTimeMillis() - start >= 50);
+  }
+
+  private static void joining(FiberScheduler scheduler) throws Exception {
+    final Fiber child = scheduler.spawn(new Runnable() {
+      public void run() {
+        Fiber.sleep(10);
+        throw new IllegalStateException();
+      }
+    });
+
+    Fiber parent = scheduler.spawn(new Runnable() {
+      public void run() {
+        try {
+          child.join();
+        } catch (InterruptedException e) {
+          throw new RuntimeException(e);
+        }
+        expect(child.exception() instanceof IllegalStateException);
+      }
+    });
+
+    parent.join();
+    expect(parent.exception() == null);
+  }
+
+  public static void main(String[] args) throws Exception {
+    FiberScheduler scheduler = new FiberScheduler(4);
+
+    relay(scheduler, 1000);
+    yielding(scheduler, 100);
+    // many more sleepers than carriers, so they can't be blocking them
+    sleeping(scheduler, 1000);
+    joining(scheduler);
+
+    scheduler.shutdown();
+    scheduler.awaitTermination();
+  }
+}
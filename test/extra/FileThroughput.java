@@ -0,0 +1,110 @@
+package extra;
+
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+
+/**
+ * Measures bulk file I/O throughput through FileOutputStream,
+ * FileInputStream and RandomAccessFile for a range of buffer sizes,
+ * printing MB/s for each.  Run it against builds before and after a
+ * change to the file natives to compare.
+ *
+ * usage: extra.FileThroughput [file [megabytes]]
+ */
+public class FileThroughput {
+  private static final int[] BufferSizes
+    = { 512, 4 * 1024, 64 * 1024, 1024 * 1024 };
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static void report(String what, int bufferSize, long bytes,
+                             long start)
+  {
+    long elapsed = Math.max(1, System.currentTimeMillis() - start);
+    System.out.println
+      (what + " " + bufferSize + " byte buffer: "
+       + ((bytes * 1000) / (elapsed * 1024 * 1024)) + " MB/s");
+  }
+
+  private static void write(File file, int bufferSize, long total)
+    throws IOException
+  {
+    byte[] buffer = new byte[bufferSize];
+    for (int i = 0; i < bufferSize; ++i) {
+      buffer[i] = (byte) i;
+    }
+
+    long start = System.currentTimeMillis();
+    FileOutputStream out = new FileOutputStream(file);
+    try {
+      for (long n = 0; n < total; n += bufferSize) {
+        out.write(buffer, 0, bufferSize);
+      }
+    } finally {
+      out.close();
+    }
+    report("FileOutputStream.write", bufferSize, total, start);
+  }
+
+  private static void read(File file, int bufferSize, long total)
+    throws IOException
+  {
+    byte[] buffer = new byte[bufferSize];
+
+    long start = System.currentTimeMillis();
+    long count = 0;
+    FileInputStream in = new FileInputStream(file);
+    try {
+      int c;
+      while ((c = in.read(buffer, 0, bufferSize)) > 0) {
+        count += c;
+      }
+    } finally {
+      in.close();
+    }
+    expect(count == total);
+    report("FileInputStream.read", bufferSize, total, start);
+  }
+
+  private static void readRandom(File file, int bufferSize, long total)
+    throws IOException
+  {
+    byte[] buffer = new byte[bufferSize];
+
+    long start = System.currentTimeMillis();
+    long count = 0;
+    RandomAccessFile in = new RandomAccessFile(file.getPath(), "r");
+    try {
+      // RandomAccessFile.read throws EOFException rather than
+      // returning -1 when asked to read past the end
+      while (count < total) {
+        count += in.read(buffer, 0, bufferSize);
+      }
+    } finally {
+      in.close();
+    }
+    expect(count == total);
+    report("RandomAccessFile.read", bufferSize, total, start);
+  }
+
+  public static void main(String[] args) throws IOException {
+    File file = new File(args.length > 0 ? args[0] : "file-throughput.tmp");
+    long total = (args.length > 1 ? Integer.parseInt(args[1]) : 64)
+      * 1024L * 1024L;
+
+    try {
+      for (int bufferSize: BufferSizes) {
+        write(file, bufferSize, total);
+        read(file, bufferSize, total);
+        readRandom(file, bufferSize, total);
+      }
+    } finally {
+      file.delete();
+    }
+  }
+}
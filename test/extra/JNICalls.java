@@ -0,0 +1,74 @@
+package extra;
+
+/**
+ * Measures the per-call overhead of JNI methods with a few common
+ * signatures, printing nanoseconds per call for each.  The natives are
+ * trivial (see test/jni.cpp), so nearly all the time is spent in the
+ * VM's transition to and from native code.
+ *
+ * usage: extra.JNICalls [iterations]
+ */
+public class JNICalls {
+  static {
+    System.loadLibrary("test");
+  }
+
+  private static native void noArguments();
+
+  private static native int intArguments(int a, int b, int c);
+
+  private native Object objectArguments(Object a, Object b);
+
+  private static native double doubleArguments(double a, double b);
+
+  private static void report(String what, int iterations, long start) {
+    long elapsed = System.currentTimeMillis() - start;
+    System.out.println
+      (what + ": " + ((elapsed * 1000 * 1000) / iterations) + " ns/call");
+  }
+
+  public static void main(String[] args) {
+    int iterations = args.length > 0 ? Integer.parseInt(args[0]) : 10000000;
+    JNICalls instance = new JNICalls();
+    Object o = new Object();
+
+    // warm up, so that compilation is not included in the results
+    for (int i = 0; i < 10000; ++i) {
+      noArguments();
+      intArguments(i, i, i);
+      instance.objectArguments(o, null);
+      doubleArguments(i, i);
+    }
+
+    long start = System.currentTimeMillis();
+    for (int i = 0; i < iterations; ++i) {
+      noArguments();
+    }
+    report("()V", iterations, start);
+
+    start = System.currentTimeMillis();
+    int sum = 0;
+    for (int i = 0; i < iterations; ++i) {
+      sum += intArguments(i, 1, 2);
+    }
+    report("(III)I", iterations, start);
+
+    start = System.currentTimeMillis();
+    for (int i = 0; i < iterations; ++i) {
+      o = instance.objectArguments(o, null);
+    }
+    report("(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;",
+           iterations, start);
+
+    start = System.currentTimeMillis();
+    double d = 0;
+    for (int i = 0; i < iterations; ++i) {
+      d = doubleArguments(d, 1);
+    }
+    report("(DD)D", iterations, start);
+
+    if (sum == 42 && d == 42) {
+      System.out.println("unlikely");
+    }
+  }
+}
@@ -107,6 +107,86 @@ Java_JNI_testLocalRef(JNIEnv* e, jclass, jobject o)
   return e->NewLocalRef(o);
 }
 
+extern "C" JNIEXPORT jint JNICALL
+Java_JNI_addInts(JNIEnv*, jclass, jint a1, jint a2, jint a3, jint a4, jint a5,
+                 jint a6)
+{
+  return a1 + a2 + a3 + a4 + a5 + a6;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_JNI_addManyInts(JNIEnv*, jclass, jint a1, jint a2, jint a3, jint a4,
+                     jint a5, jint a6, jint a7)
+{
+  return a1 + a2 + a3 + a4 + a5 + a6 + a7;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_JNI_widen(JNIEnv*, jclass, jbyte b, jshort s, jchar c, jboolean z)
+{
+  return b + s + c + (z ? 1 : 0);
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_JNI_pick(JNIEnv*, jclass, jint index, jobject a, jobject b, jobject c)
+{
+  switch (index) {
+  case 0: return a;
+  case 1: return b;
+  default: return c;
+  }
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_JNI_isSame(JNIEnv* e, jobject this_, jobject o)
+{
+  return e->IsSameObject(this_, o);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_JNI_collectWhileCritical(JNIEnv* e, jclass c, jbyteArray array)
+{
+  jboolean isCopy;
+  jbyte* before = static_cast<jbyte*>
+    (e->GetPrimitiveArrayCritical(array, &isCopy));
+
+  // strictly speaking, we shouldn't call back into Java here, but it
+  // is the easiest way to force a collection while the array is held
+  e->CallStaticVoidMethod(c, e->GetStaticMethodID(c, "collect", "()V"));
+
+  jbyte* after = static_cast<jbyte*>
+    (e->GetPrimitiveArrayCritical(array, 0));
+
+  before[0] = 42;
+
+  e->ReleasePrimitiveArrayCritical(array, after, 0);
+  e->ReleasePrimitiveArrayCritical(array, before, 0);
+
+  return before == after and not isCopy;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_extra_JNICalls_noArguments(JNIEnv*, jclass)
+{ }
+
+extern "C" JNIEXPORT jint JNICALL
+Java_extra_JNICalls_intArguments(JNIEnv*, jclass, jint a, jint b, jint c)
+{
+  return a + b + c;
+}
+
+extern "C" JNIEXPORT jobject JNICALL
+Java_extra_JNICalls_objectArguments(JNIEnv*, jobject, jobject a, jobject)
+{
+  return a;
+}
+
+extern "C" JNIEXPORT jdouble JNICALL
+Java_extra_JNICalls_doubleArguments(JNIEnv*, jclass, jdouble a, jdouble b)
+{
+  return a + b;
+}
+
 extern "C" JNIEXPORT jobject JNICALL
 Java_Buffers_allocateNative(JNIEnv* e, jclass, jint capacity)
 {
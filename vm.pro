@@ -106,6 +106,14 @@
    *** rewind(...);
  }
 
+# the VM calls these by name when the avian.profile or avian.jit.profile
+# properties are set:
+
+-keepclassmembers class avian.Machine {
+   private static void startProfiler();
+   private static void startPrecompiler();
+ }
+
 -keepclassmembernames class avian.CallbackReceiver {
    *** receive(...);
  }